@@ -0,0 +1,167 @@
+#include "bench_common.h"
+#include "matrix.h"
+#include "batched.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/*
+    Batched small matrices against one Matrix_Numerical per matrix
+    Arguments: { n (square matrices), count (matrices per batch), threads }
+*/
+namespace
+{
+    template <typename T>
+    xi_matrix::MatrixBatch<T> filled_batch(size_t count, size_t n, double seed)
+    {
+        xi_matrix::MatrixBatch<T> batch(count, n, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                T* p = batch.plane(i, j);
+                const double offset = i == j ? static_cast<double>(n) : 0.0;
+                for (size_t k = 0; k < count; ++k)
+                {
+                    p[k] = static_cast<T>(offset + std::sin(seed + 0.37 * static_cast<double>((i * n + j) * count + k)));
+                }
+            }
+        }
+        return batch;
+    }
+
+    template <typename T>
+    std::vector<xi_matrix::Matrix_Numerical<T>> unbatched(const xi_matrix::MatrixBatch<T>& batch)
+    {
+        std::vector<xi_matrix::Matrix_Numerical<T>> out;
+        out.reserve(batch.count());
+        for (size_t k = 0; k < batch.count(); ++k)
+        {
+            out.push_back(batch.get(k));
+        }
+        return out;
+    }
+
+    template <typename T>
+    void BM_BatchedMultiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const size_t count = static_cast<size_t>(state.range(1));
+        xi_bench::use_threads(state, state.range(2));
+
+        auto a = filled_batch<T>(count, n, 1.0);
+        auto b = filled_batch<T>(count, n, 2.0);
+        xi_matrix::MatrixBatch<T> c(count, n, n);
+
+        for (auto _ : state)
+        {
+            xi_matrix::multiply(a, b, c);
+            benchmark::DoNotOptimize(c.data());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd * static_cast<double>(count));
+        xi_bench::report_bytes(state, 3.0 * nd * nd * sizeof(T) * static_cast<double>(count));
+    }
+
+    template <typename T>
+    void BM_LoopMultiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const size_t count = static_cast<size_t>(state.range(1));
+        xi_bench::use_threads(state, state.range(2));
+
+        auto a = unbatched(filled_batch<T>(count, n, 1.0));
+        auto b = unbatched(filled_batch<T>(count, n, 2.0));
+
+        for (auto _ : state)
+        {
+            for (size_t k = 0; k < count; ++k)
+            {
+                auto c = a[k] * b[k];
+                benchmark::DoNotOptimize(c.data());
+            }
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd * static_cast<double>(count));
+    }
+
+    template <typename T>
+    void BM_BatchedDet(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const size_t count = static_cast<size_t>(state.range(1));
+        xi_bench::use_threads(state, state.range(2));
+
+        auto a = filled_batch<T>(count, n, 3.0);
+
+        for (auto _ : state)
+        {
+            auto d = xi_matrix::det(a);
+            benchmark::DoNotOptimize(d.data());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd / 3.0 * static_cast<double>(count));
+    }
+
+    template <typename T>
+    void BM_LoopDet(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const size_t count = static_cast<size_t>(state.range(1));
+        xi_bench::use_threads(state, state.range(2));
+
+        auto a = unbatched(filled_batch<T>(count, n, 3.0));
+
+        for (auto _ : state)
+        {
+            for (size_t k = 0; k < count; ++k)
+            {
+                benchmark::DoNotOptimize(a[k].det());
+            }
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd / 3.0 * static_cast<double>(count));
+    }
+
+    template <typename T>
+    void BM_BatchedInverse(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const size_t count = static_cast<size_t>(state.range(1));
+        xi_bench::use_threads(state, state.range(2));
+
+        auto a = filled_batch<T>(count, n, 4.0);
+        xi_matrix::MatrixBatch<T> inv(count, n, n);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_matrix::inverse(a, inv));
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd * static_cast<double>(count));
+    }
+
+    void batch_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "n", "count", "threads" })
+         ->ArgsProduct({ { 2, 3, 4, 8 }, { 1 << 16 }, xi_bench::thread_counts() })
+         ->UseRealTime()
+         ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_BatchedMultiply, float)->Apply(batch_args);
+BENCHMARK_TEMPLATE(BM_BatchedMultiply, double)->Apply(batch_args);
+BENCHMARK_TEMPLATE(BM_LoopMultiply, double)->Apply(batch_args);
+
+BENCHMARK_TEMPLATE(BM_BatchedDet, float)->Apply(batch_args);
+BENCHMARK_TEMPLATE(BM_BatchedDet, double)->Apply(batch_args);
+BENCHMARK_TEMPLATE(BM_LoopDet, double)->Apply(batch_args);
+
+BENCHMARK_TEMPLATE(BM_BatchedInverse, double)->Apply(batch_args);
@@ -0,0 +1,414 @@
+#include "bench_common.h"
+#include "derivative.h"
+#include "integral.h"
+#include "quadrature.h"
+#include "ode.h"
+#include "roots.h"
+#include "optimize.h"
+#include "chebyshev.h"
+#include "memo.h"
+#include "spline.h"
+#include "fft.h"
+
+#include <cmath>
+
+/*
+    xi_integral::definite_integral, the quadrature rules, xi_derivative::definite_derivative,
+    the xi_ode solvers, the root finders / minimizers, the Chebyshev proxies, the
+    memoization cache, the splines and the FFT
+    Arguments: { subintervals (integral only), threads }, { order } for Gauss-Legendre,
+    { trajectories, threads } for the ODE batches, { uniform, threads } for the splines,
+    { n } for the transforms and convolutions
+*/
+namespace
+{
+    double cheap(double x) { return x * x; }
+
+    double expensive(double x) { return std::sin(x) * std::exp(-0.5 * x) + std::log1p(x * x); }
+
+    template <double (*F)(double)>
+    void BM_DefiniteIntegral(benchmark::State& state)
+    {
+        const int n = static_cast<int>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_integral::definite_integral(F, 0.0, 2.0, n));
+        }
+
+        state.counters["evals"] = benchmark::Counter(
+            static_cast<double>(n + 1), benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    template <double (*F)(double)>
+    void BM_DefiniteDerivative(benchmark::State& state)
+    {
+        double x = 0.75;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_derivative::definite_derivative(F, x));
+            x += 1e-9;
+        }
+
+        // Two five-point stencils per call
+        state.counters["evals"] = benchmark::Counter(6.0, benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    template <double (*F)(double)>
+    void BM_GaussLegendre(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_integral::legendre_rule(n);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_integral::gauss_legendre(F, 0.0, 2.0, n));
+        }
+
+        state.counters["evals"] = benchmark::Counter(static_cast<double>(n), benchmark::Counter::kIsIterationInvariantRate);
+    }
+
+    double singular(double x) { return std::log(x) / std::sqrt(x); }
+
+    void BM_TanhSinhSingular(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_integral::tanh_sinh(singular, 0.0, 1.0));
+        }
+    }
+
+    /*
+        First [ components ] moments of e^-x on [ 0, 10 ], one vector pass
+    */
+    void BM_MomentsVector(benchmark::State& state)
+    {
+        const size_t components = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto moments = [components](long double x, long double* out) {
+            long double p = std::exp(-x);
+            for (size_t k = 0; k < components; ++k, p *= x)
+            {
+                out[k] = p;
+            }
+        };
+
+        for (auto _ : state)
+        {
+            auto values = xi_integral::definite_integral_vector(moments, components, 0.0, 10.0, 100'000);
+            benchmark::DoNotOptimize(values.data());
+        }
+    }
+
+    /*
+        Van der Pol oscillators (mu = 1) from [ trajectories ] starting points over [ 0, 20 ],
+        dopri5_batch against one dopri5 call per trajectory
+    */
+    std::vector<double> van_der_pol_starts(size_t count)
+    {
+        std::vector<double> y0(2 * count);
+        for (size_t l = 0; l < count; ++l)
+        {
+            y0[l] = 1.0 + 1.0 * static_cast<double>(l) / static_cast<double>(count);
+            y0[count + l] = 0.0;
+        }
+        return y0;
+    }
+
+    void BM_OdeBatch(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        const auto y0 = van_der_pol_starts(count);
+
+        auto f = [](double, const double* y, double* dydt, size_t lanes) {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                const double x = y[l], v = y[lanes + l];
+                dydt[l] = v;
+                dydt[lanes + l] = (1.0 - x * x) * v - x;
+            }
+        };
+
+        for (auto _ : state)
+        {
+            auto solution = xi_ode::dopri5_batch(f, 0.0, 20.0, y0, 2);
+            benchmark::DoNotOptimize(solution.states.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    }
+
+    void BM_OdeLoop(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        const auto y0 = van_der_pol_starts(count);
+
+        auto f = [](double, const std::vector<double>& y, std::vector<double>& dydt) {
+            dydt[0] = y[1];
+            dydt[1] = (1.0 - y[0] * y[0]) * y[1] - y[0];
+        };
+
+        xi_ode::Options options;
+        options.dense = false;
+
+        for (auto _ : state)
+        {
+            for (size_t l = 0; l < count; ++l)
+            {
+                auto solution = xi_ode::dopri5(f, 0.0, 20.0, std::vector<double>{ y0[l], y0[count + l] }, options);
+                benchmark::DoNotOptimize(solution.y.data());
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    }
+
+    /*
+        Root of cos(x) - x from x0 = 1 and the minimum of the n-dimensional Rosenbrock function,
+        the evaluations counter is the number of points f was evaluated at per solve
+    */
+    void BM_NewtonRoot(benchmark::State& state)
+    {
+        size_t evaluations = 0;
+        for (auto _ : state)
+        {
+            auto result = xi_roots::newton([](long double x) { return std::cos(x) - x; }, 1.0L);
+            evaluations = result.evaluations;
+            benchmark::DoNotOptimize(result.root);
+        }
+        state.counters["evaluations"] = static_cast<double>(evaluations);
+    }
+
+    void BM_LbfgsRosenbrock(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+
+        auto rosenbrock = [](const std::vector<double>& x) {
+            double sum = 0.0;
+            for (size_t i = 0; i + 1 < x.size(); ++i)
+            {
+                const double d = x[i + 1] - x[i] * x[i];
+                sum += 100.0 * d * d + (1.0 - x[i]) * (1.0 - x[i]);
+            }
+            return sum;
+        };
+
+        size_t evaluations = 0;
+        for (auto _ : state)
+        {
+            auto result = xi_optimize::lbfgs(rosenbrock, std::vector<double>(n, -1.0));
+            evaluations = result.evaluations;
+            benchmark::DoNotOptimize(result.x.data());
+        }
+        state.counters["evaluations"] = static_cast<double>(evaluations);
+    }
+
+    /*
+        1000 integrals of the expensive function over subintervals of [ 0, 10 ]: one Chebyshev
+        proxy and its antiderivative, against definite_integral on every subinterval
+    */
+    void BM_SubintervalsChebyshev(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            xi_chebyshev::Chebyshev proxy([](long double x) { return expensive(static_cast<double>(x)); }, 0.0L, 10.0L);
+            const auto F = proxy.antiderivative();
+
+            long double sum = 0;
+            for (int i = 0; i < 1000; ++i)
+            {
+                sum += F(0.01L * (i + 1)) - F(0.01L * i);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+
+    void BM_SubintervalsDefinite(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            long double sum = 0;
+            for (int i = 0; i < 1000; ++i)
+            {
+                sum += xi_integral::definite_integral(expensive, 0.01L * i, 0.01L * (i + 1), 1000);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+
+    /*
+        Simpson on [ 0, 10 ] with n = 10'000 and again with n = 20'000 through one memoized
+        integrand, the second call hits the cache at every other node
+    */
+    void BM_MemoizedRefinement(benchmark::State& state)
+    {
+        xi_bench::use_threads(state, state.range(0));
+
+        for (auto _ : state)
+        {
+            auto g = xi_memo::memoize(expensive, 1 << 15);
+            long double coarse = xi_integral::definite_integral(g, 0.0, 10.0, 10'000);
+            long double fine = xi_integral::definite_integral(g, 0.0, 10.0, 20'000);
+            benchmark::DoNotOptimize(coarse);
+            benchmark::DoNotOptimize(fine);
+        }
+    }
+
+    /*
+        Cubic spline through 10'000 samples of sin on a uniform or jittered grid, resampled at
+        1'000'000 increasing points as one batch or one call per point
+    */
+    xi_spline::PiecewiseCubic<double> spline_of_sin(bool uniform)
+    {
+        const size_t n = 10'000;
+        std::vector<double> x(n), y(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const double jitter = uniform || i == 0 || i == n - 1 ? 0.0 : 0.3 * std::sin(7.0 * i);
+            x[i] = (i + jitter) * 1e-3;
+            y[i] = std::sin(x[i]);
+        }
+        return xi_spline::cubic_spline(x, y);
+    }
+
+    std::vector<double> spline_points()
+    {
+        std::vector<double> points(1'000'000);
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            points[i] = 9.99 * (i + 0.5 * std::sin(0.1 * i)) / points.size();
+        }
+        return points;
+    }
+
+    void BM_SplineBatch(benchmark::State& state)
+    {
+        xi_bench::use_threads(state, state.range(1));
+        const auto spline = spline_of_sin(state.range(0) != 0);
+        const std::vector<double> points = spline_points();
+        std::vector<double> values(points.size());
+
+        for (auto _ : state)
+        {
+            spline.evaluate(points.data(), values.data(), points.size());
+            benchmark::DoNotOptimize(values.data());
+        }
+        state.SetItemsProcessed(state.iterations() * points.size());
+    }
+
+    void BM_SplineScalar(benchmark::State& state)
+    {
+        const auto spline = spline_of_sin(state.range(0) != 0);
+        const std::vector<double> points = spline_points();
+
+        for (auto _ : state)
+        {
+            double sum = 0;
+            for (double x : points)
+            {
+                sum += spline(x);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(state.iterations() * points.size());
+    }
+
+    /*
+        Complex forward transform through a cached plan: powers of two, 2 / 3 / 5 smooth and
+        prime (Bluestein) lengths
+    */
+    void BM_Fft(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const auto plan = xi_fft::plan<double>(n);
+        std::vector<double> re(n), im(n);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            for (size_t k = 0; k < n; ++k)
+            {
+                re[k] = std::sin(0.1 * k);
+                im[k] = std::cos(0.3 * k);
+            }
+            state.ResumeTiming();
+
+            plan->forward(re.data(), im.data());
+            benchmark::DoNotOptimize(re.data());
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+    }
+
+    /*
+        Linear convolution of two n sample signals, FFT against the direct sum
+    */
+    std::vector<double> signal(size_t n, double frequency)
+    {
+        std::vector<double> x(n);
+        for (size_t k = 0; k < n; ++k) x[k] = std::sin(frequency * k) + 0.5 * std::cos(3.1 * frequency * k);
+        return x;
+    }
+
+    void BM_ConvolveFft(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const std::vector<double> a = signal(n, 0.01), b = signal(n, 0.07);
+
+        for (auto _ : state)
+        {
+            auto c = xi_fft::convolve(a, b);
+            benchmark::DoNotOptimize(c.data());
+        }
+    }
+
+    void BM_ConvolveDirect(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const std::vector<double> a = signal(n, 0.01), b = signal(n, 0.07);
+
+        for (auto _ : state)
+        {
+            std::vector<double> c(2 * n - 1, 0.0);
+            for (size_t j = 0; j < n; ++j)
+            {
+                for (size_t i = 0; i < n; ++i) c[i + j] += a[i] * b[j];
+            }
+            benchmark::DoNotOptimize(c.data());
+        }
+    }
+
+    void integral_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "n", "threads" })
+         ->ArgsProduct({ { 10'000, 100'000, 1'000'000 }, xi_bench::thread_counts() })
+         ->UseRealTime();
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_DefiniteIntegral, cheap)->Apply(integral_args);
+BENCHMARK_TEMPLATE(BM_DefiniteIntegral, expensive)->Apply(integral_args);
+BENCHMARK_TEMPLATE(BM_DefiniteDerivative, cheap);
+BENCHMARK_TEMPLATE(BM_DefiniteDerivative, expensive);
+BENCHMARK_TEMPLATE(BM_GaussLegendre, expensive)->ArgName("order")->Arg(8)->Arg(20)->Arg(64);
+BENCHMARK(BM_TanhSinhSingular);
+BENCHMARK(BM_MomentsVector)
+    ->ArgNames({ "components", "threads" })
+    ->ArgsProduct({ { 8, 40 }, xi_bench::thread_counts() })
+    ->UseRealTime();
+BENCHMARK(BM_OdeBatch)
+    ->ArgNames({ "trajectories", "threads" })
+    ->ArgsProduct({ { 4096 }, xi_bench::thread_counts() })
+    ->UseRealTime();
+BENCHMARK(BM_OdeLoop)->ArgNames({ "trajectories", "threads" })->Args({ 4096, 1 })->UseRealTime();
+BENCHMARK(BM_NewtonRoot);
+BENCHMARK(BM_LbfgsRosenbrock)->ArgName("n")->Arg(2)->Arg(10)->Arg(100);
+BENCHMARK(BM_SubintervalsChebyshev);
+BENCHMARK(BM_SubintervalsDefinite);
+BENCHMARK(BM_MemoizedRefinement)->ArgName("threads")->ArgsProduct({ xi_bench::thread_counts() })->UseRealTime();
+BENCHMARK(BM_SplineBatch)->ArgNames({ "uniform", "threads" })->ArgsProduct({ { 0, 1 }, xi_bench::thread_counts() })->UseRealTime();
+BENCHMARK(BM_SplineScalar)->ArgName("uniform")->Arg(0)->Arg(1);
+BENCHMARK(BM_Fft)->ArgName("n")->Arg(1 << 10)->Arg(1000)->Arg(1031)->Arg(1 << 20);
+BENCHMARK(BM_ConvolveFft)->ArgName("n")->Arg(1 << 14)->Arg(1 << 20);
+BENCHMARK(BM_ConvolveDirect)->ArgName("n")->Arg(1 << 14);
@@ -0,0 +1,65 @@
+#ifndef XI_BENCH_COMMON
+#define XI_BENCH_COMMON
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "parallel.h"
+
+/*
+    Shared helpers for the xi benchmark suite
+
+    Every benchmark reports its work through Google Benchmark counters so the console table
+    and the JSON output (--benchmark_out=file.json --benchmark_out_format=json) carry:
+        FLOPS   floating point operations per second
+        bytes_per_second  minimum memory traffic per second (SetBytesProcessed)
+        threads           size of the xi_parallel pool, the calling thread included
+*/
+namespace xi_bench
+{
+    /*
+        1, 2, 4, ... up to the number of hardware threads
+    */
+    inline std::vector<int64_t> thread_counts()
+    {
+        const int64_t max_threads = std::max<int64_t>(1, std::thread::hardware_concurrency());
+        std::vector<int64_t> counts;
+        for (int64_t t = 1; t < max_threads; t *= 2)
+        {
+            counts.push_back(t);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+    /*
+        Resizes the xi_parallel pool for the rest of the benchmark (only when the size changes)
+        and records it
+    */
+    inline void use_threads(benchmark::State& state, int64_t threads)
+    {
+        if (xi_parallel::concurrency() != static_cast<size_t>(threads))
+        {
+            xi_parallel::configure({ static_cast<size_t>(threads) });
+        }
+        state.counters["threads"] = static_cast<double>(threads);
+    }
+
+    inline void report_flops(benchmark::State& state, double flops_per_iteration)
+    {
+        state.counters["FLOPS"] = benchmark::Counter(
+            flops_per_iteration,
+            benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000
+        );
+    }
+
+    inline void report_bytes(benchmark::State& state, double bytes_per_iteration)
+    {
+        state.SetBytesProcessed(static_cast<int64_t>(bytes_per_iteration * static_cast<double>(state.iterations())));
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "bench_common.h"
+#include "matrix_io.h"
+#include "tiled.h"
+
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+/*
+    Text matrix parsing and formatting throughput
+    Arguments: { rows, threads } over a fixed 64 column matrix,
+    { n, prefetch depth } for the out-of-core tiled matrices (256 x 256 tiles, 16 tile budget)
+*/
+namespace
+{
+    constexpr size_t columns = 64;
+
+    xi_matrix::Matrix<double> filled(size_t rows, size_t cols)
+    {
+        xi_matrix::Matrix<double> m(rows, cols);
+        double* p = m.data();
+        for (size_t k = 0; k < rows * cols; ++k)
+        {
+            p[k] = 1000.0 * std::sin(0.013 * static_cast<double>(k));
+        }
+        return m;
+    }
+
+    std::string as_csv(const xi_matrix::Matrix<double>& m)
+    {
+        std::ostringstream out;
+        xi_matrix::write_text(out, m, xi_matrix::TextFormat::csv());
+        return out.str();
+    }
+
+    void BM_ParseCsv(benchmark::State& state)
+    {
+        const size_t rows = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        const std::string text = as_csv(filled(rows, columns));
+
+        for (auto _ : state)
+        {
+            auto m = xi_matrix::parse_text<double>(text, xi_matrix::TextFormat::csv());
+            benchmark::DoNotOptimize(m.data());
+        }
+
+        xi_bench::report_bytes(state, static_cast<double>(text.size()));
+    }
+
+    void BM_FormatCsv(benchmark::State& state)
+    {
+        const size_t rows = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        const auto m = filled(rows, columns);
+        const size_t bytes = as_csv(m).size();
+
+        for (auto _ : state)
+        {
+            std::ostringstream out;
+            xi_matrix::write_text(out, m, xi_matrix::TextFormat::csv());
+            benchmark::DoNotOptimize(out.tellp());
+        }
+
+        xi_bench::report_bytes(state, static_cast<double>(bytes));
+    }
+
+    xi_matrix::TiledOptions tiled_options(int64_t prefetch_depth)
+    {
+        xi_matrix::TiledOptions options;
+        options.tile_rows = 256;
+        options.tile_cols = 256;
+        options.memory_budget = 16 * 256 * 256 * sizeof(double);
+        options.prefetch_depth = static_cast<size_t>(prefetch_depth);
+        return options;
+    }
+
+    std::string scratch_path(const char* name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    void BM_TiledSum(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const auto options = tiled_options(state.range(1));
+        const std::string path = scratch_path("xi_bench_tiled_sum.xit");
+        {
+            xi_matrix::TiledMatrix<double> m(path, n, n, options);
+            m.assign(filled(n, n));
+        }
+
+        xi_matrix::TiledMatrix<double> m(path, options);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_matrix::sum(m));
+        }
+
+        xi_bench::report_bytes(state, static_cast<double>(n * n * sizeof(double)));
+        std::filesystem::remove(path);
+    }
+
+    void BM_TiledMultiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const auto options = tiled_options(state.range(1));
+        const std::string pa = scratch_path("xi_bench_tiled_a.xit");
+        const std::string pb = scratch_path("xi_bench_tiled_b.xit");
+        const std::string pc = scratch_path("xi_bench_tiled_c.xit");
+        {
+            xi_matrix::TiledMatrix<double> a(pa, n, n, options);
+            xi_matrix::TiledMatrix<double> b(pb, n, n, options);
+            a.assign(filled(n, n));
+            b.assign(filled(n, n));
+        }
+
+        {
+            xi_matrix::TiledMatrix<double> a(pa, options);
+            xi_matrix::TiledMatrix<double> b(pb, options);
+            xi_matrix::TiledMatrix<double> c(pc, n, n, options);
+            for (auto _ : state)
+            {
+                xi_matrix::multiply(a, b, c);
+            }
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd);
+        std::filesystem::remove(pa);
+        std::filesystem::remove(pb);
+        std::filesystem::remove(pc);
+    }
+
+    void io_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "rows", "threads" })
+         ->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 16, 8), xi_bench::thread_counts() })
+         ->UseRealTime()
+         ->Unit(benchmark::kMillisecond);
+    }
+}
+
+BENCHMARK(BM_ParseCsv)->Apply(io_args);
+BENCHMARK(BM_FormatCsv)->Apply(io_args);
+
+BENCHMARK(BM_TiledSum)->ArgNames({ "n", "prefetch" })->ArgsProduct({ { 4096 }, { 0, 2 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TiledMultiply)->ArgNames({ "n", "prefetch" })->ArgsProduct({ { 1024 }, { 0, 2 } })->Unit(benchmark::kMillisecond);
@@ -0,0 +1,330 @@
+#include "bench_common.h"
+#include "distributed.h"
+#include "matrix.h"
+#include "matrix_functions.h"
+#include "precision.h"
+#include "strassen.h"
+#include "structured.h"
+
+#include <cmath>
+#include <cstddef>
+
+/*
+    Matrix_Numerical kernels over element types
+    Arguments: { n (square matrices), threads }, { n, bandwidth } for the banded solves,
+    { n, power } for the matrix powers, { n, processes } for the multi-process products
+*/
+namespace
+{
+    template <typename T>
+    xi_matrix::Matrix_Numerical<T> filled(size_t rows, size_t cols, double seed)
+    {
+        xi_matrix::Matrix_Numerical<T> m(rows, cols);
+        T* p = m.data();
+        for (size_t k = 0; k < rows * cols; ++k)
+        {
+            p[k] = static_cast<T>(std::sin(seed + 0.37 * static_cast<double>(k)));
+        }
+        return m;
+    }
+
+    template <typename T>
+    void BM_Multiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a = filled<T>(n, n, 1.0);
+        auto b = filled<T>(n, n, 2.0);
+
+        for (auto _ : state)
+        {
+            auto c = a * b;
+            benchmark::DoNotOptimize(c.data());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd);
+        xi_bench::report_bytes(state, 3.0 * nd * nd * sizeof(T));
+    }
+
+    template <typename T>
+    void BM_Transpose(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a = filled<T>(n, n, 1.0);
+
+        for (auto _ : state)
+        {
+            auto t = a.transpose();
+            benchmark::DoNotOptimize(t.data());
+        }
+
+        xi_bench::report_bytes(state, 2.0 * static_cast<double>(n * n * sizeof(T)));
+    }
+
+    template <typename T>
+    void BM_Det(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a = filled<T>(n, n, 3.0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a(i, i) += static_cast<T>(n);
+        }
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(a.det());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd / 3.0);
+    }
+
+    /*
+        Arguments: { n, threads, crossover }
+    */
+    template <typename T>
+    void BM_StrassenMultiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        xi_matrix::StrassenOptions options;
+        options.crossover = static_cast<size_t>(state.range(2));
+
+        auto a = filled<T>(n, n, 1.0);
+        auto b = filled<T>(n, n, 2.0);
+        xi_matrix::Matrix_Numerical<T> c(n, n);
+
+        for (auto _ : state)
+        {
+            xi_matrix::strassen_multiply(a, b, c, options);
+            benchmark::DoNotOptimize(c.data());
+        }
+
+        // conventional flop count, so the rate compares directly with BM_Multiply
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd);
+    }
+
+    template <typename Policy>
+    void BM_PrecisionMultiply(benchmark::State& state)
+    {
+        using S = typename Policy::storage_type;
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a64 = filled<double>(n, n, 1.0);
+        auto b64 = filled<double>(n, n, 2.0);
+        xi_matrix::Matrix<S> a(n, n);
+        xi_matrix::Matrix<S> b(n, n);
+        xi_matrix::convert(xi_matrix::Matrix_Numerical<double>(a64 * 100.0), a);
+        xi_matrix::convert(xi_matrix::Matrix_Numerical<double>(b64 * 100.0), b);
+        xi_matrix::Matrix<typename Policy::accumulate_type> c(n, n);
+
+        for (auto _ : state)
+        {
+            xi_matrix::precision_multiply<Policy>(a, b, c);
+            benchmark::DoNotOptimize(c.data());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd);
+        xi_bench::report_bytes(state, 2.0 * nd * nd * sizeof(S) + nd * nd * sizeof(typename Policy::accumulate_type));
+    }
+
+    /*
+        Finite difference style operator with [ bandwidth ] sub- and superdiagonals, solved as a
+        BandedMatrix and as the equivalent dense matrix
+    */
+    xi_matrix::BandedMatrix<double> banded(size_t n, size_t bandwidth)
+    {
+        xi_matrix::BandedMatrix<double> a(n, bandwidth, bandwidth);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const size_t first = i > bandwidth ? i - bandwidth : 0;
+            const size_t last = std::min(n - 1, i + bandwidth);
+            for (size_t j = first; j <= last; ++j)
+            {
+                a(i, j) = i == j ? 4.0 * bandwidth : -1.0 + 0.1 * std::sin(static_cast<double>(i + 3 * j));
+            }
+        }
+        return a;
+    }
+
+    void BM_BandedSolve(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const auto a = banded(n, static_cast<size_t>(state.range(1)));
+        const std::vector<double> b(n, 1.0);
+
+        for (auto _ : state)
+        {
+            auto x = a.solve(b);
+            benchmark::DoNotOptimize(x.data());
+        }
+    }
+
+    void BM_DenseBandSolve(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        const auto dense = banded(n, static_cast<size_t>(state.range(1))).to_dense();
+
+        for (auto _ : state)
+        {
+            auto lu = dense;
+            std::vector<size_t> pivots;
+            std::vector<double> x(n, 1.0);
+            xi_matrix::lu_factor(lu.view(), pivots);
+            xi_matrix::lu_solve(lu.view().as_const(), pivots, xi_matrix::MatrixView<double>(x.data(), n, 1, 1));
+            benchmark::DoNotOptimize(x.data());
+        }
+    }
+
+    /*
+        Well conditioned base whose powers neither overflow nor vanish
+    */
+    xi_matrix::Matrix_Numerical<double> power_base(size_t n)
+    {
+        auto a = filled<double>(n, n, 1.0);
+        for (size_t k = 0; k < n * n; ++k)
+        {
+            a.data()[k] /= static_cast<double>(n);
+        }
+        return a;
+    }
+
+    void BM_MatrixPower(benchmark::State& state)
+    {
+        const auto a = power_base(static_cast<size_t>(state.range(0)));
+
+        for (auto _ : state)
+        {
+            auto p = xi_matrix::pow(a, state.range(1));
+            benchmark::DoNotOptimize(p.data());
+        }
+    }
+
+    void BM_RepeatedMultiplyPower(benchmark::State& state)
+    {
+        const auto a = power_base(static_cast<size_t>(state.range(0)));
+
+        for (auto _ : state)
+        {
+            auto p = a;
+            for (int64_t k = 1; k < state.range(1); ++k)
+            {
+                p = p * a;
+            }
+            benchmark::DoNotOptimize(p.data());
+        }
+    }
+
+    void BM_Expm(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a = filled<double>(n, n, 1.0);
+
+        for (auto _ : state)
+        {
+            auto e = xi_matrix::expm(a);
+            benchmark::DoNotOptimize(e.data());
+        }
+    }
+
+    void BM_Sqrtm(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+
+        auto a = filled<double>(n, n, 1.0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a(i, i) += static_cast<double>(n);
+        }
+
+        for (auto _ : state)
+        {
+            auto r = xi_matrix::sqrtm(a);
+            benchmark::DoNotOptimize(r.data());
+        }
+    }
+
+    /*
+        SUMMA over forked worker processes, process start-up included
+    */
+    void BM_DistributedMultiply(benchmark::State& state)
+    {
+        const size_t n = static_cast<size_t>(state.range(0));
+        xi_distributed::LaunchOptions options;
+        options.processes = static_cast<size_t>(state.range(1));
+
+        auto a = filled<double>(n, n, 1.0);
+        auto b = filled<double>(n, n, 2.0);
+
+        for (auto _ : state)
+        {
+            auto c = xi_distributed::multiply(a, b, options);
+            benchmark::DoNotOptimize(c.data());
+        }
+
+        const double nd = static_cast<double>(n);
+        xi_bench::report_flops(state, 2.0 * nd * nd * nd);
+    }
+
+    void square_args(benchmark::internal::Benchmark* b, int64_t largest)
+    {
+        b->ArgNames({ "n", "threads" })
+         ->ArgsProduct({ benchmark::CreateRange(32, largest, 2), xi_bench::thread_counts() })
+         ->UseRealTime()
+         ->Unit(benchmark::kMicrosecond);
+    }
+
+    void small_args(benchmark::internal::Benchmark* b) { square_args(b, 256); }
+
+    void strassen_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "n", "threads", "crossover" })
+         ->ArgsProduct({ { 512, 1024, 2048 }, xi_bench::thread_counts(), { 128, 256, 512 } })
+         ->UseRealTime()
+         ->Unit(benchmark::kMillisecond);
+    }
+
+    void large_args(benchmark::internal::Benchmark* b) { square_args(b, 512); }
+}
+
+BENCHMARK_TEMPLATE(BM_Multiply, float)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Multiply, double)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Multiply, long double)->Apply(small_args);
+
+BENCHMARK_TEMPLATE(BM_Transpose, float)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Transpose, double)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Transpose, long double)->Apply(large_args);
+
+BENCHMARK_TEMPLATE(BM_Det, float)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Det, double)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_Det, long double)->Apply(small_args);
+
+BENCHMARK_TEMPLATE(BM_StrassenMultiply, float)->Apply(strassen_args);
+BENCHMARK_TEMPLATE(BM_StrassenMultiply, double)->Apply(strassen_args);
+
+BENCHMARK_TEMPLATE(BM_PrecisionMultiply, xi_matrix::FloatAccumulateDouble)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_PrecisionMultiply, xi_matrix::Float16Compute32)->Apply(large_args);
+BENCHMARK_TEMPLATE(BM_PrecisionMultiply, xi_matrix::Int8Accumulate32)->Apply(large_args);
+
+BENCHMARK(BM_BandedSolve)->ArgNames({ "n", "bandwidth" })->ArgsProduct({ { 1024, 1 << 20 }, { 1, 8 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DenseBandSolve)->ArgNames({ "n", "bandwidth" })->ArgsProduct({ { 1024 }, { 1, 8 } })->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_MatrixPower)->ArgNames({ "n", "power" })->ArgsProduct({ { 64, 256 }, { 1000 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RepeatedMultiplyPower)->ArgNames({ "n", "power" })->ArgsProduct({ { 64 }, { 1000 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Expm)->Apply(large_args);
+BENCHMARK(BM_Sqrtm)->Apply(small_args);
+BENCHMARK(BM_DistributedMultiply)->ArgNames({ "n", "processes" })->ArgsProduct({ { 512, 1024 }, { 1, 2, 4 } })->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,92 @@
+#include "bench_common.h"
+#include "reduction.h"
+
+#include <cmath>
+#include <cstddef>
+
+/*
+    xi_matrix reductions, one pass over rows x cols elements
+    Arguments: { rows, threads } over a fixed 256 column matrix
+*/
+namespace
+{
+    constexpr size_t columns = 256;
+
+    template <typename T>
+    xi_matrix::Matrix_Numerical<T> filled(size_t rows, size_t cols)
+    {
+        xi_matrix::Matrix_Numerical<T> m(rows, cols);
+        T* p = m.data();
+        for (size_t k = 0; k < rows * cols; ++k)
+        {
+            p[k] = static_cast<T>(std::cos(0.11 * static_cast<double>(k)));
+        }
+        return m;
+    }
+
+    template <typename T>
+    void BM_Sum(benchmark::State& state)
+    {
+        const size_t rows = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        auto m = filled<T>(rows, columns);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(xi_matrix::sum(m));
+        }
+
+        xi_bench::report_flops(state, static_cast<double>(rows * columns));
+        xi_bench::report_bytes(state, static_cast<double>(rows * columns * sizeof(T)));
+    }
+
+    template <typename T>
+    void BM_MeanPerColumn(benchmark::State& state)
+    {
+        const size_t rows = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        auto m = filled<T>(rows, columns);
+
+        for (auto _ : state)
+        {
+            auto r = xi_matrix::mean(m, xi_matrix::Axis::PER_COLUMN);
+            benchmark::DoNotOptimize(r.data());
+        }
+
+        xi_bench::report_flops(state, static_cast<double>(rows * columns));
+        xi_bench::report_bytes(state, static_cast<double>(rows * columns * sizeof(T)));
+    }
+
+    template <typename T>
+    void BM_VariancePerColumn(benchmark::State& state)
+    {
+        const size_t rows = static_cast<size_t>(state.range(0));
+        xi_bench::use_threads(state, state.range(1));
+        auto m = filled<T>(rows, columns);
+
+        for (auto _ : state)
+        {
+            auto r = xi_matrix::variance(m, xi_matrix::Axis::PER_COLUMN);
+            benchmark::DoNotOptimize(r.data());
+        }
+
+        // Mean pass plus a subtract, multiply and add per element
+        xi_bench::report_flops(state, 4.0 * static_cast<double>(rows * columns));
+        xi_bench::report_bytes(state, 2.0 * static_cast<double>(rows * columns * sizeof(T)));
+    }
+
+    void reduction_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "rows", "threads" })
+         ->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 16, 8), xi_bench::thread_counts() })
+         ->UseRealTime()
+         ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Sum, float)->Apply(reduction_args);
+BENCHMARK_TEMPLATE(BM_Sum, double)->Apply(reduction_args);
+BENCHMARK_TEMPLATE(BM_MeanPerColumn, float)->Apply(reduction_args);
+BENCHMARK_TEMPLATE(BM_MeanPerColumn, double)->Apply(reduction_args);
+BENCHMARK_TEMPLATE(BM_VariancePerColumn, float)->Apply(reduction_args);
+BENCHMARK_TEMPLATE(BM_VariancePerColumn, double)->Apply(reduction_args);
@@ -0,0 +1,133 @@
+#include "bench_common.h"
+#include "vmath.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+/*
+    Element-wise transcendentals over 2^16 elements, xi_vmath against a per element std:: loop
+    Arguments: { function (exp, log, sin, cos, tanh, sqrt), path (0 std::, 1 generic, 2 avx2, 3 avx512) }
+    Paths the CPU does not support are skipped
+*/
+namespace
+{
+    constexpr size_t elements = size_t(1) << 16;
+
+    template <typename T>
+    std::vector<T> arguments(xi_vmath::Function f)
+    {
+        std::vector<T> x(elements);
+        for (size_t i = 0; i < elements; ++i)
+        {
+            const double u = std::fmod(0.618033988749895 * static_cast<double>(i), 1.0);
+            x[i] = static_cast<T>(f == xi_vmath::Function::LOG || f == xi_vmath::Function::SQRT ? 1e-3 + 1e3 * u : 20.0 * u - 10.0);
+        }
+        return x;
+    }
+
+    template <typename T>
+    T reference(xi_vmath::Function f, T x)
+    {
+        switch (f)
+        {
+            case xi_vmath::Function::EXP: return std::exp(x);
+            case xi_vmath::Function::LOG: return std::log(x);
+            case xi_vmath::Function::SIN: return std::sin(x);
+            case xi_vmath::Function::COS: return std::cos(x);
+            case xi_vmath::Function::TANH: return std::tanh(x);
+            default: return std::sqrt(x);
+        }
+    }
+
+    /*
+        Selects the path of the benchmark, false when the CPU lacks it
+    */
+    bool use_path(benchmark::State& state, int64_t path)
+    {
+        if (path == 0) return true;
+
+        const auto requested = static_cast<xi_vmath::Isa>(path - 1);
+        if (xi_vmath::set_isa(requested) != requested)
+        {
+            state.SkipWithError("instruction set not supported");
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void BM_Elementwise(benchmark::State& state)
+    {
+        const auto f = static_cast<xi_vmath::Function>(state.range(0));
+        const int64_t path = state.range(1);
+        if (!use_path(state, path)) return;
+
+        const std::vector<T> x = arguments<T>(f);
+        std::vector<T> y(elements);
+
+        for (auto _ : state)
+        {
+            if (path == 0)
+            {
+                for (size_t i = 0; i < elements; ++i) y[i] = reference(f, x[i]);
+            }
+            else
+            {
+                xi_vmath::apply(f, x.data(), y.data(), elements);
+            }
+            benchmark::DoNotOptimize(y.data());
+        }
+
+        xi_vmath::set_isa(xi_vmath::Isa::AVX512);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * elements));
+        xi_bench::report_bytes(state, 2.0 * static_cast<double>(elements * sizeof(T)));
+    }
+
+    template <typename T>
+    void BM_Pow(benchmark::State& state)
+    {
+        const int64_t path = state.range(0);
+        if (!use_path(state, path)) return;
+
+        const std::vector<T> x = arguments<T>(xi_vmath::Function::LOG);
+        const std::vector<T> e = arguments<T>(xi_vmath::Function::EXP);
+        std::vector<T> y(elements);
+
+        for (auto _ : state)
+        {
+            if (path == 0)
+            {
+                for (size_t i = 0; i < elements; ++i) y[i] = std::pow(x[i], e[i]);
+            }
+            else
+            {
+                xi_vmath::pow(x.data(), e.data(), y.data(), elements);
+            }
+            benchmark::DoNotOptimize(y.data());
+        }
+
+        xi_vmath::set_isa(xi_vmath::Isa::AVX512);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * elements));
+        xi_bench::report_bytes(state, 3.0 * static_cast<double>(elements * sizeof(T)));
+    }
+
+    void elementwise_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "function", "path" })
+         ->ArgsProduct({ benchmark::CreateDenseRange(0, 5, 1), benchmark::CreateDenseRange(0, 3, 1) })
+         ->Unit(benchmark::kMicrosecond);
+    }
+
+    void pow_args(benchmark::internal::Benchmark* b)
+    {
+        b->ArgNames({ "path" })
+         ->DenseRange(0, 3, 1)
+         ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Elementwise, float)->Apply(elementwise_args);
+BENCHMARK_TEMPLATE(BM_Elementwise, double)->Apply(elementwise_args);
+BENCHMARK_TEMPLATE(BM_Pow, float)->Apply(pow_args);
+BENCHMARK_TEMPLATE(BM_Pow, double)->Apply(pow_args);
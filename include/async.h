@@ -0,0 +1,380 @@
+#ifndef XI_ASYNC
+#define XI_ASYNC
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+#include "integral.h"
+#include "matrix.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define XI_ASYNC_COROUTINES 1
+#endif
+
+/*
+    Asynchronous variants of the expensive xi operations
+
+    Every function here returns at once with a Future, the work itself runs as one task on
+    the xi_parallel executor and fans out over the pool from there like the synchronous call would
+
+        auto product = xi_async::multiply(A, B);
+        auto area = xi_async::definite_integral(f, 0, 10, 10'000'000);
+        ...
+        if (too_slow) area.cancel();
+        std::cout << product.progress() << "\n";
+        auto C = product.get();
+
+    Operands are copied (or moved, for rvalue Matrix_Numerical arguments) into the job, so the
+    caller may change or destroy them right after the call
+
+    cancel() is cooperative, the kernels check for it between chunks of work and the job then
+    finishes with xi_parallel::Cancelled, which get() rethrows
+    progress() counts the work units the kernels report (integrand evaluations, rows of a
+    product, eliminated columns of a factorization) against the total the job expects
+
+    With C++20 coroutines a Future can be co_awaited, the coroutine resumes on the thread that
+    finished the job
+*/
+namespace xi_async
+{
+    using xi_parallel::Cancelled;
+
+    namespace detail
+    {
+        struct State
+        {
+            xi_parallel::JobControl control;
+            std::mutex lock;
+            bool finished = false;
+            std::function<void()> continuation;
+
+            /*
+                Marks the job finished and runs whatever was waiting for it
+            */
+            void finish()
+            {
+                std::function<void()> next;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    finished = true;
+                    next = std::move(continuation);
+                }
+                if (next) next();
+            }
+        };
+
+        /*
+            Runs [ task ] on the executor, or on a thread of its own when the pool has no workers,
+            so the caller never ends up running the job itself
+        */
+        inline void launch(std::function<void()> task)
+        {
+            xi_parallel::Executor& ex = xi_parallel::executor();
+            if (ex.concurrency() > 1)
+            {
+                ex.submit(std::move(task));
+            }
+            else
+            {
+                std::thread(std::move(task)).detach();
+            }
+        }
+
+        /*
+            Owning Matrix_Numerical copy of any matrix or view, rvalue matrices are moved
+        */
+        template <typename T, typename M>
+        inline xi_matrix::Matrix_Numerical<T> owned(M&& m)
+        {
+            if constexpr (std::is_same<std::decay_t<M>, xi_matrix::Matrix_Numerical<T>>::value)
+            {
+                return std::forward<M>(m);
+            }
+            else
+            {
+                auto v = xi_matrix::detail::as_view(m);
+                xi_matrix::Matrix_Numerical<T> copy(v.rows(), v.cols());
+                copy.view().assign(v);
+                return copy;
+            }
+        }
+
+        template <typename M>
+        using value_t = xi_matrix::detail::value_type_t<std::decay_t<M>>;
+    }
+
+    /*
+        Result of an asynchronous xi operation, move only
+    */
+    template <typename T>
+    class Future
+    {
+        private:
+            std::future<T> _result;
+            std::shared_ptr<detail::State> _state;
+        public:
+            Future() = default;
+
+            Future(std::future<T> result, std::shared_ptr<detail::State> state)
+                : _result(std::move(result)), _state(std::move(state)) {};
+
+            bool valid() const { return _result.valid(); }
+
+            /*
+                True once the job has finished, successfully or not
+            */
+            bool ready() const
+            {
+                return _result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }
+
+            /*
+                Blocks until the job has finished, running queued xi tasks meanwhile when called
+                from a thread that can help
+            */
+            void wait() const
+            {
+                while (!ready())
+                {
+                    if (!xi_parallel::detail::help_pool())
+                    {
+                        _result.wait_for(std::chrono::microseconds(200));
+                    }
+                }
+            }
+
+            template <typename Rep, typename Period>
+            std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+            {
+                return _result.wait_for(timeout);
+            }
+
+            /*
+                Waits for and returns the result, rethrows whatever the job threw (Cancelled included)
+                Can only be called once
+            */
+            T get()
+            {
+                wait();
+                return _result.get();
+            }
+
+            /*
+                Asks the job to stop at its next checkpoint, has no effect once it has finished
+            */
+            void cancel() { _state->control.cancelled.store(true, std::memory_order_relaxed); }
+
+            bool cancel_requested() const { return _state->control.cancelled.load(std::memory_order_relaxed); }
+
+            uint64_t work_done() const { return _state->control.done.load(std::memory_order_relaxed); }
+
+            uint64_t work_total() const { return _state->control.total.load(std::memory_order_relaxed); }
+
+            /*
+                Fraction of the expected work done so far, in [ 0, 1 ]
+            */
+            double progress() const
+            {
+                if (ready()) return 1.0;
+                const uint64_t total = work_total();
+                if (total == 0) return 0.0;
+                return std::min(1.0, static_cast<double>(work_done()) / static_cast<double>(total));
+            }
+
+#ifdef XI_ASYNC_COROUTINES
+            struct Awaiter
+            {
+                Future& future;
+
+                bool await_ready() const { return future.ready(); }
+
+                bool await_suspend(std::coroutine_handle<> handle)
+                {
+                    std::lock_guard<std::mutex> guard(future._state->lock);
+                    if (future._state->finished) return false;
+                    future._state->continuation = [handle] { handle.resume(); };
+                    return true;
+                }
+
+                T await_resume() { return future._result.get(); }
+            };
+
+            Awaiter operator co_await() & { return Awaiter{ *this }; }
+
+            Awaiter operator co_await() && { return Awaiter{ *this }; }
+#endif
+    };
+
+    /*
+        Runs f() as an asynchronous job, [ total_work ] is the number of progress units the
+        kernels inside f are expected to report (0 if unknown)
+        f can call xi_parallel::checkpoint() itself to report progress and honour cancel()
+    */
+    template <typename F>
+    inline Future<std::invoke_result_t<std::decay_t<F>&>> run(F&& f, uint64_t total_work = 0)
+    {
+        using R = std::invoke_result_t<std::decay_t<F>&>;
+
+        auto state = std::make_shared<detail::State>();
+        state->control.total.store(total_work, std::memory_order_relaxed);
+
+        auto promise = std::make_shared<std::promise<R>>();
+        auto body = std::make_shared<std::decay_t<F>>(std::forward<F>(f));
+        Future<R> future(promise->get_future(), state);
+
+        detail::launch([state, promise, body] {
+            {
+                xi_parallel::detail::JobScope scope(&state->control);
+                try
+                {
+                    xi_parallel::checkpoint();
+                    if constexpr (std::is_void<R>::value)
+                    {
+                        (*body)();
+                        promise->set_value();
+                    }
+                    else
+                    {
+                        promise->set_value((*body)());
+                    }
+                }
+                catch (...)
+                {
+                    promise->set_exception(std::current_exception());
+                }
+            }
+            state->finish();
+        });
+
+        return future;
+    }
+
+    /*
+        xi_integral::definite_integral as a job, progress counts integrand evaluations
+    */
+    template <typename Func, typename T1, typename T2>
+    inline Future<long double> definite_integral(Func&& f, T1 a, T2 b, int n = -1)
+    {
+        const int points = n == -1 ? 10'000 : n;
+        return run([f = std::forward<Func>(f), a, b, n]() mutable {
+            return xi_integral::definite_integral(f, a, b, n);
+        }, static_cast<uint64_t>(std::max(points - 1, 0)));
+    }
+
+    /*
+        a * b as a job, progress counts finished rows of the product
+    */
+    template <typename A, typename B,
+              typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<std::decay_t<A>>::value &&
+                                          xi_matrix::detail::is_matrix_like<std::decay_t<B>>::value>>
+    inline Future<xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_t<A>, detail::value_t<B>>>>
+    multiply(A&& a, B&& b)
+    {
+        using TA = detail::value_t<A>;
+        using TB = detail::value_t<B>;
+        using R = std::common_type_t<TA, TB>;
+
+        auto lhs = detail::owned<TA>(std::forward<A>(a));
+        auto rhs = detail::owned<TB>(std::forward<B>(b));
+        assert(lhs.cols() == rhs.rows() && "Matrix dimensions must match up for multiplication");
+
+        const uint64_t rows = lhs.rows();
+        return run([lhs = std::move(lhs), rhs = std::move(rhs)] {
+            xi_matrix::Matrix_Numerical<R> out(lhs.rows(), rhs.cols());
+            xi_matrix::multiply(lhs, rhs, out);
+            return out;
+        }, rows);
+    }
+
+    /*
+        LU factorization with partial pivoting, see xi_matrix::lu_factor
+        sign is 0 when the matrix is singular
+    */
+    template <typename T>
+    struct LUResult
+    {
+        xi_matrix::Matrix_Numerical<T> lu;
+        std::vector<size_t> pivots;
+        int sign = 0;
+    };
+
+    /*
+        Factorization as a job (integer matrices are factored in long double),
+        progress counts eliminated columns
+    */
+    template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<std::decay_t<M>>::value>>
+    inline Future<LUResult<xi_matrix::detail::work_t<detail::value_t<M>>>> lu_factor(M&& m)
+    {
+        using W = xi_matrix::detail::work_t<detail::value_t<M>>;
+
+        auto work = detail::owned<W>(std::forward<M>(m));
+        assert(work.rows() == work.cols() && "Matrix must be a square matrix in order to factor it!");
+
+        const uint64_t n = work.rows();
+        return run([work = std::move(work)]() mutable {
+            LUResult<W> result;
+            result.sign = xi_matrix::lu_factor(work.view(), result.pivots);
+            result.lu = std::move(work);
+            return result;
+        }, n);
+    }
+
+    /*
+        Determinant as a job, progress counts eliminated columns
+    */
+    template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<std::decay_t<M>>::value>>
+    inline Future<detail::value_t<M>> det(M&& m)
+    {
+        using T = detail::value_t<M>;
+
+        auto copy = detail::owned<T>(std::forward<M>(m));
+        assert(copy.rows() == copy.cols() && "Matrix must be a square matrix in order to calculate determinant!");
+
+        const uint64_t n = copy.rows();
+        return run([copy = std::move(copy)] { return xi_matrix::det(copy); }, n);
+    }
+
+    /*
+        Solves a x = b for every column of [ b ] as a job, throws std::runtime_error from get()
+        if [ a ] is singular, progress counts eliminated columns of [ a ] plus solved columns of [ b ]
+    */
+    template <typename A, typename B,
+              typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<std::decay_t<A>>::value &&
+                                          xi_matrix::detail::is_matrix_like<std::decay_t<B>>::value>>
+    inline Future<xi_matrix::Matrix_Numerical<xi_matrix::detail::work_t<std::common_type_t<detail::value_t<A>, detail::value_t<B>>>>>
+    solve(A&& a, B&& b)
+    {
+        using W = xi_matrix::detail::work_t<std::common_type_t<detail::value_t<A>, detail::value_t<B>>>;
+
+        auto lhs = detail::owned<W>(std::forward<A>(a));
+        auto rhs = detail::owned<W>(std::forward<B>(b));
+        assert(
+            lhs.rows() == lhs.cols() && rhs.rows() == lhs.rows() &&
+            "Right hand side must have as many rows as the square system"
+        );
+
+        const uint64_t work = lhs.rows() + rhs.cols();
+        return run([lhs = std::move(lhs), rhs = std::move(rhs)]() mutable {
+            std::vector<size_t> pivots;
+            if (xi_matrix::lu_factor(lhs.view(), pivots) == 0)
+            {
+                throw std::runtime_error("Matrix is singular, the system has no unique solution");
+            }
+            xi_matrix::lu_solve(lhs.view().as_const(), pivots, rhs.view());
+            return std::move(rhs);
+        }, work);
+    }
+}
+
+#endif
@@ -0,0 +1,708 @@
+#ifndef XI_BATCHED
+#define XI_BATCHED
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+#include "parallel.h"
+
+/*
+    Batches of many same-shape small matrices
+
+    A MatrixBatch holds [ count ] matrices of rows x cols elements in structure-of-arrays layout:
+    element (i, j) of every matrix of the batch is stored contiguously, so plane(i, j)[k] is
+    element (i, j) of matrix k, consecutive planes are stride() elements apart
+
+        xi_matrix::MatrixBatch<double> transforms(1'000'000, 3, 3);
+        ...
+        auto dets = xi_matrix::det(transforms);
+        auto inverses = xi_matrix::inverse(transforms);
+
+    Every batched kernel walks the matrix elements in its outer loops and the batch index in
+    its innermost loop, which runs over contiguous memory with the same instruction for every
+    matrix and vectorizes, ranges of the batch are spread over the xi_parallel pool
+
+    det, inverse and solve use closed forms for 1x1 .. 3x3 and Gaussian elimination with
+    partial pivoting (chosen per matrix) above that, singular matrices get a determinant
+    of 0 and NaN inverses / solutions
+*/
+namespace xi_matrix
+{
+    template <typename T>
+    class MatrixBatch
+    {
+        static_assert(std::is_arithmetic<T>::value, "MatrixBatch requires an arithmetic element type");
+
+        private:
+            size_t _count;
+            size_t _rows;
+            size_t _cols;
+            size_t _stride;
+            std::vector<T> _data;
+
+            /*
+                Distance between two planes, the count rounded up to whole cache lines and kept
+                off multiples of 4 KiB so the planes of one matrix do not all map to the same cache sets
+            */
+            static size_t plane_stride(size_t count)
+            {
+                const size_t line = std::max<size_t>(1, 64 / sizeof(T));
+                size_t stride = (count + line - 1) / line * line;
+                if (stride > line && (stride * sizeof(T)) % 4096 == 0) stride += line;
+                return stride;
+            }
+        public:
+            using value_type = T;
+
+            MatrixBatch() : _count(0), _rows(0), _cols(0), _stride(0) {};
+
+            /*
+                [ count ] matrices of rows x cols elements, every element set to [ value ]
+            */
+            MatrixBatch(size_t count, size_t rows, size_t cols, T value = T(0))
+                : _count(count), _rows(rows), _cols(cols), _stride(plane_stride(count)), _data(_stride * rows * cols, value)
+            {
+                XI_COUNT(MATRIX, ALLOCATIONS, 1);
+                XI_COUNT(MATRIX, ALLOCATED_BYTES, _data.size() * sizeof(T));
+            };
+
+            size_t count() const { return _count; }
+
+            size_t rows() const { return _rows; }
+
+            size_t cols() const { return _cols; }
+
+            /*
+                Distance in elements between consecutive planes, at least count()
+            */
+            size_t stride() const { return _stride; }
+
+            /*
+                The [ count ] values of element (row, col), one per matrix of the batch
+            */
+            T* plane(size_t row, size_t col)
+            {
+                assert(row < _rows && col < _cols && "Element index out of bounds");
+                return _data.data() + (row * _cols + col) * _stride;
+            }
+
+            const T* plane(size_t row, size_t col) const
+            {
+                assert(row < _rows && col < _cols && "Element index out of bounds");
+                return _data.data() + (row * _cols + col) * _stride;
+            }
+
+            T* data() { return _data.data(); }
+
+            const T* data() const { return _data.data(); }
+
+            T& operator()(size_t index, size_t row, size_t col)
+            {
+                if (index >= _count || row >= _rows || col >= _cols)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _data[(row * _cols + col) * _stride + index];
+            }
+
+            const T& operator()(size_t index, size_t row, size_t col) const
+            {
+                if (index >= _count || row >= _rows || col >= _cols)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _data[(row * _cols + col) * _stride + index];
+            }
+
+            /*
+                Copies matrix or view [ m ] into slot [ index ] of the batch
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            void set(size_t index, const M& m)
+            {
+                auto v = detail::as_view(m);
+                if (index >= _count)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                assert(v.rows() == _rows && v.cols() == _cols && "Matrix dimensions must match the batch");
+
+                for (size_t i = 0; i < _rows; ++i)
+                {
+                    for (size_t j = 0; j < _cols; ++j)
+                    {
+                        _data[(i * _cols + j) * _stride + index] = static_cast<T>(v(i, j));
+                    }
+                }
+            }
+
+            /*
+                Copy of the matrix in slot [ index ]
+            */
+            Matrix_Numerical<T> get(size_t index) const
+            {
+                if (index >= _count)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+
+                Matrix_Numerical<T> m(_rows, _cols);
+                for (size_t i = 0; i < _rows; ++i)
+                {
+                    for (size_t j = 0; j < _cols; ++j)
+                    {
+                        m(i, j) = _data[(i * _cols + j) * _stride + index];
+                    }
+                }
+                return m;
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            Number of matrices a batched kernel works on at once, small enough that the
+            planes of one block stay in L1 / L2 while every element of the matrices is visited
+        */
+        inline size_t batch_block(size_t elements)
+        {
+            const size_t lanes = (size_t(1) << 15) / std::max<size_t>(1, elements);
+            return std::clamp<size_t>(lanes & ~size_t(15), 16, 1024);
+        }
+
+        /*
+            Batch grain for parallel_for so every task gets about parallel_threshold units of work
+        */
+        inline size_t batch_grain(size_t work_per_matrix, size_t block)
+        {
+            return std::max(block, parallel_threshold / std::max<size_t>(1, work_per_matrix));
+        }
+
+        /*
+            Gaussian elimination with per-matrix partial pivoting on [ len ] matrices at once
+
+            [ w ] holds n x n planes and [ r ] n x m right hand side planes of [ len ] values each,
+            plane e starting at e * len. On return [ r ] holds the solutions, the diagonal of [ w ]
+            the pivots, [ sign ] the permutation sign and [ singular ] is set for matrices
+            without a usable pivot (their right hand side is left unspecified)
+
+            Row swaps differ between matrices, they are done as selects over the whole block
+            so the lane loops stay branch free
+        */
+        template <typename T>
+        inline void batch_eliminate(size_t n, size_t m, size_t len, T* w, T* r, T* sign, unsigned char* singular,
+                                    size_t* piv, T* best, T* inv)
+        {
+            for (size_t l = 0; l < len; ++l)
+            {
+                sign[l] = T(1);
+                singular[l] = 0;
+            }
+
+            for (size_t k = 0; k < n; ++k)
+            {
+                const T* wkk = w + (k * n + k) * len;
+                for (size_t l = 0; l < len; ++l)
+                {
+                    best[l] = std::abs(wkk[l]);
+                    piv[l] = k;
+                }
+
+                for (size_t i = k + 1; i < n; ++i)
+                {
+                    const T* wik = w + (i * n + k) * len;
+                    #pragma omp simd
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        const T v = std::abs(wik[l]);
+                        const bool take = v > best[l];
+                        best[l] = take ? v : best[l];
+                        piv[l] = take ? i : piv[l];
+                    }
+                }
+
+                for (size_t i = k + 1; i < n; ++i)
+                {
+                    bool any = false;
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        any |= piv[l] == i;
+                    }
+                    if (!any) continue;
+
+                    auto swap_rows = [&](T* base, size_t width, size_t from) {
+                        for (size_t j = from; j < width; ++j)
+                        {
+                            T* pk = base + (k * width + j) * len;
+                            T* pi = base + (i * width + j) * len;
+                            #pragma omp simd
+                            for (size_t l = 0; l < len; ++l)
+                            {
+                                const bool s = piv[l] == i;
+                                const T a = pk[l];
+                                const T b = pi[l];
+                                pk[l] = s ? b : a;
+                                pi[l] = s ? a : b;
+                            }
+                        }
+                    };
+                    swap_rows(w, n, k);
+                    swap_rows(r, m, 0);
+                }
+
+                for (size_t l = 0; l < len; ++l)
+                {
+                    sign[l] = piv[l] != k ? -sign[l] : sign[l];
+                    const bool zero = best[l] == T(0);
+                    singular[l] |= zero;
+                    inv[l] = zero ? T(0) : T(1) / wkk[l];
+                }
+
+                for (size_t i = k + 1; i < n; ++i)
+                {
+                    T* f = w + (i * n + k) * len;
+                    #pragma omp simd
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        f[l] *= inv[l];
+                    }
+
+                    for (size_t j = k + 1; j < n; ++j)
+                    {
+                        T* wij = w + (i * n + j) * len;
+                        const T* wkj = w + (k * n + j) * len;
+                        #pragma omp simd
+                        for (size_t l = 0; l < len; ++l)
+                        {
+                            wij[l] -= f[l] * wkj[l];
+                        }
+                    }
+
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        T* rij = r + (i * m + j) * len;
+                        const T* rkj = r + (k * m + j) * len;
+                        #pragma omp simd
+                        for (size_t l = 0; l < len; ++l)
+                        {
+                            rij[l] -= f[l] * rkj[l];
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = n; i-- > 0;)
+            {
+                const T* wii = w + (i * n + i) * len;
+                for (size_t j = 0; j < m; ++j)
+                {
+                    T* rij = r + (i * m + j) * len;
+                    for (size_t p = i + 1; p < n; ++p)
+                    {
+                        const T* wip = w + (i * n + p) * len;
+                        const T* rpj = r + (p * m + j) * len;
+                        #pragma omp simd
+                        for (size_t l = 0; l < len; ++l)
+                        {
+                            rij[l] -= wip[l] * rpj[l];
+                        }
+                    }
+                    #pragma omp simd
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        rij[l] /= wii[l];
+                    }
+                }
+            }
+        }
+
+        /*
+            Per-task scratch space of batch_eliminate for blocks of up to [ block ] matrices
+        */
+        template <typename T>
+        struct BatchWorkspace
+        {
+            std::vector<T> w, r, sign, best, inv;
+            std::vector<unsigned char> singular;
+            std::vector<size_t> piv;
+
+            BatchWorkspace(size_t n, size_t m, size_t block)
+                : w(n * n * block), r(n * m * block), sign(block), best(block), inv(block),
+                  singular(block), piv(block)
+            {
+                XI_COUNT(MATRIX, ALLOCATIONS, 1);
+                XI_COUNT(MATRIX, ALLOCATED_BYTES, (w.size() + r.size() + 3 * block) * sizeof(T) + block * (1 + sizeof(size_t)));
+            };
+
+            /*
+                Copies matrices [ first, first + len ) of [ src ] into the block planes of [ dst ]
+            */
+            static void gather(const MatrixBatch<T>& src, size_t first, size_t len, T* dst)
+            {
+                const size_t planes = src.rows() * src.cols();
+                for (size_t e = 0; e < planes; ++e)
+                {
+                    std::copy_n(src.data() + e * src.stride() + first, len, dst + e * len);
+                }
+            }
+
+            static void scatter(const T* src, size_t first, size_t len, MatrixBatch<T>& dst)
+            {
+                const size_t planes = dst.rows() * dst.cols();
+                for (size_t e = 0; e < planes; ++e)
+                {
+                    std::copy_n(src + e * len, len, dst.data() + e * dst.stride() + first);
+                }
+            }
+        };
+
+        /*
+            Solves every system of [ a ] against [ rhs ] (or the identity when rhs is null) into [ out ],
+            returns the number of singular matrices, whose solutions are filled with NaN
+        */
+        template <typename T>
+        inline size_t batch_solve(const MatrixBatch<T>& a, const MatrixBatch<T>* rhs, MatrixBatch<T>& out)
+        {
+            const size_t n = a.rows();
+            const size_t m = out.cols();
+            const size_t block = batch_block(n * (n + m));
+            std::atomic<size_t> singular_total(0);
+
+            xi_parallel::parallel_for(0, a.count(), batch_grain(n * n * (n + m), block), [&](size_t first, size_t last) {
+                BatchWorkspace<T> ws(n, m, block);
+                size_t singular_count = 0;
+
+                for (size_t l0 = first; l0 < last; l0 += block)
+                {
+                    const size_t len = std::min(block, last - l0);
+                    BatchWorkspace<T>::gather(a, l0, len, ws.w.data());
+                    if (rhs)
+                    {
+                        BatchWorkspace<T>::gather(*rhs, l0, len, ws.r.data());
+                    }
+                    else
+                    {
+                        std::fill(ws.r.begin(), ws.r.begin() + n * m * len, T(0));
+                        for (size_t i = 0; i < n; ++i)
+                        {
+                            std::fill_n(ws.r.data() + (i * m + i) * len, len, T(1));
+                        }
+                    }
+
+                    batch_eliminate(n, m, len, ws.w.data(), ws.r.data(), ws.sign.data(), ws.singular.data(),
+                                    ws.piv.data(), ws.best.data(), ws.inv.data());
+
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        if (!ws.singular[l]) continue;
+                        ++singular_count;
+                        for (size_t e = 0; e < n * m; ++e)
+                        {
+                            ws.r[e * len + l] = std::numeric_limits<T>::quiet_NaN();
+                        }
+                    }
+
+                    BatchWorkspace<T>::scatter(ws.r.data(), l0, len, out);
+                    xi_parallel::checkpoint(len);
+                }
+
+                singular_total.fetch_add(singular_count, std::memory_order_relaxed);
+            });
+
+            return singular_total.load(std::memory_order_relaxed);
+        }
+    }
+
+    /*
+        out[k] = a[k] * b[k] for every matrix of the batches, [ out ] must not be [ a ] or [ b ]
+    */
+    template <typename T>
+    inline void multiply(const MatrixBatch<T>& a, const MatrixBatch<T>& b, MatrixBatch<T>& out)
+    {
+        assert(
+            a.count() == b.count() && a.cols() == b.rows() &&
+            out.count() == a.count() && out.rows() == a.rows() && out.cols() == b.cols() &&
+            "Batch dimensions must match up for multiplication"
+        );
+        assert(&out != &a && &out != &b && "Batched multiply cannot write into one of its operands");
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, 2 * a.count() * a.rows() * a.cols() * b.cols());
+        XI_COUNT(MATRIX, BYTES, a.count() * (a.rows() * a.cols() + b.rows() * b.cols() + out.rows() * out.cols()) * sizeof(T));
+
+        const size_t rows = a.rows();
+        const size_t inner = a.cols();
+        const size_t cols = b.cols();
+        const size_t block = detail::batch_block(rows * inner + inner * cols + rows * cols);
+
+        xi_parallel::parallel_for(0, a.count(), detail::batch_grain(rows * inner * cols, block), [&](size_t first, size_t last) {
+            for (size_t l0 = first; l0 < last; l0 += block)
+            {
+                const size_t len = std::min(block, last - l0);
+                for (size_t i = 0; i < rows; ++i)
+                {
+                    for (size_t j = 0; j < cols; ++j)
+                    {
+                        T* po = out.plane(i, j) + l0;
+                        std::fill_n(po, len, T(0));
+                        for (size_t p = 0; p < inner; ++p)
+                        {
+                            const T* pa = a.plane(i, p) + l0;
+                            const T* pb = b.plane(p, j) + l0;
+                            #pragma omp simd
+                            for (size_t l = 0; l < len; ++l)
+                            {
+                                po[l] += pa[l] * pb[l];
+                            }
+                        }
+                    }
+                }
+                xi_parallel::checkpoint(len);
+            }
+        });
+    }
+
+    template <typename T>
+    inline MatrixBatch<T> multiply(const MatrixBatch<T>& a, const MatrixBatch<T>& b)
+    {
+        MatrixBatch<T> out(a.count(), a.rows(), b.cols());
+        multiply(a, b, out);
+        return out;
+    }
+
+    /*
+        Determinant of every matrix of the batch
+    */
+    template <typename T>
+    inline std::vector<T> det(const MatrixBatch<T>& a)
+    {
+        static_assert(std::is_floating_point<T>::value, "Batched determinants require a floating point type");
+        assert(a.rows() == a.cols() && "Batch matrices must be square in order to calculate determinants!");
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, a.count() * 2 * a.rows() * a.rows() * a.rows() / 3);
+        XI_COUNT(MATRIX, BYTES, a.count() * (a.rows() * a.cols() + 1) * sizeof(T));
+
+        const size_t n = a.rows();
+        std::vector<T> result(a.count(), T(1));
+        if (n == 0) return result;
+
+        T* out = result.data();
+        const size_t block = detail::batch_block(n * n);
+
+        xi_parallel::parallel_for(0, a.count(), detail::batch_grain(n * n * n, block), [&](size_t first, size_t last) {
+            if (n <= 3)
+            {
+                auto e = [&](size_t i, size_t j) { return a.plane(i, j); };
+                if (n == 1)
+                {
+                    std::copy(e(0, 0) + first, e(0, 0) + last, out + first);
+                }
+                else if (n == 2)
+                {
+                    const T *a00 = e(0, 0), *a01 = e(0, 1), *a10 = e(1, 0), *a11 = e(1, 1);
+                    #pragma omp simd
+                    for (size_t l = first; l < last; ++l)
+                    {
+                        out[l] = a00[l] * a11[l] - a01[l] * a10[l];
+                    }
+                }
+                else
+                {
+                    const T *a00 = e(0, 0), *a01 = e(0, 1), *a02 = e(0, 2);
+                    const T *a10 = e(1, 0), *a11 = e(1, 1), *a12 = e(1, 2);
+                    const T *a20 = e(2, 0), *a21 = e(2, 1), *a22 = e(2, 2);
+                    #pragma omp simd
+                    for (size_t l = first; l < last; ++l)
+                    {
+                        out[l] = a00[l] * (a11[l] * a22[l] - a12[l] * a21[l])
+                               - a01[l] * (a10[l] * a22[l] - a12[l] * a20[l])
+                               + a02[l] * (a10[l] * a21[l] - a11[l] * a20[l]);
+                    }
+                }
+                xi_parallel::checkpoint(last - first);
+                return;
+            }
+
+            detail::BatchWorkspace<T> ws(n, 0, block);
+            for (size_t l0 = first; l0 < last; l0 += block)
+            {
+                const size_t len = std::min(block, last - l0);
+                detail::BatchWorkspace<T>::gather(a, l0, len, ws.w.data());
+                detail::batch_eliminate(n, 0, len, ws.w.data(), ws.r.data(), ws.sign.data(), ws.singular.data(),
+                                        ws.piv.data(), ws.best.data(), ws.inv.data());
+
+                T* d = out + l0;
+                std::copy_n(ws.sign.data(), len, d);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const T* wii = ws.w.data() + (i * n + i) * len;
+                    #pragma omp simd
+                    for (size_t l = 0; l < len; ++l)
+                    {
+                        d[l] *= wii[l];
+                    }
+                }
+                for (size_t l = 0; l < len; ++l)
+                {
+                    d[l] = ws.singular[l] ? T(0) : d[l];
+                }
+                xi_parallel::checkpoint(len);
+            }
+        });
+
+        return result;
+    }
+
+    /*
+        Inverts every matrix of [ a ] into [ out ], returns how many of them were singular,
+        their inverses are filled with NaN
+    */
+    template <typename T>
+    inline size_t inverse(const MatrixBatch<T>& a, MatrixBatch<T>& out)
+    {
+        static_assert(std::is_floating_point<T>::value, "Batched inverses require a floating point type");
+        assert(a.rows() == a.cols() && "Batch matrices must be square in order to invert them!");
+        assert(
+            out.count() == a.count() && out.rows() == a.rows() && out.cols() == a.cols() &&
+            "Output batch must have the shape of the inverted batch"
+        );
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, a.count() * 2 * a.rows() * a.rows() * a.rows());
+        XI_COUNT(MATRIX, BYTES, a.count() * 2 * a.rows() * a.cols() * sizeof(T));
+
+        const size_t n = a.rows();
+        if (n == 0 || n > 3)
+        {
+            return detail::batch_solve<T>(a, nullptr, out);
+        }
+
+        std::atomic<size_t> singular_total(0);
+        const T nan = std::numeric_limits<T>::quiet_NaN();
+
+        xi_parallel::parallel_for(0, a.count(), detail::batch_grain(n * n * n, detail::batch_block(2 * n * n)), [&](size_t first, size_t last) {
+            auto e = [&](size_t i, size_t j) { return a.plane(i, j); };
+            auto o = [&](size_t i, size_t j) { return out.plane(i, j); };
+            size_t singular_count = 0;
+
+            if (n == 1)
+            {
+                const T* a00 = e(0, 0);
+                T* o00 = o(0, 0);
+                for (size_t l = first; l < last; ++l)
+                {
+                    const bool zero = a00[l] == T(0);
+                    singular_count += zero;
+                    o00[l] = zero ? nan : T(1) / a00[l];
+                }
+            }
+            else if (n == 2)
+            {
+                const T *a00 = e(0, 0), *a01 = e(0, 1), *a10 = e(1, 0), *a11 = e(1, 1);
+                T *o00 = o(0, 0), *o01 = o(0, 1), *o10 = o(1, 0), *o11 = o(1, 1);
+                #pragma omp simd reduction(+ : singular_count)
+                for (size_t l = first; l < last; ++l)
+                {
+                    const T d = a00[l] * a11[l] - a01[l] * a10[l];
+                    const bool zero = d == T(0);
+                    singular_count += zero;
+                    const T r = zero ? nan : T(1) / d;
+                    const T b00 = a00[l], b01 = a01[l], b10 = a10[l], b11 = a11[l];
+                    o00[l] = b11 * r;
+                    o01[l] = -b01 * r;
+                    o10[l] = -b10 * r;
+                    o11[l] = b00 * r;
+                }
+            }
+            else
+            {
+                const T *a00 = e(0, 0), *a01 = e(0, 1), *a02 = e(0, 2);
+                const T *a10 = e(1, 0), *a11 = e(1, 1), *a12 = e(1, 2);
+                const T *a20 = e(2, 0), *a21 = e(2, 1), *a22 = e(2, 2);
+                T *o00 = o(0, 0), *o01 = o(0, 1), *o02 = o(0, 2);
+                T *o10 = o(1, 0), *o11 = o(1, 1), *o12 = o(1, 2);
+                T *o20 = o(2, 0), *o21 = o(2, 1), *o22 = o(2, 2);
+                #pragma omp simd reduction(+ : singular_count)
+                for (size_t l = first; l < last; ++l)
+                {
+                    const T c00 = a11[l] * a22[l] - a12[l] * a21[l];
+                    const T c01 = a12[l] * a20[l] - a10[l] * a22[l];
+                    const T c02 = a10[l] * a21[l] - a11[l] * a20[l];
+                    const T d = a00[l] * c00 + a01[l] * c01 + a02[l] * c02;
+                    const bool zero = d == T(0);
+                    singular_count += zero;
+                    const T r = zero ? nan : T(1) / d;
+
+                    const T b00 = a00[l], b01 = a01[l], b02 = a02[l];
+                    const T b10 = a10[l], b11 = a11[l], b12 = a12[l];
+                    const T b20 = a20[l], b21 = a21[l], b22 = a22[l];
+                    o00[l] = c00 * r;
+                    o01[l] = (b02 * b21 - b01 * b22) * r;
+                    o02[l] = (b01 * b12 - b02 * b11) * r;
+                    o10[l] = c01 * r;
+                    o11[l] = (b00 * b22 - b02 * b20) * r;
+                    o12[l] = (b02 * b10 - b00 * b12) * r;
+                    o20[l] = c02 * r;
+                    o21[l] = (b01 * b20 - b00 * b21) * r;
+                    o22[l] = (b00 * b11 - b01 * b10) * r;
+                }
+            }
+
+            singular_total.fetch_add(singular_count, std::memory_order_relaxed);
+            xi_parallel::checkpoint(last - first);
+        });
+
+        return singular_total.load(std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline MatrixBatch<T> inverse(const MatrixBatch<T>& a)
+    {
+        MatrixBatch<T> out(a.count(), a.rows(), a.cols());
+        inverse(a, out);
+        return out;
+    }
+
+    /*
+        Solves a[k] x[k] = b[k] for every matrix of the batch, [ b ] holds one or more right hand
+        side columns per matrix, returns how many systems were singular, their solutions are NaN
+    */
+    template <typename T>
+    inline size_t solve(const MatrixBatch<T>& a, const MatrixBatch<T>& b, MatrixBatch<T>& x)
+    {
+        static_assert(std::is_floating_point<T>::value, "Batched solves require a floating point type");
+        assert(
+            a.rows() == a.cols() && b.count() == a.count() && b.rows() == a.rows() &&
+            "Right hand side must have as many rows as the square systems"
+        );
+        assert(
+            x.count() == b.count() && x.rows() == b.rows() && x.cols() == b.cols() &&
+            "Solution batch must have the shape of the right hand side"
+        );
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, a.count() * (2 * a.rows() * a.rows() * a.rows() / 3 + 2 * a.rows() * a.rows() * b.cols()));
+        XI_COUNT(MATRIX, BYTES, a.count() * (a.rows() * a.cols() + 2 * b.rows() * b.cols()) * sizeof(T));
+
+        return detail::batch_solve(a, &b, x);
+    }
+
+    template <typename T>
+    inline MatrixBatch<T> solve(const MatrixBatch<T>& a, const MatrixBatch<T>& b)
+    {
+        MatrixBatch<T> x(b.count(), b.rows(), b.cols());
+        solve(a, b, x);
+        return x;
+    }
+}
+
+#endif
@@ -0,0 +1,410 @@
+#ifndef XI_CHEBYSHEV
+#define XI_CHEBYSHEV
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "fft.h"
+#include "instrument.h"
+#include "parallel.h"
+#include "roots.h"
+
+/*
+    Chebyshev proxies of smooth functions on an interval
+
+        xi_chebyshev::Chebyshev p(f, a, b);     samples f once, picks the degree adaptively
+        p(x)                                    evaluation, Clenshaw, O(n)
+        p.integral(), p.integral(lo, hi)        O(n)
+        p.derivative(), p.antiderivative()      new proxies, O(n)
+        p.roots()                               real roots in [ a, b ], O(n log n) + O(n) per root
+
+    f is sampled at the Chebyshev points x_j = cos(j pi / N) of [ a, b ] for N = 16, 32, 64, ...
+    The grids are nested, so every doubling only evaluates the N new points. The coefficients
+    come from a DCT-I of the samples (a real FFT of the even extension), and the expansion stops
+    growing once its tail has decayed below the tolerance relative to the largest coefficient.
+    Smooth functions get geometric convergence, a few dozen coefficients reach double precision
+    for analytic ones. After construction nothing calls f again.
+
+    f is called from the xi_parallel pool for large grids, like the integrands of xi_integral
+*/
+namespace xi_chebyshev
+{
+    struct Options
+    {
+        long double tolerance = std::numeric_limits<double>::epsilon();    // relative size of the discarded tail
+        size_t max_degree = size_t(1) << 16;
+    };
+
+    namespace detail
+    {
+        inline long double pi()
+        {
+            return 3.141592653589793238462643383279502884L;
+        }
+
+        /*
+            DCT-I: out_j = v_0 / 2 + sum_{k=1}^{N-1} v_k cos(j k pi / N) + (-1)^j v_N / 2, N = v.size() - 1
+            Half the real FFT of the even extension, any N
+        */
+        inline std::vector<long double> dct1(const std::vector<long double>& v)
+        {
+            const size_t N = v.size() - 1;
+            std::vector<long double> out(N + 1);
+
+            if (N == 0)
+            {
+                out[0] = v[0] / 2;
+                return out;
+            }
+
+            std::vector<long double> extended(2 * N);
+            for (size_t k = 0; k <= N; ++k) extended[k] = v[k];
+            for (size_t k = 1; k < N; ++k) extended[2 * N - k] = v[k];
+
+            std::vector<std::complex<long double>> spectrum(N + 1);
+            xi_fft::real_plan<long double>(2 * N)->forward(extended.data(), spectrum.data());
+            for (size_t j = 0; j <= N; ++j) out[j] = spectrum[j].real() / 2;
+            return out;
+        }
+
+        /*
+            Chebyshev coefficients of the samples f(cos(j pi / N)), j = 0 ... N
+        */
+        inline std::vector<long double> coefficients_from_values(const std::vector<long double>& values)
+        {
+            const size_t N = values.size() - 1;
+            if (N == 0) return values;
+
+            std::vector<long double> c = dct1(values);
+            for (long double& ck : c) ck *= 2 / static_cast<long double>(N);
+            c.front() /= 2;
+            c.back() /= 2;
+            return c;
+        }
+
+        /*
+            Values of sum c_k T_k at the N + 1 Chebyshev points cos(j pi / N), N >= c.size() - 1
+        */
+        inline std::vector<long double> values_from_coefficients(const std::vector<long double>& c, size_t N)
+        {
+            assert(N + 1 >= c.size() && "Grid must have at least as many points as coefficients");
+
+            std::vector<long double> d(N + 1, 0.0L);
+            std::copy(c.begin(), c.end(), d.begin());
+            d.front() *= 2;
+            d.back() *= 2;
+            return dct1(d);
+        }
+
+        /*
+            Length the coefficients can be cut to, or 0 if the tail has not decayed yet:
+            the last max(3, n / 8) coefficients must all be below tolerance * max |c_k|
+        */
+        inline size_t chop(const std::vector<long double>& c, long double tolerance)
+        {
+            long double scale = 0;
+            for (long double ck : c) scale = std::max(scale, std::fabs(ck));
+            if (scale == 0) return 1;
+
+            const long double threshold = tolerance * scale;
+            const size_t plateau = std::max<size_t>(3, c.size() / 8);
+            for (size_t k = c.size() - plateau; k < c.size(); ++k)
+            {
+                if (std::fabs(c[k]) > threshold) return 0;
+            }
+
+            size_t length = c.size();
+            while (length > 1 && std::fabs(c[length - 1]) <= threshold) --length;
+            return length;
+        }
+    }
+
+    class Chebyshev
+    {
+        private:
+            std::vector<long double> _c;
+            long double _a = -1;
+            long double _b = 1;
+            size_t _evaluations = 0;
+            bool _converged = true;
+
+            long double to_unit(long double x) const { return (2 * x - _a - _b) / (_b - _a); }
+
+            long double from_unit(long double t) const { return (_a + _b) / 2 + (_b - _a) / 2 * t; }
+
+            /*
+                f at the Chebyshev points cos(j pi / N), j = first, first + step, ... up to N
+            */
+            template <typename Func>
+            void sample(Func& f, std::vector<long double>& values, size_t N, size_t first, size_t step)
+            {
+                const size_t count = (N - first) / step + 1;
+                const size_t grain = 256;
+
+                xi_parallel::parallel_for(0, count, grain, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const size_t j = first + i * step;
+                        const long double t = std::cos(detail::pi() * static_cast<long double>(j) / static_cast<long double>(N));
+                        values[j] = static_cast<long double>(f(from_unit(t)));
+                    }
+                    xi_parallel::checkpoint(end - begin);
+                });
+
+                XI_COUNT(INTEGRAL, EVALUATIONS, count);
+                _evaluations += count;
+            }
+        public:
+            Chebyshev() : _c(1, 0.0L) {};
+
+            /*
+                Adaptive proxy of f on [ a, b ], the degree doubles until the coefficients have
+                decayed to options.tolerance or options.max_degree is reached (converged() is
+                false then, the proxy keeps the largest expansion)
+            */
+            template <typename Func>
+            Chebyshev(Func&& f, long double a, long double b, const Options& options = Options()) : _a(a), _b(b)
+            {
+                assert(b > a && "Interval must have b > a");
+                XI_TIME_CALL(INTEGRAL);
+
+                size_t N = 16;
+                std::vector<long double> values(N + 1);
+                sample(f, values, N, 0, 1);
+
+                while (true)
+                {
+                    std::vector<long double> c = detail::coefficients_from_values(values);
+                    const size_t length = detail::chop(c, options.tolerance);
+
+                    if (length != 0 || 2 * N > options.max_degree)
+                    {
+                        _converged = length != 0;
+                        c.resize(length != 0 ? length : c.size());
+                        _c = std::move(c);
+                        return;
+                    }
+
+                    // The old grid is every other point of the new one
+                    std::vector<long double> refined(2 * N + 1);
+                    for (size_t j = 0; j <= N; ++j) refined[2 * j] = values[j];
+                    N *= 2;
+                    sample(f, refined, N, 1, 2);
+                    values = std::move(refined);
+                }
+            }
+
+            /*
+                Proxy of a fixed [ degree ] (degree + 1 samples)
+            */
+            template <typename Func>
+            Chebyshev(Func&& f, long double a, long double b, size_t degree) : _a(a), _b(b)
+            {
+                assert(b > a && "Interval must have b > a");
+                XI_TIME_CALL(INTEGRAL);
+
+                std::vector<long double> values(degree + 1);
+                if (degree == 0)
+                {
+                    values[0] = static_cast<long double>(f(from_unit(0)));
+                    ++_evaluations;
+                    XI_COUNT(INTEGRAL, EVALUATIONS, 1);
+                }
+                else
+                {
+                    sample(f, values, degree, 0, 1);
+                }
+                _c = detail::coefficients_from_values(values);
+            }
+
+            /*
+                sum c_k T_k mapped to [ a, b ]
+            */
+            static Chebyshev from_coefficients(std::vector<long double> coefficients, long double a, long double b)
+            {
+                assert(b > a && "Interval must have b > a");
+
+                Chebyshev p;
+                p._c = coefficients.empty() ? std::vector<long double>(1, 0.0L) : std::move(coefficients);
+                p._a = a;
+                p._b = b;
+                return p;
+            }
+
+            size_t degree() const { return _c.size() - 1; }
+
+            const std::vector<long double>& coefficients() const { return _c; }
+
+            long double a() const { return _a; }
+
+            long double b() const { return _b; }
+
+            /*
+                Samples of the original function taken to build this proxy
+            */
+            size_t evaluations() const { return _evaluations; }
+
+            bool converged() const { return _converged; }
+
+            /*
+                Clenshaw recurrence, x outside [ a, b ] extrapolates
+            */
+            long double operator()(long double x) const
+            {
+                const long double t = to_unit(x);
+                long double b1 = 0, b2 = 0;
+                for (size_t k = _c.size() - 1; k > 0; --k)
+                {
+                    const long double b0 = _c[k] + 2 * t * b1 - b2;
+                    b2 = b1;
+                    b1 = b0;
+                }
+                return _c[0] + t * b1 - b2;
+            }
+
+            /*
+                Derivative of the given [ order ] as a proxy of degree - order
+            */
+            Chebyshev derivative(size_t order = 1) const
+            {
+                Chebyshev p = *this;
+                p._evaluations = 0;
+
+                for (size_t m = 0; m < order; ++m)
+                {
+                    const size_t n = p._c.size() - 1;
+                    if (n == 0)
+                    {
+                        p._c.assign(1, 0.0L);
+                        break;
+                    }
+
+                    // c'_{k-1} = c'_{k+1} + 2 k c_k, c'_0 halved
+                    std::vector<long double> d(n + 2, 0.0L);
+                    for (size_t k = n; k >= 1; --k)
+                    {
+                        d[k - 1] = d[k + 1] + 2 * static_cast<long double>(k) * p._c[k];
+                    }
+                    d[0] /= 2;
+                    d.resize(n);
+
+                    const long double scale = 2 / (_b - _a);
+                    for (long double& dk : d) dk *= scale;
+                    p._c = std::move(d);
+                }
+                return p;
+            }
+
+            /*
+                Antiderivative vanishing at a, degree + 1
+            */
+            Chebyshev antiderivative() const
+            {
+                const size_t n = _c.size() - 1;
+                const long double scale = (_b - _a) / 2;
+                auto c = [&](size_t k) { return k <= n ? _c[k] : 0.0L; };
+
+                std::vector<long double> C(n + 2, 0.0L);
+                C[1] = scale * (c(0) - c(2) / 2);
+                for (size_t k = 2; k <= n + 1; ++k)
+                {
+                    C[k] = scale * (c(k - 1) - c(k + 1)) / (2 * static_cast<long double>(k));
+                }
+
+                // Value at t = -1 is sum (-1)^k C_k
+                long double at_a = 0;
+                for (size_t k = 1; k <= n + 1; ++k) at_a += (k & 1) ? -C[k] : C[k];
+                C[0] = -at_a;
+
+                return from_coefficients(std::move(C), _a, _b);
+            }
+
+            /*
+                Integral over [ a, b ]: sum over even k of 2 c_k / (1 - k^2), scaled to the interval
+            */
+            long double integral() const
+            {
+                long double sum = 0;
+                for (size_t k = 0; k < _c.size(); k += 2)
+                {
+                    sum += 2 * _c[k] / (1 - static_cast<long double>(k) * static_cast<long double>(k));
+                }
+                return sum * (_b - _a) / 2;
+            }
+
+            /*
+                Integral over [ lo, hi ] inside [ a, b ], through the antiderivative
+                Build antiderivative() once instead when integrating over many subintervals
+            */
+            long double integral(long double lo, long double hi) const
+            {
+                const Chebyshev F = antiderivative();
+                return F(hi) - F(lo);
+            }
+
+            /*
+                Real roots in [ a, b ], in increasing order
+                Sign changes are located on a Chebyshev grid of at least 4 (degree + 1) points,
+                evaluated with one DCT, and refined by Brent's method on the proxy. Roots of even
+                multiplicity (touching zero without a sign change) are only found if they fall on
+                the grid
+            */
+            std::vector<long double> roots() const
+            {
+                std::vector<long double> found;
+                const size_t n = degree();
+                if (n == 0) return found;
+
+                const size_t N = xi_fft::good_size(std::max<size_t>(16, 4 * (n + 1)));
+
+                const std::vector<long double> values = detail::values_from_coefficients(_c, N);
+                long double scale = 0;
+                for (long double v : values) scale = std::max(scale, std::fabs(v));
+                if (scale == 0) return found;
+
+                // Grid runs from t = 1 (j = 0) down to t = -1 (j = N)
+                auto point = [&](size_t j) {
+                    return from_unit(std::cos(detail::pi() * static_cast<long double>(j) / static_cast<long double>(N)));
+                };
+
+                xi_roots::Options options;
+                options.tolerance = 4 * std::numeric_limits<long double>::epsilon();
+                auto proxy = [this](long double x) { return (*this)(x); };
+
+                for (size_t j = N + 1; j-- > 0; )
+                {
+                    if (values[j] == 0)
+                    {
+                        found.push_back(point(j));
+                    }
+                    else if (j > 0 && values[j - 1] != 0 && (values[j] < 0) != (values[j - 1] < 0))
+                    {
+                        // The grid values come from the DCT, recheck the bracket with Clenshaw
+                        const long double lo = point(j), hi = point(j - 1);
+                        const long double f_lo = proxy(lo), f_hi = proxy(hi);
+                        if ((f_lo < 0) != (f_hi < 0) || f_lo == 0 || f_hi == 0)
+                        {
+                            found.push_back(xi_roots::brent(proxy, lo, hi, options).root);
+                        }
+                        else
+                        {
+                            found.push_back(std::fabs(f_lo) < std::fabs(f_hi) ? lo : hi);
+                        }
+                    }
+                }
+
+                std::sort(found.begin(), found.end());
+                found.erase(std::unique(found.begin(), found.end()), found.end());
+                return found;
+            }
+    };
+}
+
+#endif
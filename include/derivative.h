@@ -1,10 +1,15 @@
 #ifndef XI_DERIVATIVE
 #define XI_DERIVATIVE
 
+#include <algorithm>
 #include <cmath>
 #include "math_consts.h"
+#include "instrument.h"
+#include "matrix.h"
+#include "memo.h"
 #include <type_traits>
 #include <limits>
+#include <vector>
 
 namespace xi_derivative
 {
@@ -25,20 +30,82 @@ namespace xi_derivative
             h = std::pow(std::numeric_limits<long double>::epsilon(), 0.5);
         }
 
+        XI_TIME_CALL(DERIVATIVE);
+        [[maybe_unused]] const uint64_t misses = xi_instrument::enabled ? xi_memo::misses(f) : 0;
+
         long double xl = static_cast<long double>(x);
         long double hl = static_cast<long double>(h);
 
-        // Five-point stencil at step size h
-        long double D_h = (-f(xl + 2 * hl) + 8 * f(xl + hl) - 8 * f(xl - hl) + f(xl - 2 * hl)) / (12 * hl);
+        // Five-point stencil at step size h, f(x +- h) is shared with the stencil at h / 2
+        const long double f_p1 = f(xl + hl);
+        const long double f_m1 = f(xl - hl);
+        long double D_h = (-f(xl + 2 * hl) + 8 * f_p1 - 8 * f_m1 + f(xl - 2 * hl)) / (12 * hl);
 
         hl /= 2;  
-        long double D_h2 = (-f(xl + 2 * hl) + 8 * f(xl + hl) - 8 * f(xl - hl) + f(xl - 2 * hl)) / (12 * hl);
+        long double D_h2 = (-f_p1 + 8 * f(xl + hl) - 8 * f(xl - hl) + f_m1) / (12 * hl);
+
+        XI_COUNT(DERIVATIVE, EVALUATIONS, xi_memo::evaluations(f, misses, 6));
 
         // Richardson extrapolation
         long double D_extrapolated = (16 * D_h2 - D_h) / 15;
 
         return D_extrapolated;
     }
+
+    /*
+        Jacobian J(i, j) = d f_i / d x_j of a vector function at [ x ], one column at a time with
+        the same five-point stencil and Richardson extrapolation as definite_derivative
+
+        f takes a const std::vector<T>& and returns an indexable container (std::vector<T>, ...)
+        with size(), it is evaluated once at x and 6 times per column (the +-h points are shared
+        between both stencils)
+        Unless [ h ] is given every column steps by eps^(1/7) * max(1, |x_j|), where the O(h^6)
+        error left after extrapolation and the rounding error of the differences balance
+    */
+    template <typename Func, typename T>
+    inline xi_matrix::Matrix_Numerical<T> jacobian(Func&& f, const std::vector<T>& x, long double h = -1)
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Jacobians require a floating point type"
+        );
+
+        XI_TIME_CALL(DERIVATIVE);
+
+        const size_t n = x.size();
+        const size_t m = f(x).size();
+        XI_COUNT(DERIVATIVE, EVALUATIONS, 1 + 6 * n);
+
+        xi_matrix::Matrix_Numerical<T> J(m, n);
+        std::vector<T> xp = x;
+        const T scale = std::pow(std::numeric_limits<T>::epsilon(), T(1) / 7);
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            const T hj = h > 0 ? static_cast<T>(h) : scale * std::max(T(1), std::fabs(x[j]));
+
+            auto at = [&](T offset) {
+                xp[j] = x[j] + offset;
+                return f(xp);
+            };
+
+            // Five-point stencils at step sizes hj and hj / 2
+            const auto p2 = at(2 * hj), p1 = at(hj), m1 = at(-hj), m2 = at(-2 * hj);
+            const auto q1 = at(hj / 2), n1 = at(-hj / 2);
+            xp[j] = x[j];
+
+            for (size_t i = 0; i < m; ++i)
+            {
+                const T D_h = (-static_cast<T>(p2[i]) + 8 * static_cast<T>(p1[i]) - 8 * static_cast<T>(m1[i]) + static_cast<T>(m2[i])) / (12 * hj);
+                const T D_h2 = (-static_cast<T>(p1[i]) + 8 * static_cast<T>(q1[i]) - 8 * static_cast<T>(n1[i]) + static_cast<T>(m1[i])) / (6 * hj);
+
+                // Richardson extrapolation
+                J(i, j) = (16 * D_h2 - D_h) / 15;
+            }
+        }
+
+        return J;
+    }
 }
 
 
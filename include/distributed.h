@@ -0,0 +1,1011 @@
+#ifndef XI_DISTRIBUTED
+#define XI_DISTRIBUTED
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "integral.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "reduction.h"
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+    Multi-process execution of matrix products, reductions and integration (Linux)
+
+    launch(body, options) forks options.processes cooperating worker processes (by default one per
+    NUMA node), pins each to the CPUs of one node and runs body(Communicator&) in all of them;
+    the caller waits and rethrows the first failure. Worker processes start their own xi_parallel
+    pool on the node they are pinned to, so every buffer a worker allocates and fills is placed
+    on its node by the kernel's first-touch policy
+
+    Processes exchange messages through a Transport. SocketTransport, a full mesh of Unix domain
+    socket pairs, is built in; anything else (MPI, TCP, RDMA) can be plugged in by implementing
+    Transport and driving the collectives of Communicator over it. SharedArray is memory mapped
+    shared between the caller and every worker, results are written straight into it
+
+        xi_distributed::launch([&](xi_distributed::Communicator& comm) {
+            auto layout = xi_distributed::block_cyclic(n, n, comm.size());
+            xi_distributed::DistributedMatrix<double> A(comm, layout), B(comm, layout), C(comm, layout);
+            A.assign(a);  B.assign(b);                    // every worker copies only its own blocks
+            xi_distributed::summa(comm, A, B, C);
+            C.store(result.view(n, n));                   // result is a SharedArray<double>
+        });
+
+    or, for a one-off product of in-memory matrices, xi_distributed::multiply(a, b)
+
+    Matrices are distributed 2-D block-cyclically over a process_rows x process_cols grid
+    (ScaLAPACK layout): block (I, J) lives on process (I mod process_rows, J mod process_cols),
+    which stores its blocks contiguously in one local Matrix_Numerical
+    summa() is the SUMMA product (van de Geijn and Watts, 1997): for every block column k of A the
+    owners broadcast their panel of A along process rows and their panel of B along process
+    columns, and each process adds the panel product to its local part of C
+
+    launch() must not be called while xi work is running on other threads (see
+    xi_parallel::fork_process), and the worker processes leave through _exit, so they run no
+    static destructors or atexit handlers
+*/
+namespace xi_distributed
+{
+    /*
+        Ordered, reliable byte streams between every pair of processes
+        Messages between two processes arrive in the order they were sent, a receive blocks until
+        all of its bytes have arrived
+    */
+    class Transport
+    {
+        public:
+            virtual ~Transport() = default;
+
+            virtual size_t rank() const = 0;
+
+            virtual size_t size() const = 0;
+
+            virtual void send(size_t to, const void* data, size_t bytes) = 0;
+
+            virtual void receive(size_t from, void* data, size_t bytes) = 0;
+    };
+
+    /*
+        Transport over one connected Unix domain stream socket per peer, as set up by launch()
+    */
+    class SocketTransport : public Transport
+    {
+        private:
+            size_t _rank;
+            std::vector<int> _peers;
+        public:
+            /*
+                [ peers ] holds the socket connected to every other process, -1 at [ rank ]
+                The transport owns and closes the sockets
+            */
+            SocketTransport(size_t rank, std::vector<int> peers) : _rank(rank), _peers(std::move(peers)) {};
+
+            SocketTransport(const SocketTransport&) = delete;
+
+            SocketTransport& operator=(const SocketTransport&) = delete;
+
+            ~SocketTransport() override
+            {
+                for (int fd : _peers)
+                {
+                    if (fd >= 0) ::close(fd);
+                }
+            }
+
+            size_t rank() const override { return _rank; }
+
+            size_t size() const override { return _peers.size(); }
+
+            void send(size_t to, const void* data, size_t bytes) override
+            {
+                assert(to < _peers.size() && to != _rank && "Messages go to another process");
+
+                const char* p = static_cast<const char*>(data);
+                while (bytes > 0)
+                {
+                    ssize_t sent = ::send(_peers[to], p, bytes, MSG_NOSIGNAL);
+                    if (sent < 0 && errno == EINTR) continue;
+                    if (sent <= 0)
+                    {
+                        throw std::runtime_error("xi_distributed: send to process " + std::to_string(to) + " failed (" + std::strerror(errno) + ")");
+                    }
+                    p += sent;
+                    bytes -= static_cast<size_t>(sent);
+                }
+            }
+
+            void receive(size_t from, void* data, size_t bytes) override
+            {
+                assert(from < _peers.size() && from != _rank && "Messages come from another process");
+
+                char* p = static_cast<char*>(data);
+                while (bytes > 0)
+                {
+                    ssize_t got = ::recv(_peers[from], p, bytes, 0);
+                    if (got < 0 && errno == EINTR) continue;
+                    if (got == 0)
+                    {
+                        throw std::runtime_error("xi_distributed: process " + std::to_string(from) + " closed its connection");
+                    }
+                    if (got < 0)
+                    {
+                        throw std::runtime_error("xi_distributed: receive from process " + std::to_string(from) + " failed (" + std::strerror(errno) + ")");
+                    }
+                    p += got;
+                    bytes -= static_cast<size_t>(got);
+                }
+            }
+    };
+
+    /*
+        Typed point to point messages and collectives over a Transport
+        Every process of the group has to enter the same collectives in the same order
+        Reductions combine contributions in rank order, so results do not depend on timing
+    */
+    class Communicator
+    {
+        private:
+            Transport& _transport;
+
+            template <typename T>
+            static void check_type()
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be sent between processes");
+            }
+        public:
+            explicit Communicator(Transport& transport) : _transport(transport) {};
+
+            size_t rank() const { return _transport.rank(); }
+
+            size_t size() const { return _transport.size(); }
+
+            Transport& transport() const { return _transport; }
+
+            template <typename T>
+            void send(size_t to, const T* data, size_t count)
+            {
+                check_type<T>();
+                _transport.send(to, data, count * sizeof(T));
+            }
+
+            template <typename T>
+            void receive(size_t from, T* data, size_t count)
+            {
+                check_type<T>();
+                _transport.receive(from, data, count * sizeof(T));
+            }
+
+            /*
+                Copies [ count ] elements at [ data ] on [ root ] to every process of [ group ]
+                (ranks, including root), binomial tree so the root sends log2(group size) times
+                Processes outside the group must not call it
+            */
+            template <typename T>
+            void broadcast(T* data, size_t count, const std::vector<size_t>& group, size_t root)
+            {
+                check_type<T>();
+                const size_t g = group.size();
+                if (g <= 1 || count == 0) return;
+
+                const size_t self = static_cast<size_t>(std::find(group.begin(), group.end(), rank()) - group.begin());
+                const size_t top = static_cast<size_t>(std::find(group.begin(), group.end(), root) - group.begin());
+                assert(self < g && top < g && "Broadcast root and caller must belong to the group");
+
+                // positions relative to the root: receive from the parent, then send to the children
+                const size_t v = (self + g - top) % g;
+                size_t mask = 1;
+                while (mask < g)
+                {
+                    if (v & mask)
+                    {
+                        receive(group[(v - mask + top) % g], data, count);
+                        break;
+                    }
+                    mask <<= 1;
+                }
+
+                for (mask >>= 1; mask > 0; mask >>= 1)
+                {
+                    if (v + mask < g)
+                    {
+                        send(group[(v + mask + top) % g], data, count);
+                    }
+                }
+            }
+
+            template <typename T>
+            void broadcast(T* data, size_t count, size_t root = 0)
+            {
+                std::vector<size_t> everyone(size());
+                for (size_t r = 0; r < everyone.size(); ++r)
+                {
+                    everyone[r] = r;
+                }
+                broadcast(data, count, everyone, root);
+            }
+
+            /*
+                data[k] = op(... op(op(data_0[k], data_1[k]), data_2[k]) ...) on [ root ],
+                the buffers of the other processes are left as they were
+            */
+            template <typename T, typename Op>
+            void reduce(T* data, size_t count, size_t root, Op op)
+            {
+                check_type<T>();
+                if (rank() != root)
+                {
+                    send(root, data, count);
+                    return;
+                }
+
+                std::vector<T> own(data, data + count);
+                std::vector<T> other(count);
+                for (size_t r = 0; r < size(); ++r)
+                {
+                    const T* contribution = own.data();
+                    if (r != root)
+                    {
+                        receive(r, other.data(), count);
+                        contribution = other.data();
+                    }
+
+                    for (size_t k = 0; k < count; ++k)
+                    {
+                        data[k] = r == 0 ? contribution[k] : op(data[k], contribution[k]);
+                    }
+                }
+            }
+
+            /*
+                reduce to process 0, then broadcast the result to everyone
+            */
+            template <typename T, typename Op>
+            void allreduce(T* data, size_t count, Op op)
+            {
+                reduce(data, count, 0, op);
+                broadcast(data, count, 0);
+            }
+
+            template <typename T, typename Op>
+            T allreduce(T value, Op op)
+            {
+                allreduce(&value, 1, op);
+                return value;
+            }
+
+            template <typename T>
+            T allreduce_sum(T value)
+            {
+                return allreduce(value, [](T x, T y) { return x + y; });
+            }
+
+            void barrier()
+            {
+                allreduce(char(0), [](char x, char) { return x; });
+            }
+    };
+
+    /*
+        Memory shared by the process that creates it and every process it launches afterwards,
+        move only. Pages are only placed (on the NUMA node of the first process to write them)
+        when they are first touched
+    */
+    template <typename T>
+    class SharedArray
+    {
+        private:
+            T* _data;
+            size_t _size;
+
+            void release()
+            {
+                if (_data != nullptr)
+                {
+                    ::munmap(_data, _size * sizeof(T));
+                    _data = nullptr;
+                    _size = 0;
+                }
+            }
+        public:
+            static_assert(std::is_trivially_copyable<T>::value, "Shared arrays hold trivially copyable types only");
+
+            explicit SharedArray(size_t size) : _data(nullptr), _size(size)
+            {
+                if (size == 0) return;
+
+                void* map = ::mmap(nullptr, size * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+                if (map == MAP_FAILED)
+                {
+                    throw std::runtime_error(std::string("xi_distributed: failed to map shared memory (") + std::strerror(errno) + ")");
+                }
+                _data = static_cast<T*>(map);
+            };
+
+            SharedArray(const SharedArray&) = delete;
+
+            SharedArray& operator=(const SharedArray&) = delete;
+
+            SharedArray(SharedArray&& other) noexcept : _data(other._data), _size(other._size)
+            {
+                other._data = nullptr;
+                other._size = 0;
+            };
+
+            SharedArray& operator=(SharedArray&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    _data = other._data;
+                    _size = other._size;
+                    other._data = nullptr;
+                    other._size = 0;
+                }
+                return *this;
+            }
+
+            ~SharedArray() { release(); }
+
+            T* data() const { return _data; }
+
+            size_t size() const { return _size; }
+
+            T& operator[](size_t k) const { return _data[k]; }
+
+            /*
+                Dense row-major rows x cols view of the first rows * cols elements
+            */
+            xi_matrix::MatrixView<T> view(size_t rows, size_t cols) const
+            {
+                assert(rows * cols <= _size && "View does not fit in the shared array");
+                return xi_matrix::MatrixView<T>(_data, rows, cols, static_cast<std::ptrdiff_t>(cols));
+            }
+    };
+
+    struct LaunchOptions
+    {
+        /*
+            Worker processes, 0 starts one per NUMA node
+        */
+        size_t processes = 0;
+
+        /*
+            xi_parallel threads of every worker, 0 uses the CPUs of its node (or an even share of
+            the machine without pinning)
+        */
+        size_t threads_per_process = 0;
+
+        /*
+            Pins worker r to the CPUs of NUMA node r mod (number of nodes)
+        */
+        bool pin_numa = true;
+    };
+
+    namespace detail
+    {
+        /*
+            Body of worker [ rank ]: pins it, runs [ body ] and leaves through _exit, a failure
+            message goes into the worker's slot of [ errors ]
+        */
+        template <typename F>
+        [[noreturn]] inline void run_worker(size_t rank, std::vector<int> peers, const std::vector<int>& cpus,
+                                            F& body, const SharedArray<char>& errors, size_t slot)
+        {
+            int status = 0;
+            try
+            {
+#ifdef __linux__
+                if (!cpus.empty())
+                {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    for (int cpu : cpus)
+                    {
+                        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+                    }
+                    ::sched_setaffinity(0, sizeof(set), &set);
+                }
+#else
+                (void)cpus;
+#endif
+                SocketTransport transport(rank, std::move(peers));
+                Communicator comm(transport);
+                body(comm);
+            }
+            catch (const std::exception& e)
+            {
+                std::snprintf(errors.data() + rank * slot, slot, "%s", e.what());
+                status = 1;
+            }
+            catch (...)
+            {
+                std::snprintf(errors.data() + rank * slot, slot, "unknown exception");
+                status = 1;
+            }
+
+            std::cout.flush();
+            std::cerr.flush();
+            std::fflush(nullptr);
+            ::_exit(status);
+        }
+    }
+
+    /*
+        Runs body(Communicator&) in options.processes forked worker processes and waits for all of
+        them, throws std::runtime_error naming every worker that threw or died
+        The workers see a copy-on-write snapshot of the caller's memory, results have to come
+        back through a SharedArray created before the call (or through the transport)
+    */
+    template <typename F>
+    inline void launch(F&& body, const LaunchOptions& options = LaunchOptions())
+    {
+        const std::vector<std::vector<int>> nodes = xi_parallel::detail::numa_nodes();
+        const size_t processes = options.processes ? options.processes : nodes.size();
+        const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+
+        constexpr size_t slot = 256;
+        SharedArray<char> errors(processes * slot);
+
+        // full mesh, sockets[i][j] is the end process i uses to talk to process j
+        std::vector<std::vector<int>> sockets(processes, std::vector<int>(processes, -1));
+        auto close_all = [&sockets]() {
+            for (auto& row : sockets)
+            {
+                for (int& fd : row)
+                {
+                    if (fd >= 0) ::close(fd);
+                    fd = -1;
+                }
+            }
+        };
+
+        for (size_t i = 0; i < processes; ++i)
+        {
+            for (size_t j = i + 1; j < processes; ++j)
+            {
+                int pair[2];
+                if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+                {
+                    close_all();
+                    throw std::runtime_error(std::string("xi_distributed: failed to create sockets (") + std::strerror(errno) + ")");
+                }
+                sockets[i][j] = pair[0];
+                sockets[j][i] = pair[1];
+            }
+        }
+
+        std::fflush(nullptr);
+        std::cout.flush();
+
+        std::vector<pid_t> workers;
+        for (size_t r = 0; r < processes; ++r)
+        {
+            const std::vector<int> no_cpus;
+            const std::vector<int>& cpus = options.pin_numa ? nodes[r % nodes.size()] : no_cpus;
+
+            xi_parallel::PoolOptions pool;
+            pool.threads = options.threads_per_process
+                ? options.threads_per_process
+                : (options.pin_numa ? cpus.size() : std::max<size_t>(1, hardware / processes));
+
+            const pid_t pid = xi_parallel::fork_process(pool);
+            if (pid < 0)
+            {
+                const std::string reason = std::strerror(errno);
+                close_all();
+                for (pid_t w : workers)
+                {
+                    int status;
+                    ::waitpid(w, &status, 0);
+                }
+                throw std::runtime_error("xi_distributed: failed to start worker process (" + reason + ")");
+            }
+
+            if (pid == 0)
+            {
+                std::vector<int> peers = sockets[r];
+                for (size_t i = 0; i < processes; ++i)
+                {
+                    for (size_t j = 0; j < processes; ++j)
+                    {
+                        if (i != r && sockets[i][j] >= 0) ::close(sockets[i][j]);
+                    }
+                }
+                detail::run_worker(r, std::move(peers), cpus, body, errors, slot);
+            }
+
+            workers.push_back(pid);
+        }
+
+        close_all();
+
+        std::string failure;
+        for (size_t r = 0; r < workers.size(); ++r)
+        {
+            int status = 0;
+            while (::waitpid(workers[r], &status, 0) < 0 && errno == EINTR)
+            {
+            }
+
+            // every failure is reported, the first one is often only a peer noticing another's exit
+            std::string reason;
+            if (WIFSIGNALED(status))
+            {
+                reason = "worker " + std::to_string(r) + " was killed by signal " + std::to_string(WTERMSIG(status));
+            }
+            else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+            {
+                reason = "worker " + std::to_string(r) + " failed: " + std::string(errors.data() + r * slot);
+            }
+            if (!reason.empty())
+            {
+                failure += (failure.empty() ? "" : "; ") + reason;
+            }
+        }
+
+        if (!failure.empty())
+        {
+            throw std::runtime_error("xi_distributed: " + failure);
+        }
+    }
+
+    /*
+        2-D block-cyclic distribution of a rows x cols matrix over a process_rows x process_cols
+        grid, process (p, q) has rank p * process_cols + q
+    */
+    struct BlockCyclic
+    {
+        size_t rows = 0;
+        size_t cols = 0;
+        size_t block_rows = 128;
+        size_t block_cols = 128;
+        size_t process_rows = 1;
+        size_t process_cols = 1;
+
+        size_t processes() const { return process_rows * process_cols; }
+
+        /*
+            Elements of a dimension of length [ n ] in blocks of [ b ] dealt over [ p ] processes
+            that process [ index ] holds (ScaLAPACK's numroc)
+        */
+        static size_t local_length(size_t n, size_t b, size_t p, size_t index)
+        {
+            const size_t blocks = (n + b - 1) / b;
+            size_t length = (blocks / p + (index < blocks % p ? 1 : 0)) * b;
+            if (blocks > 0 && (blocks - 1) % p == index)
+            {
+                length -= blocks * b - n;
+            }
+            return length;
+        }
+
+        size_t local_rows(size_t process_row) const { return local_length(rows, block_rows, process_rows, process_row); }
+
+        size_t local_cols(size_t process_col) const { return local_length(cols, block_cols, process_cols, process_col); }
+
+        size_t owner(size_t row, size_t col) const
+        {
+            return (row / block_rows % process_rows) * process_cols + col / block_cols % process_cols;
+        }
+
+        /*
+            Position of a global row / column inside the local matrix of the process that owns it
+        */
+        size_t local_row(size_t row) const { return row / (block_rows * process_rows) * block_rows + row % block_rows; }
+
+        size_t local_col(size_t col) const { return col / (block_cols * process_cols) * block_cols + col % block_cols; }
+
+        /*
+            Global row / column of local row / column [ local ] of process row / column [ p ]
+        */
+        size_t global_row(size_t p, size_t local) const
+        {
+            return ((local / block_rows) * process_rows + p) * block_rows + local % block_rows;
+        }
+
+        size_t global_col(size_t q, size_t local) const
+        {
+            return ((local / block_cols) * process_cols + q) * block_cols + local % block_cols;
+        }
+    };
+
+    /*
+        Most square process grid with process_rows * process_cols == processes, process_rows <= process_cols
+    */
+    inline std::pair<size_t, size_t> process_grid(size_t processes)
+    {
+        size_t rows = 1;
+        for (size_t r = 1; r * r <= processes; ++r)
+        {
+            if (processes % r == 0) rows = r;
+        }
+        return { rows, processes / rows };
+    }
+
+    inline BlockCyclic block_cyclic(size_t rows, size_t cols, size_t processes, size_t block_rows = 128, size_t block_cols = 128)
+    {
+        assert(block_rows > 0 && block_cols > 0 && "Blocks must not be empty");
+        const auto grid = process_grid(processes);
+        BlockCyclic layout;
+        layout.rows = rows;
+        layout.cols = cols;
+        layout.block_rows = block_rows;
+        layout.block_cols = block_cols;
+        layout.process_rows = grid.first;
+        layout.process_cols = grid.second;
+        return layout;
+    }
+
+    /*
+        The part of a block-cyclically distributed matrix owned by one process, its blocks packed
+        into one local_rows x local_cols Matrix_Numerical that is allocated and zeroed (first
+        touched) by the owning process
+    */
+    template <typename T>
+    class DistributedMatrix
+    {
+        private:
+            BlockCyclic _layout;
+            size_t _process_row;
+            size_t _process_col;
+            xi_matrix::Matrix_Numerical<T> _local;
+
+            /*
+                Calls f(global_row, global_col, local_row, local_col, rows, cols) for every owned block
+            */
+            template <typename F>
+            void for_each_block(F&& f) const
+            {
+                const size_t lr = _local.rows();
+                const size_t lc = _local.cols();
+                for (size_t li = 0; li < lr; li += _layout.block_rows)
+                {
+                    const size_t h = std::min(_layout.block_rows, lr - li);
+                    for (size_t lj = 0; lj < lc; lj += _layout.block_cols)
+                    {
+                        const size_t w = std::min(_layout.block_cols, lc - lj);
+                        f(_layout.global_row(_process_row, li), _layout.global_col(_process_col, lj), li, lj, h, w);
+                    }
+                }
+            }
+        public:
+            DistributedMatrix(const Communicator& comm, const BlockCyclic& layout)
+                : _layout(layout),
+                  _process_row(comm.rank() / layout.process_cols),
+                  _process_col(comm.rank() % layout.process_cols),
+                  _local(layout.local_rows(comm.rank() / layout.process_cols), layout.local_cols(comm.rank() % layout.process_cols))
+            {
+                assert(layout.processes() == comm.size() && "Process grid must cover every process of the communicator");
+            };
+
+            const BlockCyclic& layout() const { return _layout; }
+
+            size_t rows() const { return _layout.rows; };
+
+            size_t cols() const { return _layout.cols; };
+
+            size_t process_row() const { return _process_row; };
+
+            size_t process_col() const { return _process_col; };
+
+            xi_matrix::Matrix_Numerical<T>& local() { return _local; }
+
+            const xi_matrix::Matrix_Numerical<T>& local() const { return _local; }
+
+            /*
+                Copies the owned blocks out of a global matrix or view this process can read, such
+                as one inherited from the caller of launch() or held in a SharedArray
+            */
+            template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value>>
+            void assign(const M& global)
+            {
+                auto v = xi_matrix::detail::as_view(global);
+                assert(v.rows() == rows() && v.cols() == cols() && "Matrix dimensions must match the distributed matrix");
+
+                auto local = _local.view();
+                for_each_block([&](size_t gi, size_t gj, size_t li, size_t lj, size_t h, size_t w) {
+                    local.block(li, lj, h, w).assign(v.block(gi, gj, h, w));
+                });
+            }
+
+            /*
+                Writes the owned blocks into a global view, e.g. of a SharedArray every process
+                stores into
+            */
+            void store(xi_matrix::MatrixView<T> global) const
+            {
+                assert(global.rows() == rows() && global.cols() == cols() && "Matrix dimensions must match the distributed matrix");
+
+                auto local = _local.view();
+                for_each_block([&](size_t gi, size_t gj, size_t li, size_t lj, size_t h, size_t w) {
+                    global.block(gi, gj, h, w).assign(local.block(li, lj, h, w));
+                });
+            }
+
+            /*
+                Collects the whole matrix on [ root ] through the transport, the other processes
+                get an empty matrix
+            */
+            xi_matrix::Matrix_Numerical<T> gather(Communicator& comm, size_t root = 0) const
+            {
+                if (comm.rank() != root)
+                {
+                    comm.send(root, _local.data(), _local.rows() * _local.cols());
+                    return xi_matrix::Matrix_Numerical<T>();
+                }
+
+                xi_matrix::Matrix_Numerical<T> result(rows(), cols());
+                for (size_t r = 0; r < comm.size(); ++r)
+                {
+                    DistributedMatrix<T> part(_layout, r / _layout.process_cols, r % _layout.process_cols);
+                    if (r == root)
+                    {
+                        part._local = _local;
+                    }
+                    else
+                    {
+                        comm.receive(r, part._local.data(), part._local.rows() * part._local.cols());
+                    }
+                    part.store(result.view());
+                }
+                return result;
+            }
+
+        private:
+            DistributedMatrix(const BlockCyclic& layout, size_t process_row, size_t process_col)
+                : _layout(layout), _process_row(process_row), _process_col(process_col),
+                  _local(layout.local_rows(process_row), layout.local_cols(process_col)) {};
+    };
+
+    /*
+        c = a * b by SUMMA, all three on the same process grid with a.block_cols == b.block_rows,
+        c.block_rows == a.block_rows and c.block_cols == b.block_cols
+        Each step broadcasts one block column of A along the process rows and one block row of B
+        along the process columns, then multiplies them locally on the xi_parallel pool
+    */
+    template <typename T>
+    inline void summa(Communicator& comm, const DistributedMatrix<T>& a, const DistributedMatrix<T>& b, DistributedMatrix<T>& c)
+    {
+        const BlockCyclic& la = a.layout();
+        const BlockCyclic& lb = b.layout();
+        const BlockCyclic& lc = c.layout();
+        assert(
+            la.cols == lb.rows && lc.rows == la.rows && lc.cols == lb.cols &&
+            "Matrix dimensions must match up for multiplication"
+        );
+        assert(
+            la.process_rows == lc.process_rows && la.process_cols == lc.process_cols &&
+            lb.process_rows == lc.process_rows && lb.process_cols == lc.process_cols &&
+            la.block_cols == lb.block_rows && lc.block_rows == la.block_rows && lc.block_cols == lb.block_cols &&
+            "Operands of a distributed product must share the process grid and matching block sizes"
+        );
+
+        XI_TIME_CALL(MATRIX);
+
+        const size_t pr = lc.process_rows;
+        const size_t pc = lc.process_cols;
+        const size_t p = c.process_row();
+        const size_t q = c.process_col();
+
+        std::vector<size_t> row_group(pc);
+        std::vector<size_t> col_group(pr);
+        for (size_t k = 0; k < pc; ++k) row_group[k] = p * pc + k;
+        for (size_t k = 0; k < pr; ++k) col_group[k] = k * pc + q;
+
+        xi_matrix::Matrix_Numerical<T>& out = c.local();
+        const size_t m = out.rows();
+        const size_t n = out.cols();
+        const size_t kb = la.block_cols;
+        const size_t panels = (la.cols + kb - 1) / kb;
+
+        out.view().fill(T(0));
+        if (panels == 0) return;
+
+        std::vector<T> a_panel(m * kb);
+        std::vector<T> b_panel(kb * n);
+        xi_matrix::Matrix_Numerical<T> partial(m, n);
+
+        for (size_t panel = 0; panel < panels; ++panel)
+        {
+            const size_t width = std::min(kb, la.cols - panel * kb);
+            const size_t owner_col = panel % pc;
+            const size_t owner_row = panel % pr;
+
+            xi_matrix::MatrixView<T> ap(a_panel.data(), m, width, static_cast<std::ptrdiff_t>(width));
+            xi_matrix::MatrixView<T> bp(b_panel.data(), width, n, static_cast<std::ptrdiff_t>(n));
+
+            if (q == owner_col)
+            {
+                ap.assign(a.local().view().block(0, la.local_col(panel * kb), m, width));
+            }
+            comm.broadcast(a_panel.data(), m * width, row_group, p * pc + owner_col);
+
+            if (p == owner_row)
+            {
+                bp.assign(b.local().view().block(lb.local_row(panel * kb), 0, width, n));
+            }
+            comm.broadcast(b_panel.data(), width * n, col_group, owner_row * pc + q);
+
+            if (m == 0 || n == 0) continue;
+
+            if (panel == 0)
+            {
+                xi_matrix::multiply(ap.as_const(), bp.as_const(), out);
+            }
+            else
+            {
+                xi_matrix::multiply(ap.as_const(), bp.as_const(), partial);
+                out += partial;
+            }
+        }
+    }
+
+    /*
+        Reductions over a distributed matrix, every process gets the result
+    */
+    template <typename T>
+    inline xi_matrix::detail::accum_t<T> sum(Communicator& comm, const DistributedMatrix<T>& m)
+    {
+        return comm.allreduce_sum(xi_matrix::sum(m.local()));
+    }
+
+    template <typename T>
+    inline T min(Communicator& comm, const DistributedMatrix<T>& m)
+    {
+        T local = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+        if (m.local().rows() * m.local().cols() != 0) local = xi_matrix::min(m.local());
+        return comm.allreduce(local, [](T x, T y) { return std::min(x, y); });
+    }
+
+    template <typename T>
+    inline T max(Communicator& comm, const DistributedMatrix<T>& m)
+    {
+        T local = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+        if (m.local().rows() * m.local().cols() != 0) local = xi_matrix::max(m.local());
+        return comm.allreduce(local, [](T x, T y) { return std::max(x, y); });
+    }
+
+    /*
+        Entry-wise norm, Norm::L2 is the Frobenius norm
+    */
+    template <typename T>
+    inline xi_matrix::detail::real_t<T> norm(Communicator& comm, const DistributedMatrix<T>& m, xi_matrix::Norm kind = xi_matrix::Norm::L2)
+    {
+        using R = xi_matrix::detail::real_t<T>;
+        const bool empty = m.local().rows() * m.local().cols() == 0;
+        const R local = empty ? R(0) : xi_matrix::norm(m.local(), kind);
+
+        switch (kind)
+        {
+            case xi_matrix::Norm::L1:
+                return comm.allreduce_sum(local);
+            case xi_matrix::Norm::INF:
+                return comm.allreduce(local, [](R x, R y) { return std::max(x, y); });
+            case xi_matrix::Norm::L2:
+            default:
+                return std::sqrt(comm.allreduce_sum(local * local));
+        }
+    }
+
+    /*
+        One-off a * b over launch(): every worker copies its blocks of [ a ] and [ b ] from its
+        snapshot of the caller's memory, runs SUMMA and stores its blocks of the product into
+        shared memory, which is copied into the returned matrix
+    */
+    template <typename A, typename B, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<A>::value && xi_matrix::detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<xi_matrix::detail::value_type_t<A>, xi_matrix::detail::value_type_t<B>>>
+    multiply(const A& a, const B& b, const LaunchOptions& options = LaunchOptions(), size_t block = 128)
+    {
+        using T = std::common_type_t<xi_matrix::detail::value_type_t<A>, xi_matrix::detail::value_type_t<B>>;
+
+        auto va = xi_matrix::detail::as_view(a);
+        auto vb = xi_matrix::detail::as_view(b);
+        assert(va.cols() == vb.rows() && "Matrix dimensions must match up for multiplication");
+
+        const size_t m = va.rows();
+        const size_t k = va.cols();
+        const size_t n = vb.cols();
+        SharedArray<T> result(m * n);
+
+        launch([&](Communicator& comm) {
+            DistributedMatrix<T> da(comm, block_cyclic(m, k, comm.size(), block, block));
+            DistributedMatrix<T> db(comm, block_cyclic(k, n, comm.size(), block, block));
+            DistributedMatrix<T> dc(comm, block_cyclic(m, n, comm.size(), block, block));
+            da.assign(va);
+            db.assign(vb);
+            summa(comm, da, db, dc);
+            dc.store(result.view(m, n));
+        }, options);
+
+        xi_matrix::Matrix_Numerical<T> product(m, n);
+        if (m * n != 0) product.view().assign(result.view(m, n).as_const());
+        return product;
+    }
+
+    /*
+        Sum of every element of an in-memory matrix, each worker reducing a block of rows
+    */
+    template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value>>
+    inline xi_matrix::detail::accum_t<xi_matrix::detail::value_type_t<M>>
+    sum(const M& matrix, const LaunchOptions& options = LaunchOptions())
+    {
+        using R = xi_matrix::detail::accum_t<xi_matrix::detail::value_type_t<M>>;
+        auto v = xi_matrix::detail::as_view(matrix);
+        SharedArray<R> result(1);
+
+        launch([&](Communicator& comm) {
+            const size_t first = v.rows() * comm.rank() / comm.size();
+            const size_t last = v.rows() * (comm.rank() + 1) / comm.size();
+            R partial = last > first ? xi_matrix::sum(v.row_range(first, last - first)) : R(0);
+
+            comm.reduce(&partial, 1, 0, [](R x, R y) { return x + y; });
+            if (comm.rank() == 0) result[0] = partial;
+        }, options);
+
+        return result[0];
+    }
+
+    /*
+        Simpson's rule over [ a, b ] with [ n ] intervals (-1 picks 10'000 like
+        xi_integral::definite_integral), every worker integrating an even share of the intervals
+        on its own node
+    */
+    template <typename Func, typename T1, typename T2>
+    inline long double definite_integral(Func&& f, T1 a, T2 b, int n = -1, const LaunchOptions& options = LaunchOptions())
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+        if (n == -1) n = 10'000;
+        if (n <= 0 || n % 2 == 1)
+        {
+            throw std::invalid_argument("xi_distributed: N must be positive and even for definite integral");
+        }
+
+        SharedArray<long double> result(1);
+        const long double lo = static_cast<long double>(a);
+        const long double h = (static_cast<long double>(b) - lo) / n;
+        const size_t pairs = static_cast<size_t>(n) / 2;
+
+        launch([&](Communicator& comm) {
+            // whole Simpson panels (pairs of intervals) per worker, so the pieces add up to the rule on [ a, b ]
+            const size_t first = 2 * (pairs * comm.rank() / comm.size());
+            const size_t last = 2 * (pairs * (comm.rank() + 1) / comm.size());
+            long double partial = 0;
+            if (last > first)
+            {
+                partial = xi_integral::definite_integral(f, lo + first * h, lo + last * h, static_cast<int>(last - first));
+            }
+
+            comm.reduce(&partial, 1, 0, [](long double x, long double y) { return x + y; });
+            if (comm.rank() == 0) result[0] = partial;
+        }, options);
+
+        return result[0];
+    }
+}
+
+#endif
@@ -0,0 +1,760 @@
+#ifndef XI_FFT
+#define XI_FFT
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "matrix.h"
+#include "parallel.h"
+
+/*
+    Fast Fourier transforms of any length
+
+        auto X = xi_fft::fft(x);                    // X_k = sum_j x_j exp(-2 pi i j k / n)
+        auto y = xi_fft::ifft(X);                   // scaled by 1 / n, y == x
+        auto R = xi_fft::rfft(samples);             // n / 2 + 1 coefficients of real data
+        auto c = xi_fft::convolve(signal, kernel);  // O(n log n) linear convolution
+
+    A Plan holds everything one length needs: the factorization into radix 4 / 2 / 3 / 5 stages
+    with their twiddle tables, or, for lengths with other prime factors, the chirp and the
+    transformed kernel of Bluestein's algorithm on a 2 / 3 / 5 smooth length >= 2n - 1.
+    plan<T>(n) and real_plan<T>(n) build a length once and share it between all later calls
+    and threads, plans are immutable.
+
+    The stages are self-sorting (Stockham), ping-ponging between the data and one scratch
+    buffer without a bit reversal pass. Data is transformed as separate real and imaginary
+    arrays so the butterflies vectorize with omp simd, and large stages are split over the
+    xi_parallel pool.
+
+    Real input of even length is transformed as a complex sequence of half the length.
+    fft2 / ifft2 transform split real and imaginary MatrixViews along rows, then columns.
+*/
+namespace xi_fft
+{
+    namespace detail
+    {
+        inline long double pi()
+        {
+            return 3.141592653589793238462643383279502884L;
+        }
+
+        /*
+            exp(-2 pi i k / n) computed in long double with k reduced modulo n first
+        */
+        template <typename T>
+        inline std::complex<T> root_of_unity(size_t k, size_t n)
+        {
+            const long double angle = -2 * pi() * static_cast<long double>(k % n) / static_cast<long double>(n);
+            return { static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)) };
+        }
+
+        /*
+            Scratch buffer of a transform, taken from a per thread stack with one level per transform
+            in flight. A thread waiting in parallel_for runs other pool tasks, which may start another
+            transform on the same thread before the first one is done.
+            Buffers are kept, transforms of one length in a loop do not fault in fresh pages
+        */
+        template <typename T>
+        class Scratch
+        {
+            private:
+                struct Stack
+                {
+                    std::vector<std::vector<T>> buffers;
+                    size_t depth = 0;
+                };
+
+                static Stack& stack()
+                {
+                    thread_local Stack s;
+                    return s;
+                }
+
+                Stack& _stack;
+                T* _data;
+
+            public:
+                explicit Scratch(size_t size) : _stack(stack())
+                {
+                    if (_stack.depth == _stack.buffers.size()) _stack.buffers.emplace_back();
+                    std::vector<T>& buffer = _stack.buffers[_stack.depth];
+                    if (buffer.size() < size) buffer.resize(size);
+                    _data = buffer.data();
+                    ++_stack.depth;
+                }
+
+                Scratch(const Scratch&) = delete;
+                Scratch& operator=(const Scratch&) = delete;
+
+                ~Scratch() { --_stack.depth; }
+
+                T* data() const { return _data; }
+        };
+
+        /*
+            In place DFT of the R values (re[k], im[k]), exp(-2 pi i / R) as the root
+        */
+        template <size_t R, typename T>
+        inline void small_dft(T* re, T* im)
+        {
+            if constexpr (R == 2)
+            {
+                const T r = re[0] - re[1], i = im[0] - im[1];
+                re[0] += re[1]; im[0] += im[1];
+                re[1] = r; im[1] = i;
+            }
+            else if constexpr (R == 3)
+            {
+                const T sin60 = static_cast<T>(0.866025403784438646763723170752936183L);
+                const T tr = re[1] + re[2], ti = im[1] + im[2];
+                const T br = re[0] - tr / 2, bi = im[0] - ti / 2;
+                const T dr = sin60 * (re[1] - re[2]), di = sin60 * (im[1] - im[2]);
+                re[0] += tr; im[0] += ti;
+                re[1] = br + di; im[1] = bi - dr;
+                re[2] = br - di; im[2] = bi + dr;
+            }
+            else if constexpr (R == 4)
+            {
+                const T t0r = re[0] + re[2], t0i = im[0] + im[2];
+                const T t1r = re[0] - re[2], t1i = im[0] - im[2];
+                const T t2r = re[1] + re[3], t2i = im[1] + im[3];
+                const T t3r = re[1] - re[3], t3i = im[1] - im[3];
+                re[0] = t0r + t2r; im[0] = t0i + t2i;
+                re[2] = t0r - t2r; im[2] = t0i - t2i;
+                re[1] = t1r + t3i; im[1] = t1i - t3r;
+                re[3] = t1r - t3i; im[3] = t1i + t3r;
+            }
+            else
+            {
+                static_assert(R == 5, "Stages are radix 2, 3, 4 or 5");
+                const T c1 = static_cast<T>(0.309016994374947424102293417182819059L);
+                const T c2 = static_cast<T>(-0.809016994374947424102293417182819059L);
+                const T s1 = static_cast<T>(0.951056516295153572116439333379382143L);
+                const T s2 = static_cast<T>(0.587785252292473129168705954639072769L);
+
+                const T t1r = re[1] + re[4], t1i = im[1] + im[4];
+                const T t2r = re[2] + re[3], t2i = im[2] + im[3];
+                const T t3r = re[1] - re[4], t3i = im[1] - im[4];
+                const T t4r = re[2] - re[3], t4i = im[2] - im[3];
+
+                const T b1r = re[0] + c1 * t1r + c2 * t2r, b1i = im[0] + c1 * t1i + c2 * t2i;
+                const T b2r = re[0] + c2 * t1r + c1 * t2r, b2i = im[0] + c2 * t1i + c1 * t2i;
+                const T d1r = s1 * t3r + s2 * t4r, d1i = s1 * t3i + s2 * t4i;
+                const T d2r = s2 * t3r - s1 * t4r, d2i = s2 * t3i - s1 * t4i;
+
+                re[0] += t1r + t2r; im[0] += t1i + t2i;
+                re[1] = b1r + d1i; im[1] = b1i - d1r;
+                re[4] = b1r - d1i; im[4] = b1i + d1r;
+                re[2] = b2r + d2i; im[2] = b2i - d2r;
+                re[3] = b2r - d2i; im[3] = b2i + d2r;
+            }
+        }
+
+        /*
+            One decimation in frequency Stockham stage on a sub-length of m * R with stride s:
+            y[q + s (R p + k)] = w^(p k) sum_j x[q + s (p + j m)] exp(-2 pi i j k / R),
+            w = exp(-2 pi i / (m R)), twiddles stored as w[(k - 1) m + p]
+        */
+        template <size_t R, typename T>
+        inline void stage(size_t m, size_t s, const T* xr, const T* xi, T* yr, T* yi, const T* wr, const T* wi)
+        {
+            auto butterfly = [=](size_t p, size_t q) {
+                T ar[R], ai[R];
+                for (size_t k = 0; k < R; ++k)
+                {
+                    ar[k] = xr[q + s * (p + k * m)];
+                    ai[k] = xi[q + s * (p + k * m)];
+                }
+                small_dft<R>(ar, ai);
+
+                const size_t out = q + s * R * p;
+                yr[out] = ar[0];
+                yi[out] = ai[0];
+                for (size_t k = 1; k < R; ++k)
+                {
+                    const T cr = wr[(k - 1) * m + p], ci = wi[(k - 1) * m + p];
+                    yr[out + s * k] = ar[k] * cr - ai[k] * ci;
+                    yi[out + s * k] = ar[k] * ci + ai[k] * cr;
+                }
+            };
+
+            // p outer, q inner walks both buffers sequentially; only the first stages, where the
+            // q loop is too short to vectorize, run the strided p loop innermost instead
+            const bool q_inner = s >= m || s >= 4;
+            const size_t grain = std::max<size_t>(1, (size_t(1) << 14) / (R * (q_inner ? s : m)));
+            if (q_inner)
+            {
+                xi_parallel::parallel_for(0, m, grain, [&](size_t first, size_t last) {
+                    for (size_t p = first; p < last; ++p)
+                    {
+                        #pragma omp simd
+                        for (size_t q = 0; q < s; ++q) butterfly(p, q);
+                    }
+                });
+            }
+            else
+            {
+                xi_parallel::parallel_for(0, s, grain, [&](size_t first, size_t last) {
+                    for (size_t q = first; q < last; ++q)
+                    {
+                        #pragma omp simd
+                        for (size_t p = 0; p < m; ++p) butterfly(p, q);
+                    }
+                });
+            }
+        }
+
+        inline bool is_smooth(size_t n)
+        {
+            for (size_t p : { 2, 3, 5 })
+            {
+                while (n % p == 0) n /= p;
+            }
+            return n == 1;
+        }
+    }
+
+    /*
+        Smallest length >= n whose only prime factors are 2, 3 and 5
+    */
+    inline size_t good_size(size_t n)
+    {
+        if (n <= 1) return 1;
+        while (!detail::is_smooth(n)) ++n;
+        return n;
+    }
+
+    template <typename T>
+    class Plan;
+
+    template <typename T>
+    std::shared_ptr<const Plan<T>> plan(size_t n);
+
+    /*
+        Complex transform of one length, forward (unscaled) and inverse (scaled by 1 / n)
+    */
+    template <typename T>
+    class Plan
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "FFT plans require a floating point type"
+        );
+
+        private:
+            struct Stage
+            {
+                size_t radix;
+                size_t m;
+                size_t s;
+                size_t twiddles;    // offset into _wr / _wi
+            };
+
+            size_t _n;
+            std::vector<Stage> _stages;
+            std::vector<T> _wr, _wi;
+
+            // Bluestein: chirp exp(-pi i k^2 / n) and the transform of its conjugate, scaled by 1 / M
+            std::shared_ptr<const Plan> _inner;
+            std::vector<T> _chirp_r, _chirp_i, _kernel_r, _kernel_i;
+
+            void bluestein(T* re, T* im) const
+            {
+                const size_t M = _inner->size();
+                std::vector<T> ar(M, T(0)), ai(M, T(0));
+
+                for (size_t j = 0; j < _n; ++j)
+                {
+                    ar[j] = re[j] * _chirp_r[j] - im[j] * _chirp_i[j];
+                    ai[j] = re[j] * _chirp_i[j] + im[j] * _chirp_r[j];
+                }
+                _inner->forward(ar.data(), ai.data());
+
+                // Multiply by the kernel and conjugate, so the forward plan runs the inverse
+                #pragma omp simd
+                for (size_t k = 0; k < M; ++k)
+                {
+                    const T r = ar[k] * _kernel_r[k] - ai[k] * _kernel_i[k];
+                    const T i = ar[k] * _kernel_i[k] + ai[k] * _kernel_r[k];
+                    ar[k] = r;
+                    ai[k] = -i;
+                }
+                _inner->forward(ar.data(), ai.data());
+
+                for (size_t k = 0; k < _n; ++k)
+                {
+                    const T r = ar[k], i = -ai[k];
+                    re[k] = r * _chirp_r[k] - i * _chirp_i[k];
+                    im[k] = r * _chirp_i[k] + i * _chirp_r[k];
+                }
+            }
+
+        public:
+            explicit Plan(size_t n) : _n(n)
+            {
+                if (n <= 1) return;
+
+                size_t rest = n;
+                std::vector<size_t> radices;
+                while (rest % 4 == 0) { radices.push_back(4); rest /= 4; }
+                for (size_t r : { 2, 3, 5 })
+                {
+                    while (rest % r == 0) { radices.push_back(r); rest /= r; }
+                }
+
+                if (rest != 1)
+                {
+                    // Prime factors beyond 5: a convolution of length M >= 2n - 1 computes the DFT
+                    const size_t M = good_size(2 * n - 1);
+                    _inner = plan<T>(M);
+
+                    _chirp_r.resize(n); _chirp_i.resize(n);
+                    _kernel_r.assign(M, T(0)); _kernel_i.assign(M, T(0));
+                    for (size_t k = 0; k < n; ++k)
+                    {
+                        // exp(-pi i k^2 / n) = exp(-2 pi i (k^2 mod 2n) / 2n)
+                        const auto c = detail::root_of_unity<T>((k * k) % (2 * n), 2 * n);
+                        _chirp_r[k] = c.real();
+                        _chirp_i[k] = c.imag();
+                        _kernel_r[k] = c.real() / static_cast<T>(M);
+                        _kernel_i[k] = -c.imag() / static_cast<T>(M);
+                        if (k > 0)
+                        {
+                            _kernel_r[M - k] = _kernel_r[k];
+                            _kernel_i[M - k] = _kernel_i[k];
+                        }
+                    }
+                    _inner->forward(_kernel_r.data(), _kernel_i.data());
+                    return;
+                }
+
+                // Every twiddle is an n-th root of unity, the upper half are conjugates of the lower
+                std::vector<std::complex<T>> roots(n);
+                for (size_t k = 0; 2 * k <= n; ++k)
+                {
+                    roots[k] = detail::root_of_unity<T>(k, n);
+                    if (k > 0) roots[n - k] = std::conj(roots[k]);
+                }
+
+                size_t length = n, s = 1;
+                for (size_t r : radices)
+                {
+                    const size_t m = length / r;
+                    _stages.push_back(Stage{ r, m, s, _wr.size() });
+                    for (size_t k = 1; k < r; ++k)
+                    {
+                        for (size_t p = 0; p < m; ++p)
+                        {
+                            // exp(-2 pi i p k / length)
+                            const std::complex<T> w = roots[(p * k * s) % n];
+                            _wr.push_back(w.real());
+                            _wi.push_back(w.imag());
+                        }
+                    }
+                    length = m;
+                    s *= r;
+                }
+            }
+
+            size_t size() const { return _n; }
+
+            /*
+                True if the length has prime factors other than 2, 3 and 5
+            */
+            bool uses_bluestein() const { return static_cast<bool>(_inner); }
+
+            /*
+                In place forward transform of n values held as separate real / imaginary arrays
+            */
+            void forward(T* re, T* im) const
+            {
+                if (_n <= 1) return;
+                if (_inner)
+                {
+                    bluestein(re, im);
+                    return;
+                }
+
+                const detail::Scratch<T> scratch(2 * _n);
+                T *xr = re, *xi = im, *yr = scratch.data(), *yi = scratch.data() + _n;
+
+                for (const Stage& st : _stages)
+                {
+                    const T* wr = _wr.data() + st.twiddles;
+                    const T* wi = _wi.data() + st.twiddles;
+                    switch (st.radix)
+                    {
+                        case 2: detail::stage<2>(st.m, st.s, xr, xi, yr, yi, wr, wi); break;
+                        case 3: detail::stage<3>(st.m, st.s, xr, xi, yr, yi, wr, wi); break;
+                        case 4: detail::stage<4>(st.m, st.s, xr, xi, yr, yi, wr, wi); break;
+                        default: detail::stage<5>(st.m, st.s, xr, xi, yr, yi, wr, wi); break;
+                    }
+                    std::swap(xr, yr);
+                    std::swap(xi, yi);
+                }
+
+                if (xr != re)
+                {
+                    std::copy(xr, xr + _n, re);
+                    std::copy(xi, xi + _n, im);
+                }
+            }
+
+            /*
+                In place inverse transform, scaled by 1 / n
+            */
+            void inverse(T* re, T* im) const
+            {
+                // conj(F(conj(x))) is n times the inverse
+                for (size_t k = 0; k < _n; ++k) im[k] = -im[k];
+                forward(re, im);
+
+                const T scale = T(1) / static_cast<T>(std::max<size_t>(_n, 1));
+                #pragma omp simd
+                for (size_t k = 0; k < _n; ++k)
+                {
+                    re[k] *= scale;
+                    im[k] = -im[k] * scale;
+                }
+            }
+
+            void forward(std::complex<T>* data) const { execute(data, false); }
+
+            void inverse(std::complex<T>* data) const { execute(data, true); }
+
+        private:
+            void execute(std::complex<T>* data, bool backward) const
+            {
+                std::vector<T> re(_n), im(_n);
+                for (size_t k = 0; k < _n; ++k)
+                {
+                    re[k] = data[k].real();
+                    im[k] = data[k].imag();
+                }
+
+                if (backward) inverse(re.data(), im.data());
+                else forward(re.data(), im.data());
+
+                for (size_t k = 0; k < _n; ++k)
+                {
+                    data[k] = { re[k], im[k] };
+                }
+            }
+    };
+
+    /*
+        Transform of n real values into the n / 2 + 1 non-redundant coefficients and back
+        Even lengths run a complex plan of length n / 2 on the interleaved even / odd samples
+    */
+    template <typename T>
+    class RealPlan
+    {
+        private:
+            size_t _n;
+            std::shared_ptr<const Plan<T>> _half;
+            std::vector<T> _wr, _wi;      // exp(-2 pi i k / n), k = 0 ... n / 2
+
+        public:
+            explicit RealPlan(size_t n) : _n(n)
+            {
+                if (n % 2 == 1 || n < 2)
+                {
+                    _half = plan<T>(n);
+                    return;
+                }
+
+                _half = plan<T>(n / 2);
+                _wr.resize(n / 2 + 1);
+                _wi.resize(n / 2 + 1);
+                for (size_t k = 0; 2 * k <= n / 2; ++k)
+                {
+                    // w^(n / 2 - k) = -conj(w^k)
+                    const auto w = detail::root_of_unity<T>(k, n);
+                    _wr[k] = w.real();
+                    _wi[k] = w.imag();
+                    _wr[n / 2 - k] = -w.real();
+                    _wi[n / 2 - k] = w.imag();
+                }
+            }
+
+            size_t size() const { return _n; }
+
+            /*
+                out[k] = sum_j x_j exp(-2 pi i j k / n) for k = 0 ... n / 2
+            */
+            void forward(const T* x, std::complex<T>* out) const
+            {
+                if (_wr.empty())
+                {
+                    std::vector<T> re(x, x + _n), im(_n, T(0));
+                    _half->forward(re.data(), im.data());
+                    for (size_t k = 0; k <= _n / 2; ++k) out[k] = { re[k], im[k] };
+                    return;
+                }
+
+                const size_t h = _n / 2;
+                std::vector<T> zr(h), zi(h);
+                for (size_t j = 0; j < h; ++j)
+                {
+                    zr[j] = x[2 * j];
+                    zi[j] = x[2 * j + 1];
+                }
+                _half->forward(zr.data(), zi.data());
+
+                // E_k = (Z_k + conj Z_h-k) / 2, O_k = -i (Z_k - conj Z_h-k) / 2, X_k = E_k + w^k O_k
+                out[0] = { zr[0] + zi[0], T(0) };
+                out[h] = { zr[0] - zi[0], T(0) };
+                for (size_t k = 1; k < h; ++k)
+                {
+                    const size_t b = h - k;
+                    const T er = (zr[k] + zr[b]) / 2, ei = (zi[k] - zi[b]) / 2;
+                    const T orr = (zi[k] + zi[b]) / 2, oi = (zr[b] - zr[k]) / 2;
+                    out[k] = { er + _wr[k] * orr - _wi[k] * oi, ei + _wr[k] * oi + _wi[k] * orr };
+                }
+            }
+
+            /*
+                The n real values whose forward transform is X[0 ... n / 2]
+            */
+            void inverse(const std::complex<T>* X, T* x) const
+            {
+                if (_wr.empty())
+                {
+                    std::vector<T> re(_n), im(_n);
+                    for (size_t k = 0; k < _n; ++k)
+                    {
+                        const std::complex<T> v = k <= _n / 2 ? X[k] : std::conj(X[_n - k]);
+                        re[k] = v.real();
+                        im[k] = v.imag();
+                    }
+                    _half->inverse(re.data(), im.data());
+                    std::copy(re.begin(), re.end(), x);
+                    return;
+                }
+
+                const size_t h = _n / 2;
+                std::vector<T> zr(h), zi(h);
+                for (size_t k = 0; k < h; ++k)
+                {
+                    // E_k = (X_k + conj X_h-k) / 2, O_k = (X_k - conj X_h-k) / (2 w^k), Z_k = E_k + i O_k
+                    const std::complex<T> a = X[k], b = std::conj(X[h - k]);
+                    const std::complex<T> e = (a + b) / T(2);
+                    const std::complex<T> d = (a - b) / T(2);
+                    const std::complex<T> o = { d.real() * _wr[k] + d.imag() * _wi[k], d.imag() * _wr[k] - d.real() * _wi[k] };
+                    zr[k] = e.real() - o.imag();
+                    zi[k] = e.imag() + o.real();
+                }
+                _half->inverse(zr.data(), zi.data());
+                for (size_t j = 0; j < h; ++j)
+                {
+                    x[2 * j] = zr[j];
+                    x[2 * j + 1] = zi[j];
+                }
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            Shared plan of length n, built outside the lock (Bluestein plans fetch their inner
+            plan from here); when two threads build the same length the first one is kept
+        */
+        template <typename P>
+        inline std::shared_ptr<const P> cached(size_t n)
+        {
+            static std::mutex mutex;
+            static std::unordered_map<size_t, std::shared_ptr<const P>> plans;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = plans.find(n);
+                if (it != plans.end()) return it->second;
+            }
+
+            auto built = std::make_shared<const P>(n);
+            std::lock_guard<std::mutex> lock(mutex);
+            return plans.emplace(n, std::move(built)).first->second;
+        }
+    }
+
+    template <typename T>
+    inline std::shared_ptr<const Plan<T>> plan(size_t n)
+    {
+        return detail::cached<Plan<T>>(n);
+    }
+
+    template <typename T>
+    inline std::shared_ptr<const RealPlan<T>> real_plan(size_t n)
+    {
+        return detail::cached<RealPlan<T>>(n);
+    }
+
+    template <typename T>
+    inline std::vector<std::complex<T>> fft(std::vector<std::complex<T>> data)
+    {
+        plan<T>(data.size())->forward(data.data());
+        return data;
+    }
+
+    template <typename T>
+    inline std::vector<std::complex<T>> ifft(std::vector<std::complex<T>> data)
+    {
+        plan<T>(data.size())->inverse(data.data());
+        return data;
+    }
+
+    /*
+        The x.size() / 2 + 1 coefficients of real data, the rest are their conjugates
+    */
+    template <typename T>
+    inline std::vector<std::complex<T>> rfft(const std::vector<T>& x)
+    {
+        std::vector<std::complex<T>> out(x.size() / 2 + 1);
+        if (x.empty()) return {};
+        real_plan<T>(x.size())->forward(x.data(), out.data());
+        return out;
+    }
+
+    /*
+        Real sequence of length [ n ] from its n / 2 + 1 coefficients
+    */
+    template <typename T>
+    inline std::vector<T> irfft(const std::vector<std::complex<T>>& X, size_t n)
+    {
+        if (X.size() != n / 2 + 1)
+        {
+            throw std::invalid_argument("xi_fft::irfft: need n / 2 + 1 coefficients");
+        }
+        std::vector<T> x(n);
+        if (n == 0) return x;
+        real_plan<T>(n)->inverse(X.data(), x.data());
+        return x;
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        inline void transform_lines(xi_matrix::MatrixView<T> re, xi_matrix::MatrixView<T> im, bool along_rows, bool backward)
+        {
+            const size_t lines = along_rows ? re.rows() : re.cols();
+            const size_t length = along_rows ? re.cols() : re.rows();
+            const auto p = plan<T>(length);
+
+            const std::ptrdiff_t step_r = along_rows ? re.col_stride() : re.row_stride();
+            const std::ptrdiff_t step_i = along_rows ? im.col_stride() : im.row_stride();
+
+            xi_parallel::parallel_for(0, lines, std::max<size_t>(1, 4096 / std::max<size_t>(length, 1)), [&](size_t first, size_t last) {
+                std::vector<T> r(length), i(length);
+                for (size_t line = first; line < last; ++line)
+                {
+                    T* pr = along_rows ? &re(line, 0) : &re(0, line);
+                    T* pi = along_rows ? &im(line, 0) : &im(0, line);
+                    for (size_t k = 0; k < length; ++k)
+                    {
+                        r[k] = pr[static_cast<std::ptrdiff_t>(k) * step_r];
+                        i[k] = pi[static_cast<std::ptrdiff_t>(k) * step_i];
+                    }
+
+                    if (backward) p->inverse(r.data(), i.data());
+                    else p->forward(r.data(), i.data());
+
+                    for (size_t k = 0; k < length; ++k)
+                    {
+                        pr[static_cast<std::ptrdiff_t>(k) * step_r] = r[k];
+                        pi[static_cast<std::ptrdiff_t>(k) * step_i] = i[k];
+                    }
+                }
+            });
+        }
+    }
+
+    /*
+        In place 2-D transform of the complex matrix re + i im, rows first, then columns
+    */
+    template <typename T>
+    inline void fft2(xi_matrix::MatrixView<T> re, xi_matrix::MatrixView<T> im)
+    {
+        if (re.rows() != im.rows() || re.cols() != im.cols())
+        {
+            throw std::invalid_argument("xi_fft::fft2: real and imaginary parts must have the same shape");
+        }
+        if (re.empty()) return;
+        detail::transform_lines(re, im, true, false);
+        detail::transform_lines(re, im, false, false);
+    }
+
+    /*
+        Inverse of fft2, scaled by 1 / (rows cols)
+    */
+    template <typename T>
+    inline void ifft2(xi_matrix::MatrixView<T> re, xi_matrix::MatrixView<T> im)
+    {
+        if (re.rows() != im.rows() || re.cols() != im.cols())
+        {
+            throw std::invalid_argument("xi_fft::ifft2: real and imaginary parts must have the same shape");
+        }
+        if (re.empty()) return;
+        detail::transform_lines(re, im, true, true);
+        detail::transform_lines(re, im, false, true);
+    }
+
+    /*
+        Linear convolution, a.size() + b.size() - 1 values
+        Short kernels are summed directly, otherwise both signals go through real transforms of
+        a 2 / 3 / 5 smooth length
+    */
+    template <typename T>
+    inline std::vector<T> convolve(const std::vector<T>& a, const std::vector<T>& b)
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Convolution requires a floating point type"
+        );
+
+        if (a.empty() || b.empty()) return {};
+        const size_t n = a.size() + b.size() - 1;
+
+        if (std::min(a.size(), b.size()) <= 32)
+        {
+            const std::vector<T>& longer = a.size() >= b.size() ? a : b;
+            const std::vector<T>& shorter = a.size() >= b.size() ? b : a;
+            std::vector<T> out(n, T(0));
+            for (size_t j = 0; j < shorter.size(); ++j)
+            {
+                const T w = shorter[j];
+                T* o = out.data() + j;
+                #pragma omp simd
+                for (size_t i = 0; i < longer.size(); ++i) o[i] += w * longer[i];
+            }
+            return out;
+        }
+
+        size_t m = good_size(n);
+        if (m % 2 == 1) m = good_size(m + 1);
+        const auto p = real_plan<T>(m);
+
+        std::vector<T> pa(m, T(0)), pb(m, T(0));
+        std::copy(a.begin(), a.end(), pa.begin());
+        std::copy(b.begin(), b.end(), pb.begin());
+
+        std::vector<std::complex<T>> A(m / 2 + 1), B(m / 2 + 1);
+        p->forward(pa.data(), A.data());
+        p->forward(pb.data(), B.data());
+        for (size_t k = 0; k < A.size(); ++k) A[k] *= B[k];
+        p->inverse(A.data(), pa.data());
+
+        pa.resize(n);
+        return pa;
+    }
+}
+
+#endif
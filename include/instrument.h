@@ -0,0 +1,291 @@
+#ifndef XI_INSTRUMENT
+#define XI_INSTRUMENT
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+    Hot path instrumentation for the xi modules
+
+    Compiled out unless XI_ENABLE_INSTRUMENTATION is defined before the first xi header is included
+    (or the CMake option XI_INSTRUMENTATION is turned on). Without it every XI_COUNT / XI_TIME_CALL
+    expands to nothing and the counted expressions are never evaluated.
+
+    With it every thread accumulates into its own block of counters with plain relaxed
+    stores, nothing is shared on the hot path. snapshot() sums the blocks of all running
+    threads plus whatever threads that already exited left behind:
+
+        auto before = xi_instrument::snapshot();
+        run_job();
+        std::cout << xi_instrument::snapshot() - before;
+
+    Counters are kept per subsystem:
+        CALLS            kernel / entry point invocations
+        EVALUATIONS      calls of user supplied functions (integrands, derivative targets, ODE right-hand sides)
+        FLOPS            floating point (or integer multiply-add) operations
+        BYTES            minimum bytes read and written by the kernels
+        ALLOCATIONS      matrix buffers and kernel workspaces allocated
+        ALLOCATED_BYTES  size of those allocations
+        NANOSECONDS      wall time spent inside the timed calls, per thread
+*/
+namespace xi_instrument
+{
+    enum class Subsystem : size_t { INTEGRAL, DERIVATIVE, MATRIX, REDUCTION, PRECISION, IO, ODE, COUNT };
+
+    enum class Counter : size_t { CALLS, EVALUATIONS, FLOPS, BYTES, ALLOCATIONS, ALLOCATED_BYTES, NANOSECONDS, COUNT };
+
+    inline constexpr size_t subsystem_count = static_cast<size_t>(Subsystem::COUNT);
+
+    inline constexpr size_t counter_count = static_cast<size_t>(Counter::COUNT);
+
+#ifdef XI_ENABLE_INSTRUMENTATION
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    inline const char* name(Subsystem s)
+    {
+        static const char* const names[] = { "integral", "derivative", "matrix", "reduction", "precision", "io", "ode" };
+        return names[static_cast<size_t>(s)];
+    }
+
+    inline const char* name(Counter c)
+    {
+        static const char* const names[] = {
+            "calls", "evaluations", "flops", "bytes", "allocations", "allocated_bytes", "nanoseconds"
+        };
+        return names[static_cast<size_t>(c)];
+    }
+
+    /*
+        Plain copy of every counter at one point in time, subtract two snapshots to attribute
+        the cost of the work done between them
+    */
+    struct Snapshot
+    {
+        uint64_t values[subsystem_count][counter_count] = {};
+
+        uint64_t get(Subsystem s, Counter c) const { return values[static_cast<size_t>(s)][static_cast<size_t>(c)]; }
+
+        Snapshot operator-(const Snapshot& earlier) const
+        {
+            Snapshot delta;
+            for (size_t s = 0; s < subsystem_count; ++s)
+            {
+                for (size_t c = 0; c < counter_count; ++c)
+                {
+                    delta.values[s][c] = values[s][c] - earlier.values[s][c];
+                }
+            }
+            return delta;
+        }
+
+        /*
+            { "integral": { "calls": 3, "evaluations": 30003, ... }, "derivative": { ... }, ... }
+        */
+        std::string to_json() const
+        {
+            std::ostringstream out;
+            out << "{";
+            for (size_t s = 0; s < subsystem_count; ++s)
+            {
+                out << (s ? ", " : "") << "\"" << name(static_cast<Subsystem>(s)) << "\": {";
+                for (size_t c = 0; c < counter_count; ++c)
+                {
+                    out << (c ? ", " : "") << "\"" << name(static_cast<Counter>(c)) << "\": " << values[s][c];
+                }
+                out << "}";
+            }
+            out << "}";
+            return out.str();
+        }
+    };
+
+    /*
+        One line per subsystem that recorded anything
+    */
+    inline std::ostream& operator<<(std::ostream& os, const Snapshot& snap)
+    {
+        for (size_t s = 0; s < subsystem_count; ++s)
+        {
+            const uint64_t* row = snap.values[s];
+            if (std::all_of(row, row + counter_count, [](uint64_t v) { return v == 0; })) continue;
+
+            os << name(static_cast<Subsystem>(s)) << ":";
+            for (size_t c = 0; c < counter_count; ++c)
+            {
+                if (row[c]) os << " " << name(static_cast<Counter>(c)) << "=" << row[c];
+            }
+            os << "\n";
+        }
+        return os;
+    }
+
+    namespace detail
+    {
+        struct Block
+        {
+            std::atomic<uint64_t> values[subsystem_count][counter_count] = {};
+        };
+
+        /*
+            Every live per-thread block, plus the totals of threads that have exited
+            The registry is intentionally never destroyed so threads finishing during
+            static destruction can still fold their counts into it
+        */
+        struct Registry
+        {
+            std::mutex lock;
+            std::vector<Block*> live;
+            Block retired;
+
+            static Registry& instance()
+            {
+                static Registry* registry = new Registry();
+                return *registry;
+            }
+        };
+
+        struct ThreadBlock
+        {
+            Block block;
+
+            ThreadBlock()
+            {
+                Registry& r = Registry::instance();
+                std::lock_guard<std::mutex> guard(r.lock);
+                r.live.push_back(&block);
+            }
+
+            ~ThreadBlock()
+            {
+                Registry& r = Registry::instance();
+                std::lock_guard<std::mutex> guard(r.lock);
+                for (size_t s = 0; s < subsystem_count; ++s)
+                {
+                    for (size_t c = 0; c < counter_count; ++c)
+                    {
+                        r.retired.values[s][c].fetch_add(block.values[s][c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    }
+                }
+                r.live.erase(std::find(r.live.begin(), r.live.end(), &block));
+            }
+        };
+
+        inline Block& local()
+        {
+            thread_local ThreadBlock block;
+            return block.block;
+        }
+
+        /*
+            Only the owning thread writes its block, a relaxed load + store is enough
+            and avoids a locked read-modify-write on the hot path
+        */
+        inline void add(Subsystem s, Counter c, uint64_t n)
+        {
+            std::atomic<uint64_t>& v = local().values[static_cast<size_t>(s)][static_cast<size_t>(c)];
+            v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    /*
+        Sums the counters of every thread, safe to call while kernels are running
+    */
+    inline Snapshot snapshot()
+    {
+        Snapshot snap;
+        if (!enabled) return snap;
+
+        detail::Registry& r = detail::Registry::instance();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        auto accumulate = [&](const detail::Block& b) {
+            for (size_t s = 0; s < subsystem_count; ++s)
+            {
+                for (size_t c = 0; c < counter_count; ++c)
+                {
+                    snap.values[s][c] += b.values[s][c].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+        accumulate(r.retired);
+        for (const detail::Block* b : r.live)
+        {
+            accumulate(*b);
+        }
+        return snap;
+    }
+
+    /*
+        Zeroes every counter, counts added concurrently with the reset may survive it
+        Prefer differencing two snapshots when other threads are busy
+    */
+    inline void reset()
+    {
+        if (!enabled) return;
+
+        detail::Registry& r = detail::Registry::instance();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        auto clear = [](detail::Block& b) {
+            for (size_t s = 0; s < subsystem_count; ++s)
+            {
+                for (size_t c = 0; c < counter_count; ++c)
+                {
+                    b.values[s][c].store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        clear(r.retired);
+        for (detail::Block* b : r.live)
+        {
+            clear(*b);
+        }
+    }
+
+    /*
+        Counts one call into [ subsystem ] and the wall time until the end of the enclosing scope
+    */
+    class ScopedCall
+    {
+        private:
+            Subsystem _subsystem;
+            std::chrono::steady_clock::time_point _start;
+        public:
+            explicit ScopedCall(Subsystem subsystem) : _subsystem(subsystem), _start(std::chrono::steady_clock::now()) {};
+
+            ScopedCall(const ScopedCall&) = delete;
+            ScopedCall& operator=(const ScopedCall&) = delete;
+
+            ~ScopedCall()
+            {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+                detail::add(_subsystem, Counter::CALLS, 1);
+                detail::add(_subsystem, Counter::NANOSECONDS, static_cast<uint64_t>(elapsed.count()));
+            }
+    };
+}
+
+#ifdef XI_ENABLE_INSTRUMENTATION
+#define XI_COUNT(subsystem, counter, n) \
+    ::xi_instrument::detail::add(::xi_instrument::Subsystem::subsystem, ::xi_instrument::Counter::counter, static_cast<uint64_t>(n))
+#define XI_TIME_CALL(subsystem) \
+    ::xi_instrument::ScopedCall xi_scoped_call_(::xi_instrument::Subsystem::subsystem)
+#else
+#define XI_COUNT(subsystem, counter, n) ((void)0)
+#define XI_TIME_CALL(subsystem) ((void)0)
+#endif
+
+#endif
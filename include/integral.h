@@ -1,14 +1,25 @@
 #ifndef XI_INTEGRAL
 #define XI_INTEGRAL
 
-#include <omp.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "math_consts.h"
+#include "instrument.h"
+#include "parallel.h"
+#include "memo.h"
 
 namespace xi_integral
 {
     /*
         Simpsons Rule Based Definite Integral
+        Every interior point evaluated is one unit of job progress (see xi_parallel::checkpoint)
     */
     template <typename Func, typename T1, typename T2>
     inline long double definite_integral(Func&& f, T1 a, T2 b, int n = -1)
@@ -26,25 +37,454 @@ namespace xi_integral
 
         if (n == -1) n = 10'000;
 
+        XI_TIME_CALL(INTEGRAL);
+        [[maybe_unused]] const uint64_t misses = xi_instrument::enabled ? xi_memo::misses(f) : 0;
+
         long double delta_x = (static_cast<long double>(b) - a) / n;
         long double sum = f(a) + f(b);
 
-        #pragma omp parallel for reduction(+ : sum)
-        for (int i = 1; i < n; ++i)
+        // Interior points are summed in fixed blocks and the block sums added in order,
+        // so the result does not depend on how many threads took part
+        const int block = 4096;
+        const int interior = std::max(n - 1, 0);
+        std::vector<long double> partial(static_cast<size_t>((interior + block - 1) / block));
+
+        xi_parallel::parallel_for(0, partial.size(), 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c)
+            {
+                const int begin = 1 + static_cast<int>(c) * block;
+                const int end = std::min(n, begin + block);
+                long double block_sum = 0;
+
+                for (int i = begin; i < end; ++i)
+                {
+                    long double x = a + i * delta_x;
+
+                    if (i % 2 == 0)
+                    {
+                        block_sum += 2 * f(x);
+                    }
+                    else
+                    {
+                        block_sum += 4 * f(x);
+                    }
+                }
+
+                partial[c] = block_sum;
+                xi_parallel::checkpoint(static_cast<uint64_t>(end - begin));
+            }
+        });
+
+        for (long double block_sum : partial)
         {
-            long double x = a + i * delta_x;
+            sum += block_sum;
+        }
+
+        XI_COUNT(INTEGRAL, EVALUATIONS, xi_memo::evaluations(f, misses, static_cast<uint64_t>(n + 1)));
+        return (delta_x / 3) * sum;
+    }
+
+    /*
+        Result of an adaptive integrator: the estimate, the change between the last two
+        estimates (used as the error estimate), the integrand evaluations spent so far and
+        whether the requested tolerance was met
+    */
+    struct IntegrationResult
+    {
+        long double value = 0;
+        long double error = 0;
+        size_t evaluations = 0;
+        bool converged = false;
+    };
+
+    /*
+        Romberg integration that keeps its state between calls
+
+        Level k is the trapezoid rule on 2^k intervals, built from level k - 1 by evaluating only
+        the 2^(k - 1) new midpoints, and Richardson extrapolation of the trapezoid values gives
+        the Romberg table; only its last row is kept. Asking for a tighter tolerance later
+        continues from the last level instead of starting over:
+
+            xi_integral::RombergIntegrator romberg(f, 0.0, 1.0);
+            auto coarse = romberg.integrate(1e-6);
+            auto fine = romberg.integrate(1e-12);     // only the additional levels are evaluated
+
+        Converges fast for smooth integrands, for endpoint singularities use tanh_sinh (quadrature.h)
+        Every new midpoint is one unit of job progress (see xi_parallel::checkpoint)
+    */
+    template <typename Func>
+    class RombergIntegrator
+    {
+        private:
+            Func _f;
+            long double _a;
+            long double _b;
+            std::vector<long double> _row;
+            long double _previous = 0;
+            size_t _evaluations = 0;
+
+            /*
+                Sum of f over the 2^(level - 1) midpoints of level [ level ], in fixed blocks added
+                in order so the result does not depend on the number of threads
+            */
+            long double midpoint_sum(size_t level)
+            {
+                const uint64_t count = uint64_t(1) << (level - 1);
+                const long double h = (_b - _a) / static_cast<long double>(uint64_t(1) << level);
+                const uint64_t block = 4096;
+                [[maybe_unused]] const uint64_t misses = xi_instrument::enabled ? xi_memo::misses(_f) : 0;
+                std::vector<long double> partial(static_cast<size_t>((count + block - 1) / block));
+
+                xi_parallel::parallel_for(0, partial.size(), 1, [&](size_t first, size_t last) {
+                    for (size_t c = first; c < last; ++c)
+                    {
+                        const uint64_t begin = c * block;
+                        const uint64_t end = std::min(count, begin + block);
+                        long double block_sum = 0;
+
+                        for (uint64_t i = begin; i < end; ++i)
+                        {
+                            block_sum += _f(_a + static_cast<long double>(2 * i + 1) * h);
+                        }
+
+                        partial[c] = block_sum;
+                        xi_parallel::checkpoint(end - begin);
+                    }
+                });
+
+                long double sum = 0;
+                for (long double block_sum : partial)
+                {
+                    sum += block_sum;
+                }
+
+                XI_COUNT(INTEGRAL, EVALUATIONS, xi_memo::evaluations(_f, misses, count));
+                _evaluations += static_cast<size_t>(count);
+                return sum;
+            }
+        public:
+            RombergIntegrator(Func f, long double a, long double b) : _f(std::forward<Func>(f)), _a(a), _b(b) {};
+
+            /*
+                Number of levels computed so far, level 0 is the plain trapezoid on one interval
+            */
+            size_t levels() const { return _row.size(); }
 
-            if (i % 2 == 0)
+            size_t evaluations() const { return _evaluations; }
+
+            /*
+                Best estimate so far, the diagonal of the Romberg table
+            */
+            long double estimate() const { return _row.empty() ? 0 : _row.back(); }
+
+            /*
+                Change of the estimate over the last level
+            */
+            long double error() const { return _row.size() < 2 ? std::numeric_limits<long double>::infinity() : std::fabs(_row.back() - _previous); }
+
+            /*
+                Adds one level, doubling the number of intervals
+            */
+            void refine()
+            {
+                XI_TIME_CALL(INTEGRAL);
+
+                if (_row.empty())
+                {
+                    [[maybe_unused]] const uint64_t misses = xi_instrument::enabled ? xi_memo::misses(_f) : 0;
+                    _evaluations += 2;
+                    _row.push_back((_b - _a) / 2 * (_f(_a) + _f(_b)));
+                    XI_COUNT(INTEGRAL, EVALUATIONS, xi_memo::evaluations(_f, misses, 2));
+                    return;
+                }
+
+                const size_t level = _row.size();
+                const long double h = (_b - _a) / static_cast<long double>(uint64_t(1) << level);
+
+                // New trapezoid value from the previous one and the new midpoints, then
+                // Richardson extrapolation along the new row
+                _previous = _row.back();
+                long double above = _row[0];
+                _row[0] = _row[0] / 2 + h * midpoint_sum(level);
+
+                long double factor = 1;
+                for (size_t j = 1; j < level; ++j)
+                {
+                    factor *= 4;
+                    const long double next_above = _row[j];
+                    _row[j] = _row[j - 1] + (_row[j - 1] - above) / (factor - 1);
+                    above = next_above;
+                }
+                factor *= 4;
+                _row.push_back(_row[level - 1] + (_row[level - 1] - above) / (factor - 1));
+            }
+
+            /*
+                Refines until the estimate changes by at most [ tolerance ] over one level, relative
+                to the size of the estimate once that exceeds 1, or [ max_levels ] levels exist
+                At least 4 levels are always computed so that integrands sampled only where they
+                happen to vanish do not stop the iteration early
+            */
+            IntegrationResult integrate(long double tolerance = 1e-10L, size_t max_levels = 25)
+            {
+                assert(tolerance > 0 && "Tolerance must be positive");
+                assert(max_levels <= 62 && "Romberg level count must fit the point index");
+
+                IntegrationResult result;
+                while (_row.size() < max_levels)
+                {
+                    if (_row.size() >= 4 && error() <= tolerance * std::max(std::fabs(estimate()), 1.0L))
+                    {
+                        break;
+                    }
+                    refine();
+                }
+
+                result.value = estimate();
+                result.error = error();
+                result.evaluations = _evaluations;
+                result.converged = result.error <= tolerance * std::max(std::fabs(result.value), 1.0L);
+                return result;
+            }
+    };
+
+    /*
+        Romberg integral of f over [ a, b ] to a relative [ tolerance ], see RombergIntegrator
+    */
+    template <typename Func, typename T1, typename T2>
+    inline IntegrationResult romberg_integral(Func&& f, T1 a, T2 b, long double tolerance = 1e-10L, size_t max_levels = 25)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+
+        RombergIntegrator<Func&> romberg(f, static_cast<long double>(a), static_cast<long double>(b));
+        return romberg.integrate(tolerance, max_levels);
+    }
+
+    namespace detail
+    {
+        /*
+            Writes the [ components ] values of the vector valued integrand at x into [ values ],
+            f either fills a buffer itself, f(x, values), or returns something indexable, f(x)[j]
+        */
+        template <typename Func>
+        inline void evaluate_into(Func& f, long double x, long double* values, size_t components)
+        {
+            if constexpr (std::is_invocable<Func&, long double, long double*>::value)
             {
-                sum += 2 * f(x);
+                f(x, values);
             }
             else
             {
-                sum += 4 * f(x);
+                const auto result = f(x);
+                for (size_t j = 0; j < components; ++j)
+                {
+                    values[j] = static_cast<long double>(result[j]);
+                }
             }
         }
 
-        return (delta_x / 3) * sum;
+        /*
+            sum over i < count of weight(i) f(point(i)), component by component
+            Points are taken in fixed blocks on the xi_parallel pool and the block sums added in
+            order, the inner accumulation runs over the components and vectorizes
+        */
+        template <typename Func, typename Point, typename Weight>
+        inline std::vector<long double> vector_sum(Func& f, size_t components, uint64_t count, Point point, Weight weight)
+        {
+            const uint64_t block = 1024;
+            const size_t blocks = static_cast<size_t>((count + block - 1) / block);
+            std::vector<long double> partial(blocks * components, 0.0L);
+
+            xi_parallel::parallel_for(0, blocks, 1, [&](size_t first, size_t last) {
+                std::vector<long double> values(components);
+                for (size_t c = first; c < last; ++c)
+                {
+                    const uint64_t begin = c * block;
+                    const uint64_t end = std::min(count, begin + block);
+                    long double* acc = partial.data() + c * components;
+
+                    for (uint64_t i = begin; i < end; ++i)
+                    {
+                        evaluate_into(f, point(i), values.data(), components);
+                        const long double w = weight(i);
+                        const long double* v = values.data();
+
+                        #pragma omp simd
+                        for (size_t j = 0; j < components; ++j)
+                        {
+                            acc[j] += w * v[j];
+                        }
+                    }
+
+                    xi_parallel::checkpoint(end - begin);
+                }
+            });
+
+            std::vector<long double> sum(components, 0.0L);
+            for (size_t c = 0; c < blocks; ++c)
+            {
+                const long double* acc = partial.data() + c * components;
+                for (size_t j = 0; j < components; ++j)
+                {
+                    sum[j] += acc[j];
+                }
+            }
+
+            XI_COUNT(INTEGRAL, EVALUATIONS, count);
+            return sum;
+        }
+    }
+
+    /*
+        Composite Simpson integral of a vector valued integrand over [ a, b ], every component
+        is integrated over the same n + 1 nodes in one pass, so subexpressions shared between the
+        components (moments, Fourier coefficients, ...) are computed once per node:
+
+            auto moments = xi_integral::definite_integral_vector([](long double x, long double* out) {
+                long double p = std::exp(-x);
+                for (size_t k = 0; k < 8; ++k, p *= x) out[k] = p;
+            }, 8, 0.0, 10.0);
+
+        f either fills [ components ] values, f(x, out), or returns an indexable container
+        n must be even, -1 picks 10'000 like definite_integral
+    */
+    template <typename Func, typename T1, typename T2>
+    inline std::vector<long double> definite_integral_vector(Func&& f, size_t components, T1 a, T2 b, int n = -1)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+
+        if (n == -1) n = 10'000;
+        assert(n > 0 && n % 2 == 0 && "N must be even for definite integral!");
+
+        XI_TIME_CALL(INTEGRAL);
+        XI_COUNT(INTEGRAL, EVALUATIONS, 2);
+
+        const long double lo = static_cast<long double>(a);
+        const long double delta_x = (static_cast<long double>(b) - lo) / n;
+
+        std::vector<long double> result = detail::vector_sum(f, components, static_cast<uint64_t>(n - 1),
+            [&](uint64_t i) { return lo + static_cast<long double>(i + 1) * delta_x; },
+            [](uint64_t i) { return i % 2 == 0 ? 4.0L : 2.0L; });
+
+        std::vector<long double> ends(components);
+        detail::evaluate_into(f, lo, ends.data(), components);
+        for (size_t j = 0; j < components; ++j)
+        {
+            result[j] += ends[j];
+        }
+        detail::evaluate_into(f, static_cast<long double>(b), ends.data(), components);
+        for (size_t j = 0; j < components; ++j)
+        {
+            result[j] = (result[j] + ends[j]) * (delta_x / 3);
+        }
+        return result;
+    }
+
+    /*
+        Result of romberg_integral_vector, [ error ] is the largest change of any component
+        over the last level
+    */
+    struct VectorIntegrationResult
+    {
+        std::vector<long double> values;
+        long double error = 0;
+        size_t evaluations = 0;
+        bool converged = false;
+    };
+
+    /*
+        Romberg integration of a vector valued integrand, see RombergIntegrator and
+        definite_integral_vector for the integrand forms
+
+        Error control is shared: the step is halved until the largest change of any component
+        is at most [ tolerance ] times the largest component (or absolute below 1), so every
+        component comes from the same nodes and the same number of levels
+    */
+    template <typename Func, typename T1, typename T2>
+    inline VectorIntegrationResult romberg_integral_vector(Func&& f, size_t components, T1 a, T2 b,
+                                                           long double tolerance = 1e-10L, size_t max_levels = 25)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+        assert(tolerance > 0 && "Tolerance must be positive");
+        assert(max_levels >= 1 && max_levels <= 62 && "Romberg level count must fit the point index");
+
+        XI_TIME_CALL(INTEGRAL);
+        XI_COUNT(INTEGRAL, EVALUATIONS, 2);
+
+        const long double lo = static_cast<long double>(a);
+        const long double hi = static_cast<long double>(b);
+        const size_t m = components;
+
+        // row[j * m + c] is column j of the current Romberg row for component c
+        std::vector<long double> row(m);
+        std::vector<long double> ends(m);
+        detail::evaluate_into(f, lo, row.data(), m);
+        detail::evaluate_into(f, hi, ends.data(), m);
+        for (size_t c = 0; c < m; ++c)
+        {
+            row[c] = (hi - lo) / 2 * (row[c] + ends[c]);
+        }
+
+        VectorIntegrationResult result;
+        result.evaluations = 2;
+        result.error = std::numeric_limits<long double>::infinity();
+
+        std::vector<long double> above(m);
+        for (size_t level = 1; level < max_levels; ++level)
+        {
+            const long double h = (hi - lo) / static_cast<long double>(uint64_t(1) << level);
+            std::vector<long double> mid = detail::vector_sum(f, m, uint64_t(1) << (level - 1),
+                [&](uint64_t i) { return lo + static_cast<long double>(2 * i + 1) * h; },
+                [](uint64_t) { return 1.0L; });
+            result.evaluations += static_cast<size_t>(uint64_t(1) << (level - 1));
+
+            const std::vector<long double> previous(row.end() - static_cast<std::ptrdiff_t>(m), row.end());
+            std::copy(row.begin(), row.begin() + static_cast<std::ptrdiff_t>(m), above.begin());
+            for (size_t c = 0; c < m; ++c)
+            {
+                row[c] = row[c] / 2 + h * mid[c];
+            }
+
+            row.resize((level + 1) * m);
+            long double factor = 1;
+            for (size_t j = 1; j <= level; ++j)
+            {
+                factor *= 4;
+                long double* current = row.data() + j * m;
+                const long double* left = row.data() + (j - 1) * m;
+
+                for (size_t c = 0; c < m; ++c)
+                {
+                    // current[c] still holds column j of the previous row (unset for j == level)
+                    const long double next_above = j < level ? current[c] : 0;
+                    current[c] = left[c] + (left[c] - above[c]) / (factor - 1);
+                    above[c] = next_above;
+                }
+            }
+
+            long double change = 0, size = 0;
+            const long double* diagonal = row.data() + level * m;
+            for (size_t c = 0; c < m; ++c)
+            {
+                change = std::max(change, std::fabs(diagonal[c] - previous[c]));
+                size = std::max(size, std::fabs(diagonal[c]));
+            }
+            result.error = change;
+            result.converged = change <= tolerance * std::max(size, 1.0L);
+            if (level >= 4 && result.converged) break;
+        }
+
+        result.values.assign(row.end() - static_cast<std::ptrdiff_t>(m), row.end());
+        return result;
     }
 }
 
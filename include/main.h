@@ -3,3 +3,24 @@
 #include "integral.h"
 #include "array.h"
 #include "matrix.h"
+#include "reduction.h"
+#include "precision.h"
+#include "matrix_io.h"
+#include "instrument.h"
+#include "parallel.h"
+#include "async.h"
+#include "batched.h"
+#include "strassen.h"
+#include "quadrature.h"
+#include "ode.h"
+#include "roots.h"
+#include "optimize.h"
+#include "chebyshev.h"
+#include "memo.h"
+#include "spline.h"
+#include "fft.h"
+#include "structured.h"
+#include "matrix_functions.h"
+#include "tiled.h"
+#include "distributed.h"
+#include "vmath.h"
@@ -13,6 +13,12 @@
 #include <iostream>
 #include <cassert>
 #include <utility>
+#include <cstddef>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include "instrument.h"
+#include "parallel.h"
 
 /*
     NOTE:
@@ -21,7 +27,7 @@
 
     GENERAL DOCUMENTATION:
     Main Library for Xi Matrices and Operations
-    
+
     Intended for easy use of different matrix based operations
     and for future use of generating variable data
     to execute data science or for various applications
@@ -41,68 +47,399 @@
             so calculations wouldn't be done incorrectly on char or string datatypes,
 
 
-        - 
+        - Matrices keep their elements in one contiguous row-major buffer, parts of a
+        matrix (blocks, rows, columns, diagonals, strided slices) are handed out as
+        MatrixView / ConstMatrixView objects which only hold a pointer, a shape and strides,
+        so nothing is copied when an algorithm works on a sub-block
+
+            * Every arithmetic operator and factorization routine accepts views
+            as well as whole matrices
 */
 namespace xi_matrix
 {
+    template <typename T>
+    class MatrixView;
+
     /*
-    Standard Matrix Of Datatype [ T ] Elements, chars and string datatypes included
+        Read only, non-owning window of rows x cols elements of type [ T ]
+        Element (i, j) lives at data()[i * row_stride() + j * col_stride()], strides are counted in elements
+
+        The view never owns its elements, the viewed storage has to outlive it
     */
     template <typename T>
-    class Matrix
+    class ConstMatrixView
     {
         private:
+            const T* _ptr;
             size_t _rows;
             size_t _cols;
-            std::vector<std::vector<T>> _data;
+            std::ptrdiff_t _row_stride;
+            std::ptrdiff_t _col_stride;
+
+            std::ptrdiff_t offset(size_t row, size_t col) const
+            {
+                return static_cast<std::ptrdiff_t>(row) * _row_stride + static_cast<std::ptrdiff_t>(col) * _col_stride;
+            }
         public:
+            using value_type = T;
+
             /*
-                Empty Matrix Constructor, rows = cols = 0 and no data is present
+                Empty View, rows = cols = 0 and no data is viewed
             */
-            Matrix() : _rows(0), _cols(0) {};
+            ConstMatrixView() : _ptr(nullptr), _rows(0), _cols(0), _row_stride(0), _col_stride(1) {};
 
             /*
-                Will initialize rows = cols = [ size_t ] size and fill data values with 0's or blank chars if char or string datatypes are declared
+                Views rows x cols elements starting at [ ptr ], walking [ row_stride ] elements between rows
+                and [ col_stride ] elements between columns
+            */
+            ConstMatrixView(const T* ptr, size_t rows, size_t cols, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride = 1)
+                : _ptr(ptr), _rows(rows), _cols(cols), _row_stride(row_stride), _col_stride(col_stride) {};
+
+            /*
+                Any mutable view can be read through a read only one
+            */
+            ConstMatrixView(const MatrixView<T>& v)
+                : _ptr(v.data()), _rows(v.rows()), _cols(v.cols()), _row_stride(v.row_stride()), _col_stride(v.col_stride()) {};
+
+            const T* data() const { return _ptr; }
+
+            size_t rows() const { return _rows; };
+
+            size_t cols() const { return _cols; };
+
+            size_t size() const { return _rows * _cols; };
+
+            bool empty() const { return _rows == 0 || _cols == 0; };
+
+            std::ptrdiff_t row_stride() const { return _row_stride; };
+
+            std::ptrdiff_t col_stride() const { return _col_stride; };
+
+            /*
+                True when the viewed elements form one dense row-major run in memory
             */
-            Matrix(size_t size) : _rows(size), _cols(size) 
+            bool is_contiguous() const
             {
-                _data.resize(size, std::vector<T>(size));
-            };
+                return _col_stride == 1 && (_rows <= 1 || _row_stride == static_cast<std::ptrdiff_t>(_cols));
+            }
+
+            const T& operator()(size_t row, size_t col) const
+            {
+                if (row >= _rows || col >= _cols)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _ptr[offset(row, col)];
+            }
+
+            T at(size_t row, size_t col) const
+            {
+                return (*this)(row, col);
+            }
 
             /*
-                Will initialize the dimensions to a rows x cols fashion and fill data values with 0's or blank chars if char or string datatypes are declared
+                Returns the rows x cols block whose top left element is (row, col)
             */
-            Matrix(size_t rows, size_t cols) : _rows(rows), _cols(cols)
+            ConstMatrixView<T> block(size_t row, size_t col, size_t rows, size_t cols) const
             {
-                _data.resize(rows, std::vector<T>(cols));
-            };
+                if (row + rows > _rows || col + cols > _cols)
+                {
+                    throw std::out_of_range("Block out of bounds");
+                }
+                return ConstMatrixView<T>(_ptr + offset(row, col), rows, cols, _row_stride, _col_stride);
+            }
 
             /*
-                Will initialize the dimensions to a rows x cols fashion and fill data values with the argued data value
+                Returns row [ i ] as a 1 x cols view
             */
-            Matrix(size_t rows, size_t cols, T value) : _rows(rows), _cols(cols)
+            ConstMatrixView<T> row(size_t i) const { return block(i, 0, 1, _cols); }
+
+            /*
+                Returns column [ j ] as a rows x 1 view
+            */
+            ConstMatrixView<T> col(size_t j) const { return block(0, j, _rows, 1); }
+
+            /*
+                Returns [ count ] consecutive rows starting at row [ first ]
+            */
+            ConstMatrixView<T> row_range(size_t first, size_t count) const { return block(first, 0, count, _cols); }
+
+            /*
+                Returns [ count ] consecutive columns starting at column [ first ]
+            */
+            ConstMatrixView<T> col_range(size_t first, size_t count) const { return block(0, first, _rows, count); }
+
+            /*
+                Returns diagonal [ k ] as a column view, k = 0 is the main diagonal,
+                k > 0 diagonals lie above it and k < 0 below it
+            */
+            ConstMatrixView<T> diagonal(std::ptrdiff_t k = 0) const
             {
-                _data.resize(rows, std::vector<T>(cols));
-                for (int i = 0; i < this->rows(); ++i)
-                    for (int j = 0; j < this->cols(); ++j)
-                        _data.at(i).at(j) = value;
-            };
+                size_t row = k < 0 ? static_cast<size_t>(-k) : 0;
+                size_t col = k > 0 ? static_cast<size_t>(k) : 0;
+
+                if (row >= _rows || col >= _cols)
+                {
+                    return ConstMatrixView<T>(_ptr, 0, 1, _row_stride + _col_stride, _col_stride);
+                }
+
+                size_t length = std::min(_rows - row, _cols - col);
+                return ConstMatrixView<T>(_ptr + offset(row, col), length, 1, _row_stride + _col_stride, _col_stride);
+            }
 
             /*
-                Will copy the dimensions and values of the argued matrix [ a ]
+                Returns every [ row_step ]-th row and [ col_step ]-th column of the rows x cols
+                strided window that starts at (row, col)
+            */
+            ConstMatrixView<T> slice(size_t row, size_t col, size_t rows, size_t cols, size_t row_step = 1, size_t col_step = 1) const
+            {
+                assert(row_step > 0 && col_step > 0 && "Slice steps must be positive");
+
+                if ((rows > 0 && row + (rows - 1) * row_step >= _rows) ||
+                    (cols > 0 && col + (cols - 1) * col_step >= _cols))
+                {
+                    throw std::out_of_range("Slice out of bounds");
+                }
+                return ConstMatrixView<T>(
+                    _ptr + offset(row, col), rows, cols,
+                    _row_stride * static_cast<std::ptrdiff_t>(row_step),
+                    _col_stride * static_cast<std::ptrdiff_t>(col_step)
+                );
+            }
+
+            /*
+                Returns the transpose of the view, no elements are moved, only the strides are swapped
             */
-            Matrix(const xi_matrix::Matrix<T>& a) : _rows(a.rows()), _cols(a.cols())
+            ConstMatrixView<T> transpose() const
+            {
+                return ConstMatrixView<T>(_ptr, _cols, _rows, _col_stride, _row_stride);
+            }
+    };
+
+    /*
+        Read-Write, non-owning window of rows x cols elements of type [ T ]
+        Same layout rules as ConstMatrixView, writes go straight to the viewed storage
+    */
+    template <typename T>
+    class MatrixView
+    {
+        private:
+            T* _ptr;
+            size_t _rows;
+            size_t _cols;
+            std::ptrdiff_t _row_stride;
+            std::ptrdiff_t _col_stride;
+
+            std::ptrdiff_t offset(size_t row, size_t col) const
+            {
+                return static_cast<std::ptrdiff_t>(row) * _row_stride + static_cast<std::ptrdiff_t>(col) * _col_stride;
+            }
+        public:
+            using value_type = T;
+
+            MatrixView() : _ptr(nullptr), _rows(0), _cols(0), _row_stride(0), _col_stride(1) {};
+
+            MatrixView(T* ptr, size_t rows, size_t cols, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride = 1)
+                : _ptr(ptr), _rows(rows), _cols(cols), _row_stride(row_stride), _col_stride(col_stride) {};
+
+            T* data() const { return _ptr; }
+
+            size_t rows() const { return _rows; };
+
+            size_t cols() const { return _cols; };
+
+            size_t size() const { return _rows * _cols; };
+
+            bool empty() const { return _rows == 0 || _cols == 0; };
+
+            std::ptrdiff_t row_stride() const { return _row_stride; };
+
+            std::ptrdiff_t col_stride() const { return _col_stride; };
+
+            bool is_contiguous() const
             {
-                _data.resize(_rows, std::vector<T>(_cols));
+                return _col_stride == 1 && (_rows <= 1 || _row_stride == static_cast<std::ptrdiff_t>(_cols));
+            }
+
+            ConstMatrixView<T> as_const() const { return ConstMatrixView<T>(*this); }
 
-                for (int i = 0; i < _rows; ++i)
+            T& operator()(size_t row, size_t col) const
+            {
+                if (row >= _rows || col >= _cols)
                 {
-                    for (int j = 0; j < _cols; ++j)
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _ptr[offset(row, col)];
+            }
+
+            T at(size_t row, size_t col) const
+            {
+                return (*this)(row, col);
+            }
+
+            void setValue(size_t row, size_t col, T value) const
+            {
+                (*this)(row, col) = value;
+            }
+
+            MatrixView<T> block(size_t row, size_t col, size_t rows, size_t cols) const
+            {
+                if (row + rows > _rows || col + cols > _cols)
+                {
+                    throw std::out_of_range("Block out of bounds");
+                }
+                return MatrixView<T>(_ptr + offset(row, col), rows, cols, _row_stride, _col_stride);
+            }
+
+            MatrixView<T> row(size_t i) const { return block(i, 0, 1, _cols); }
+
+            MatrixView<T> col(size_t j) const { return block(0, j, _rows, 1); }
+
+            MatrixView<T> row_range(size_t first, size_t count) const { return block(first, 0, count, _cols); }
+
+            MatrixView<T> col_range(size_t first, size_t count) const { return block(0, first, _rows, count); }
+
+            MatrixView<T> diagonal(std::ptrdiff_t k = 0) const
+            {
+                size_t row = k < 0 ? static_cast<size_t>(-k) : 0;
+                size_t col = k > 0 ? static_cast<size_t>(k) : 0;
+
+                if (row >= _rows || col >= _cols)
+                {
+                    return MatrixView<T>(_ptr, 0, 1, _row_stride + _col_stride, _col_stride);
+                }
+
+                size_t length = std::min(_rows - row, _cols - col);
+                return MatrixView<T>(_ptr + offset(row, col), length, 1, _row_stride + _col_stride, _col_stride);
+            }
+
+            MatrixView<T> slice(size_t row, size_t col, size_t rows, size_t cols, size_t row_step = 1, size_t col_step = 1) const
+            {
+                assert(row_step > 0 && col_step > 0 && "Slice steps must be positive");
+
+                if ((rows > 0 && row + (rows - 1) * row_step >= _rows) ||
+                    (cols > 0 && col + (cols - 1) * col_step >= _cols))
+                {
+                    throw std::out_of_range("Slice out of bounds");
+                }
+                return MatrixView<T>(
+                    _ptr + offset(row, col), rows, cols,
+                    _row_stride * static_cast<std::ptrdiff_t>(row_step),
+                    _col_stride * static_cast<std::ptrdiff_t>(col_step)
+                );
+            }
+
+            MatrixView<T> transpose() const
+            {
+                return MatrixView<T>(_ptr, _cols, _rows, _col_stride, _row_stride);
+            }
+
+            /*
+                Sets every viewed element to [ value ]
+            */
+            void fill(T value) const
+            {
+                for (size_t i = 0; i < _rows; ++i)
+                {
+                    T* row = _ptr + offset(i, 0);
+                    for (size_t j = 0; j < _cols; ++j)
+                    {
+                        row[static_cast<std::ptrdiff_t>(j) * _col_stride] = value;
+                    }
+                }
+            }
+
+            /*
+                Copies the elements of the same shaped view [ src ] into this view
+            */
+            template <typename U>
+            void assign(ConstMatrixView<U> src) const
+            {
+                assert(
+                    src.rows() == _rows && src.cols() == _cols &&
+                    "View dimensions must match for assignment"
+                );
+
+                for (size_t i = 0; i < _rows; ++i)
+                {
+                    T* out = _ptr + offset(i, 0);
+                    const U* in = src.data() + static_cast<std::ptrdiff_t>(i) * src.row_stride();
+                    for (size_t j = 0; j < _cols; ++j)
                     {
-                        this->_data[i][j] = a.at(i, j);
+                        out[static_cast<std::ptrdiff_t>(j) * _col_stride] =
+                            static_cast<T>(in[static_cast<std::ptrdiff_t>(j) * src.col_stride()]);
                     }
                 }
+            }
+
+            template <typename U>
+            void assign(MatrixView<U> src) const { assign(src.as_const()); }
+    };
+
+    /*
+    Standard Matrix Of Datatype [ T ] Elements, chars and string datatypes included
+    */
+    template <typename T>
+    class Matrix
+    {
+        private:
+            size_t _rows;
+            size_t _cols;
+            std::vector<T> _data;
+
+            /*
+                Reports the element buffer to the instrumentation layer (see instrument.h)
+            */
+            void count_allocation() const
+            {
+                if (_data.empty()) return;
+                XI_COUNT(MATRIX, ALLOCATIONS, 1);
+                XI_COUNT(MATRIX, ALLOCATED_BYTES, _data.size() * sizeof(T));
+            }
+        public:
+            using value_type = T;
+
+            /*
+                Empty Matrix Constructor, rows = cols = 0 and no data is present
+            */
+            Matrix() : _rows(0), _cols(0) {};
+
+            /*
+                Will initialize rows = cols = [ size_t ] size and fill data values with 0's or blank chars if char or string datatypes are declared
+            */
+            Matrix(size_t size) : _rows(size), _cols(size), _data(size * size) { count_allocation(); };
+
+            /*
+                Will initialize the dimensions to a rows x cols fashion and fill data values with 0's or blank chars if char or string datatypes are declared
+            */
+            Matrix(size_t rows, size_t cols) : _rows(rows), _cols(cols), _data(rows * cols) { count_allocation(); };
+
+            /*
+                Will initialize the dimensions to a rows x cols fashion and fill data values with the argued data value
+            */
+            Matrix(size_t rows, size_t cols, T value) : _rows(rows), _cols(cols), _data(rows * cols, value) { count_allocation(); };
+
+            /*
+                Will copy the dimensions and values of the argued matrix [ a ]
+            */
+            Matrix(const xi_matrix::Matrix<T>& a) : _rows(a._rows), _cols(a._cols), _data(a._data) { count_allocation(); };
 
+            /*
+                Takes over the storage of [ a ], leaving it as an empty matrix
+            */
+            Matrix(xi_matrix::Matrix<T>&& a) noexcept : _rows(a._rows), _cols(a._cols), _data(std::move(a._data))
+            {
+                a._rows = 0;
+                a._cols = 0;
+            };
+
+            /*
+                Copies the elements seen through the view [ v ] into a new, owning matrix
+            */
+            explicit Matrix(xi_matrix::ConstMatrixView<T> v) : _rows(v.rows()), _cols(v.cols()), _data(v.rows() * v.cols())
+            {
+                count_allocation();
+                this->view().assign(v);
             };
 
             /*
@@ -111,23 +448,52 @@ namespace xi_matrix
             */
             template <size_t rows, size_t cols>
             Matrix(T (&array)[rows][cols]) : _rows(rows), _cols(cols) {
-                _data.resize(rows, std::vector<T>(cols));
+                _data.resize(rows * cols);
+                count_allocation();
                 for (size_t i = 0; i < rows; ++i)
                     for (size_t j = 0; j < cols; ++j)
-                        _data.at(i).at(j) = array[i][j];
+                        _data[i * cols + j] = array[i][j];
             };
 
+            xi_matrix::Matrix<T>& operator=(const xi_matrix::Matrix<T>& a)
+            {
+                const bool grows = _data.capacity() < a._data.size();
+                _rows = a._rows;
+                _cols = a._cols;
+                _data = a._data;
+                if (grows) count_allocation();
+                return *this;
+            }
+
+            xi_matrix::Matrix<T>& operator=(xi_matrix::Matrix<T>&& a) noexcept
+            {
+                _rows = a._rows;
+                _cols = a._cols;
+                _data = std::move(a._data);
+                a._rows = 0;
+                a._cols = 0;
+                return *this;
+            }
+
             /*
-                Returns the std::vector<std::vector<T>> of data that the matrix contains
+                Returns the contiguous row-major std::vector<T> of data that the matrix contains,
+                element (i, j) is stored at index i * cols() + j
                 Read-Write based function
             */
-            std::vector<std::vector<T>>& getData() { return _data; }
+            std::vector<T>& getData() { return _data; }
 
             /*
-                Returns the std::vector<std::vector<T>> of data that the matrix contains
+                Returns the contiguous row-major std::vector<T> of data that the matrix contains
                 Read only based function
             */
-            std::vector<std::vector<T>>& getData() const { return _data; }
+            const std::vector<T>& getData() const { return _data; }
+
+            /*
+                Returns a pointer to the first element of the row-major buffer
+            */
+            T* data() { return _data.data(); }
+
+            const T* data() const { return _data.data(); }
 
             /*
                 Returns the length of rows of the matrix
@@ -141,18 +507,62 @@ namespace xi_matrix
             */
             size_t cols() const { return _cols; };
 
+            /*
+                Returns a view over the whole matrix
+            */
+            xi_matrix::MatrixView<T> view()
+            {
+                return xi_matrix::MatrixView<T>(_data.data(), _rows, _cols, static_cast<std::ptrdiff_t>(_cols));
+            }
+
+            xi_matrix::ConstMatrixView<T> view() const
+            {
+                return xi_matrix::ConstMatrixView<T>(_data.data(), _rows, _cols, static_cast<std::ptrdiff_t>(_cols));
+            }
+
+            /*
+                Views over parts of the matrix, see ConstMatrixView for their meaning
+                None of them copy any elements
+            */
+            xi_matrix::MatrixView<T> block(size_t row, size_t col, size_t rows, size_t cols) { return view().block(row, col, rows, cols); }
+
+            xi_matrix::ConstMatrixView<T> block(size_t row, size_t col, size_t rows, size_t cols) const { return view().block(row, col, rows, cols); }
+
+            xi_matrix::MatrixView<T> row(size_t i) { return view().row(i); }
+
+            xi_matrix::ConstMatrixView<T> row(size_t i) const { return view().row(i); }
+
+            xi_matrix::MatrixView<T> col(size_t j) { return view().col(j); }
+
+            xi_matrix::ConstMatrixView<T> col(size_t j) const { return view().col(j); }
+
+            xi_matrix::MatrixView<T> diagonal(std::ptrdiff_t k = 0) { return view().diagonal(k); }
+
+            xi_matrix::ConstMatrixView<T> diagonal(std::ptrdiff_t k = 0) const { return view().diagonal(k); }
+
+            xi_matrix::MatrixView<T> slice(size_t row, size_t col, size_t rows, size_t cols, size_t row_step = 1, size_t col_step = 1)
+            {
+                return view().slice(row, col, rows, cols, row_step, col_step);
+            }
+
+            xi_matrix::ConstMatrixView<T> slice(size_t row, size_t col, size_t rows, size_t cols, size_t row_step = 1, size_t col_step = 1) const
+            {
+                return view().slice(row, col, rows, cols, row_step, col_step);
+            }
+
             /*
                 Returns a pointer to a pointer of an array that is contained with copied values of the matrix
-                Read-Write based function??
+                Caller owns the result, every row and then the outer array have to be delete[]'d
             */
             T** array()
             {
-                T** arr = new T*[_cols];
-                for (int i = 0; i < _rows; ++i)
+                T** arr = new T*[_rows];
+                for (size_t i = 0; i < _rows; ++i)
                 {
-                    for (int j = 0; j < _cols; ++j)
+                    arr[i] = new T[_cols];
+                    for (size_t j = 0; j < _cols; ++j)
                     {
-                        arr[i][j] = _data.at(i).at(j);
+                        arr[i][j] = _data[i * _cols + j];
                     }
                 }
                 return arr;
@@ -163,7 +573,11 @@ namespace xi_matrix
             */
             T at(size_t row, size_t col)
             {
-                return _data.at(row).at(col);
+                if (row >= _rows || col >= _cols)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _data[row * _cols + col];
             };
 
             /*
@@ -171,15 +585,19 @@ namespace xi_matrix
             */
             T at(size_t row, size_t col) const
             {
-                return _data.at(row).at(col);
+                if (row >= _rows || col >= _cols)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _data[row * _cols + col];
             };
 
             /*
                 Read-Write based function??
             */
-            void setValue(size_t row, size_t col, T value) 
+            void setValue(size_t row, size_t col, T value)
             {
-                this->getData().at(row).at(col) = value;
+                (*this)(row, col) = value;
             };
 
             /*
@@ -194,19 +612,20 @@ namespace xi_matrix
 
             /*
                 Read-Write based function
+                Writes through std::cout without flushing it on every row, see matrix_io.h for bulk text output
             */
             void print()
             {
-                std::cout << "[" << std::endl;
+                std::cout << "[\n";
                 for (int i = 0; i < this->rows(); i++)
                 {
                     for (int j = 0; j < this->cols(); j++)
                     {
                         std::cout << this->at(i, j) << " ";
                     }
-                    std::cout << std::endl;
+                    std::cout << "\n";
                 }
-                std::cout << "]" << std::endl;
+                std::cout << "]\n";
             };
 
             /*
@@ -214,39 +633,40 @@ namespace xi_matrix
             */
             void print() const
             {
-                std::cout << "[" << std::endl;
+                std::cout << "[\n";
                 for (int i = 0; i < this->rows(); i++)
                 {
                     for (int j = 0; j < this->cols(); j++)
                     {
                         std::cout << this->at(i, j) << " ";
                     }
-                    std::cout << std::endl;
+                    std::cout << "\n";
                 }
-                std::cout << "]" << std::endl;
+                std::cout << "]\n";
             };
 
             /*
-                Read-Write based function
+                Read based function, returns a new matrix holding the transpose
+                (use view().transpose() for a transpose that copies nothing)
             */
-            xi_matrix::Matrix<T> transpose()
+            xi_matrix::Matrix<T> transpose() const
             {
-                std::vector<std::vector<T>> newData(this->cols(), std::vector<T>(this->rows()));
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, BYTES, 2 * _data.size() * sizeof(T));
+
+                xi_matrix::Matrix<T> result(this->cols(), this->rows());
 
-                for (int i = 0; i < this->rows(); ++i)
+                for (size_t i = 0; i < this->rows(); ++i)
                 {
-                    for (int j = 0; j < this->cols(); ++j)
+                    for (size_t j = 0; j < this->cols(); ++j)
                     {
-                        newData[j][i] = this->_data[i][j];
+                        result._data[j * _rows + i] = this->_data[i * _cols + j];
                     }
                 }
 
-                xi_matrix::Matrix<T> result(this->cols(), this->rows());
-                result.getData() = std::move(newData);
-
                 return result;
             }
-            
+
             /*
                 Read-Write based function??
             */
@@ -265,40 +685,43 @@ namespace xi_matrix
                 return os;
             }
 
-            std::vector<T>& operator[](size_t row)
+            /*
+                Returns a pointer to the first element of [ row ], so m[i][j] indexing keeps working
+            */
+            T* operator[](size_t row)
             {
                 if (row >= this->rows())
                 {
                     throw std::out_of_range("Row index out of bounds");
                 }
-                return _data[row];
+                return _data.data() + row * _cols;
             }
 
-            std::vector<T>& operator[](size_t row) const
+            const T* operator[](size_t row) const
             {
                 if (row >= this->rows())
                 {
                     throw std::out_of_range("Row index out of bounds");
                 }
-                return _data[row];
+                return _data.data() + row * _cols;
             }
 
-            T& operator()(size_t row, size_t col) 
+            T& operator()(size_t row, size_t col)
             {
                 if (row >= this->rows() || col >= this->cols())
                 {
                     throw std::out_of_range("Index out of bounds");
                 }
-                return _data[row][col];
+                return _data[row * _cols + col];
             }
 
-            T& operator()(size_t row, size_t col) const 
+            const T& operator()(size_t row, size_t col) const
             {
                 if (row >= this->rows() || col >= this->cols())
                 {
                     throw std::out_of_range("Index out of bounds");
                 }
-                return _data[row][col];
+                return _data[row * _cols + col];
             }
 
             bool operator==(const xi_matrix::Matrix<T>& a) const
@@ -308,46 +731,489 @@ namespace xi_matrix
                     return false;
                 }
 
-                for (int i = 0; i < this->_rows; ++i)
+                return this->_data == a.getData();
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            Turns anything matrix shaped (a Matrix or one of its subclasses, or a view) into a read only view
+        */
+        template <typename T>
+        inline ConstMatrixView<T> as_view(const Matrix<T>& m) { return m.view(); }
+
+        template <typename T>
+        inline ConstMatrixView<T> as_view(const MatrixView<T>& v) { return v.as_const(); }
+
+        template <typename T>
+        inline ConstMatrixView<T> as_view(const ConstMatrixView<T>& v) { return v; }
+
+        template <typename T>
+        inline MatrixView<T> as_mutable_view(Matrix<T>& m) { return m.view(); }
+
+        template <typename T>
+        inline MatrixView<T> as_mutable_view(const MatrixView<T>& v) { return v; }
+
+        template <typename M, typename = void>
+        struct is_matrix_like : std::false_type {};
+
+        template <typename M>
+        struct is_matrix_like<M, std::void_t<decltype(as_view(std::declval<const M&>()))>> : std::true_type {};
+
+        template <typename M>
+        struct is_view : std::false_type {};
+
+        template <typename T>
+        struct is_view<MatrixView<T>> : std::true_type {};
+
+        template <typename T>
+        struct is_view<ConstMatrixView<T>> : std::true_type {};
+
+        template <typename M>
+        using value_type_t = typename decltype(as_view(std::declval<const M&>()))::value_type;
+
+        /*
+            Floating point type used internally by factorizations, integer matrices are factored in long double
+        */
+        template <typename T>
+        using work_t = std::conditional_t<std::is_floating_point<T>::value, T, long double>;
+
+        /*
+            Element count (multiply-adds for gemm) from which kernels split their rows across the xi_parallel pool
+        */
+        inline constexpr size_t parallel_threshold = size_t(1) << 15;
+
+        /*
+            out(i, j) = op(a(i, j), b(i, j)), the inner loop runs over raw pointers
+            and is unit stride whenever all three views are
+            Broadcast operands arrive here as views with a zero row or column stride
+        */
+        template <typename T, typename U, typename R, typename Op>
+        inline void elementwise(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> out, Op op)
+        {
+            assert(
+                a.rows() == b.rows() && a.cols() == b.cols() &&
+                a.rows() == out.rows() && a.cols() == out.cols() &&
+                "Matrix dimensions must match for element-wise operations"
+            );
+
+            XI_TIME_CALL(MATRIX);
+            XI_COUNT(MATRIX, FLOPS, out.size());
+            XI_COUNT(MATRIX, BYTES, out.size() * (sizeof(T) + sizeof(U) + sizeof(R)));
+
+            const bool unit = a.col_stride() == 1 && b.col_stride() == 1 && out.col_stride() == 1;
+
+            const size_t grain = std::max<size_t>(1, parallel_threshold / std::max<size_t>(1, a.cols()));
+
+            xi_parallel::parallel_for(0, a.rows(), grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i)
                 {
-                    for (int j = 0; j < this->_cols; ++j)
+                    const T* pa = a.data() + static_cast<std::ptrdiff_t>(i) * a.row_stride();
+                    const U* pb = b.data() + static_cast<std::ptrdiff_t>(i) * b.row_stride();
+                    R* po = out.data() + static_cast<std::ptrdiff_t>(i) * out.row_stride();
+
+                    if (unit)
+                    {
+                        for (size_t j = 0; j < a.cols(); ++j)
+                        {
+                            po[j] = static_cast<R>(op(pa[j], pb[j]));
+                        }
+                    }
+                    else
                     {
-                        if (this->at(i, j) != a.at(i, j))
+                        for (size_t j = 0; j < a.cols(); ++j)
                         {
-                            return false;
+                            std::ptrdiff_t jj = static_cast<std::ptrdiff_t>(j);
+                            po[jj * out.col_stride()] = static_cast<R>(op(pa[jj * a.col_stride()], pb[jj * b.col_stride()]));
                         }
                     }
                 }
+            });
+        }
+
+        /*
+            out = a * b in i-k-j order so the innermost loop streams along rows of b and out,
+            blocks of rows of out are computed in parallel, every finished row is one unit of job progress
+        */
+        template <typename T, typename U, typename R>
+        inline void gemm(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> out)
+        {
+            assert(
+                a.cols() == b.rows() && out.rows() == a.rows() && out.cols() == b.cols() &&
+                "Matrix dimensions must match up for multiplication"
+            );
+
+            XI_TIME_CALL(MATRIX);
+            XI_COUNT(MATRIX, FLOPS, 2 * a.rows() * a.cols() * b.cols());
+            XI_COUNT(MATRIX, BYTES, a.size() * sizeof(T) + b.size() * sizeof(U) + out.size() * sizeof(R));
 
-                return true;
+            const bool unit = b.col_stride() == 1 && out.col_stride() == 1;
+            const size_t grain = std::max<size_t>(1, parallel_threshold / std::max<size_t>(1, a.cols() * b.cols()));
+
+            xi_parallel::parallel_for(0, a.rows(), grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i)
+                {
+                    R* po = out.data() + static_cast<std::ptrdiff_t>(i) * out.row_stride();
+                    const T* pa = a.data() + static_cast<std::ptrdiff_t>(i) * a.row_stride();
+
+                    for (size_t j = 0; j < out.cols(); ++j)
+                    {
+                        po[static_cast<std::ptrdiff_t>(j) * out.col_stride()] = R(0);
+                    }
+
+                    for (size_t k = 0; k < a.cols(); ++k)
+                    {
+                        const R aik = static_cast<R>(pa[static_cast<std::ptrdiff_t>(k) * a.col_stride()]);
+                        const U* pb = b.data() + static_cast<std::ptrdiff_t>(k) * b.row_stride();
+
+                        if (unit)
+                        {
+                            for (size_t j = 0; j < b.cols(); ++j)
+                            {
+                                po[j] += aik * static_cast<R>(pb[j]);
+                            }
+                        }
+                        else
+                        {
+                            for (size_t j = 0; j < b.cols(); ++j)
+                            {
+                                std::ptrdiff_t jj = static_cast<std::ptrdiff_t>(j);
+                                po[jj * out.col_stride()] += aik * static_cast<R>(pb[jj * b.col_stride()]);
+                            }
+                        }
+                    }
+
+                    xi_parallel::checkpoint(1);
+                }
+            });
+        }
+    }
+
+    /*
+        Returns a rows x cols read only view of [ m ] following NumPy broadcasting rules:
+        every dimension of [ m ] has to be either equal to the requested one or 1,
+        a dimension of length 1 is repeated by giving it a stride of 0, nothing is copied
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline ConstMatrixView<detail::value_type_t<M>> broadcast(const M& m, size_t rows, size_t cols)
+    {
+        auto v = detail::as_view(m);
+        assert(
+            (v.rows() == rows || v.rows() == 1) && (v.cols() == cols || v.cols() == 1) &&
+            "Operands could not be broadcast together"
+        );
+
+        return ConstMatrixView<detail::value_type_t<M>>(
+            v.data(), rows, cols,
+            v.rows() == rows ? v.row_stride() : 0,
+            v.cols() == cols ? v.col_stride() : 0
+        );
+    }
+
+    namespace detail
+    {
+        /*
+            Shape of the result of an element-wise operation between [ a ] and [ b ] after broadcasting
+        */
+        template <typename A, typename B>
+        inline std::pair<size_t, size_t> broadcast_shape(const A& a, const B& b)
+        {
+            auto va = as_view(a);
+            auto vb = as_view(b);
+            assert(
+                (va.rows() == vb.rows() || va.rows() == 1 || vb.rows() == 1) &&
+                (va.cols() == vb.cols() || va.cols() == 1 || vb.cols() == 1) &&
+                "Operands could not be broadcast together"
+            );
+
+            return {
+                va.rows() == 1 ? vb.rows() : va.rows(),
+                va.cols() == 1 ? vb.cols() : va.cols()
+            };
+        }
+
+        template <typename A, typename B, typename Out, typename Op>
+        inline void broadcast_elementwise(const A& a, const B& b, Out&& out, Op op)
+        {
+            auto vo = as_mutable_view(out);
+            elementwise(
+                xi_matrix::broadcast(a, vo.rows(), vo.cols()),
+                xi_matrix::broadcast(b, vo.rows(), vo.cols()),
+                vo, op
+            );
+        }
+    }
+
+    /*
+        out = a + b, [ out ] may be [ a ] or [ b ] itself but must not partially overlap either of them
+        [ a ] and [ b ] are broadcast to the shape of [ out ] (a 1 x cols row or rows x 1 column is repeated)
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    add(const A& a, const B& b, Out&& out)
+    {
+        using C = std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>;
+        detail::broadcast_elementwise(a, b, out,
+            [](auto x, auto y) { return static_cast<C>(x) + static_cast<C>(y); });
+    }
+
+    /*
+        out = a - b, same aliasing and broadcasting rules as add
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    subtract(const A& a, const B& b, Out&& out)
+    {
+        using C = std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>;
+        detail::broadcast_elementwise(a, b, out,
+            [](auto x, auto y) { return static_cast<C>(x) - static_cast<C>(y); });
+    }
+
+    /*
+        out(i, j) = a(i, j) * b(i, j), same aliasing and broadcasting rules as add
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    multiply_elementwise(const A& a, const B& b, Out&& out)
+    {
+        using C = std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>;
+        detail::broadcast_elementwise(a, b, out,
+            [](auto x, auto y) { return static_cast<C>(x) * static_cast<C>(y); });
+    }
+
+    /*
+        out(i, j) = a(i, j) / b(i, j), same aliasing and broadcasting rules as add
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    divide_elementwise(const A& a, const B& b, Out&& out)
+    {
+        using C = std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>;
+        detail::broadcast_elementwise(a, b, out,
+            [](auto x, auto y) { return static_cast<C>(x) / static_cast<C>(y); });
+    }
+
+    /*
+        out = a * scalar, [ out ] may be [ a ] itself
+    */
+    template <typename A, typename S, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && std::is_arithmetic<S>::value>
+    scale(const A& a, S scalar, Out&& out)
+    {
+        auto va = detail::as_view(a);
+        detail::elementwise(va, va, detail::as_mutable_view(out),
+            [scalar](auto x, auto) { return scalar * x; });
+    }
+
+    /*
+        out = a * b (matrix product), [ out ] must not overlap [ a ] or [ b ]
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    multiply(const A& a, const B& b, Out&& out)
+    {
+        detail::gemm(detail::as_view(a), detail::as_view(b), detail::as_mutable_view(out));
+    }
+
+    /*
+        In place LU factorization with partial pivoting of the square view [ a ]
+        On return the strictly lower part of [ a ] holds L (its unit diagonal is implied) and
+        the upper part holds U, pivots[k] is the row that was swapped with row k at step k
+
+        Returns the sign of the row permutation (+1 / -1), or 0 if [ a ] is singular
+        Every eliminated column is one unit of job progress (see xi_parallel::checkpoint)
+    */
+    template <typename T>
+    inline int lu_factor(MatrixView<T> a, std::vector<size_t>& pivots)
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "LU factorization requires a floating point element type"
+        );
+        assert(a.rows() == a.cols() && "Matrix must be a square matrix in order to factor it!");
+
+        const size_t n = a.rows();
+        const std::ptrdiff_t rs = a.row_stride();
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, 2 * n * n * n / 3);
+        XI_COUNT(MATRIX, BYTES, 2 * n * n * sizeof(T));
+        const std::ptrdiff_t cs = a.col_stride();
+        T* p = a.data();
+        auto el = [&](size_t i, size_t j) -> T& {
+            return p[static_cast<std::ptrdiff_t>(i) * rs + static_cast<std::ptrdiff_t>(j) * cs];
+        };
+
+        pivots.resize(n);
+        int sign = 1;
+
+        for (size_t k = 0; k < n; ++k)
+        {
+            size_t pivot = k;
+            T largest = std::abs(el(k, k));
+            for (size_t i = k + 1; i < n; ++i)
+            {
+                if (std::abs(el(i, k)) > largest)
+                {
+                    largest = std::abs(el(i, k));
+                    pivot = i;
+                }
             }
-    };
+
+            pivots[k] = pivot;
+            if (largest == T(0))
+            {
+                return 0;
+            }
+
+            if (pivot != k)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    std::swap(el(k, j), el(pivot, j));
+                }
+                sign = -sign;
+            }
+
+            const T inv = T(1) / el(k, k);
+            for (size_t i = k + 1; i < n; ++i)
+            {
+                T& lik = el(i, k);
+                lik *= inv;
+                if (lik == T(0)) continue;
+
+                for (size_t j = k + 1; j < n; ++j)
+                {
+                    el(i, j) -= lik * el(k, j);
+                }
+            }
+
+            xi_parallel::checkpoint(1);
+        }
+
+        return sign;
+    }
+
+    /*
+        Solves A x = b in place for every column of [ b ], given the output of lu_factor for A
+        Every solved column is one unit of job progress
+    */
+    template <typename T>
+    inline void lu_solve(ConstMatrixView<T> lu, const std::vector<size_t>& pivots, MatrixView<T> b)
+    {
+        assert(
+            lu.rows() == lu.cols() && b.rows() == lu.rows() && pivots.size() == lu.rows() &&
+            "Right hand side must have as many rows as the factored matrix"
+        );
+
+        const size_t n = lu.rows();
+
+        XI_TIME_CALL(MATRIX);
+        XI_COUNT(MATRIX, FLOPS, 2 * n * n * b.cols());
+        XI_COUNT(MATRIX, BYTES, lu.size() * sizeof(T) + 2 * b.size() * sizeof(T));
+
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (pivots[k] != k)
+            {
+                for (size_t j = 0; j < b.cols(); ++j)
+                {
+                    std::swap(b(k, j), b(pivots[k], j));
+                }
+            }
+        }
+
+        for (size_t j = 0; j < b.cols(); ++j)
+        {
+            for (size_t i = 1; i < n; ++i)
+            {
+                T sum = b(i, j);
+                for (size_t k = 0; k < i; ++k)
+                {
+                    sum -= lu(i, k) * b(k, j);
+                }
+                b(i, j) = sum;
+            }
+
+            for (size_t i = n; i-- > 0;)
+            {
+                T sum = b(i, j);
+                for (size_t k = i + 1; k < n; ++k)
+                {
+                    sum -= lu(i, k) * b(k, j);
+                }
+                b(i, j) = sum / lu(i, i);
+            }
+
+            xi_parallel::checkpoint(1);
+        }
+    }
+
+    /*
+        Determinant of any square matrix or view, computed through an LU factorization of a copy
+        Integer matrices are factored in long double and the result is rounded back
+    */
+    template <typename M>
+    inline std::enable_if_t<detail::is_matrix_like<M>::value, detail::value_type_t<M>>
+    det(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        using W = detail::work_t<T>;
+
+        auto v = detail::as_view(m);
+        assert(
+            v.rows() == v.cols() &&
+            "Matrix must be a square matrix in order to calculate determinant!"
+        );
+
+        if (v.rows() == 0) return T(1);
+
+        std::vector<W> buffer(v.rows() * v.cols());
+        XI_COUNT(MATRIX, ALLOCATIONS, 1);
+        XI_COUNT(MATRIX, ALLOCATED_BYTES, buffer.size() * sizeof(W));
+        MatrixView<W> work(buffer.data(), v.rows(), v.cols(), static_cast<std::ptrdiff_t>(v.cols()));
+        work.assign(v);
+
+        std::vector<size_t> pivots;
+        int sign = lu_factor(work, pivots);
+        if (sign == 0) return T(0);
+
+        W result = static_cast<W>(sign);
+        for (size_t i = 0; i < v.rows(); ++i)
+        {
+            result *= work(i, i);
+        }
+
+        if (std::is_integral<T>::value)
+        {
+            return static_cast<T>(std::llround(result));
+        }
+        return static_cast<T>(result);
+    }
 
     /*
         Standard Matrix Class for most mathematical operations, determinants and inverses are (soon to be) implemented, char and string datatypes are not allowed
+        Arithmetic operators accept other Matrix_Numerical objects as well as MatrixView / ConstMatrixView operands
     */
     template <typename T = long double>
     class Matrix_Numerical : public Matrix<T>
     {
-        private:
-            size_t _rows;
-            size_t _cols;
-            std::vector<std::vector<T>> _data;
         public:
             static_assert(
-                std::is_arithmetic<T>::value && 
-                !std::is_same<T, char>::value && 
-                !std::is_same<T, unsigned char>::value && 
-                !std::is_same<T, signed char>::value, 
+                std::is_arithmetic<T>::value &&
+                !std::is_same<T, char>::value &&
+                !std::is_same<T, unsigned char>::value &&
+                !std::is_same<T, signed char>::value,
                 "Value type must be arithmetic and not a character type!"
             );
 
             using Matrix<T>::Matrix;
 
             /*
-                Currently a Stub Function for later development of determinant, simply returns the first element in the matrix
+                Determinant, closed form for 2x2 and 3x3 matrices and LU factorization with partial pivoting otherwise
             */
-            T det()
+            T det() const
             {
                 assert(
                     this->rows() == this->cols() &&
@@ -367,104 +1233,55 @@ namespace xi_matrix
                     return (aei + bfg + cdh - ceg - bdi - afh);
                 }
 
-                //Until further functionality progresses
-                return this->getData()[0][0];
+                return xi_matrix::det(this->view());
             }
 
             // Inverse Function To Be Included Soon
-            
-            template <typename U>
-            xi_matrix::Matrix_Numerical<std::common_type_t<T, U>> 
-            operator+(const xi_matrix::Matrix_Numerical<U>& other) {
-                
-                assert(
-                    this->rows() == other.rows() && this->cols() == other.cols()
-                    && "Matrix dimensions must match for addition"
-                );
 
-                using ResultType = std::common_type_t<T, U>;
+            /*
+                Element-wise sum, [ other ] may be a 1 x cols row or rows x 1 column (or the other way around)
+                which is then broadcast across the larger operand
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            xi_matrix::Matrix_Numerical<std::common_type_t<T, detail::value_type_t<M>>>
+            operator+(const M& other) const
+            {
+                using ResultType = std::common_type_t<T, detail::value_type_t<M>>;
 
-                xi_matrix::Matrix_Numerical<ResultType> result(this->rows(), this->cols());
-
-                for (size_t i = 0; i < this->rows(); ++i)
-                {
-                    for (size_t j = 0; j < this->cols(); ++j)
-                    {
-                        result.getData()[i][j] = 
-                            static_cast<ResultType>(this->at(i, j)) + static_cast<ResultType>(other.at(i, j));
-                    }
-                }
+                auto shape = detail::broadcast_shape(*this, other);
+                xi_matrix::Matrix_Numerical<ResultType> result(shape.first, shape.second);
+                xi_matrix::add(*this, other, result);
 
                 return result;
             };
 
-            template <typename U>
-            xi_matrix::Matrix_Numerical<std::common_type_t<T, U>>
-            operator-(const xi_matrix::Matrix_Numerical<U>& other)
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            xi_matrix::Matrix_Numerical<std::common_type_t<T, detail::value_type_t<M>>>
+            operator-(const M& other) const
             {
-                assert(
-                    this->rows() == other.rows() && this->cols() == other.cols()
-                    && "Matrix dimensions must match for addition"
-                );
+                using ResultType = std::common_type_t<T, detail::value_type_t<M>>;
 
-                using ResultType = std::common_type_t<T, U>;
-
-                xi_matrix::Matrix_Numerical<ResultType> result(this->rows(), this->cols());
-
-                for (size_t i = 0; i < this->rows(); ++i)
-                {
-                    for (size_t j = 0; j < this->cols(); ++j)
-                    {
-                        result.getData()[i][j] = 
-                            static_cast<ResultType>(this->at(i, j)) - static_cast<ResultType>(other.at(i, j));
-                    }
-                }
+                auto shape = detail::broadcast_shape(*this, other);
+                xi_matrix::Matrix_Numerical<ResultType> result(shape.first, shape.second);
+                xi_matrix::subtract(*this, other, result);
 
                 return result;
             };
 
-            template <typename U>
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
             xi_matrix::Matrix_Numerical<T>&
-            operator+=(const xi_matrix::Matrix_Numerical<U>& other)
+            operator+=(const M& other)
             {
-                assert(
-                    this->rows() == other.rows() && this->cols() == other.cols()
-                    && "Matrix dimensions must match for addition"
-                );
-
-                using ResultType = std::common_type_t<T, U>;
-
-                for (int i = 0; i < this->rows(); ++i)
-                {
-                    for (int j = 0; j < this->cols(); ++j)
-                    {
-                        this->getData()[i][j] =
-                            static_cast<ResultType>(this->at(i, j)) + static_cast<ResultType>(other.at(i, j));
-                    }
-                }
+                xi_matrix::add(this->view().as_const(), other, this->view());
 
                 return *this;
             };
 
-            template <typename U>
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
             xi_matrix::Matrix_Numerical<T>&
-            operator-=(const xi_matrix::Matrix_Numerical<U>& other)
+            operator-=(const M& other)
             {
-                assert(
-                    this->rows() == other.rows() && this->cols() == other.cols()
-                    && "Matrix dimensions must match for addition"
-                );
-
-                using ResultType = std::common_type_t<T, U>;
-
-                for (int i = 0; i < this->rows(); ++i)
-                {
-                    for (int j = 0; j < this->cols(); ++j)
-                    {
-                        this->getData()[i][j] =
-                            static_cast<ResultType>(this->at(i, j)) - static_cast<ResultType>(other.at(i, j));
-                    }
-                }
+                xi_matrix::subtract(this->view().as_const(), other, this->view());
 
                 return *this;
             };
@@ -474,12 +1291,9 @@ namespace xi_matrix
             {
                 xi_matrix::Matrix_Numerical<T> result(*this);
 
-                for (size_t i = 0; i < result.rows(); ++i)
+                for (T& value : result.getData())
                 {
-                    for (size_t j = 0; j < result.cols(); ++j)
-                    {
-                        result.getData()[i][j] += 1;
-                    }
+                    value += 1;
                 }
 
                 return result;
@@ -490,12 +1304,9 @@ namespace xi_matrix
             {
                 xi_matrix::Matrix_Numerical<T> result(*this);
 
-                for (size_t i = 0; i < result.rows(); ++i)
+                for (T& value : result.getData())
                 {
-                    for (size_t j = 0; j < result.cols(); ++j)
-                    {
-                        result.getData()[i][j] -= 1;
-                    }
+                    value -= 1;
                 }
 
                 return result;
@@ -506,12 +1317,9 @@ namespace xi_matrix
             {
                 xi_matrix::Matrix_Numerical<T> result(*this);
 
-                for (size_t i = 0; i < result.rows(); ++i)
+                for (T& value : this->getData())
                 {
-                    for (size_t j = 0; j < result.cols(); ++j)
-                    {
-                        this->getData()[i][j] += 1;
-                    }
+                    value += 1;
                 }
 
                 return result;
@@ -522,12 +1330,9 @@ namespace xi_matrix
             {
                 xi_matrix::Matrix_Numerical<T> result(*this);
 
-                for (size_t i = 0; i < result.rows(); ++i)
+                for (T& value : this->getData())
                 {
-                    for (size_t j = 0; j < result.cols(); ++j)
-                    {
-                        this->getData()[i][j] -= 1;
-                    }
+                    value -= 1;
                 }
 
                 return result;
@@ -537,15 +1342,7 @@ namespace xi_matrix
             operator*(T number) const
             {
                 xi_matrix::Matrix_Numerical<T> result(this->rows(), this->cols());
-
-                for (size_t i = 0; i < this->rows(); ++i)
-                {
-                    for (size_t j = 0; j < this->cols(); ++j)
-                    {
-                        result.getData()[i][j] =
-                            number * this->at(i, j);
-                    }
-                }
+                xi_matrix::scale(this->view(), number, result);
 
                 return result;
             }
@@ -556,78 +1353,185 @@ namespace xi_matrix
                 return mat * scalar;
             }
 
-            template <typename U>
-            xi_matrix::Matrix_Numerical<std::common_type_t<T, U>>
-            operator*(const xi_matrix::Matrix_Numerical<U>& other)
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            xi_matrix::Matrix_Numerical<std::common_type_t<T, detail::value_type_t<M>>>
+            operator*(const M& other) const
             {
+                auto b = detail::as_view(other);
                 assert(
-                    this->cols() == other.rows() && //this->cols() != other.rows()
+                    this->cols() == b.rows() && //this->cols() != other.rows()
                     "Matrix dimensions must match up for multiplication"
                 );
 
-                using ResultType = std::common_type_t<T, U>;
+                using ResultType = std::common_type_t<T, detail::value_type_t<M>>;
 
-                xi_matrix::Matrix_Numerical<ResultType> result(this->rows(), other.cols());
-
-                ResultType sum = 0;
-                for (int i = 0; i < this->rows(); ++i)
-                {
-                    for (int j = 0; j < other.cols(); ++j)
-                    {
-                        sum = 0;
-                        for (int k = 0; k < this->cols(); ++k)
-                        {
-                            sum += (this->at(i, k) * other.at(k, j));
-                        }
-                        result.getData()[i][j] = sum;
-                    }
-                }
+                xi_matrix::Matrix_Numerical<ResultType> result(this->rows(), b.cols());
+                xi_matrix::multiply(this->view(), b, result);
 
                 return result;
             }
     };
 
     /*
-        Creates a square Identity Matrix, determinants and inverses available as well as mathematical operations, less constructors to use from to make this class
+        Arithmetic with a view on the left hand side, results are always owning Matrix_Numerical objects
+    */
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_view<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>>
+    operator+(const A& a, const B& b)
+    {
+        auto shape = detail::broadcast_shape(a, b);
+        xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>> result(shape.first, shape.second);
+        xi_matrix::add(a, b, result);
+        return result;
+    }
+
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_view<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>>
+    operator-(const A& a, const B& b)
+    {
+        auto shape = detail::broadcast_shape(a, b);
+        xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>> result(shape.first, shape.second);
+        xi_matrix::subtract(a, b, result);
+        return result;
+    }
+
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_view<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>>
+    operator*(const A& a, const B& b)
+    {
+        xi_matrix::Matrix_Numerical<std::common_type_t<typename A::value_type, detail::value_type_t<B>>> result(a.rows(), detail::as_view(b).cols());
+        xi_matrix::multiply(a, b, result);
+        return result;
+    }
+
+    template <typename A, typename = std::enable_if_t<detail::is_view<A>::value>>
+    inline xi_matrix::Matrix_Numerical<typename A::value_type>
+    operator*(const A& a, typename A::value_type scalar)
+    {
+        xi_matrix::Matrix_Numerical<typename A::value_type> result(a.rows(), a.cols());
+        xi_matrix::scale(a, scalar, result);
+        return result;
+    }
+
+    template <typename A, typename = std::enable_if_t<detail::is_view<A>::value>>
+    inline xi_matrix::Matrix_Numerical<typename A::value_type>
+    operator*(typename A::value_type scalar, const A& a)
+    {
+        return a * scalar;
+    }
+
+    /*
+        Element-wise (Hadamard) product and quotient of two broadcast compatible operands
+    */
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>>
+    multiply_elementwise(const A& a, const B& b)
+    {
+        auto shape = detail::broadcast_shape(a, b);
+        xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>> result(shape.first, shape.second);
+        xi_matrix::multiply_elementwise(a, b, result);
+        return result;
+    }
+
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>>
+    divide_elementwise(const A& a, const B& b)
+    {
+        auto shape = detail::broadcast_shape(a, b);
+        xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>> result(shape.first, shape.second);
+        xi_matrix::divide_elementwise(a, b, result);
+        return result;
+    }
+
+    /*
+        Square identity operator of any size without storage: products return the other operand,
+        det() is 1 and the inverse is itself. to_dense() (or the implicit conversion) builds the
+        Matrix_Numerical where a dense identity is really needed
     */
     template <typename T>
-    class IdentityMatrix : public Matrix_Numerical<T>
+    class IdentityMatrix
     {
+        private:
+            size_t _size;
+
         public:
 
-            IdentityMatrix(size_t size) : Matrix_Numerical<T>(size, size)
+            IdentityMatrix(size_t size) : _size(size)
             {
                 assert(
-                    size > 1 && 
+                    size > 1 &&
                     "Identity Matrix must be at least 2x2 sized"
                 );
+            };
+
+            size_t rows() const { return _size; }
 
-                for (size_t i = 0; i < size; ++i)
+            size_t cols() const { return _size; }
+
+            T at(size_t row, size_t col) const
+            {
+                if (row >= _size || col >= _size)
                 {
-                    for (size_t j = 0; j < size; ++j)
-                    {
-                        if (i == j)
-                        {
-                            this->setValue(i, j, static_cast<T>(1)); // Set diagonal to 1
-                        }
-                        else
-                        {
-                            this->setValue(i, j, static_cast<T>(0)); // Set off-diagonal to 0
-                        }
-                    }
+                    throw std::out_of_range("Index out of bounds");
                 }
-            };
+                return row == col ? static_cast<T>(1) : static_cast<T>(0);
+            }
 
-            size_t det()
+            T operator()(size_t row, size_t col) const { return at(row, col); }
+
+            T det() const
             {
                 return 1; // Determinant of an Identity Matrix is always 1
             }
 
-            *this inverse()
+            IdentityMatrix<T> inverse() const
             {
                 return *this; // Inverse of an Identity Matrix is itself
             }
+
+            std::vector<T> operator*(const std::vector<T>& x) const
+            {
+                assert(x.size() == _size && "Vector length must match the matrix size");
+                return x;
+            }
+
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            xi_matrix::Matrix_Numerical<detail::value_type_t<M>> operator*(const M& other) const
+            {
+                auto b = detail::as_view(other);
+                assert(
+                    _size == b.rows() &&
+                    "Matrix dimensions must match up for multiplication"
+                );
+                return xi_matrix::Matrix_Numerical<detail::value_type_t<M>>(b);
+            }
+
+            xi_matrix::Matrix_Numerical<T> to_dense() const
+            {
+                xi_matrix::Matrix_Numerical<T> result(_size, _size, static_cast<T>(0));
+                for (size_t i = 0; i < _size; ++i)
+                {
+                    result(i, i) = static_cast<T>(1);
+                }
+                return result;
+            }
+
+            operator xi_matrix::Matrix_Numerical<T>() const { return to_dense(); }
     };
+
+    /*
+        A I = A for any matrix-like A with as many columns as the identity has rows
+    */
+    template <typename M, typename T, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline xi_matrix::Matrix_Numerical<detail::value_type_t<M>> operator*(const M& a, const IdentityMatrix<T>& identity)
+    {
+        auto v = detail::as_view(a);
+        assert(
+            v.cols() == identity.rows() &&
+            "Matrix dimensions must match up for multiplication"
+        );
+        return xi_matrix::Matrix_Numerical<detail::value_type_t<M>>(v);
+    }
 }
 
 #endif
\ No newline at end of file
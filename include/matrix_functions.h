@@ -0,0 +1,474 @@
+#ifndef XI_MATRIX_FUNCTIONS
+#define XI_MATRIX_FUNCTIONS
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+#include "strassen.h"
+
+/*
+    Functions of square matrices, built on the conventional / Strassen products and LU solves
+
+        pow(A, k)       binary powering, about 2 log2(k) products (A^1000 takes 14 instead of 999),
+                        negative k powers the inverse, three n x n buffers are reused throughout
+        expm(A)         scaling and squaring with a diagonal Pade approximant of degree 3 to 13
+                        (Higham, SIAM J. Matrix Anal. Appl. 26(4), 2005): at most 6 products and one
+                        LU solve, plus one product per halving of || A ||_1
+        sqrtm(A)        principal square root by the scaled product form of the Denman-Beavers
+                        iteration, one product and one inverse per step, quadratic convergence
+
+    Products of floating point matrices above the Strassen crossover go through strassen_multiply,
+    see the accuracy notes in strassen.h
+    expm and sqrtm require a floating point element type, long double uses the double precision
+    Pade thresholds (and is then accurate to about double precision)
+*/
+namespace xi_matrix
+{
+    namespace detail
+    {
+        /*
+            out = a * b through the fastest kernel for the element type, [ out ] must not overlap
+        */
+        template <typename T>
+        inline void square_product(const Matrix_Numerical<T>& a, const Matrix_Numerical<T>& b, Matrix_Numerical<T>& out)
+        {
+            if constexpr (std::is_floating_point<T>::value)
+            {
+                xi_matrix::strassen_multiply(a, b, out);
+            }
+            else
+            {
+                xi_matrix::multiply(a, b, out);
+            }
+        }
+
+        /*
+            out = identity * I + sum of coefficient * matrix over [ terms ], all n x n and contiguous
+        */
+        template <typename T>
+        inline void combine(Matrix_Numerical<T>& out, T identity, std::initializer_list<std::pair<T, const Matrix_Numerical<T>*>> terms)
+        {
+            const size_t n = out.rows();
+            T* po = out.data();
+
+            for (size_t k = 0; k < n * n; ++k)
+            {
+                T sum = T(0);
+                for (const auto& term : terms)
+                {
+                    sum += term.first * term.second->data()[k];
+                }
+                po[k] = sum;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                po[i * n + i] += identity;
+            }
+        }
+
+        /*
+            Maximum absolute column sum
+        */
+        template <typename T>
+        inline T norm_one(const Matrix_Numerical<T>& a)
+        {
+            const size_t n = a.rows();
+            std::vector<T> sums(n, T(0));
+            const T* p = a.data();
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    sums[j] += std::abs(p[i * n + j]);
+                }
+            }
+
+            T largest = T(0);
+            for (T sum : sums)
+            {
+                largest = std::max(largest, sum);
+            }
+            return largest;
+        }
+
+        /*
+            Writes the inverse of [ a ] into [ out ] and log | det(a) | into [ log_det ],
+            returns false (leaving [ out ] untouched) if [ a ] is singular
+        */
+        template <typename T>
+        inline bool invert(const Matrix_Numerical<T>& a, Matrix_Numerical<T>& lu, Matrix_Numerical<T>& out,
+                           std::vector<size_t>& pivots, T& log_det)
+        {
+            const size_t n = a.rows();
+            lu = a;
+            if (xi_matrix::lu_factor(lu.view(), pivots) == 0)
+            {
+                return false;
+            }
+
+            log_det = T(0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                log_det += std::log(std::abs(lu(i, i)));
+            }
+
+            out = Matrix_Numerical<T>(n, n, T(0));
+            for (size_t i = 0; i < n; ++i)
+            {
+                out(i, i) = T(1);
+            }
+            xi_matrix::lu_solve(lu.view().as_const(), pivots, out.view());
+
+            return true;
+        }
+
+        /*
+            Largest 1-norms for which the Pade approximant of each degree reaches unit roundoff
+            (Higham 2005, tables 2.3 and 3.1), the last degree is used with scaling and squaring
+        */
+        template <typename T>
+        struct pade_table
+        {
+            static constexpr size_t count = 5;
+            static constexpr unsigned degrees[count] = { 3, 5, 7, 9, 13 };
+            static constexpr double thetas[count] = {
+                1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+                2.097847961257068e0, 5.371920351148152e0
+            };
+        };
+
+        template <>
+        struct pade_table<float>
+        {
+            static constexpr size_t count = 3;
+            static constexpr unsigned degrees[count] = { 3, 5, 7 };
+            static constexpr double thetas[count] = { 4.258730016922831e-1, 1.880152677804762e0, 3.925724783138660e0 };
+        };
+
+        /*
+            Numerator coefficients b_0 .. b_m of the degree m diagonal Pade approximant to exp
+        */
+        inline const double* pade_coefficients(unsigned degree)
+        {
+            static const double b3[] = { 120.0, 60.0, 12.0, 1.0 };
+            static const double b5[] = { 30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0 };
+            static const double b7[] = { 17297280.0, 8648640.0, 1995840.0, 277200.0, 25200.0, 1512.0, 56.0, 1.0 };
+            static const double b9[] = {
+                17643225600.0, 8821612800.0, 2075673600.0, 302702400.0, 30270240.0,
+                2162160.0, 110880.0, 3960.0, 90.0, 1.0
+            };
+            static const double b13[] = {
+                64764752532480000.0, 32382376266240000.0, 7771770303897600.0, 1187353796428800.0,
+                129060195264000.0, 10559470521600.0, 670442572800.0, 33522128640.0,
+                1323241920.0, 40840800.0, 960960.0, 16380.0, 182.0, 1.0
+            };
+
+            switch (degree)
+            {
+                case 3: return b3;
+                case 5: return b5;
+                case 7: return b7;
+                case 9: return b9;
+                default: return b13;
+            }
+        }
+
+        /*
+            Degree m Pade approximant r(a) = (V - U)^-1 (V + U), with U the odd and V the even part
+            of the numerator, degree 13 evaluates both from a^2, a^4 and a^6 only
+        */
+        template <typename T>
+        inline Matrix_Numerical<T> pade_exp(const Matrix_Numerical<T>& a, unsigned degree)
+        {
+            const size_t n = a.rows();
+            const double* b = pade_coefficients(degree);
+            auto c = [b](unsigned j) { return static_cast<T>(b[j]); };
+
+            Matrix_Numerical<T> a2(n, n), a4, a6, u(n, n), v(n, n), sum(n, n);
+            square_product(a, a, a2);
+
+            if (degree >= 5)
+            {
+                a4 = Matrix_Numerical<T>(n, n);
+                square_product(a2, a2, a4);
+            }
+            if (degree >= 7)
+            {
+                a6 = Matrix_Numerical<T>(n, n);
+                square_product(a4, a2, a6);
+            }
+
+            switch (degree)
+            {
+                case 3:
+                    combine(sum, c(1), { { c(3), &a2 } });
+                    combine(v, c(0), { { c(2), &a2 } });
+                    break;
+                case 5:
+                    combine(sum, c(1), { { c(5), &a4 }, { c(3), &a2 } });
+                    combine(v, c(0), { { c(4), &a4 }, { c(2), &a2 } });
+                    break;
+                case 7:
+                    combine(sum, c(1), { { c(7), &a6 }, { c(5), &a4 }, { c(3), &a2 } });
+                    combine(v, c(0), { { c(6), &a6 }, { c(4), &a4 }, { c(2), &a2 } });
+                    break;
+                case 9:
+                {
+                    Matrix_Numerical<T> a8(n, n);
+                    square_product(a4, a4, a8);
+                    combine(sum, c(1), { { c(9), &a8 }, { c(7), &a6 }, { c(5), &a4 }, { c(3), &a2 } });
+                    combine(v, c(0), { { c(8), &a8 }, { c(6), &a6 }, { c(4), &a4 }, { c(2), &a2 } });
+                    break;
+                }
+                default:
+                {
+                    // U = a [ a6 (b13 a6 + b11 a4 + b9 a2) + b7 a6 + b5 a4 + b3 a2 + b1 I ]
+                    // V = a6 (b12 a6 + b10 a4 + b8 a2) + b6 a6 + b4 a4 + b2 a2 + b0 I
+                    Matrix_Numerical<T> inner(n, n);
+                    combine(inner, T(0), { { c(13), &a6 }, { c(11), &a4 }, { c(9), &a2 } });
+                    square_product(a6, inner, sum);
+                    combine(sum, c(1), { { T(1), &sum }, { c(7), &a6 }, { c(5), &a4 }, { c(3), &a2 } });
+
+                    combine(inner, T(0), { { c(12), &a6 }, { c(10), &a4 }, { c(8), &a2 } });
+                    square_product(a6, inner, v);
+                    combine(v, c(0), { { T(1), &v }, { c(6), &a6 }, { c(4), &a4 }, { c(2), &a2 } });
+                    break;
+                }
+            }
+
+            square_product(a, sum, u);
+
+            // (V - U) r = (V + U), solved in place of the numerator
+            Matrix_Numerical<T>& q = sum;
+            combine(q, T(0), { { T(1), &v }, { T(-1), &u } });
+            combine(v, T(0), { { T(1), &v }, { T(1), &u } });
+
+            std::vector<size_t> pivots;
+            if (xi_matrix::lu_factor(q.view(), pivots) == 0)
+            {
+                throw std::runtime_error("expm: Pade denominator is singular");
+            }
+            xi_matrix::lu_solve(q.view().as_const(), pivots, v.view());
+
+            return v;
+        }
+    }
+
+    /*
+        out = a^k for a square matrix or view [ a ] and any integer k, k = 0 gives the identity and a
+        negative k powers the inverse of [ a ] (floating point types only, throws std::domain_error
+        when [ a ] is singular)
+
+        Right to left binary powering: the base is squared once per bit of k and multiplied into the
+        accumulator once per set bit, ping-ponging between three n x n buffers
+    */
+    template <typename A, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<std::decay_t<Out>>::value>
+    pow(const A& a, long long k, Out&& out)
+    {
+        using T = detail::value_type_t<A>;
+
+        auto va = detail::as_view(a);
+        auto vo = detail::as_mutable_view(out);
+        assert(va.rows() == va.cols() && "Matrix must be a square matrix in order to raise it to a power!");
+        assert(vo.rows() == va.rows() && vo.cols() == va.cols() && "Output must have the dimensions of the base");
+
+        XI_TIME_CALL(MATRIX);
+
+        const size_t n = va.rows();
+        if (k == 0)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    vo(i, j) = i == j ? T(1) : T(0);
+                }
+            }
+            return;
+        }
+
+        Matrix_Numerical<T> base(va);
+        Matrix_Numerical<T> scratch(n, n);
+
+        if (k < 0)
+        {
+            if constexpr (std::is_floating_point<T>::value)
+            {
+                Matrix_Numerical<T> inverse;
+                std::vector<size_t> pivots;
+                T log_det;
+                if (!detail::invert(base, scratch, inverse, pivots, log_det))
+                {
+                    throw std::domain_error("Matrix is singular and has no negative powers");
+                }
+                base = std::move(inverse);
+            }
+            else
+            {
+                throw std::domain_error("Negative matrix powers require a floating point element type");
+            }
+        }
+
+        unsigned long long bits = k < 0 ? 0ull - static_cast<unsigned long long>(k) : static_cast<unsigned long long>(k);
+
+        // the lowest set bit starts the accumulator, so no product with the identity is formed
+        while ((bits & 1ull) == 0)
+        {
+            detail::square_product(base, base, scratch);
+            std::swap(base, scratch);
+            bits >>= 1;
+        }
+
+        Matrix_Numerical<T> result(base);
+        bits >>= 1;
+
+        while (bits != 0)
+        {
+            detail::square_product(base, base, scratch);
+            std::swap(base, scratch);
+
+            if (bits & 1ull)
+            {
+                detail::square_product(result, base, scratch);
+                std::swap(result, scratch);
+            }
+            bits >>= 1;
+        }
+
+        vo.assign(result.view().as_const());
+    }
+
+    template <typename A, typename = std::enable_if_t<detail::is_matrix_like<A>::value>>
+    inline Matrix_Numerical<detail::value_type_t<A>> pow(const A& a, long long k)
+    {
+        auto va = detail::as_view(a);
+        Matrix_Numerical<detail::value_type_t<A>> result(va.rows(), va.cols());
+        xi_matrix::pow(a, k, result);
+        return result;
+    }
+
+    /*
+        Matrix exponential of a square matrix or view, throws std::runtime_error if the Pade
+        denominator is singular (which only happens for non finite input)
+    */
+    template <typename A, typename = std::enable_if_t<detail::is_matrix_like<A>::value>>
+    inline Matrix_Numerical<detail::value_type_t<A>> expm(const A& a)
+    {
+        using T = detail::value_type_t<A>;
+        using Table = detail::pade_table<T>;
+        static_assert(std::is_floating_point<T>::value, "expm requires a floating point element type");
+
+        auto va = detail::as_view(a);
+        assert(va.rows() == va.cols() && "Matrix must be a square matrix in order to exponentiate it!");
+
+        XI_TIME_CALL(MATRIX);
+
+        const size_t n = va.rows();
+        Matrix_Numerical<T> x(va);
+        if (n == 0) return x;
+
+        const T norm = detail::norm_one(x);
+        for (size_t m = 0; m + 1 < Table::count; ++m)
+        {
+            if (norm <= static_cast<T>(Table::thetas[m]))
+            {
+                return detail::pade_exp(x, Table::degrees[m]);
+            }
+        }
+
+        // scale so || a / 2^s ||_1 <= theta of the top degree, then square the result s times
+        const T top = static_cast<T>(Table::thetas[Table::count - 1]);
+        int s = 0;
+        if (norm > top)
+        {
+            s = static_cast<int>(std::ceil(std::log2(norm / top)));
+            for (size_t k = 0; k < n * n; ++k)
+            {
+                x.data()[k] = std::ldexp(x.data()[k], -s);
+            }
+        }
+
+        Matrix_Numerical<T> result = detail::pade_exp(x, Table::degrees[Table::count - 1]);
+        for (int i = 0; i < s; ++i)
+        {
+            detail::square_product(result, result, x);
+            std::swap(result, x);
+        }
+
+        return result;
+    }
+
+    /*
+        Principal square root X of a square matrix or view (X X = A, eigenvalues of X in the right
+        half plane), defined when A has no eigenvalue on the closed negative real axis
+
+        Product form Denman-Beavers iteration with determinant scaling mu = | det M |^(-1 / 2n)
+        (Higham, Functions of Matrices, 2008, section 6.3)
+            X <- mu / 2 X (I + mu^-2 M^-1),  M <- I / 2 + (mu^2 M + mu^-2 M^-1) / 4
+        starting from X = M = A, until || M - I ||_1 <= 16 n u
+
+        Throws std::domain_error if A (or an iterate) is singular and std::runtime_error if the
+        iteration stalls, which happens for eigenvalues on or very near the negative real axis
+    */
+    template <typename A, typename = std::enable_if_t<detail::is_matrix_like<A>::value>>
+    inline Matrix_Numerical<detail::value_type_t<A>> sqrtm(const A& a, size_t max_iterations = 64)
+    {
+        using T = detail::value_type_t<A>;
+        static_assert(std::is_floating_point<T>::value, "sqrtm requires a floating point element type");
+
+        auto va = detail::as_view(a);
+        assert(va.rows() == va.cols() && "Matrix must be a square matrix in order to take its square root!");
+
+        XI_TIME_CALL(MATRIX);
+
+        const size_t n = va.rows();
+        Matrix_Numerical<T> x(va);
+        if (n == 0) return x;
+
+        Matrix_Numerical<T> m(x), inverse, lu, product(n, n);
+        std::vector<size_t> pivots;
+
+        const T tolerance = T(16) * static_cast<T>(n) * std::numeric_limits<T>::epsilon();
+        T distance = std::numeric_limits<T>::infinity();
+
+        for (size_t iteration = 0; iteration < max_iterations; ++iteration)
+        {
+            T log_det;
+            if (!detail::invert(m, lu, inverse, pivots, log_det))
+            {
+                if (iteration == 0) throw std::domain_error("sqrtm: matrix is singular");
+                break;
+            }
+
+            // scaling only pays off far from convergence, close to it it would slow the quadratic phase
+            const T mu = distance > T(1e-2) ? std::exp(-log_det / (T(2) * static_cast<T>(n))) : T(1);
+            const T mu2 = mu * mu;
+
+            detail::square_product(x, inverse, product);
+            detail::combine(x, T(0), { { mu / T(2), &x }, { T(1) / (T(2) * mu), &product } });
+            detail::combine(m, T(0.5), { { mu2 / T(4), &m }, { T(1) / (T(4) * mu2), &inverse } });
+
+            Matrix_Numerical<T>& residual = product;
+            detail::combine(residual, T(-1), { { T(1), &m } });
+            distance = detail::norm_one(residual);
+
+            if (!std::isfinite(distance)) break;
+            if (distance <= tolerance) return x;
+        }
+
+        throw std::runtime_error("sqrtm: Denman-Beavers iteration did not converge, the matrix may have eigenvalues on the negative real axis");
+    }
+}
+
+#endif
@@ -0,0 +1,936 @@
+#ifndef XI_MATRIX_IO
+#define XI_MATRIX_IO
+
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "matrix.h"
+#include "precision.h"
+#include "parallel.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+    Reading and writing matrices to and from files
+
+    Binary format (.xim), little endian:
+
+        offset  size  field
+             0     8  magic "XIMATRIX"
+             8     4  version (1)
+            12     4  dtype (see DType)
+            16     4  element size in bytes
+            20     4  byte order mark 0x01020304 as written by the producing machine
+            24     8  rows
+            32     8  cols
+            40     8  row stride, in elements
+            48     8  column stride, in elements
+            56     8  alignment of the data block, in bytes
+            64     8  data offset from the start of the file, in bytes
+            72    56  reserved, zero
+           128        data
+
+    Element (i, j) is stored at data + (i * row stride + j * column stride) * element size,
+    files written by xi are dense row-major (row stride = cols, column stride = 1)
+
+    MappedMatrix maps a file read only and hands out a ConstMatrixView straight into the mapping,
+    nothing is parsed or copied and pages are only read from disk when they are touched
+
+    Text format: one matrix row per line, fields separated by a delimiter (CSV) or by whitespace,
+    blank lines are skipped
+
+    Text files are mapped rather than read through iostreams, cut into chunks on line boundaries and
+    parsed in parallel with std::from_chars, writers format rows with std::to_chars into large
+    buffers and never flush per row
+*/
+namespace xi_matrix
+{
+    enum class DType : uint32_t
+    {
+        FLOAT32 = 1,
+        FLOAT64 = 2,
+        LONG_DOUBLE = 3,
+        FLOAT16 = 4,
+        BFLOAT16 = 5,
+        INT8 = 6,
+        INT16 = 7,
+        INT32 = 8,
+        INT64 = 9,
+        UINT8 = 10,
+        UINT16 = 11,
+        UINT32 = 12,
+        UINT64 = 13
+    };
+
+    /*
+        DType code of an element type, only defined for the types listed in DType
+    */
+    template <typename T>
+    struct dtype_of;
+
+    template <> struct dtype_of<float> { static constexpr DType value = DType::FLOAT32; };
+    template <> struct dtype_of<double> { static constexpr DType value = DType::FLOAT64; };
+    template <> struct dtype_of<long double> { static constexpr DType value = DType::LONG_DOUBLE; };
+    template <> struct dtype_of<float16> { static constexpr DType value = DType::FLOAT16; };
+    template <> struct dtype_of<bfloat16> { static constexpr DType value = DType::BFLOAT16; };
+    template <> struct dtype_of<int8_t> { static constexpr DType value = DType::INT8; };
+    template <> struct dtype_of<int16_t> { static constexpr DType value = DType::INT16; };
+    template <> struct dtype_of<int32_t> { static constexpr DType value = DType::INT32; };
+    template <> struct dtype_of<int64_t> { static constexpr DType value = DType::INT64; };
+    template <> struct dtype_of<uint8_t> { static constexpr DType value = DType::UINT8; };
+    template <> struct dtype_of<uint16_t> { static constexpr DType value = DType::UINT16; };
+    template <> struct dtype_of<uint32_t> { static constexpr DType value = DType::UINT32; };
+    template <> struct dtype_of<uint64_t> { static constexpr DType value = DType::UINT64; };
+
+    struct MatrixFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t dtype;
+        uint32_t element_size;
+        uint32_t byte_order;
+        uint64_t rows;
+        uint64_t cols;
+        int64_t row_stride;
+        int64_t col_stride;
+        uint64_t alignment;
+        uint64_t data_offset;
+        uint8_t reserved[56];
+    };
+
+    static_assert(sizeof(MatrixFileHeader) == 128, "Matrix file header must be 128 bytes");
+
+    namespace detail
+    {
+        inline constexpr char matrix_magic[8] = { 'X', 'I', 'M', 'A', 'T', 'R', 'I', 'X' };
+        inline constexpr uint32_t matrix_version = 1;
+        inline constexpr uint32_t byte_order_mark = 0x01020304u;
+
+        inline std::runtime_error io_error(const std::string& what, const std::string& path)
+        {
+            return std::runtime_error(what + ": " + path + " (" + std::strerror(errno) + ")");
+        }
+
+        template <typename T>
+        inline MatrixFileHeader make_header(uint64_t rows, uint64_t cols, uint64_t alignment)
+        {
+            assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+            MatrixFileHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, matrix_magic, sizeof(header.magic));
+            header.version = matrix_version;
+            header.dtype = static_cast<uint32_t>(dtype_of<T>::value);
+            header.element_size = sizeof(T);
+            header.byte_order = byte_order_mark;
+            header.rows = rows;
+            header.cols = cols;
+            header.row_stride = static_cast<int64_t>(cols);
+            header.col_stride = 1;
+            header.alignment = alignment;
+            header.data_offset = (sizeof(MatrixFileHeader) + alignment - 1) / alignment * alignment;
+            return header;
+        }
+
+        /*
+            Checks a header against the file it came from and the element type it is read as
+        */
+        template <typename T>
+        inline void validate_header(const MatrixFileHeader& header, uint64_t file_size, const std::string& path)
+        {
+            if (std::memcmp(header.magic, matrix_magic, sizeof(header.magic)) != 0)
+            {
+                throw std::runtime_error("Not an xi matrix file: " + path);
+            }
+            if (header.version != matrix_version)
+            {
+                throw std::runtime_error("Unsupported xi matrix file version: " + path);
+            }
+            if (header.byte_order != byte_order_mark)
+            {
+                throw std::runtime_error("Matrix file was written with a different byte order: " + path);
+            }
+            if (header.dtype != static_cast<uint32_t>(dtype_of<T>::value) || header.element_size != sizeof(T))
+            {
+                throw std::runtime_error("Matrix file element type does not match the requested type: " + path);
+            }
+
+            if (header.data_offset < sizeof(MatrixFileHeader) || header.data_offset > file_size ||
+                header.data_offset % alignof(T) != 0)
+            {
+                throw std::runtime_error("Matrix file data offset is out of range or misaligned: " + path);
+            }
+
+            if (header.rows == 0 || header.cols == 0)
+            {
+                return;
+            }
+
+            // Element counts and offsets are kept well inside int64_t, nothing below can overflow
+            const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max() / 4) / sizeof(T);
+            auto magnitude = [](int64_t stride) { return stride < 0 ? uint64_t(0) - static_cast<uint64_t>(stride) : static_cast<uint64_t>(stride); };
+            if (header.cols > limit / header.rows ||
+                magnitude(header.row_stride) > limit / header.rows ||
+                magnitude(header.col_stride) > limit / header.cols)
+            {
+                throw std::runtime_error("Matrix file dimensions or strides overflow: " + path);
+            }
+
+            // Furthest element in both directions must stay within the data block
+            int64_t low = 0;
+            int64_t high = 0;
+            int64_t row_span = static_cast<int64_t>(header.rows - 1) * header.row_stride;
+            int64_t col_span = static_cast<int64_t>(header.cols - 1) * header.col_stride;
+            (row_span < 0 ? low : high) += row_span;
+            (col_span < 0 ? low : high) += col_span;
+
+            if (low < 0 || (static_cast<uint64_t>(high) + 1) * sizeof(T) > file_size - header.data_offset)
+            {
+                throw std::runtime_error("Matrix file is truncated or its strides are out of range: " + path);
+            }
+        }
+
+        inline void write_all(std::FILE* file, const void* data, size_t bytes, const std::string& path)
+        {
+            if (bytes != 0 && std::fwrite(data, 1, bytes, file) != bytes)
+            {
+                throw io_error("Failed to write matrix file", path);
+            }
+            XI_COUNT(IO, BYTES, bytes);
+        }
+    }
+
+    /*
+        Read only memory mapping of a binary matrix file, move only
+        The view stays valid for as long as the MappedMatrix it came from is alive
+    */
+    template <typename T>
+    class MappedMatrix
+    {
+        private:
+            void* _map;
+            size_t _length;
+            MatrixFileHeader _header;
+
+            void release()
+            {
+                if (_map != nullptr)
+                {
+                    ::munmap(_map, _length);
+                    _map = nullptr;
+                    _length = 0;
+                }
+            }
+        public:
+            MappedMatrix() : _map(nullptr), _length(0) { std::memset(&_header, 0, sizeof(_header)); };
+
+            /*
+                Maps [ path ], throws std::runtime_error if the file cannot be opened or is not a
+                valid matrix file of element type [ T ]
+            */
+            explicit MappedMatrix(const std::string& path) : _map(nullptr), _length(0)
+            {
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                {
+                    throw detail::io_error("Failed to open matrix file", path);
+                }
+
+                struct stat info;
+                if (::fstat(fd, &info) != 0)
+                {
+                    ::close(fd);
+                    throw detail::io_error("Failed to stat matrix file", path);
+                }
+
+                _length = static_cast<size_t>(info.st_size);
+                if (_length < sizeof(MatrixFileHeader))
+                {
+                    ::close(fd);
+                    throw std::runtime_error("Matrix file is too small to hold a header: " + path);
+                }
+
+                _map = ::mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (_map == MAP_FAILED)
+                {
+                    _map = nullptr;
+                    throw detail::io_error("Failed to map matrix file", path);
+                }
+
+                std::memcpy(&_header, _map, sizeof(_header));
+                try
+                {
+                    detail::validate_header<T>(_header, _length, path);
+                }
+                catch (...)
+                {
+                    release();
+                    throw;
+                }
+            };
+
+            MappedMatrix(const MappedMatrix&) = delete;
+
+            MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+            MappedMatrix(MappedMatrix&& other) noexcept : _map(other._map), _length(other._length), _header(other._header)
+            {
+                other._map = nullptr;
+                other._length = 0;
+            };
+
+            MappedMatrix& operator=(MappedMatrix&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    _map = other._map;
+                    _length = other._length;
+                    _header = other._header;
+                    other._map = nullptr;
+                    other._length = 0;
+                }
+                return *this;
+            }
+
+            ~MappedMatrix() { release(); }
+
+            size_t rows() const { return static_cast<size_t>(_header.rows); };
+
+            size_t cols() const { return static_cast<size_t>(_header.cols); };
+
+            const MatrixFileHeader& header() const { return _header; }
+
+            const T* data() const
+            {
+                return _map ? reinterpret_cast<const T*>(static_cast<const char*>(_map) + _header.data_offset) : nullptr;
+            }
+
+            /*
+                Zero-copy read only view over the mapped elements
+            */
+            ConstMatrixView<T> view() const
+            {
+                return ConstMatrixView<T>(data(), rows(), cols(), _header.row_stride, _header.col_stride);
+            }
+
+            /*
+                Hints the kernel that the mapping will be read front to back (true) or randomly (false)
+            */
+            void advise_sequential(bool sequential = true) const
+            {
+                if (_map != nullptr)
+                {
+                    ::madvise(_map, _length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                }
+            }
+
+            /*
+                Asks the kernel to start reading the whole file in the background
+            */
+            void prefetch() const
+            {
+                if (_map != nullptr)
+                {
+                    ::madvise(_map, _length, MADV_WILLNEED);
+                }
+            }
+    };
+
+    /*
+        Streams a dense row-major matrix file with a fixed number of columns,
+        rows are appended as they become available so the whole matrix never has to be in memory
+        The row count in the header is filled in by close() (or the destructor)
+    */
+    template <typename T>
+    class MatrixFileWriter
+    {
+        private:
+            std::FILE* _file;
+            std::string _path;
+            MatrixFileHeader _header;
+            std::vector<char> _buffer;
+
+        public:
+            /*
+                Creates (or truncates) [ path ] for a matrix of [ cols ] columns,
+                the data block starts on a multiple of [ alignment ] bytes
+            */
+            MatrixFileWriter(const std::string& path, size_t cols, size_t alignment = 64)
+                : _file(nullptr), _path(path), _header(detail::make_header<T>(0, cols, alignment)), _buffer(size_t(1) << 20)
+            {
+                _file = std::fopen(path.c_str(), "wb");
+                if (_file == nullptr)
+                {
+                    throw detail::io_error("Failed to create matrix file", path);
+                }
+                std::setvbuf(_file, _buffer.data(), _IOFBF, _buffer.size());
+
+                // The destructor does not run for a constructor that throws
+                try
+                {
+                    detail::write_all(_file, &_header, sizeof(_header), _path);
+                    std::vector<char> padding(_header.data_offset - sizeof(_header), 0);
+                    detail::write_all(_file, padding.data(), padding.size(), _path);
+                }
+                catch (...)
+                {
+                    std::fclose(_file);
+                    _file = nullptr;
+                    throw;
+                }
+            };
+
+            MatrixFileWriter(const MatrixFileWriter&) = delete;
+
+            MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+            ~MatrixFileWriter()
+            {
+                try
+                {
+                    close();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            size_t rows() const { return static_cast<size_t>(_header.rows); };
+
+            size_t cols() const { return static_cast<size_t>(_header.cols); };
+
+            /*
+                Appends one row of cols() elements
+            */
+            void append_row(const T* row)
+            {
+                assert(_file != nullptr && "Matrix file writer is already closed");
+                detail::write_all(_file, row, cols() * sizeof(T), _path);
+                ++_header.rows;
+            }
+
+            /*
+                Appends every row of [ rows ], which must have cols() columns
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            void append_rows(const M& rows)
+            {
+                auto v = detail::as_view(rows);
+                static_assert(std::is_same<detail::value_type_t<M>, T>::value, "Element type must match the file");
+                assert(v.cols() == cols() && "Appended rows must have as many columns as the file");
+
+                if (v.is_contiguous())
+                {
+                    assert(_file != nullptr && "Matrix file writer is already closed");
+                    detail::write_all(_file, v.data(), v.size() * sizeof(T), _path);
+                    _header.rows += v.rows();
+                    return;
+                }
+
+                std::vector<T> row(cols());
+                for (size_t i = 0; i < v.rows(); ++i)
+                {
+                    MatrixView<T>(row.data(), 1, cols(), static_cast<std::ptrdiff_t>(cols())).assign(v.row(i));
+                    append_row(row.data());
+                }
+            }
+
+            /*
+                Writes the final row count into the header and closes the file, safe to call twice
+            */
+            void close()
+            {
+                if (_file == nullptr)
+                {
+                    return;
+                }
+
+                std::FILE* file = _file;
+                _file = nullptr;
+
+                bool ok = std::fflush(file) == 0 &&
+                          std::fseek(file, 0, SEEK_SET) == 0 &&
+                          std::fwrite(&_header, 1, sizeof(_header), file) == sizeof(_header);
+                ok = (std::fclose(file) == 0) && ok;
+
+                if (!ok)
+                {
+                    throw detail::io_error("Failed to finish matrix file", _path);
+                }
+            }
+    };
+
+    /*
+        Writes any matrix or view to [ path ] in the binary format
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline void save_binary(const std::string& path, const M& m, size_t alignment = 64)
+    {
+        auto v = detail::as_view(m);
+        XI_TIME_CALL(IO);
+
+        MatrixFileWriter<detail::value_type_t<M>> writer(path, v.cols(), alignment);
+        writer.append_rows(v);
+        writer.close();
+    }
+
+    /*
+        Maps [ path ] read only, see MappedMatrix
+    */
+    template <typename T>
+    inline MappedMatrix<T> map_binary(const std::string& path)
+    {
+        return MappedMatrix<T>(path);
+    }
+
+    /*
+        Reads [ path ] into an owning matrix (one copy out of the mapping)
+    */
+    template <typename T>
+    inline Matrix<T> load_binary(const std::string& path)
+    {
+        XI_TIME_CALL(IO);
+
+        MappedMatrix<T> mapped(path);
+        mapped.advise_sequential();
+        XI_COUNT(IO, BYTES, mapped.view().size() * sizeof(T));
+        return Matrix<T>(mapped.view());
+    }
+
+    /*
+        Layout of a text matrix
+            delimiter: field separator, ' ' or '\t' treat any run of spaces and tabs as one separator
+            skip_rows: leading lines to ignore (column titles)
+    */
+    struct TextFormat
+    {
+        char delimiter = ',';
+        size_t skip_rows = 0;
+
+        static TextFormat csv(size_t skip_rows = 0) { return TextFormat{ ',', skip_rows }; }
+
+        static TextFormat whitespace(size_t skip_rows = 0) { return TextFormat{ ' ', skip_rows }; }
+    };
+
+    namespace detail
+    {
+        /*
+            Bytes of input handed to one parsing task
+        */
+        inline constexpr size_t text_chunk_bytes = size_t(4) << 20;
+
+        inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        /*
+            True if [ first, last ) holds anything besides blanks
+        */
+        inline bool has_content(const char* first, const char* last)
+        {
+            for (; first != last; ++first)
+            {
+                if (!is_blank(*first)) return true;
+            }
+            return false;
+        }
+
+        inline const char* next_line(const char* first, const char* last)
+        {
+            const void* nl = std::memchr(first, '\n', static_cast<size_t>(last - first));
+            return nl ? static_cast<const char*>(nl) + 1 : last;
+        }
+
+        /*
+            End of the line [ line, eol ) without its newline
+        */
+        inline const char* line_end(const char* line, const char* eol)
+        {
+            return eol > line && eol[-1] == '\n' ? eol - 1 : eol;
+        }
+
+        inline std::runtime_error parse_error(const std::string& what, size_t row)
+        {
+            return std::runtime_error(what + " on data row " + std::to_string(row + 1));
+        }
+
+        /*
+            Parses one number starting at [ p ], leading blanks, a leading '+' and surrounding
+            double quotes are accepted, returns the position after it
+        */
+        template <typename T>
+        inline const char* parse_field(const char* p, const char* end, T& value, size_t row)
+        {
+            while (p != end && is_blank(*p)) ++p;
+
+            bool quoted = p != end && *p == '"';
+            if (quoted) ++p;
+            if (p != end && *p == '+') ++p;
+
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc())
+            {
+                throw parse_error(result.ec == std::errc::result_out_of_range ? "Number out of range" : "Malformed number", row);
+            }
+            p = result.ptr;
+
+            if (quoted)
+            {
+                if (p == end || *p != '"') throw parse_error("Unterminated quoted field", row);
+                ++p;
+            }
+            while (p != end && is_blank(*p)) ++p;
+            return p;
+        }
+
+        /*
+            Number of fields on the line [ first, last ), last excludes the newline
+        */
+        inline size_t count_fields(const char* first, const char* last, char delimiter)
+        {
+            const bool spaces = delimiter == ' ' || delimiter == '\t';
+            size_t fields = 0;
+            const char* p = first;
+
+            if (spaces)
+            {
+                while (p != last)
+                {
+                    while (p != last && is_blank(*p)) ++p;
+                    if (p == last) break;
+                    ++fields;
+                    while (p != last && !is_blank(*p)) ++p;
+                }
+                return fields;
+            }
+
+            fields = 1;
+            for (; p != last; ++p)
+            {
+                if (*p == delimiter) ++fields;
+            }
+            return fields;
+        }
+
+        /*
+            Parses exactly [ cols ] fields of the line [ first, last ) into [ out ]
+        */
+        template <typename T>
+        inline void parse_line(const char* first, const char* last, char delimiter, size_t cols, T* out, size_t row)
+        {
+            const bool spaces = delimiter == ' ' || delimiter == '\t';
+            const char* p = first;
+
+            for (size_t j = 0; j < cols; ++j)
+            {
+                p = parse_field(p, last, out[j], row);
+
+                if (j + 1 < cols)
+                {
+                    if (spaces)
+                    {
+                        if (p == first || p == last || !is_blank(p[-1])) throw parse_error("Too few fields", row);
+                    }
+                    else
+                    {
+                        if (p == last || *p != delimiter) throw parse_error(p == last ? "Too few fields" : "Unexpected character", row);
+                        ++p;
+                    }
+                }
+            }
+
+            if (p != last && has_content(p, last))
+            {
+                throw parse_error("Too many fields", row);
+            }
+        }
+
+        /*
+            Parses the text [ first, last ) into a rows x cols matrix in two parallel passes:
+            every chunk counts its non empty lines, a prefix sum turns the counts into the first
+            output row of every chunk, then every chunk parses its lines straight into place
+        */
+        template <typename T>
+        inline Matrix_Numerical<T> parse_text(const char* first, const char* last, const TextFormat& format)
+        {
+            XI_TIME_CALL(IO);
+            XI_COUNT(IO, BYTES, last - first);
+
+            for (size_t skipped = 0; skipped < format.skip_rows && first != last; ++skipped)
+            {
+                first = next_line(first, last);
+            }
+
+            // Shape comes from the first non empty line
+            const char* probe = first;
+            while (probe != last && !has_content(probe, line_end(probe, next_line(probe, last))))
+            {
+                probe = next_line(probe, last);
+            }
+            if (probe == last)
+            {
+                return Matrix_Numerical<T>();
+            }
+            const size_t cols = count_fields(probe, line_end(probe, next_line(probe, last)), format.delimiter);
+
+            // Chunk boundaries, every chunk but the first starts right after a newline
+            std::vector<const char*> bounds{ first };
+            while (bounds.back() != last)
+            {
+                const char* target = static_cast<size_t>(last - bounds.back()) > text_chunk_bytes
+                    ? bounds.back() + text_chunk_bytes : last;
+                bounds.push_back(target == last ? last : next_line(target, last));
+            }
+            const size_t chunks = bounds.size() - 1;
+
+            std::vector<size_t> counts(chunks + 1, 0);
+
+            xi_parallel::parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+                for (size_t c = first; c < last; ++c)
+                {
+                    size_t lines = 0;
+                    for (const char* p = bounds[c]; p != bounds[c + 1];)
+                    {
+                        const char* eol = next_line(p, bounds[c + 1]);
+                        if (has_content(p, line_end(p, eol))) ++lines;
+                        p = eol;
+                    }
+                    counts[c + 1] = lines;
+                }
+            });
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                counts[c + 1] += counts[c];
+            }
+
+            Matrix_Numerical<T> result(counts[chunks], cols);
+            T* data = result.data();
+
+            std::string error;
+            size_t error_row = static_cast<size_t>(-1);
+            std::mutex error_lock;
+
+            xi_parallel::parallel_for(0, chunks, 1, [&](size_t first, size_t last) {
+                for (size_t c = first; c < last; ++c)
+                {
+                    size_t row = counts[c];
+                    try
+                    {
+                        for (const char* p = bounds[c]; p != bounds[c + 1];)
+                        {
+                            const char* eol = next_line(p, bounds[c + 1]);
+                            const char* stop = line_end(p, eol);
+                            if (has_content(p, stop))
+                            {
+                                parse_line(p, stop, format.delimiter, cols, data + row * cols, row);
+                                ++row;
+                            }
+                            p = eol;
+                        }
+                    }
+                    catch (const std::exception& e)
+                    {
+                        // Report the first bad row of the file, not the first one any thread reached
+                        std::lock_guard<std::mutex> guard(error_lock);
+                        if (row < error_row)
+                        {
+                            error_row = row;
+                            error = e.what();
+                        }
+                    }
+                }
+            });
+
+            if (!error.empty())
+            {
+                throw std::runtime_error(error);
+            }
+
+            return result;
+        }
+
+        /*
+            Appends row [ i ] of [ v ] to [ out ], shortest round trip form for floating point types
+        */
+        template <typename T>
+        inline void format_row(ConstMatrixView<T> v, size_t i, char delimiter, std::string& out)
+        {
+            char scratch[64];
+            for (size_t j = 0; j < v.cols(); ++j)
+            {
+                std::to_chars_result result = std::to_chars(scratch, scratch + sizeof(scratch), v(i, j));
+                out.append(scratch, result.ptr);
+                out.push_back(j + 1 < v.cols() ? delimiter : '\n');
+            }
+        }
+    }
+
+    /*
+        Parses CSV / whitespace separated numbers held in memory
+        Throws std::runtime_error naming the first data row with a malformed number or the wrong field count
+    */
+    template <typename T = long double>
+    inline Matrix_Numerical<T> parse_text(std::string_view text, const TextFormat& format = TextFormat())
+    {
+        return detail::parse_text<T>(text.data(), text.data() + text.size(), format);
+    }
+
+    /*
+        Reads a CSV / whitespace separated text file, the file is mapped and parsed in parallel chunks
+    */
+    template <typename T = long double>
+    inline Matrix_Numerical<T> read_text(const std::string& path, const TextFormat& format = TextFormat())
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw detail::io_error("Failed to open text matrix", path);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw detail::io_error("Failed to stat text matrix", path);
+        }
+
+        const size_t length = static_cast<size_t>(info.st_size);
+        if (length == 0)
+        {
+            ::close(fd);
+            return Matrix_Numerical<T>();
+        }
+
+        void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            throw detail::io_error("Failed to map text matrix", path);
+        }
+        ::madvise(map, length, MADV_SEQUENTIAL);
+
+        try
+        {
+            const char* text = static_cast<const char*>(map);
+            Matrix_Numerical<T> result = detail::parse_text<T>(text, text + length, format);
+            ::munmap(map, length);
+            return result;
+        }
+        catch (const std::exception& e)
+        {
+            ::munmap(map, length);
+            throw std::runtime_error(std::string(e.what()) + " in " + path);
+        }
+    }
+
+    template <typename T = long double>
+    inline Matrix_Numerical<T> read_csv(const std::string& path, size_t skip_rows = 0)
+    {
+        return read_text<T>(path, TextFormat::csv(skip_rows));
+    }
+
+    /*
+        Writes any matrix or view as text, blocks of rows are formatted in parallel into
+        memory and then written in order with one fwrite per block
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline void write_text(const std::string& path, const M& m, const TextFormat& format = TextFormat())
+    {
+        XI_TIME_CALL(IO);
+
+        auto v = detail::as_view(m);
+        const char delimiter = format.delimiter;
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            throw detail::io_error("Failed to create text matrix", path);
+        }
+
+        const size_t rows_per_part = std::max<size_t>(1, (size_t(1) << 16) / std::max<size_t>(1, v.cols()));
+        const size_t parts_per_block = 64;
+        std::vector<std::string> parts(parts_per_block);
+
+        try
+        {
+            for (size_t block = 0; block < v.rows(); block += rows_per_part * parts_per_block)
+            {
+                xi_parallel::parallel_for(0, parts_per_block, 1, [&](size_t first_part, size_t last_part) {
+                    for (size_t part = first_part; part < last_part; ++part)
+                    {
+                        parts[part].clear();
+                        size_t first = block + part * rows_per_part;
+                        size_t last = std::min(v.rows(), first + rows_per_part);
+                        for (size_t i = first; i < last; ++i)
+                        {
+                            detail::format_row(v, i, delimiter, parts[part]);
+                        }
+                    }
+                });
+
+                for (const std::string& part : parts)
+                {
+                    detail::write_all(file, part.data(), part.size(), path);
+                }
+            }
+        }
+        catch (...)
+        {
+            std::fclose(file);
+            throw;
+        }
+
+        if (std::fclose(file) != 0)
+        {
+            throw detail::io_error("Failed to finish text matrix", path);
+        }
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline void write_csv(const std::string& path, const M& m)
+    {
+        write_text(path, m, TextFormat::csv());
+    }
+
+    /*
+        Writes any matrix or view to a stream in the text format, row by row through one
+        reusable buffer and without flushing
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline void write_text(std::ostream& os, const M& m, const TextFormat& format = TextFormat())
+    {
+        XI_TIME_CALL(IO);
+
+        auto v = detail::as_view(m);
+        std::string buffer;
+        for (size_t i = 0; i < v.rows(); ++i)
+        {
+            detail::format_row(v, i, format.delimiter, buffer);
+            if (buffer.size() >= (size_t(1) << 16))
+            {
+                XI_COUNT(IO, BYTES, buffer.size());
+                os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        XI_COUNT(IO, BYTES, buffer.size());
+        os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+}
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef XI_MEMO
+#define XI_MEMO
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+    Opt-in memoization of expensive scalar callables
+
+        auto g = xi_memo::memoize(simulation, 1 << 16);
+        xi_integral::definite_integral(g, 0, 1, 1000);
+        xi_integral::definite_integral(g, 0, 1, 2000);      // the 1001 shared abscissae are hits
+        std::cout << g.stats().hit_rate();
+
+    Results are keyed on the exact bit pattern of the argument after conversion to the argument
+    type (long double by default, only its 80 value bits for the x87 format), so only
+    bit-identical abscissae hit; the xi integrators produce those when n doubles, for shared
+    interval endpoints and for repeated stencils. Keys are spread over independently locked
+    shards, each holding capacity / shards entries evicted in clock (second chance) order.
+
+    f runs outside the locks, so slow evaluations never block other lookups. Two threads missing
+    the same key at the same time both evaluate it, the first result is kept.
+
+    xi_integral and xi_derivative recognize memoized callables and count only cache misses as
+    EVALUATIONS in xi_instrument
+*/
+namespace xi_memo
+{
+    struct CacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t size = 0;
+
+        double hit_rate() const
+        {
+            const uint64_t lookups = hits + misses;
+            return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+        }
+    };
+
+    namespace detail
+    {
+        /*
+            Bytes of [ T ] that carry its value, the x87 long double has 6 bytes of padding
+        */
+        template <typename T>
+        inline constexpr size_t value_bytes =
+            std::is_same<T, long double>::value && std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(T);
+
+        struct Key
+        {
+            uint64_t lo = 0;
+            uint64_t hi = 0;
+
+            bool operator==(const Key& other) const { return lo == other.lo && hi == other.hi; }
+        };
+
+        template <typename T>
+        inline Key key_of(const T& x)
+        {
+            static_assert(
+                std::is_trivially_copyable<T>::value && value_bytes<T> <= sizeof(Key),
+                "Memoized arguments must be trivially copyable and at most 16 bytes"
+            );
+
+            unsigned char bytes[sizeof(Key)] = {};
+            std::memcpy(bytes, &x, value_bytes<T>);
+
+            Key key;
+            std::memcpy(&key.lo, bytes, sizeof(uint64_t));
+            std::memcpy(&key.hi, bytes + sizeof(uint64_t), sizeof(uint64_t));
+            return key;
+        }
+
+        // splitmix64 finalizer, shards and hash buckets use differently mixed keys so they do not correlate
+        inline uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const { return static_cast<size_t>(mix(key.lo ^ mix(key.hi))); }
+        };
+    }
+
+    template <typename Func, typename Arg = long double>
+    class Memoized
+    {
+        public:
+            using argument_type = Arg;
+            using result_type = std::decay_t<std::invoke_result_t<Func&, Arg>>;
+
+        private:
+            struct Entry
+            {
+                detail::Key key;
+                result_type value;
+                bool referenced;
+            };
+
+            struct Shard
+            {
+                std::mutex mutex;
+                std::unordered_map<detail::Key, size_t, detail::KeyHash> index;
+                std::vector<Entry> entries;
+                size_t hand = 0;
+                uint64_t hits = 0, misses = 0, evictions = 0;
+            };
+
+            Func _f;
+            size_t _shard_count;
+            size_t _shard_capacity;
+            std::unique_ptr<Shard[]> _shards;
+
+            Shard& shard_of(const detail::Key& key) const
+            {
+                return _shards[detail::mix(key.lo ^ (key.hi << 1)) % _shard_count];
+            }
+
+            /*
+                Clock eviction: the hand clears reference bits until it finds an entry that was
+                not used since its last pass, that slot is reused
+            */
+            void insert(Shard& shard, const detail::Key& key, const result_type& value)
+            {
+                if (shard.entries.size() < _shard_capacity)
+                {
+                    shard.index.emplace(key, shard.entries.size());
+                    shard.entries.push_back(Entry{ key, value, false });
+                    return;
+                }
+
+                while (shard.entries[shard.hand].referenced)
+                {
+                    shard.entries[shard.hand].referenced = false;
+                    shard.hand = (shard.hand + 1) % shard.entries.size();
+                }
+
+                Entry& victim = shard.entries[shard.hand];
+                shard.index.erase(victim.key);
+                victim = Entry{ key, value, false };
+                shard.index.emplace(key, shard.hand);
+                shard.hand = (shard.hand + 1) % shard.entries.size();
+                ++shard.evictions;
+            }
+
+        public:
+            /*
+                Caches up to [ capacity ] results (at least one per shard) over [ shards ] locks
+            */
+            Memoized(Func f, size_t capacity = size_t(1) << 16, size_t shards = 16)
+                : _f(std::move(f)),
+                  _shard_count(std::max<size_t>(1, std::min(shards, std::max<size_t>(capacity, 1)))),
+                  _shard_capacity(std::max<size_t>(1, capacity / _shard_count)),
+                  _shards(new Shard[_shard_count])
+            {
+                for (size_t s = 0; s < _shard_count; ++s)
+                {
+                    _shards[s].index.reserve(_shard_capacity);
+                }
+            }
+
+            result_type operator()(Arg x)
+            {
+                const detail::Key key = detail::key_of(x);
+                Shard& shard = shard_of(key);
+
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    auto it = shard.index.find(key);
+                    if (it != shard.index.end())
+                    {
+                        Entry& entry = shard.entries[it->second];
+                        entry.referenced = true;
+                        ++shard.hits;
+                        return entry.value;
+                    }
+                    ++shard.misses;
+                }
+
+                result_type value = _f(x);
+
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (shard.index.find(key) == shard.index.end())
+                {
+                    insert(shard, key, value);
+                }
+                return value;
+            }
+
+            /*
+                Lookups so far summed over the shards, size is the number of cached results
+            */
+            CacheStats stats() const
+            {
+                CacheStats total;
+                for (size_t s = 0; s < _shard_count; ++s)
+                {
+                    Shard& shard = _shards[s];
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    total.hits += shard.hits;
+                    total.misses += shard.misses;
+                    total.evictions += shard.evictions;
+                    total.size += shard.entries.size();
+                }
+                return total;
+            }
+
+            size_t capacity() const { return _shard_capacity * _shard_count; }
+
+            /*
+                Drops every cached result and resets the statistics
+            */
+            void clear()
+            {
+                for (size_t s = 0; s < _shard_count; ++s)
+                {
+                    Shard& shard = _shards[s];
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard.index.clear();
+                    shard.entries.clear();
+                    shard.hand = 0;
+                    shard.hits = shard.misses = shard.evictions = 0;
+                }
+            }
+
+            Func& function() { return _f; }
+    };
+
+    /*
+        Memoizing wrapper of [ f ] for arguments of type [ Arg ]
+    */
+    template <typename Arg = long double, typename Func>
+    inline Memoized<std::decay_t<Func>, Arg> memoize(Func&& f, size_t capacity = size_t(1) << 16, size_t shards = 16)
+    {
+        return Memoized<std::decay_t<Func>, Arg>(std::forward<Func>(f), capacity, shards);
+    }
+
+    template <typename Func>
+    struct is_memoized : std::false_type {};
+
+    template <typename Func, typename Arg>
+    struct is_memoized<Memoized<Func, Arg>> : std::true_type {};
+
+    template <typename Func>
+    inline constexpr bool is_memoized_v = is_memoized<std::remove_cv_t<std::remove_reference_t<Func>>>::value;
+
+    /*
+        Calls of the wrapped function so far for memoized callables, [ otherwise ] for any other
+        callable; the xi modules take the difference around a call to count real evaluations
+    */
+    template <typename Func>
+    inline uint64_t misses(const Func& f, uint64_t otherwise = 0)
+    {
+        if constexpr (is_memoized_v<Func>)
+        {
+            return f.stats().misses;
+        }
+        else
+        {
+            return otherwise;
+        }
+    }
+
+    /*
+        Evaluations a call of an xi routine really cost: the misses since [ before ] (taken with
+        misses(f) ahead of the call) for memoized callables, [ nominal ] for any other callable
+        Other threads sharing the cache during the call are attributed to it as well
+    */
+    template <typename Func>
+    inline uint64_t evaluations(const Func& f, uint64_t before, uint64_t nominal)
+    {
+        if constexpr (is_memoized_v<Func>)
+        {
+            return f.stats().misses - before;
+        }
+        else
+        {
+            (void)before;
+            return nominal;
+        }
+    }
+}
+
+#endif
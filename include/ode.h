@@ -0,0 +1,917 @@
+#ifndef XI_ODE
+#define XI_ODE
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "parallel.h"
+#include "matrix.h"
+#include "derivative.h"
+
+/*
+    Initial value problems y' = f(t, y), y(t0) = y0 on [ t0, t1 ] (t1 < t0 integrates backwards)
+
+        dopri5(f, t0, t1, y0)           explicit Dormand-Prince 5(4), adaptive, with dense output
+        rosenbrock23(f, t0, t1, y0)     linearly implicit Rosenbrock 2(3) for stiff problems
+        dopri5_batch(f, t0, t1, y0, n)  many independent initial conditions of one system at once
+
+    The right-hand side writes f(t, y) into its last argument, no state vectors are allocated
+    per evaluation:
+
+        auto f = [](double t, const std::vector<double>& y, std::vector<double>& dydt) { ... };
+
+    Both single trajectory solvers return a Solution holding every accepted step. Evaluating it
+    at any t inside the span interpolates with the order 4 continuous extension of Dormand-Prince
+    or a cubic Hermite polynomial for Rosenbrock, so output times never shorten the steps.
+
+    Stiff problems (widely separated time scales, e.g. chemical kinetics) force an explicit method
+    to steps bounded by the fastest decay rather than the accuracy. rosenbrock23 is Shampine's
+    L-stable ode23s scheme: one Jacobian and one LU factorization of I - h d J per step and three
+    linear solves, no Newton iteration. The Jacobian and df/dt come from xi_derivative::jacobian,
+    the factorization and solves from xi_matrix::lu_factor / lu_solve.
+
+    The step size is controlled on the scaled RMS norm of the local error estimate,
+    |err_i| / (atol + rtol * max(|y_i|, |y_new_i|)) must stay below 1 on average
+*/
+namespace xi_ode
+{
+    struct Options
+    {
+        double rtol = 1e-6;
+        double atol = 1e-9;
+        double initial_step = 0;    // 0 picks one from the problem
+        double max_step = 0;        // 0 allows steps as long as the whole span
+        size_t max_steps = 1000000; // std::runtime_error beyond this many attempted steps
+        bool dense = true;          // keep every step, false keeps only both endpoints
+    };
+
+    /*
+        Trajectory computed by dopri5 or rosenbrock23
+
+        t holds the accepted step boundaries (t.front() = t0, t.back() = t1), the state at t[k]
+        is y[k * dimension ... (k + 1) * dimension), dydt holds f at the same points
+        operator()(time) interpolates anywhere in the span, it needs the default Options::dense
+    */
+    template <typename T>
+    struct Solution
+    {
+        size_t dimension = 0;
+        std::vector<T> t;
+        std::vector<T> y;
+        std::vector<T> dydt;
+        std::vector<T> coefficients;    // 5 * dimension per step for the Dormand-Prince interpolant
+
+        size_t evaluations = 0;         // right-hand side calls, Jacobian columns included
+        size_t steps = 0;               // accepted steps
+        size_t rejected = 0;            // rejected steps
+        size_t jacobians = 0;           // Jacobians / LU factorizations (rosenbrock23)
+
+        const T* state(size_t k) const
+        {
+            if (k >= t.size())
+            {
+                throw std::out_of_range("xi_ode::Solution: state index out of range");
+            }
+            return y.data() + k * dimension;
+        }
+
+        std::vector<T> final_state() const
+        {
+            return std::vector<T>(y.end() - dimension, y.end());
+        }
+
+        std::vector<T> operator()(T time) const
+        {
+            std::vector<T> out(dimension);
+            at(time, out.data());
+            return out;
+        }
+
+        void at(T time, T* out) const
+        {
+            if (t.size() < 2 || dydt.size() != y.size())
+            {
+                throw std::logic_error("xi_ode::Solution: interpolation needs a dense solution");
+            }
+
+            const bool forward = t.back() >= t.front();
+            const T lo = forward ? t.front() : t.back();
+            const T hi = forward ? t.back() : t.front();
+            if (!(time >= lo && time <= hi))
+            {
+                throw std::out_of_range("xi_ode::Solution: time outside the integrated span");
+            }
+
+            // Step k covers [ t[k], t[k + 1] ]
+            auto it = forward
+                ? std::upper_bound(t.begin() + 1, t.end() - 1, time)
+                : std::upper_bound(t.begin() + 1, t.end() - 1, time, std::greater<T>());
+            const size_t k = static_cast<size_t>(it - t.begin()) - 1;
+
+            const T h = t[k + 1] - t[k];
+            const T theta = (time - t[k]) / h;
+            const T theta1 = 1 - theta;
+            const size_t n = dimension;
+
+            if (!coefficients.empty())
+            {
+                const T* r = coefficients.data() + 5 * n * k;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = r[i] + theta * (r[n + i] + theta1 * (r[2 * n + i] + theta * (r[3 * n + i] + theta1 * r[4 * n + i])));
+                }
+                return;
+            }
+
+            // Cubic Hermite on both end points and slopes
+            const T* y0 = y.data() + k * n;
+            const T* y1 = y0 + n;
+            const T* f0 = dydt.data() + k * n;
+            const T* f1 = f0 + n;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const T d = y1[i] - y0[i];
+                out[i] = y0[i] + theta * d + theta * (theta - 1) * ((1 - 2 * theta) * d + (theta - 1) * h * f0[i] + theta * h * f1[i]);
+            }
+        }
+    };
+
+    /*
+        Final (and requested intermediate) states of dopri5_batch
+
+        Component i of trajectory l at times[k] is states[(k * dimension + i) * count + l],
+        the same component-major layout as the initial conditions
+    */
+    template <typename T>
+    struct BatchSolution
+    {
+        size_t dimension = 0;
+        size_t count = 0;
+        std::vector<T> times;
+        std::vector<T> states;
+
+        size_t evaluations = 0;         // right-hand side calls, each over one block of trajectories
+        size_t steps = 0;
+        size_t rejected = 0;
+
+        T operator()(size_t k, size_t i, size_t l) const
+        {
+            assert(k < times.size() && i < dimension && l < count && "Batch solution index out of range");
+            return states[(k * dimension + i) * count + l];
+        }
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        struct identity { using type = T; };
+
+        template <typename T>
+        using identity_t = typename identity<T>::type;
+
+        /*
+            Dormand-Prince 5(4) tableau, error weights (5th minus 4th order) and the
+            coefficients of Hairer's order 4 continuous extension
+        */
+        struct DormandPrince
+        {
+            static constexpr long double c2 = 1.0L / 5, c3 = 3.0L / 10, c4 = 4.0L / 5, c5 = 8.0L / 9;
+
+            static constexpr long double a21 = 1.0L / 5;
+            static constexpr long double a31 = 3.0L / 40, a32 = 9.0L / 40;
+            static constexpr long double a41 = 44.0L / 45, a42 = -56.0L / 15, a43 = 32.0L / 9;
+            static constexpr long double a51 = 19372.0L / 6561, a52 = -25360.0L / 2187, a53 = 64448.0L / 6561, a54 = -212.0L / 729;
+            static constexpr long double a61 = 9017.0L / 3168, a62 = -355.0L / 33, a63 = 46732.0L / 5247, a64 = 49.0L / 176, a65 = -5103.0L / 18656;
+            static constexpr long double a71 = 35.0L / 384, a73 = 500.0L / 1113, a74 = 125.0L / 192, a75 = -2187.0L / 6784, a76 = 11.0L / 84;
+
+            static constexpr long double e1 = 71.0L / 57600, e3 = -71.0L / 16695, e4 = 71.0L / 1920, e5 = -17253.0L / 339200, e6 = 22.0L / 525, e7 = -1.0L / 40;
+
+            static constexpr long double d1 = -12715105075.0L / 11282082432, d3 = 87487479700.0L / 32700410799, d4 = -10690763975.0L / 1880347072;
+            static constexpr long double d5 = 701980252875.0L / 199316789632, d6 = -1453857185.0L / 822651844, d7 = 69997945.0L / 29380423;
+        };
+
+        /*
+            Scaled RMS error norm of every lane, the result is the largest of them
+            Arrays are component-major, element (i, l) at i * lanes + l
+        */
+        template <typename T>
+        inline T error_norm(const T* err, const T* y0, const T* y1, size_t n, size_t lanes, const Options& options, std::vector<T>& sums)
+        {
+            const T atol = static_cast<T>(options.atol);
+            const T rtol = static_cast<T>(options.rtol);
+
+            sums.assign(lanes, T(0));
+            T* s = sums.data();
+            for (size_t i = 0; i < n; ++i)
+            {
+                const size_t row = i * lanes;
+                #pragma omp simd
+                for (size_t l = 0; l < lanes; ++l)
+                {
+                    const T scale = atol + rtol * std::max(std::fabs(y0[row + l]), std::fabs(y1[row + l]));
+                    const T r = err[row + l] / scale;
+                    s[l] += r * r;
+                }
+            }
+
+            T worst = 0;
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                // NaN compares false, keep it so the step is rejected
+                if (!(s[l] <= worst)) worst = s[l];
+            }
+            return n ? std::sqrt(worst / static_cast<T>(n)) : T(0);
+        }
+
+        /*
+            Starting step of Hairer, Norsett & Wanner (II.4): a step whose explicit Euler
+            error estimate is about 1 / 100 of the tolerance, for a method of [ order ]
+            Costs one right-hand side evaluation
+        */
+        template <typename T, typename Rhs>
+        inline T initial_step(Rhs& rhs, T t0, T t1, const std::vector<T>& y0, const std::vector<T>& f0, size_t n, size_t lanes, int order, const Options& options)
+        {
+            if (options.initial_step > 0)
+            {
+                return static_cast<T>(options.initial_step);
+            }
+
+            std::vector<T> sums, zero(y0.size(), T(0));
+            const T d0 = error_norm(y0.data(), y0.data(), zero.data(), n, lanes, options, sums);
+            const T d1 = error_norm(f0.data(), y0.data(), zero.data(), n, lanes, options, sums);
+
+            T h0 = (d0 < T(1e-5) || d1 < T(1e-5)) ? T(1e-6) : T(0.01) * d0 / d1;
+            h0 = std::min(h0, std::fabs(t1 - t0));
+            const T dir = t1 >= t0 ? T(1) : T(-1);
+
+            std::vector<T> y1(y0.size()), f1(y0.size());
+            for (size_t i = 0; i < y0.size(); ++i)
+            {
+                y1[i] = y0[i] + dir * h0 * f0[i];
+            }
+            rhs(t0 + dir * h0, y1, f1);
+
+            for (size_t i = 0; i < y0.size(); ++i)
+            {
+                f1[i] -= f0[i];
+            }
+            const T d2 = error_norm(f1.data(), y0.data(), zero.data(), n, lanes, options, sums) / h0;
+
+            const T d = std::max(d1, d2);
+            const T h1 = d <= T(1e-15)
+                ? std::max(T(1e-6), h0 * T(1e-3))
+                : std::pow(T(0.01) / d, T(1) / (order + 1));
+
+            return std::min(100 * h0, h1);
+        }
+
+        /*
+            Stage storage and step attempts of Dormand-Prince over n components of [ lanes ]
+            trajectories (component-major), lanes = 1 is the ordinary single system
+            k[0] must hold f(t, y) before a step, after accept() it holds f(t + h, y + h ...)
+        */
+        template <typename T>
+        class DormandPrinceStepper
+        {
+            public:
+                DormandPrinceStepper(size_t n, size_t lanes)
+                    : n(n), lanes(lanes), y(n * lanes), y1(n * lanes), ytmp(n * lanes), err(n * lanes)
+                {
+                    for (auto& stage : k) stage.resize(n * lanes);
+                }
+
+                /*
+                    Attempts the step (t, y) -> (t + h, y1), returns the error norm
+                    Six right-hand side evaluations
+                */
+                template <typename Rhs>
+                T attempt(Rhs& rhs, T t, T h, const Options& options)
+                {
+                    using C = DormandPrince;
+
+                    stage(h, { T(C::a21) });
+                    rhs(t + T(C::c2) * h, ytmp, k[1]);
+                    stage(h, { T(C::a31), T(C::a32) });
+                    rhs(t + T(C::c3) * h, ytmp, k[2]);
+                    stage(h, { T(C::a41), T(C::a42), T(C::a43) });
+                    rhs(t + T(C::c4) * h, ytmp, k[3]);
+                    stage(h, { T(C::a51), T(C::a52), T(C::a53), T(C::a54) });
+                    rhs(t + T(C::c5) * h, ytmp, k[4]);
+                    stage(h, { T(C::a61), T(C::a62), T(C::a63), T(C::a64), T(C::a65) });
+                    rhs(t + h, ytmp, k[5]);
+
+                    // 5th order solution, its slope is the first stage of the next step (FSAL)
+                    const size_t size = y.size();
+                    {
+                        const T b1 = h * T(C::a71), b3 = h * T(C::a73), b4 = h * T(C::a74), b5 = h * T(C::a75), b6 = h * T(C::a76);
+                        const T *k1 = k[0].data(), *k3 = k[2].data(), *k4 = k[3].data(), *k5 = k[4].data(), *k6 = k[5].data();
+                        const T* y0 = y.data();
+                        T* out = y1.data();
+                        #pragma omp simd
+                        for (size_t i = 0; i < size; ++i)
+                        {
+                            out[i] = y0[i] + b1 * k1[i] + b3 * k3[i] + b4 * k4[i] + b5 * k5[i] + b6 * k6[i];
+                        }
+                    }
+                    rhs(t + h, y1, k[6]);
+
+                    {
+                        const T w1 = h * T(C::e1), w3 = h * T(C::e3), w4 = h * T(C::e4), w5 = h * T(C::e5), w6 = h * T(C::e6), w7 = h * T(C::e7);
+                        const T *k1 = k[0].data(), *k3 = k[2].data(), *k4 = k[3].data(), *k5 = k[4].data(), *k6 = k[5].data(), *k7 = k[6].data();
+                        T* e = err.data();
+                        #pragma omp simd
+                        for (size_t i = 0; i < size; ++i)
+                        {
+                            e[i] = w1 * k1[i] + w3 * k3[i] + w4 * k4[i] + w5 * k5[i] + w6 * k6[i] + w7 * k7[i];
+                        }
+                    }
+
+                    return error_norm(err.data(), y.data(), y1.data(), n, lanes, options, sums);
+                }
+
+                /*
+                    Continuous extension of the last attempted step, five arrays of y.size()
+                    written to [ r ]: y(t + theta h) = r0 + theta (r1 + theta1 (r2 + theta (r3 + theta1 r4)))
+                */
+                void dense(T h, T* r) const
+                {
+                    using C = DormandPrince;
+
+                    const size_t size = y.size();
+                    const T w1 = h * T(C::d1), w3 = h * T(C::d3), w4 = h * T(C::d4), w5 = h * T(C::d5), w6 = h * T(C::d6), w7 = h * T(C::d7);
+                    const T *k1 = k[0].data(), *k3 = k[2].data(), *k4 = k[3].data(), *k5 = k[4].data(), *k6 = k[5].data(), *k7 = k[6].data();
+                    const T *y0 = y.data(), *yn = y1.data();
+                    T *r0 = r, *r1 = r + size, *r2 = r + 2 * size, *r3 = r + 3 * size, *r4 = r + 4 * size;
+
+                    #pragma omp simd
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        const T diff = yn[i] - y0[i];
+                        const T bspl = h * k1[i] - diff;
+                        r0[i] = y0[i];
+                        r1[i] = diff;
+                        r2[i] = bspl;
+                        r3[i] = diff - h * k7[i] - bspl;
+                        r4[i] = w1 * k1[i] + w3 * k3[i] + w4 * k4[i] + w5 * k5[i] + w6 * k6[i] + w7 * k7[i];
+                    }
+                }
+
+                /*
+                    y(t + theta h) of the last attempted step written to [ out ]
+                */
+                void interpolate(T h, T theta, T* out) const
+                {
+                    using C = DormandPrince;
+
+                    const size_t size = y.size();
+                    const T theta1 = 1 - theta;
+                    const T w1 = h * T(C::d1), w3 = h * T(C::d3), w4 = h * T(C::d4), w5 = h * T(C::d5), w6 = h * T(C::d6), w7 = h * T(C::d7);
+                    const T *k1 = k[0].data(), *k3 = k[2].data(), *k4 = k[3].data(), *k5 = k[4].data(), *k6 = k[5].data(), *k7 = k[6].data();
+                    const T *y0 = y.data(), *yn = y1.data();
+
+                    #pragma omp simd
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        const T diff = yn[i] - y0[i];
+                        const T bspl = h * k1[i] - diff;
+                        const T r3 = diff - h * k7[i] - bspl;
+                        const T r4 = w1 * k1[i] + w3 * k3[i] + w4 * k4[i] + w5 * k5[i] + w6 * k6[i] + w7 * k7[i];
+                        out[i] = y0[i] + theta * (diff + theta1 * (bspl + theta * (r3 + theta1 * r4)));
+                    }
+                }
+
+                void accept()
+                {
+                    std::swap(y, y1);
+                    std::swap(k[0], k[6]);
+                }
+
+                size_t n, lanes;
+                std::vector<T> y, y1, ytmp, err;
+                std::vector<T> k[7];
+
+            private:
+                std::vector<T> sums;
+
+                // ytmp = y + h * sum_j a[j] k[j]
+                void stage(T h, std::initializer_list<T> a)
+                {
+                    const size_t size = y.size();
+                    const T* y0 = y.data();
+                    T* out = ytmp.data();
+
+                    #pragma omp simd
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        out[i] = y0[i];
+                    }
+
+                    size_t j = 0;
+                    for (T aj : a)
+                    {
+                        const T w = h * aj;
+                        const T* kj = k[j++].data();
+                        #pragma omp simd
+                        for (size_t i = 0; i < size; ++i)
+                        {
+                            out[i] += w * kj[i];
+                        }
+                    }
+                }
+        };
+
+        /*
+            Shared step size loop of the explicit solvers, [ stepper ].y holds y(t0) on entry
+            on_accept(t, h, t_new) runs after every accepted step before the stepper moves on,
+            so the stepper still describes the step (dense output, y, y1)
+        */
+        template <typename T, typename Rhs, typename OnAccept>
+        inline void dopri5_loop(DormandPrinceStepper<T>& stepper, Rhs& rhs, T t0, T t1, const Options& options, OnAccept&& on_accept, size_t& evaluations, size_t& steps, size_t& rejected)
+        {
+            const T dir = t1 >= t0 ? T(1) : T(-1);
+            const T span = std::fabs(t1 - t0);
+            const T max_step = options.max_step > 0 ? std::min(static_cast<T>(options.max_step), span) : span;
+            const T eps = std::numeric_limits<T>::epsilon();
+
+            // PI step control (Gustafsson), beta as in Hairer's DOPRI5
+            const T beta = T(0.04);
+            const T alpha = T(0.2) - T(0.75) * beta;
+
+            rhs(t0, stepper.y, stepper.k[0]);
+            ++evaluations;
+
+            T h = std::min(detail::initial_step(rhs, t0, t1, stepper.y, stepper.k[0], stepper.n, stepper.lanes, 5, options), max_step);
+            if (options.initial_step <= 0) ++evaluations;
+
+            T t = t0;
+            T err_old = T(1e-4);
+            bool last_rejected = false;
+            size_t attempts = 0;
+
+            while (dir * (t1 - t) > 0)
+            {
+                if (++attempts > options.max_steps)
+                {
+                    throw std::runtime_error("xi_ode: maximum number of steps exceeded");
+                }
+                // Land exactly on t1, and stretch a step that would leave a sliver behind
+                h = std::min(h, max_step);
+                bool last = false;
+                if (h >= std::fabs(t1 - t) * (1 - 4 * eps) || std::fabs(t1 - t) - h <= 0.01 * h)
+                {
+                    h = std::fabs(t1 - t);
+                    last = true;
+                }
+                // Relative to the time and the span, a step that reaches t1 is never too short
+                if (!last && h <= 16 * eps * std::max(std::fabs(t), span))
+                {
+                    throw std::runtime_error("xi_ode: step size underflow");
+                }
+
+                const T err = stepper.attempt(rhs, t, dir * h, options);
+                evaluations += 6;
+
+                if (err <= 1)
+                {
+                    T factor = T(0.9) * std::pow(std::max(err, T(1e-10)), -alpha) * std::pow(err_old, beta);
+                    factor = std::min(T(10), std::max(T(0.2), factor));
+                    if (last_rejected) factor = std::min(factor, T(1));
+                    err_old = std::max(err, T(1e-4));
+
+                    const T t_new = last ? t1 : t + dir * h;
+                    on_accept(t, dir * h, t_new);
+                    stepper.accept();
+                    t = t_new;
+                    ++steps;
+
+                    h *= factor;
+                    last_rejected = false;
+                    xi_parallel::checkpoint(1);
+                }
+                else
+                {
+                    // NaN / inf in the stages lands here as well
+                    const T factor = err < std::numeric_limits<T>::infinity()
+                        ? std::max(T(0.2), T(0.9) * std::pow(err, -alpha))
+                        : T(0.2);
+                    h *= factor;
+                    ++rejected;
+                    last_rejected = true;
+                }
+            }
+        }
+
+        template <typename T>
+        inline void record(Solution<T>& solution, T t, const T* y, const T* dydt)
+        {
+            const size_t n = solution.dimension;
+            solution.t.push_back(t);
+            solution.y.insert(solution.y.end(), y, y + n);
+            solution.dydt.insert(solution.dydt.end(), dydt, dydt + n);
+        }
+    }
+
+    /*
+        Explicit Dormand-Prince 5(4) with FSAL, PI step size control and the continuous
+        extension of order 4 for dense output, 6 evaluations of f per step
+
+        f(t, y, dydt) with y a const std::vector<T>& and dydt a std::vector<T>& of the same size
+        Throws std::runtime_error when the step size underflows (stiff or singular problems,
+        use rosenbrock23) or more than options.max_steps steps are attempted
+    */
+    template <typename Func, typename T>
+    inline Solution<T> dopri5(Func&& f, T t0, detail::identity_t<T> t1, const std::vector<T>& y0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "ODE states must be floating point"
+        );
+        assert(options.rtol > 0 && options.atol >= 0 && "Tolerances must be positive");
+
+        XI_TIME_CALL(ODE);
+
+        const size_t n = y0.size();
+        Solution<T> solution;
+        solution.dimension = n;
+
+        detail::DormandPrinceStepper<T> stepper(n, 1);
+        stepper.y = y0;
+
+        auto rhs = [&](T t, const std::vector<T>& y, std::vector<T>& dydt) { f(t, y, dydt); };
+
+        if (t0 == t1)
+        {
+            rhs(t0, stepper.y, stepper.k[0]);
+            solution.evaluations = 1;
+            detail::record(solution, t0, stepper.y.data(), stepper.k[0].data());
+            detail::record(solution, t1, stepper.y.data(), stepper.k[0].data());
+            XI_COUNT(ODE, EVALUATIONS, 1);
+            return solution;
+        }
+
+        bool first = true;
+        auto on_accept = [&](T t, T h, T t_new) {
+            if (first)
+            {
+                detail::record(solution, t, stepper.y.data(), stepper.k[0].data());
+                first = false;
+            }
+
+            if (options.dense || t_new == t1)
+            {
+                detail::record(solution, t_new, stepper.y1.data(), stepper.k[6].data());
+            }
+            if (options.dense)
+            {
+                const size_t offset = solution.coefficients.size();
+                solution.coefficients.resize(offset + 5 * n);
+                stepper.dense(h, solution.coefficients.data() + offset);
+            }
+        };
+
+        detail::dopri5_loop(stepper, rhs, t0, t1, options, on_accept, solution.evaluations, solution.steps, solution.rejected);
+        XI_COUNT(ODE, EVALUATIONS, solution.evaluations);
+
+        if (!options.dense)
+        {
+            solution.dydt.clear();
+        }
+        return solution;
+    }
+
+    /*
+        Linearly implicit Rosenbrock 2(3) (Shampine & Reichelt, the ode23s scheme), L-stable
+        and suited to stiff systems
+
+        Every accepted step builds J = df/dy and df/dt with xi_derivative::jacobian (6 n + 8
+        evaluations of f) and factors W = I - h d J, d = 1 / (2 + sqrt 2), with
+        xi_matrix::lu_factor; a rejected step only refactors W. The 2nd order solution is
+        advanced, the 3rd order stage estimates its error. Dense output is cubic Hermite.
+
+        Same f signature, options and exceptions as dopri5
+    */
+    template <typename Func, typename T>
+    inline Solution<T> rosenbrock23(Func&& f, T t0, detail::identity_t<T> t1, const std::vector<T>& y0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "ODE states must be floating point"
+        );
+        assert(options.rtol > 0 && options.atol >= 0 && "Tolerances must be positive");
+
+        XI_TIME_CALL(ODE);
+
+        const size_t n = y0.size();
+        Solution<T> solution;
+        solution.dimension = n;
+
+        std::vector<T> y = y0, y_new(n), ytmp(n), f0(n), f1(n), f2(n), dfdt(n), k1(n), k2(n), k3(n), err(n), sums;
+
+        auto rhs = [&](T t, const std::vector<T>& state, std::vector<T>& dydt) {
+            f(t, state, dydt);
+            ++solution.evaluations;
+        };
+
+        rhs(t0, y, f0);
+        detail::record(solution, t0, y.data(), f0.data());
+
+        if (t0 == t1)
+        {
+            detail::record(solution, t1, y.data(), f0.data());
+            XI_COUNT(ODE, EVALUATIONS, solution.evaluations);
+            return solution;
+        }
+
+        const T d = T(1) / (2 + std::sqrt(T(2)));
+        const T e32 = 6 + std::sqrt(T(2));
+        const T dir = t1 >= t0 ? T(1) : T(-1);
+        const T span = std::fabs(t1 - t0);
+        const T max_step = options.max_step > 0 ? std::min(static_cast<T>(options.max_step), span) : span;
+        const T eps = std::numeric_limits<T>::epsilon();
+
+        T h = std::min(detail::initial_step(rhs, t0, t1, y, f0, n, 1, 2, options), max_step);
+
+        xi_matrix::Matrix_Numerical<T> J, W(n, n);
+        std::vector<size_t> pivots;
+        bool stale = true;
+
+        auto solve = [&](std::vector<T>& b) {
+            xi_matrix::lu_solve(W.view().as_const(), pivots, xi_matrix::MatrixView<T>(b.data(), n, 1, 1));
+        };
+
+        T t = t0;
+        size_t attempts = 0;
+        bool last_rejected = false;
+
+        while (dir * (t1 - t) > 0)
+        {
+            if (++attempts > options.max_steps)
+            {
+                throw std::runtime_error("xi_ode: maximum number of steps exceeded");
+            }
+            h = std::min(h, max_step);
+            bool last = false;
+            if (h >= std::fabs(t1 - t) * (1 - 4 * eps) || std::fabs(t1 - t) - h <= 0.01 * h)
+            {
+                h = std::fabs(t1 - t);
+                last = true;
+            }
+            if (!last && h <= 16 * eps * std::max(std::fabs(t), span))
+            {
+                throw std::runtime_error("xi_ode: step size underflow");
+            }
+            const T hs = dir * h;
+
+            if (stale)
+            {
+                J = xi_derivative::jacobian([&](const std::vector<T>& state) {
+                    std::vector<T> out(n);
+                    rhs(t, state, out);
+                    return out;
+                }, y);
+
+                const auto Jt = xi_derivative::jacobian([&](const std::vector<T>& time) {
+                    std::vector<T> out(n);
+                    rhs(time[0], y, out);
+                    return out;
+                }, std::vector<T>{ t });
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    dfdt[i] = Jt(i, 0);
+                }
+                ++solution.jacobians;
+                stale = false;
+            }
+
+            // W = I - h d J
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    W(i, j) = (i == j ? T(1) : T(0)) - hs * d * J(i, j);
+                }
+            }
+
+            if (xi_matrix::lu_factor(W.view(), pivots) == 0)
+            {
+                h *= T(0.5);
+                ++solution.rejected;
+                last_rejected = true;
+                continue;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                k1[i] = f0[i] + hs * d * dfdt[i];
+            }
+            solve(k1);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                ytmp[i] = y[i] + T(0.5) * hs * k1[i];
+            }
+            rhs(t + T(0.5) * hs, ytmp, f1);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                k2[i] = f1[i] - k1[i];
+            }
+            solve(k2);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                k2[i] += k1[i];
+                y_new[i] = y[i] + hs * k2[i];
+            }
+
+            const T t_new = last ? t1 : t + hs;
+            rhs(t_new, y_new, f2);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                k3[i] = f2[i] - e32 * (k2[i] - f1[i]) - 2 * (k1[i] - f0[i]) + hs * d * dfdt[i];
+            }
+            solve(k3);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                err[i] = hs / 6 * (k1[i] - 2 * k2[i] + k3[i]);
+            }
+            const T norm = detail::error_norm(err.data(), y.data(), y_new.data(), n, 1, options, sums);
+
+            if (norm <= 1)
+            {
+                T factor = std::min(T(5), T(0.8) * std::pow(std::max(norm, T(1e-10)), T(-1) / 3));
+                if (last_rejected) factor = std::min(factor, T(1));
+
+                std::swap(y, y_new);
+                std::swap(f0, f2);
+                t = t_new;
+                ++solution.steps;
+
+                if (options.dense || t == t1)
+                {
+                    detail::record(solution, t, y.data(), f0.data());
+                }
+
+                h *= factor;
+                stale = true;
+                last_rejected = false;
+                xi_parallel::checkpoint(1);
+            }
+            else
+            {
+                const T factor = norm < std::numeric_limits<T>::infinity()
+                    ? std::max(T(0.2), T(0.8) * std::pow(norm, T(-1) / 3))
+                    : T(0.2);
+                h *= factor;
+                ++solution.rejected;
+                last_rejected = true;
+            }
+        }
+
+        XI_COUNT(ODE, EVALUATIONS, solution.evaluations);
+
+        if (!options.dense)
+        {
+            solution.dydt.clear();
+        }
+        return solution;
+    }
+
+    namespace detail
+    {
+        /*
+            Trajectories integrated in lockstep by one task: they share the step size (the
+            worst lane decides) and every stage is one SIMD loop over them
+        */
+        inline constexpr size_t ode_batch_lanes = 64;
+    }
+
+    /*
+        Integrates [ count ] = y0.size() / dimension independent initial conditions of the same
+        system with Dormand-Prince 5(4)
+
+        Initial conditions are component-major, y0[i * count + l] is component i of trajectory l,
+        and so is the state handed to the right-hand side:
+
+            f(t, y, dydt, lanes)    const T* y, T* dydt, element (i, l) at i * lanes + l
+
+        so a plain loop over l inside f vectorizes. Trajectories are split into blocks of up to
+        64 lanes that run in parallel (xi_parallel::parallel_for), the lanes of a block step
+        together with the step size of the most demanding one; group similar initial conditions
+        to keep that cheap.
+
+        [ times ] (default { t1 }) lists the output times in integration order inside
+        [ t0, t1 ], states there are interpolated with the dense output and never shorten a step
+    */
+    template <typename Func, typename T>
+    inline BatchSolution<T> dopri5_batch(Func&& f, T t0, detail::identity_t<T> t1, const std::vector<T>& y0, size_t dimension, std::vector<T> times = {}, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "ODE states must be floating point"
+        );
+        assert(dimension > 0 && y0.size() % dimension == 0 && "Initial conditions must hold dimension values per trajectory");
+        assert(options.rtol > 0 && options.atol >= 0 && "Tolerances must be positive");
+
+        XI_TIME_CALL(ODE);
+
+        if (times.empty())
+        {
+            times.push_back(t1);
+        }
+
+        const T dir = t1 >= t0 ? T(1) : T(-1);
+        for (size_t k = 0; k < times.size(); ++k)
+        {
+            if (dir * (times[k] - t0) < 0 || dir * (times[k] - t1) > 0 || (k > 0 && dir * (times[k] - times[k - 1]) < 0))
+            {
+                throw std::invalid_argument("xi_ode::dopri5_batch: output times must be ordered inside [ t0, t1 ]");
+            }
+        }
+
+        const size_t n = dimension;
+        const size_t count = y0.size() / n;
+        const size_t blocks = (count + detail::ode_batch_lanes - 1) / detail::ode_batch_lanes;
+
+        BatchSolution<T> solution;
+        solution.dimension = n;
+        solution.count = count;
+        solution.times = times;
+        solution.states.resize(times.size() * n * count);
+
+        std::vector<size_t> evaluations(blocks), steps(blocks), rejected(blocks);
+
+        xi_parallel::parallel_for(0, blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; ++b)
+            {
+                const size_t begin = b * detail::ode_batch_lanes;
+                const size_t lanes = std::min(detail::ode_batch_lanes, count - begin);
+
+                detail::DormandPrinceStepper<T> stepper(n, lanes);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    std::copy_n(y0.begin() + i * count + begin, lanes, stepper.y.begin() + i * lanes);
+                }
+
+                auto rhs = [&](T t, const std::vector<T>& y, std::vector<T>& dydt) { f(t, y.data(), dydt.data(), lanes); };
+
+                std::vector<T> point(n * lanes);
+                size_t next = 0;
+
+                auto store = [&](size_t k, const T* state) {
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        std::copy_n(state + i * lanes, lanes, solution.states.begin() + (k * n + i) * count + begin);
+                    }
+                };
+
+                while (next < times.size() && times[next] == t0)
+                {
+                    store(next++, stepper.y.data());
+                }
+
+                auto on_accept = [&](T t, T h, T t_new) {
+                    while (next < times.size() && dir * (times[next] - t_new) <= 0)
+                    {
+                        if (times[next] == t_new)
+                        {
+                            store(next++, stepper.y1.data());
+                            continue;
+                        }
+                        stepper.interpolate(h, (times[next] - t) / h, point.data());
+                        store(next++, point.data());
+                    }
+                };
+
+                if (t0 != t1)
+                {
+                    detail::dopri5_loop(stepper, rhs, t0, static_cast<T>(t1), options, on_accept, evaluations[b], steps[b], rejected[b]);
+                }
+            }
+        });
+
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            solution.evaluations += evaluations[b];
+            solution.steps += steps[b];
+            solution.rejected += rejected[b];
+        }
+        XI_COUNT(ODE, EVALUATIONS, solution.evaluations);
+
+        return solution;
+    }
+}
+
+#endif
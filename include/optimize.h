@@ -0,0 +1,626 @@
+#ifndef XI_OPTIMIZE
+#define XI_OPTIMIZE
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+#include "roots.h"
+
+/*
+    Unconstrained minimization of f : R^n -> R
+
+        lbfgs(f, x0)            limited memory BFGS with a backtracking Armijo line search
+        trust_region(f, x0)     dogleg trust region on a BFGS model Hessian
+        nelder_mead(f, x0)      derivative free simplex search (adaptive coefficients)
+
+    The objective is f(x) returning the value, with x a const std::vector<T>&. The gradient based
+    methods also take f(x, gradient), which returns the value and fills the gradient; otherwise the
+    gradient is a forward difference that reuses f(x), n extra points per gradient.
+
+    xi_roots::batched(g) wraps g(const std::vector<std::vector<T>>& xs, std::vector<T>& fx),
+    the difference points of a gradient and the vertices of a new or shrunk simplex are then
+    evaluated in one call
+
+    Results report the number of evaluated points (gradient points included) next to the minimum
+*/
+namespace xi_optimize
+{
+    using xi_roots::batched;
+
+    struct Options
+    {
+        double gradient_tolerance = 1e-6;   // converged once max |g_i| is at most this (lbfgs, trust_region)
+        double step_tolerance = 1e-10;      // or once a step changes no x_i by more than this * (1 + |x_i|)
+        double value_tolerance = 1e-12;     // or once f drops by less than this * (1 + |f|), nelder_mead: spread of the simplex values
+        size_t max_iterations = 1000;
+        size_t max_evaluations = 100000;    // stops once more points have been evaluated
+        size_t history = 8;                 // correction pairs kept by lbfgs
+    };
+
+    template <typename T>
+    struct OptimizeResult
+    {
+        std::vector<T> x;
+        T value = 0;
+        size_t evaluations = 0;             // points at which f was evaluated
+        size_t iterations = 0;
+        bool converged = false;
+    };
+
+    namespace detail
+    {
+        template <typename Func, typename T>
+        inline constexpr bool has_gradient_v =
+            !xi_roots::detail::is_batched_v<Func> &&
+            std::is_invocable<Func&, const std::vector<T>&, std::vector<T>&>::value;
+
+        /*
+            f(x), a callable that computes its gradient anyway leaves it in [ gradient ] if given
+        */
+        template <typename Func, typename T>
+        inline T value(Func& f, const std::vector<T>& x, size_t& evaluations, std::vector<T>* gradient = nullptr)
+        {
+            if constexpr (xi_roots::detail::is_batched_v<Func>)
+            {
+                std::vector<std::vector<T>> points{ x };
+                std::vector<T> values;
+                xi_roots::detail::evaluate(f, points, values, evaluations);
+                return values[0];
+            }
+            else
+            {
+                ++evaluations;
+                XI_COUNT(DERIVATIVE, EVALUATIONS, 1);
+                if constexpr (has_gradient_v<Func, T>)
+                {
+                    std::vector<T> unused;
+                    std::vector<T>& out = gradient ? *gradient : unused;
+                    out.resize(x.size());
+                    return static_cast<T>(f(x, out));
+                }
+                else
+                {
+                    return static_cast<T>(f(x));
+                }
+            }
+        }
+
+        /*
+            f(x) and its gradient, analytic when f provides it, otherwise forward differences
+            with steps sqrt(eps) * max(1, |x_i|) sharing f(x), all points in one batch
+            With a [ known ] value of f(x) (from the line search) f(x) is not evaluated again,
+            and neither is an analytic gradient value() already left in [ gradient ]
+        */
+        template <typename Func, typename T>
+        inline T value_and_gradient(Func& f, const std::vector<T>& x, std::vector<T>& gradient, size_t& evaluations, const T* known = nullptr)
+        {
+            const size_t n = x.size();
+
+            if constexpr (has_gradient_v<Func, T>)
+            {
+                if (known && gradient.size() == n)
+                {
+                    return *known;
+                }
+                gradient.resize(n);
+                ++evaluations;
+                XI_COUNT(DERIVATIVE, EVALUATIONS, 1);
+                return static_cast<T>(f(x, gradient));
+            }
+            else
+            {
+                gradient.resize(n);
+                const T root_eps = std::sqrt(std::numeric_limits<T>::epsilon());
+                const size_t offset = known ? 0 : 1;
+                std::vector<std::vector<T>> points(n + offset, x);
+                std::vector<T> steps(n), values;
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    steps[i] = (x[i] + root_eps * std::max(T(1), std::fabs(x[i]))) - x[i];
+                    points[i + offset][i] += steps[i];
+                }
+
+                xi_roots::detail::evaluate(f, points, values, evaluations);
+                const T fx = known ? *known : values[0];
+                for (size_t i = 0; i < n; ++i)
+                {
+                    gradient[i] = (values[i + offset] - fx) / steps[i];
+                }
+                return fx;
+            }
+        }
+
+        template <typename T>
+        inline T dot(const std::vector<T>& a, const std::vector<T>& b)
+        {
+            T sum = 0;
+            for (size_t i = 0; i < a.size(); ++i) sum += a[i] * b[i];
+            return sum;
+        }
+
+        template <typename T>
+        inline T norm_inf(const std::vector<T>& v)
+        {
+            T largest = 0;
+            for (T value : v) largest = std::max(largest, std::fabs(value));
+            return largest;
+        }
+
+        template <typename T>
+        inline bool small_step(const std::vector<T>& step, const std::vector<T>& x, const Options& options)
+        {
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                if (std::fabs(step[i]) > static_cast<T>(options.step_tolerance) * (1 + std::fabs(x[i])))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename T>
+        inline bool small_decrease(T before, T after, const Options& options)
+        {
+            return before - after <= static_cast<T>(options.value_tolerance) * (1 + std::fabs(after));
+        }
+    }
+
+    /*
+        Limited memory BFGS (Nocedal): the inverse Hessian is applied with the two loop recursion
+        over the last options.history steps, scaled by s'y / y'y. Steps are backtracked with
+        quadratic interpolation until the Armijo condition holds, the full step is usually taken.
+        Pairs with s'y <= 0 (possible with a forward difference gradient) are skipped
+    */
+    template <typename Func, typename T>
+    inline OptimizeResult<T> lbfgs(Func&& f, const std::vector<T>& x0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Optimization requires a floating point state"
+        );
+
+        XI_TIME_CALL(DERIVATIVE);
+
+        const size_t n = x0.size();
+        OptimizeResult<T> result;
+        result.x = x0;
+
+        std::vector<T> g, g_new, direction(n), x_new(n), s(n), y(n), alpha;
+        std::deque<std::vector<T>> S, Y;
+        std::deque<T> rho;
+
+        T fx = detail::value_and_gradient(f, result.x, g, result.evaluations);
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            if (detail::norm_inf(g) <= static_cast<T>(options.gradient_tolerance))
+            {
+                result.converged = true;
+                break;
+            }
+            if (result.evaluations >= options.max_evaluations)
+            {
+                break;
+            }
+
+            // Two loop recursion, direction = -H g
+            for (size_t i = 0; i < n; ++i) direction[i] = -g[i];
+            alpha.assign(S.size(), T(0));
+            for (size_t k = S.size(); k-- > 0; )
+            {
+                alpha[k] = rho[k] * detail::dot(S[k], direction);
+                for (size_t i = 0; i < n; ++i) direction[i] -= alpha[k] * Y[k][i];
+            }
+
+            T gamma = S.empty()
+                ? std::min(T(1), T(1) / detail::norm_inf(g))
+                : detail::dot(S.back(), Y.back()) / detail::dot(Y.back(), Y.back());
+            for (T& d : direction) d *= gamma;
+
+            for (size_t k = 0; k < S.size(); ++k)
+            {
+                const T beta = rho[k] * detail::dot(Y[k], direction);
+                for (size_t i = 0; i < n; ++i) direction[i] += (alpha[k] - beta) * S[k][i];
+            }
+
+            T slope = detail::dot(g, direction);
+            if (!(slope < 0))
+            {
+                // Not a descent direction, restart from steepest descent
+                S.clear(); Y.clear(); rho.clear();
+                gamma = std::min(T(1), T(1) / detail::norm_inf(g));
+                for (size_t i = 0; i < n; ++i) direction[i] = -gamma * g[i];
+                slope = detail::dot(g, direction);
+            }
+
+            // Backtracking on the Armijo condition, value only until a step is accepted
+            T step = 1, f_new = 0;
+            bool accepted = false;
+            for (int backtrack = 0; backtrack < 40; ++backtrack)
+            {
+                for (size_t i = 0; i < n; ++i) x_new[i] = result.x[i] + step * direction[i];
+                g_new.clear();
+                f_new = detail::value(f, x_new, result.evaluations, &g_new);
+
+                if (f_new <= fx + T(1e-4) * step * slope)
+                {
+                    accepted = true;
+                    break;
+                }
+
+                // Minimum of the quadratic through f(0), f'(0) and f(step), kept in [ 0.1, 0.5 ] step
+                const T trial = -slope * step * step / (2 * (f_new - fx - slope * step));
+                step = std::isfinite(trial) ? std::min(T(0.5) * step, std::max(T(0.1) * step, trial)) : T(0.5) * step;
+            }
+            if (!accepted)
+            {
+                break;
+            }
+
+            for (size_t i = 0; i < n; ++i) s[i] = x_new[i] - result.x[i];
+            detail::value_and_gradient(f, x_new, g_new, result.evaluations, &f_new);
+            for (size_t i = 0; i < n; ++i) y[i] = g_new[i] - g[i];
+
+            const T sy = detail::dot(s, y);
+            if (sy > std::numeric_limits<T>::epsilon() * detail::dot(y, y))
+            {
+                if (S.size() == std::max<size_t>(options.history, 1))
+                {
+                    S.pop_front(); Y.pop_front(); rho.pop_front();
+                }
+                S.push_back(s);
+                Y.push_back(y);
+                rho.push_back(T(1) / sy);
+            }
+
+            const T f_old = fx;
+            std::swap(result.x, x_new);
+            std::swap(g, g_new);
+            fx = f_new;
+
+            if (detail::small_step(s, result.x, options) || detail::small_decrease(f_old, fx, options))
+            {
+                ++result.iterations;
+                result.converged = true;
+                break;
+            }
+        }
+
+        result.value = fx;
+        return result;
+    }
+
+    /*
+        Dogleg trust region on a BFGS model Hessian B (Powell damped, so B stays positive
+        definite), the Newton point of the model comes from xi_matrix::lu_factor / lu_solve
+        The radius shrinks when the model predicts the decrease badly and grows when a step on
+        the boundary predicts it well, rejected steps cost one evaluation and no gradient
+    */
+    template <typename Func, typename T>
+    inline OptimizeResult<T> trust_region(Func&& f, const std::vector<T>& x0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Optimization requires a floating point state"
+        );
+
+        XI_TIME_CALL(DERIVATIVE);
+
+        const size_t n = x0.size();
+        OptimizeResult<T> result;
+        result.x = x0;
+
+        std::vector<T> g, g_new, p(n), newton(n), cauchy(n), x_new(n), s(n), y(n), Bs(n), Bg(n);
+        std::vector<size_t> pivots;
+        xi_matrix::Matrix_Numerical<T> B(n, n, T(0)), LU(n, n);
+        for (size_t i = 0; i < n; ++i) B(i, i) = 1;
+        bool scaled = false;
+
+        T fx = detail::value_and_gradient(f, result.x, g, result.evaluations);
+        T radius = std::max(T(1), detail::norm_inf(result.x)) * T(0.1);
+        const T max_radius = radius * 1000;
+
+        auto times_B = [&](const std::vector<T>& v, std::vector<T>& out) {
+            for (size_t i = 0; i < n; ++i)
+            {
+                T sum = 0;
+                for (size_t j = 0; j < n; ++j) sum += B(i, j) * v[j];
+                out[i] = sum;
+            }
+        };
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            if (detail::norm_inf(g) <= static_cast<T>(options.gradient_tolerance))
+            {
+                result.converged = true;
+                break;
+            }
+            if (result.evaluations >= options.max_evaluations)
+            {
+                break;
+            }
+
+            // Newton point B p = -g
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j) LU(i, j) = B(i, j);
+                newton[i] = -g[i];
+            }
+            const bool solvable = xi_matrix::lu_factor(LU.view(), pivots) != 0;
+            if (solvable)
+            {
+                xi_matrix::lu_solve(LU.view().as_const(), pivots, xi_matrix::MatrixView<T>(newton.data(), n, 1, 1));
+            }
+            const T newton_length = std::sqrt(detail::dot(newton, newton));
+
+            if (solvable && newton_length <= radius)
+            {
+                p = newton;
+            }
+            else
+            {
+                // Cauchy point along -g, then the dogleg to the Newton point
+                times_B(g, Bg);
+                const T gg = detail::dot(g, g);
+                const T gBg = detail::dot(g, Bg);
+                const T tau = gBg > 0 ? gg / gBg : std::numeric_limits<T>::infinity();
+                for (size_t i = 0; i < n; ++i) cauchy[i] = -tau * g[i];
+                const T cauchy_length = std::sqrt(detail::dot(cauchy, cauchy));
+
+                if (!solvable || cauchy_length >= radius)
+                {
+                    const T scale = radius / std::sqrt(gg);
+                    for (size_t i = 0; i < n; ++i) p[i] = -scale * g[i];
+                }
+                else
+                {
+                    // |cauchy + t (newton - cauchy)| = radius
+                    for (size_t i = 0; i < n; ++i) s[i] = newton[i] - cauchy[i];
+                    const T a = detail::dot(s, s), b = 2 * detail::dot(cauchy, s), c = cauchy_length * cauchy_length - radius * radius;
+                    const T t = (-b + std::sqrt(b * b - 4 * a * c)) / (2 * a);
+                    for (size_t i = 0; i < n; ++i) p[i] = cauchy[i] + t * s[i];
+                }
+            }
+
+            times_B(p, Bs);
+            const T predicted = -(detail::dot(g, p) + T(0.5) * detail::dot(p, Bs));
+            for (size_t i = 0; i < n; ++i) x_new[i] = result.x[i] + p[i];
+            g_new.clear();
+            const T f_new = detail::value(f, x_new, result.evaluations, &g_new);
+            const T ratio = (fx - f_new) / predicted;
+            const T length = std::sqrt(detail::dot(p, p));
+
+            if (!(ratio >= T(0.25)))
+            {
+                radius = T(0.25) * length;
+            }
+            else if (ratio > T(0.75) && length >= T(0.99) * radius)
+            {
+                radius = std::min(2 * radius, max_radius);
+            }
+
+            if (!(ratio > T(1e-4)) || !(predicted > 0))
+            {
+                if (radius <= std::numeric_limits<T>::epsilon() * (1 + detail::norm_inf(result.x)))
+                {
+                    break;
+                }
+                continue;
+            }
+
+            detail::value_and_gradient(f, x_new, g_new, result.evaluations, &f_new);
+            for (size_t i = 0; i < n; ++i)
+            {
+                s[i] = p[i];
+                y[i] = g_new[i] - g[i];
+            }
+
+            T sy = detail::dot(s, y);
+            if (!scaled && sy > 0)
+            {
+                // Initial scaling y'y / s'y before the first update (Nocedal & Wright 6.20)
+                const T scale = detail::dot(y, y) / sy;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    for (size_t j = 0; j < n; ++j) B(i, j) *= scale;
+                }
+                scaled = true;
+            }
+
+            // Damped BFGS update (Powell), r replaces y when s'y < 0.2 s'Bs
+            times_B(s, Bs);
+            const T sBs = detail::dot(s, Bs);
+            if (sBs > 0)
+            {
+                const T theta = sy >= T(0.2) * sBs ? T(1) : T(0.8) * sBs / (sBs - sy);
+                for (size_t i = 0; i < n; ++i) y[i] = theta * y[i] + (1 - theta) * Bs[i];
+                sy = detail::dot(s, y);
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        B(i, j) += y[i] * y[j] / sy - Bs[i] * Bs[j] / sBs;
+                    }
+                }
+            }
+
+            const T f_old = fx;
+            std::swap(result.x, x_new);
+            std::swap(g, g_new);
+            fx = f_new;
+
+            if (detail::small_step(s, result.x, options) || detail::small_decrease(f_old, fx, options))
+            {
+                ++result.iterations;
+                result.converged = true;
+                break;
+            }
+        }
+
+        result.value = fx;
+        return result;
+    }
+
+    /*
+        Nelder-Mead with the dimension adaptive coefficients of Gao & Han (2012), which keep the
+        simplex from collapsing in higher dimensions, one dimensional problems use the standard ones.
+        The initial simplex steps 5% of every non-zero coordinate (0.00025 for zeros) and is
+        evaluated in one batch, as is a shrink.
+        Converged once the simplex values spread by at most options.value_tolerance and its
+        vertices by at most options.step_tolerance (relative)
+    */
+    template <typename Func, typename T>
+    inline OptimizeResult<T> nelder_mead(Func&& f, const std::vector<T>& x0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Optimization requires a floating point state"
+        );
+
+        XI_TIME_CALL(DERIVATIVE);
+
+        const size_t n = x0.size();
+        // Below two dimensions the adaptive shrink would be 0 and collapse the simplex onto its best
+        // vertex, n = 2 gives the standard coefficients (1, 2, 0.5, 0.5)
+        const T dim = static_cast<T>(n);
+        const T adaptive = static_cast<T>(std::max<size_t>(n, 2));
+        const T reflect = 1, expand = 1 + 2 / adaptive, contract = T(0.75) - 1 / (2 * adaptive), shrink = 1 - 1 / adaptive;
+
+        OptimizeResult<T> result;
+
+        // Batch evaluation of simplex vertices through the plain value() path for gradient callables
+        auto evaluate = [&](const std::vector<std::vector<T>>& points, std::vector<T>& values) {
+            if constexpr (detail::has_gradient_v<Func, T>)
+            {
+                values.resize(points.size());
+                for (size_t i = 0; i < points.size(); ++i) values[i] = detail::value(f, points[i], result.evaluations);
+            }
+            else
+            {
+                xi_roots::detail::evaluate(f, points, values, result.evaluations);
+            }
+        };
+
+        std::vector<std::vector<T>> simplex(n + 1, x0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            simplex[i + 1][i] = x0[i] != 0 ? T(1.05) * x0[i] : T(0.00025);
+        }
+        std::vector<T> values;
+        evaluate(simplex, values);
+
+        std::vector<size_t> order(n + 1);
+        std::vector<T> centroid(n), xr(n), xe(n), xc(n);
+
+        auto sort = [&]() {
+            std::iota(order.begin(), order.end(), size_t(0));
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+        };
+        auto point = [&](T t, std::vector<T>& out) {
+            const auto& worst = simplex[order[n]];
+            for (size_t i = 0; i < n; ++i) out[i] = centroid[i] + t * (centroid[i] - worst[i]);
+        };
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            sort();
+            const size_t best = order[0], worst = order[n], second = order[n - (n > 0 ? 1 : 0)];
+
+            T spread = 0, size = 0;
+            for (size_t k = 1; k <= n; ++k)
+            {
+                spread = std::max(spread, std::fabs(values[order[k]] - values[best]));
+                for (size_t i = 0; i < n; ++i)
+                {
+                    size = std::max(size, std::fabs(simplex[order[k]][i] - simplex[best][i]) / (1 + std::fabs(simplex[best][i])));
+                }
+            }
+            if (spread <= static_cast<T>(options.value_tolerance) * (1 + std::fabs(values[best])) && size <= static_cast<T>(options.step_tolerance))
+            {
+                result.converged = true;
+                break;
+            }
+            if (result.evaluations >= options.max_evaluations)
+            {
+                break;
+            }
+
+            std::fill(centroid.begin(), centroid.end(), T(0));
+            for (size_t k = 0; k < n; ++k)
+            {
+                for (size_t i = 0; i < n; ++i) centroid[i] += simplex[order[k]][i];
+            }
+            for (T& c : centroid) c /= dim;
+
+            point(reflect, xr);
+            const T fr = detail::value(f, xr, result.evaluations);
+
+            if (fr < values[best])
+            {
+                point(reflect * expand, xe);
+                const T fe = detail::value(f, xe, result.evaluations);
+                if (fe < fr)
+                {
+                    simplex[worst] = xe;
+                    values[worst] = fe;
+                }
+                else
+                {
+                    simplex[worst] = xr;
+                    values[worst] = fr;
+                }
+                continue;
+            }
+            if (fr < values[second])
+            {
+                simplex[worst] = xr;
+                values[worst] = fr;
+                continue;
+            }
+
+            // Outside contraction towards the reflected point, inside towards the worst
+            const bool outside = fr < values[worst];
+            point(outside ? reflect * contract : -contract, xc);
+            const T fc = detail::value(f, xc, result.evaluations);
+            if (fc < (outside ? fr : values[worst]))
+            {
+                simplex[worst] = xc;
+                values[worst] = fc;
+                continue;
+            }
+
+            // Shrink towards the best vertex, the n new vertices in one batch
+            std::vector<std::vector<T>> shrunk;
+            shrunk.reserve(n);
+            for (size_t k = 1; k <= n; ++k)
+            {
+                auto& vertex = simplex[order[k]];
+                for (size_t i = 0; i < n; ++i) vertex[i] = simplex[best][i] + shrink * (vertex[i] - simplex[best][i]);
+                shrunk.push_back(vertex);
+            }
+            std::vector<T> shrunk_values;
+            evaluate(shrunk, shrunk_values);
+            for (size_t k = 1; k <= n; ++k) values[order[k]] = shrunk_values[k - 1];
+        }
+
+        sort();
+        result.x = simplex[order[0]];
+        result.value = values[order[0]];
+        return result;
+    }
+}
+
+#endif
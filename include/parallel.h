@@ -0,0 +1,814 @@
+#ifndef XI_PARALLEL
+#define XI_PARALLEL
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __unix__
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/*
+    Work-stealing task scheduler shared by every xi module
+
+    One pool of worker threads runs all parallel work in xi: integration, matrix kernels,
+    reductions, conversions and text I/O. Every worker owns a deque of tasks, pushes and pops
+    its own work at the back and steals from the front of the others when it runs dry.
+
+    parallel_for splits a range into chunks that the calling thread and any idle workers claim
+    one at a time. A parallel_for started from inside another one (an integrand that multiplies
+    matrices, for example) queues its helpers on the same pool, so nesting never creates threads
+    beyond the pool size, and a thread that waits for its chunks keeps running queued tasks
+    instead of sleeping. The caller can always finish every chunk on its own, so a loop completes
+    even when no other thread is free to help.
+
+        xi_parallel::configure({ 8 });               // 8 way parallelism: the caller + 7 workers
+        xi_parallel::parallel_for(0, n, 1024, [&](size_t first, size_t last) { ... });
+
+    Services that already own a thread pool can route all of this through it instead, by
+    implementing Executor and installing it with set_executor()
+*/
+namespace xi_parallel
+{
+    /*
+        Anything that can run tasks on other threads
+        submit() must not run [ task ] inline or block until it completes
+    */
+    class Executor
+    {
+        public:
+            virtual ~Executor() = default;
+
+            virtual void submit(std::function<void()> task) = 0;
+
+            /*
+                Number of threads that may run tasks at the same time, counting the caller
+            */
+            virtual size_t concurrency() const = 0;
+    };
+
+    struct PoolOptions
+    {
+        /*
+            Total parallelism including the calling thread, 0 picks std::thread::hardware_concurrency()
+            The pool starts threads - 1 workers, 1 runs everything on the caller
+        */
+        size_t threads = 0;
+
+        /*
+            Pins every worker to one CPU, filling NUMA node 0 first, then node 1, ...
+        */
+        bool pin_threads = false;
+    };
+
+    namespace detail
+    {
+        using Task = std::function<void()>;
+
+        /*
+            Mutex guarded double ended queue, the owner works LIFO at the back (hot caches),
+            thieves take the oldest, usually largest, tasks from the front
+        */
+        class WorkQueue
+        {
+            private:
+                std::mutex _lock;
+                std::deque<Task> _tasks;
+            public:
+                void push(Task task)
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _tasks.push_back(std::move(task));
+                }
+
+                bool pop(Task& task)
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    if (_tasks.empty()) return false;
+                    task = std::move(_tasks.back());
+                    _tasks.pop_back();
+                    return true;
+                }
+
+                bool steal(Task& task)
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    if (_tasks.empty()) return false;
+                    task = std::move(_tasks.front());
+                    _tasks.pop_front();
+                    return true;
+                }
+        };
+
+        /*
+            "0-3,8-11" -> { 0, 1, 2, 3, 8, 9, 10, 11 }
+        */
+        inline std::vector<int> parse_cpu_list(const std::string& list)
+        {
+            std::vector<int> cpus;
+            std::stringstream in(list);
+            std::string range;
+            while (std::getline(in, range, ','))
+            {
+                if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+                size_t dash = range.find('-');
+                int lo = std::stoi(range.substr(0, dash));
+                int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+                for (int c = lo; c <= hi; ++c)
+                {
+                    cpus.push_back(c);
+                }
+            }
+            return cpus;
+        }
+
+        /*
+            CPUs this process may run on, grouped by NUMA node
+            Falls back to a single node of 0 .. hardware_concurrency - 1 off Linux
+        */
+        inline std::vector<std::vector<int>> numa_nodes()
+        {
+            std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+            for (int node = 0;; ++node)
+            {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (!file) break;
+
+                std::string list;
+                std::getline(file, list);
+                std::vector<int> cpus;
+                for (int cpu : parse_cpu_list(list))
+                {
+                    if (!masked || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) cpus.push_back(cpu);
+                }
+                if (!cpus.empty()) nodes.push_back(std::move(cpus));
+            }
+#endif
+            if (nodes.empty())
+            {
+                nodes.emplace_back();
+                for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c)
+                {
+                    nodes.back().push_back(static_cast<int>(c));
+                }
+            }
+            return nodes;
+        }
+
+        inline void pin_current_thread(int cpu)
+        {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)cpu;
+#endif
+        }
+    }
+
+    class ThreadPool;
+
+    namespace detail
+    {
+        /*
+            Which pool (if any) the current thread is a worker of
+        */
+        struct WorkerContext
+        {
+            ThreadPool* pool = nullptr;
+            size_t index = 0;
+        };
+
+        inline WorkerContext& current_worker()
+        {
+            thread_local WorkerContext context;
+            return context;
+        }
+    }
+
+    /*
+        Thrown by checkpoint() inside a job that has been cancelled
+    */
+    class Cancelled : public std::runtime_error
+    {
+        public:
+            Cancelled() : std::runtime_error("xi job was cancelled") {};
+    };
+
+    /*
+        Cancellation flag and progress counter of one asynchronous job (see async.h)
+        The job is visible to every chunk and task it spawns through parallel_for and TaskGroup
+    */
+    struct JobControl
+    {
+        std::atomic<bool> cancelled{ false };
+        std::atomic<uint64_t> done{ 0 };
+        std::atomic<uint64_t> total{ 0 };
+    };
+
+    namespace detail
+    {
+        inline JobControl*& current_job()
+        {
+            thread_local JobControl* job = nullptr;
+            return job;
+        }
+
+        /*
+            Makes [ job ] the current job of this thread until the end of the scope
+        */
+        class JobScope
+        {
+            private:
+                JobControl* _previous;
+            public:
+                explicit JobScope(JobControl* job) : _previous(current_job()) { current_job() = job; };
+
+                JobScope(const JobScope&) = delete;
+                JobScope& operator=(const JobScope&) = delete;
+
+                ~JobScope() { current_job() = _previous; }
+        };
+    }
+
+    /*
+        Reports [ units ] of finished work to the current job and throws Cancelled if it has been
+        cancelled. Kernels call it between chunks, outside of a job it is a single thread local load
+    */
+    inline void checkpoint(uint64_t units = 0)
+    {
+        JobControl* job = detail::current_job();
+        if (job == nullptr) return;
+        if (units != 0) job->done.fetch_add(units, std::memory_order_relaxed);
+        if (job->cancelled.load(std::memory_order_relaxed)) throw Cancelled();
+    }
+
+    /*
+        The built-in executor, a fixed set of workers with one WorkQueue each
+        Tasks submitted from a worker go to its own queue, tasks from other threads are dealt
+        round robin, idle workers steal from workers on their own NUMA node before the rest
+    */
+    class ThreadPool : public Executor
+    {
+        private:
+            struct Worker
+            {
+                detail::WorkQueue queue;
+                std::vector<size_t> victims;
+                std::thread thread;
+            };
+
+            std::vector<std::unique_ptr<Worker>> _workers;
+            std::atomic<size_t> _queued{ 0 };
+            std::atomic<size_t> _next_queue{ 0 };
+            std::atomic<size_t> _sleeping{ 0 };
+            bool _stopping = false;
+            std::mutex _sleep_lock;
+            std::condition_variable _wake;
+
+            bool take(size_t index, detail::Task& task)
+            {
+                Worker& self = *_workers[index];
+                if (self.queue.pop(task)) return true;
+                for (size_t victim : self.victims)
+                {
+                    if (_workers[victim]->queue.steal(task)) return true;
+                }
+                return false;
+            }
+
+            void run(size_t index, int cpu)
+            {
+                detail::current_worker() = { this, index };
+                if (cpu >= 0) detail::pin_current_thread(cpu);
+
+                detail::Task task;
+                for (;;)
+                {
+                    if (take(index, task))
+                    {
+                        _queued.fetch_sub(1, std::memory_order_relaxed);
+                        task();
+                        task = nullptr;
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(_sleep_lock);
+                    _sleeping.fetch_add(1);
+                    _wake.wait(lock, [&] { return _stopping || _queued.load() > 0; });
+                    _sleeping.fetch_sub(1);
+                    if (_stopping && _queued.load(std::memory_order_relaxed) == 0) return;
+                }
+            }
+        public:
+            explicit ThreadPool(const PoolOptions& options = PoolOptions())
+            {
+                const std::vector<std::vector<int>> nodes = detail::numa_nodes();
+
+                // Worker k runs on cpus[k] and belongs to node_of[k]
+                std::vector<int> cpus;
+                std::vector<size_t> node_of;
+                for (size_t n = 0; n < nodes.size(); ++n)
+                {
+                    for (int cpu : nodes[n])
+                    {
+                        cpus.push_back(cpu);
+                        node_of.push_back(n);
+                    }
+                }
+
+                size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+                size_t workers = threads - 1;
+
+                _workers.reserve(workers);
+                for (size_t k = 0; k < workers; ++k)
+                {
+                    _workers.push_back(std::make_unique<Worker>());
+                }
+
+                // Steal order: same node nearest first, then everyone else
+                for (size_t k = 0; k < workers; ++k)
+                {
+                    const size_t node = node_of[k % node_of.size()];
+                    for (size_t step = 1; step < workers; ++step)
+                    {
+                        size_t v = (k + step) % workers;
+                        if (node_of[v % node_of.size()] == node) _workers[k]->victims.push_back(v);
+                    }
+                    for (size_t step = 1; step < workers; ++step)
+                    {
+                        size_t v = (k + step) % workers;
+                        if (node_of[v % node_of.size()] != node) _workers[k]->victims.push_back(v);
+                    }
+                }
+
+                for (size_t k = 0; k < workers; ++k)
+                {
+                    int cpu = options.pin_threads ? cpus[k % cpus.size()] : -1;
+                    _workers[k]->thread = std::thread([this, k, cpu] { run(k, cpu); });
+                }
+            }
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            /*
+                Runs every task still queued, then joins the workers
+            */
+            ~ThreadPool() override
+            {
+                {
+                    std::lock_guard<std::mutex> guard(_sleep_lock);
+                    _stopping = true;
+                }
+                _wake.notify_all();
+                for (auto& worker : _workers)
+                {
+                    worker->thread.join();
+                }
+            }
+
+            /*
+                Queues [ task ], tasks must not throw (use TaskGroup or parallel_for for work that can)
+                A pool without workers runs the task on the calling thread
+            */
+            void submit(std::function<void()> task) override
+            {
+                if (_workers.empty())
+                {
+                    task();
+                    return;
+                }
+
+                detail::WorkerContext& context = detail::current_worker();
+                size_t target = context.pool == this
+                    ? context.index
+                    : _next_queue.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+
+                _workers[target]->queue.push(std::move(task));
+                _queued.fetch_add(1);
+
+                if (_sleeping.load() > 0)
+                {
+                    { std::lock_guard<std::mutex> guard(_sleep_lock); }
+                    _wake.notify_one();
+                }
+            }
+
+            size_t concurrency() const override { return _workers.size() + 1; }
+
+            size_t workers() const { return _workers.size(); }
+
+            /*
+                Runs one queued task on the calling thread if there is any, used by threads that
+                wait on other tasks so they keep the pool busy instead of blocking
+            */
+            bool run_pending_task()
+            {
+                if (_workers.empty()) return false;
+
+                detail::Task task;
+                detail::WorkerContext& context = detail::current_worker();
+                bool found = false;
+
+                if (context.pool == this)
+                {
+                    found = take(context.index, task);
+                }
+                else
+                {
+                    size_t start = _next_queue.load(std::memory_order_relaxed);
+                    for (size_t k = 0; k < _workers.size() && !found; ++k)
+                    {
+                        found = _workers[(start + k) % _workers.size()]->queue.steal(task);
+                    }
+                }
+
+                if (!found) return false;
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+
+                // A stolen task must not see the job of the thread that happens to run it
+                detail::JobScope scope(nullptr);
+                task();
+                return true;
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            Process wide choice of executor, the built-in pool is created on first use
+        */
+        struct Runtime
+        {
+            std::mutex lock;
+            PoolOptions options;
+            std::unique_ptr<ThreadPool> pool;
+            std::shared_ptr<Executor> external;
+            std::atomic<Executor*> current{ nullptr };
+
+            static Runtime& instance()
+            {
+                static Runtime runtime;
+                return runtime;
+            }
+
+            Executor& get()
+            {
+                Executor* e = current.load(std::memory_order_acquire);
+                if (e != nullptr) return *e;
+
+                std::lock_guard<std::mutex> guard(lock);
+                if (!external && !pool)
+                {
+                    pool = std::make_unique<ThreadPool>(options);
+                }
+                e = external ? external.get() : static_cast<Executor*>(pool.get());
+                current.store(e, std::memory_order_release);
+                return *e;
+            }
+        };
+
+        /*
+            Runs one queued task of the pool this thread belongs to (or of the built-in pool)
+            Returns false if there was nothing to run or xi runs on an external executor
+        */
+        inline bool help_pool()
+        {
+            ThreadPool* pool = current_worker().pool;
+            if (pool == nullptr)
+            {
+                pool = dynamic_cast<ThreadPool*>(&Runtime::instance().get());
+            }
+            return pool != nullptr && pool->run_pending_task();
+        }
+
+        /*
+            Blocks until done() holds, running queued pool tasks meanwhile when there are any
+        */
+        template <typename Done>
+        inline void wait_until(std::mutex& lock, std::condition_variable& signal, Done done)
+        {
+            while (!done())
+            {
+                if (help_pool()) continue;
+
+                std::unique_lock<std::mutex> guard(lock);
+                signal.wait_for(guard, std::chrono::microseconds(200), done);
+            }
+        }
+
+        /*
+            Shared state of one parallel_for, chunks are claimed through [ next ]
+            Helpers that start after every chunk was claimed return without touching the body
+        */
+        struct Loop
+        {
+            size_t first;
+            size_t last;
+            size_t grain;
+            size_t chunks;
+            const void* body;
+            void (*invoke)(const void*, size_t, size_t);
+            JobControl* job;
+
+            std::atomic<size_t> next{ 0 };
+            std::atomic<size_t> done{ 0 };
+            std::atomic<bool> failed{ false };
+            std::exception_ptr error;
+            std::mutex lock;
+            std::condition_variable finished;
+
+            void work()
+            {
+                for (;;)
+                {
+                    size_t c = next.fetch_add(1, std::memory_order_relaxed);
+                    if (c >= chunks) return;
+
+                    if (!failed.load(std::memory_order_relaxed))
+                    {
+                        size_t begin = first + c * grain;
+                        try
+                        {
+                            invoke(body, begin, std::min(last, begin + grain));
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> guard(lock);
+                            if (!error) error = std::current_exception();
+                            failed.store(true, std::memory_order_relaxed);
+                        }
+                    }
+
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        finished.notify_all();
+                    }
+                }
+            }
+        };
+    }
+
+    /*
+        Replaces the built-in pool with one built from [ options ]
+        Must not be called while xi work is running on the current pool
+    */
+    inline void configure(const PoolOptions& options)
+    {
+        detail::Runtime& r = detail::Runtime::instance();
+        std::unique_ptr<ThreadPool> retired;
+        {
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.options = options;
+            r.current.store(nullptr, std::memory_order_release);
+            retired = std::move(r.pool);
+        }
+    }
+
+    /*
+        Routes all xi parallelism through [ executor ], nullptr goes back to the built-in pool
+        The built-in pool is shut down while an external executor is installed
+    */
+    inline void set_executor(std::shared_ptr<Executor> executor)
+    {
+        detail::Runtime& r = detail::Runtime::instance();
+        std::unique_ptr<ThreadPool> retired;
+        {
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.external = std::move(executor);
+            r.current.store(nullptr, std::memory_order_release);
+            if (r.external) retired = std::move(r.pool);
+        }
+    }
+
+#ifdef __unix__
+    /*
+        fork() for processes that go on using xi: worker threads are not copied into a child, so
+        the child leaks (rather than joins) the pool it inherited and builds a fresh one from
+        [ child_options ] on first use. The parent keeps its pool
+        Must not be called while xi work is running, other xi locks could be held in the copy
+        Returns what fork() returned
+    */
+    inline pid_t fork_process(const PoolOptions& child_options)
+    {
+        detail::Runtime& r = detail::Runtime::instance();
+        std::unique_lock<std::mutex> guard(r.lock);
+
+        const pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            (void)r.pool.release();
+            r.options = child_options;
+            r.current.store(nullptr, std::memory_order_release);
+        }
+        return pid;
+    }
+#endif
+
+    inline Executor& executor() { return detail::Runtime::instance().get(); }
+
+    inline size_t concurrency() { return executor().concurrency(); }
+
+    /*
+        Calls body(begin, end) over consecutive chunks of at most [ grain ] indices covering [ first, last )
+        Ranges no longer than [ grain ] run on the calling thread without touching the pool
+        The first exception thrown by [ body ] is rethrown once every started chunk has finished,
+        chunks that had not started yet are skipped
+    */
+    template <typename Body>
+    inline void parallel_for(size_t first, size_t last, size_t grain, Body&& body)
+    {
+        if (last <= first) return;
+        grain = std::max<size_t>(grain, 1);
+
+        const size_t chunks = (last - first + grain - 1) / grain;
+        if (chunks == 1)
+        {
+            body(first, last);
+            return;
+        }
+
+        Executor& ex = executor();
+        if (ex.concurrency() == 1)
+        {
+            body(first, last);
+            return;
+        }
+
+        using B = std::remove_reference_t<Body>;
+        auto loop = std::make_shared<detail::Loop>();
+        loop->first = first;
+        loop->last = last;
+        loop->grain = grain;
+        loop->chunks = chunks;
+        loop->body = &body;
+        loop->invoke = [](const void* b, size_t begin, size_t end) { (*static_cast<B*>(const_cast<void*>(b)))(begin, end); };
+        loop->job = detail::current_job();
+
+        const size_t helpers = std::min(chunks, ex.concurrency()) - 1;
+        for (size_t h = 0; h < helpers; ++h)
+        {
+            ex.submit([loop] {
+                detail::JobScope scope(loop->job);
+                loop->work();
+            });
+        }
+
+        loop->work();
+        detail::wait_until(loop->lock, loop->finished, [&] {
+            return loop->done.load(std::memory_order_acquire) == chunks;
+        });
+
+        if (loop->error) std::rethrow_exception(loop->error);
+    }
+
+    /*
+        parallel_for with a grain that gives every thread about four chunks
+    */
+    template <typename Body>
+    inline void parallel_for(size_t first, size_t last, Body&& body)
+    {
+        if (last <= first) return;
+        size_t grain = (last - first + 4 * concurrency() - 1) / (4 * concurrency());
+        parallel_for(first, last, grain, std::forward<Body>(body));
+    }
+
+    /*
+        Set of tasks that can be waited on together
+        wait() runs tasks of the group that no thread picked up yet on the calling thread,
+        so a group always finishes, even on an executor whose threads are all busy
+    */
+    class TaskGroup
+    {
+        private:
+            struct State
+            {
+                std::mutex lock;
+                std::condition_variable finished;
+                std::deque<detail::Task> pending;
+                std::atomic<size_t> outstanding{ 0 };
+                std::exception_ptr error;
+
+                bool run_one()
+                {
+                    detail::Task task;
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        if (pending.empty()) return false;
+                        task = std::move(pending.front());
+                        pending.pop_front();
+                    }
+
+                    std::exception_ptr failure;
+                    try
+                    {
+                        task();
+                    }
+                    catch (...)
+                    {
+                        failure = std::current_exception();
+                    }
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (failure && !error) error = failure;
+                    if (outstanding.fetch_sub(1) == 1) finished.notify_all();
+                    return true;
+                }
+            };
+
+            std::shared_ptr<State> _state = std::make_shared<State>();
+        public:
+            TaskGroup() = default;
+
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+
+            /*
+                Waits for tasks still running, exceptions are dropped, call wait() to see them
+            */
+            ~TaskGroup()
+            {
+                try
+                {
+                    wait();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            template <typename F>
+            void run(F&& f)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(_state->lock);
+                    _state->pending.emplace_back([job = detail::current_job(), task = std::forward<F>(f)]() mutable {
+                        detail::JobScope scope(job);
+                        task();
+                    });
+                    ++_state->outstanding;
+                }
+
+                std::shared_ptr<State> state = _state;
+                Executor& ex = executor();
+                if (ex.concurrency() > 1)
+                {
+                    ex.submit([state] { state->run_one(); });
+                }
+            }
+
+            /*
+                Returns once every task has finished, rethrows the first exception any of them threw
+            */
+            void wait()
+            {
+                while (_state->run_one())
+                {
+                }
+
+                State& s = *_state;
+                detail::wait_until(s.lock, s.finished, [&] { return s.outstanding.load() == 0; });
+
+                std::exception_ptr error;
+                {
+                    std::lock_guard<std::mutex> guard(s.lock);
+                    std::swap(error, s.error);
+                }
+                if (error) std::rethrow_exception(error);
+            }
+    };
+}
+
+#endif
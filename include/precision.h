@@ -0,0 +1,721 @@
+#ifndef XI_PRECISION
+#define XI_PRECISION
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <cassert>
+#include <type_traits>
+#include "matrix.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+    GCC / Clang on x86 compile the SIMD kernels for AVX2 + FMA + F16C through target attributes and
+    pick them at run time, other compilers only get them when the target flags enable them
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XI_PRECISION_DISPATCH 1
+#define XI_PRECISION_TARGET __attribute__((target("avx2,fma,f16c")))
+#else
+#define XI_PRECISION_DISPATCH 0
+#define XI_PRECISION_TARGET
+#endif
+
+#if XI_PRECISION_DISPATCH || defined(__AVX__)
+#define XI_PRECISION_AVX 1
+#else
+#define XI_PRECISION_AVX 0
+#endif
+
+#if XI_PRECISION_DISPATCH || defined(__AVX2__)
+#define XI_PRECISION_AVX2 1
+#else
+#define XI_PRECISION_AVX2 0
+#endif
+
+#if XI_PRECISION_DISPATCH || (defined(__AVX__) && defined(__F16C__))
+#define XI_PRECISION_F16C 1
+#else
+#define XI_PRECISION_F16C 0
+#endif
+
+#if XI_PRECISION_DISPATCH || defined(__FMA__)
+#define XI_PRECISION_FMA 1
+#else
+#define XI_PRECISION_FMA 0
+#endif
+
+/*
+    Explicit precision policies for matrix products
+
+    Matrix_Numerical promotes through std::common_type_t and defaults to long double, which is
+    exact but slow (x87, never vectorized). A Precision<Storage, Compute, Accumulate> policy instead
+    says how elements are stored, in which type each product is formed and in which type
+    products are summed:
+
+        FloatAccumulateDouble   float storage,    products and sums in double
+        Float16Compute32        float16 storage,  products and sums in float
+        BFloat16Compute32       bfloat16 storage, products and sums in float
+        Int8Accumulate32        int8 storage,     products and sums in int32
+        Int16Accumulate32       int16 storage,    products and sums in int32
+
+    Each policy has an AVX2 / FMA / F16C dot product kernel. With GCC or Clang on x86 they are
+    compiled regardless of the target flags and used when the CPU supports all three, no
+    -march=native needed; other compilers use them when the target flags enable them (/arch:AVX2).
+    Everything else runs a portable scalar loop
+
+    Integer accumulation wraps around in int32 exactly like the hardware instructions do (the
+    scalar paths sum in uint32_t, so the wrap is defined behaviour there too),
+    keep K * max|a| * max|b| below 2^31 to stay exact
+*/
+namespace xi_matrix
+{
+    namespace detail
+    {
+        inline uint32_t float_bits(float f)
+        {
+            uint32_t x;
+            std::memcpy(&x, &f, sizeof(x));
+            return x;
+        }
+
+        inline float bits_float(uint32_t x)
+        {
+            float f;
+            std::memcpy(&f, &x, sizeof(f));
+            return f;
+        }
+
+        /*
+            IEEE 754 binary32 -> binary16, round to nearest even, overflow goes to infinity
+        */
+        inline uint16_t float_to_half(float f)
+        {
+#if defined(__F16C__)
+            return static_cast<uint16_t>(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+            uint32_t x = float_bits(f);
+            uint32_t sign = (x >> 16) & 0x8000u;
+            uint32_t mant = x & 0x007fffffu;
+            int32_t exp = static_cast<int32_t>((x >> 23) & 0xffu);
+
+            if (exp == 0xff)
+            {
+                return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x0200u | (mant >> 13) : 0u));
+            }
+
+            int32_t e = exp - 127 + 15;
+            if (e >= 0x1f)
+            {
+                return static_cast<uint16_t>(sign | 0x7c00u);
+            }
+
+            if (e <= 0)
+            {
+                if (e < -10) return static_cast<uint16_t>(sign);
+
+                mant |= 0x00800000u;
+                uint32_t shift = static_cast<uint32_t>(14 - e);
+                uint32_t half = mant >> shift;
+                uint32_t rest = mant & ((1u << shift) - 1u);
+                uint32_t halfway = 1u << (shift - 1u);
+                if (rest > halfway || (rest == halfway && (half & 1u))) ++half;
+                return static_cast<uint16_t>(sign | half);
+            }
+
+            uint32_t half = sign | (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+            uint32_t rest = mant & 0x1fffu;
+            if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ++half;
+            return static_cast<uint16_t>(half);
+#endif
+        }
+
+        inline float half_to_float(uint16_t h)
+        {
+#if defined(__F16C__)
+            return _cvtsh_ss(h);
+#else
+            uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+            uint32_t exp = (h >> 10) & 0x1fu;
+            uint32_t mant = h & 0x03ffu;
+
+            if (exp == 0)
+            {
+                if (mant == 0) return bits_float(sign);
+
+                int32_t e = 1;
+                while (!(mant & 0x0400u))
+                {
+                    mant <<= 1;
+                    --e;
+                }
+                mant &= 0x03ffu;
+                return bits_float(sign | (static_cast<uint32_t>(e + 112) << 23) | (mant << 13));
+            }
+
+            if (exp == 0x1f)
+            {
+                return bits_float(sign | 0x7f800000u | (mant << 13));
+            }
+
+            return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+#endif
+        }
+
+        /*
+            binary32 -> bfloat16 (the upper half of a float), round to nearest even, NaNs stay NaN
+        */
+        inline uint16_t float_to_bfloat(float f)
+        {
+            uint32_t x = float_bits(f);
+            if ((x & 0x7fffffffu) > 0x7f800000u)
+            {
+                return static_cast<uint16_t>((x >> 16) | 0x0040u);
+            }
+            x += 0x7fffu + ((x >> 16) & 1u);
+            return static_cast<uint16_t>(x >> 16);
+        }
+
+        inline float bfloat_to_float(uint16_t b)
+        {
+            return bits_float(static_cast<uint32_t>(b) << 16);
+        }
+    }
+
+    /*
+        16 bit IEEE half precision storage type, all arithmetic is meant to happen after converting to float
+    */
+    struct float16
+    {
+        uint16_t bits = 0;
+
+        float16() = default;
+
+        explicit float16(float value) : bits(detail::float_to_half(value)) {};
+
+        static float16 from_bits(uint16_t raw)
+        {
+            float16 h;
+            h.bits = raw;
+            return h;
+        }
+
+        explicit operator float() const { return detail::half_to_float(bits); }
+
+        bool operator==(const float16& other) const { return bits == other.bits; }
+
+        bool operator!=(const float16& other) const { return bits != other.bits; }
+    };
+
+    /*
+        16 bit brain floating point storage type, same exponent range as float with an 8 bit mantissa
+    */
+    struct bfloat16
+    {
+        uint16_t bits = 0;
+
+        bfloat16() = default;
+
+        explicit bfloat16(float value) : bits(detail::float_to_bfloat(value)) {};
+
+        static bfloat16 from_bits(uint16_t raw)
+        {
+            bfloat16 b;
+            b.bits = raw;
+            return b;
+        }
+
+        explicit operator float() const { return detail::bfloat_to_float(bits); }
+
+        bool operator==(const bfloat16& other) const { return bits == other.bits; }
+
+        bool operator!=(const bfloat16& other) const { return bits != other.bits; }
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, float16 h) { return os << static_cast<float>(h); }
+
+    inline std::ostream& operator<<(std::ostream& os, bfloat16 b) { return os << static_cast<float>(b); }
+
+    static_assert(sizeof(float16) == 2 && sizeof(bfloat16) == 2, "16 bit storage types must be packed");
+
+    /*
+        Storage: element type of the operands
+        Compute: type every product is formed in
+        Accumulate: type products are summed in
+    */
+    template <typename Storage, typename Compute, typename Accumulate>
+    struct Precision
+    {
+        using storage_type = Storage;
+        using compute_type = Compute;
+        using accumulate_type = Accumulate;
+    };
+
+    using FloatAccumulateDouble = Precision<float, double, double>;
+    using Float16Compute32 = Precision<float16, float, float>;
+    using BFloat16Compute32 = Precision<bfloat16, float, float>;
+    using Int8Accumulate32 = Precision<int8_t, int32_t, int32_t>;
+    using Int16Accumulate32 = Precision<int16_t, int32_t, int32_t>;
+
+    namespace detail
+    {
+        template <typename T>
+        struct is_half_precision : std::integral_constant<bool,
+            std::is_same<T, float16>::value || std::is_same<T, bfloat16>::value> {};
+
+        /*
+            static_cast that routes 16 bit floating point types through float
+        */
+        template <typename To, typename From>
+        inline To convert_element(From x)
+        {
+            if constexpr (is_half_precision<From>::value && !std::is_same<To, From>::value)
+            {
+                return convert_element<To>(static_cast<float>(x));
+            }
+            else if constexpr (is_half_precision<To>::value && !std::is_same<To, From>::value)
+            {
+                return To(static_cast<float>(x));
+            }
+            else
+            {
+                return static_cast<To>(x);
+            }
+        }
+
+        /*
+            Integers are summed in the unsigned type of the same width, wrapping instead of
+            overflowing a signed type
+        */
+        template <typename A>
+        using wrapping_t = typename std::conditional_t<std::is_integral<A>::value, std::make_unsigned<A>, std::common_type<A>>::type;
+
+        /*
+            Portable dot product: every product in Compute, summed in Accumulate
+        */
+        template <typename Policy>
+        inline typename Policy::accumulate_type dot_scalar(
+            const typename Policy::storage_type* x, const typename Policy::storage_type* y, size_t n)
+        {
+            using C = typename Policy::compute_type;
+            using A = typename Policy::accumulate_type;
+            using W = wrapping_t<A>;
+
+            W acc = W(0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                acc += static_cast<W>(convert_element<C>(x[i]) * convert_element<C>(y[i]));
+            }
+            return static_cast<A>(acc);
+        }
+
+        /*
+            Whether the SIMD kernels may run on this CPU
+        */
+        inline bool simd_supported()
+        {
+#if XI_PRECISION_DISPATCH
+            static const bool supported = [] {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+            }();
+            return supported;
+#else
+            return true;
+#endif
+        }
+
+#if XI_PRECISION_AVX
+        XI_PRECISION_TARGET inline double hsum(__m256d v)
+        {
+            __m128d lo = _mm256_castpd256_pd128(v);
+            __m128d hi = _mm256_extractf128_pd(v, 1);
+            lo = _mm_add_pd(lo, hi);
+            return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        }
+
+        XI_PRECISION_TARGET inline float hsum(__m256 v)
+        {
+            __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+            return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+        }
+
+        XI_PRECISION_TARGET inline __m256d fmadd(__m256d a, __m256d b, __m256d c)
+        {
+#if XI_PRECISION_FMA
+            return _mm256_fmadd_pd(a, b, c);
+#else
+            return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+        }
+
+        XI_PRECISION_TARGET inline __m256 fmadd(__m256 a, __m256 b, __m256 c)
+        {
+#if XI_PRECISION_FMA
+            return _mm256_fmadd_ps(a, b, c);
+#else
+            return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+        }
+#endif
+
+#if XI_PRECISION_AVX2
+        XI_PRECISION_TARGET inline int32_t hsum(__m256i v)
+        {
+            __m128i lo = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4e));
+            lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xb1));
+            return _mm_cvtsi128_si32(lo);
+        }
+
+        XI_PRECISION_TARGET inline __m256 load_bfloat8(const bfloat16* p)
+        {
+            __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+        }
+#endif
+
+        template <typename Policy>
+        struct DotKernel
+        {
+            static typename Policy::accumulate_type run(
+                const typename Policy::storage_type* x, const typename Policy::storage_type* y, size_t n)
+            {
+                return dot_scalar<Policy>(x, y, n);
+            }
+        };
+
+#if XI_PRECISION_AVX
+        /*
+            float storage, double products and sums: widen 8 floats into two 4 x double registers
+        */
+        template <>
+        struct DotKernel<FloatAccumulateDouble>
+        {
+            static double run(const float* x, const float* y, size_t n)
+            {
+                return simd_supported() ? simd(x, y, n) : dot_scalar<FloatAccumulateDouble>(x, y, n);
+            }
+
+            XI_PRECISION_TARGET static double simd(const float* x, const float* y, size_t n)
+            {
+                __m256d acc0 = _mm256_setzero_pd();
+                __m256d acc1 = _mm256_setzero_pd();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    __m256 vx = _mm256_loadu_ps(x + i);
+                    __m256 vy = _mm256_loadu_ps(y + i);
+                    acc0 = fmadd(_mm256_cvtps_pd(_mm256_castps256_ps128(vx)), _mm256_cvtps_pd(_mm256_castps256_ps128(vy)), acc0);
+                    acc1 = fmadd(_mm256_cvtps_pd(_mm256_extractf128_ps(vx, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(vy, 1)), acc1);
+                }
+                double acc = hsum(_mm256_add_pd(acc0, acc1));
+                for (; i < n; ++i)
+                {
+                    acc += static_cast<double>(x[i]) * static_cast<double>(y[i]);
+                }
+                return acc;
+            }
+        };
+#endif
+
+#if XI_PRECISION_F16C
+        template <>
+        struct DotKernel<Float16Compute32>
+        {
+            static float run(const float16* x, const float16* y, size_t n)
+            {
+                return simd_supported() ? simd(x, y, n) : dot_scalar<Float16Compute32>(x, y, n);
+            }
+
+            XI_PRECISION_TARGET static float simd(const float16* x, const float16* y, size_t n)
+            {
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    acc0 = fmadd(
+                        _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))),
+                        _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i))), acc0);
+                    acc1 = fmadd(
+                        _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i + 8))),
+                        _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i + 8))), acc1);
+                }
+                float acc = hsum(_mm256_add_ps(acc0, acc1));
+                for (; i < n; ++i)
+                {
+                    acc += static_cast<float>(x[i]) * static_cast<float>(y[i]);
+                }
+                return acc;
+            }
+        };
+#endif
+
+#if XI_PRECISION_AVX2
+        template <>
+        struct DotKernel<BFloat16Compute32>
+        {
+            static float run(const bfloat16* x, const bfloat16* y, size_t n)
+            {
+                return simd_supported() ? simd(x, y, n) : dot_scalar<BFloat16Compute32>(x, y, n);
+            }
+
+            XI_PRECISION_TARGET static float simd(const bfloat16* x, const bfloat16* y, size_t n)
+            {
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    acc0 = fmadd(load_bfloat8(x + i), load_bfloat8(y + i), acc0);
+                    acc1 = fmadd(load_bfloat8(x + i + 8), load_bfloat8(y + i + 8), acc1);
+                }
+                float acc = hsum(_mm256_add_ps(acc0, acc1));
+                for (; i < n; ++i)
+                {
+                    acc += static_cast<float>(x[i]) * static_cast<float>(y[i]);
+                }
+                return acc;
+            }
+        };
+
+        /*
+            int8: sign extend 16 lanes to int16, vpmaddwd multiplies pairs and adds neighbours into int32
+        */
+        template <>
+        struct DotKernel<Int8Accumulate32>
+        {
+            static int32_t run(const int8_t* x, const int8_t* y, size_t n)
+            {
+                return simd_supported() ? simd(x, y, n) : dot_scalar<Int8Accumulate32>(x, y, n);
+            }
+
+            XI_PRECISION_TARGET static int32_t simd(const int8_t* x, const int8_t* y, size_t n)
+            {
+                __m256i acc = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    __m256i vx = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+                    __m256i vy = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+                    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(vx, vy));
+                }
+                uint32_t total = static_cast<uint32_t>(hsum(acc));
+                for (; i < n; ++i)
+                {
+                    total += static_cast<uint32_t>(static_cast<int32_t>(x[i]) * static_cast<int32_t>(y[i]));
+                }
+                return static_cast<int32_t>(total);
+            }
+        };
+
+        template <>
+        struct DotKernel<Int16Accumulate32>
+        {
+            static int32_t run(const int16_t* x, const int16_t* y, size_t n)
+            {
+                return simd_supported() ? simd(x, y, n) : dot_scalar<Int16Accumulate32>(x, y, n);
+            }
+
+            XI_PRECISION_TARGET static int32_t simd(const int16_t* x, const int16_t* y, size_t n)
+            {
+                __m256i acc = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16)
+                {
+                    __m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                    __m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i));
+                    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(vx, vy));
+                }
+                uint32_t total = static_cast<uint32_t>(hsum(acc));
+                for (; i < n; ++i)
+                {
+                    total += static_cast<uint32_t>(static_cast<int32_t>(x[i]) * static_cast<int32_t>(y[i]));
+                }
+                return static_cast<int32_t>(total);
+            }
+        };
+#endif
+
+#if XI_PRECISION_F16C
+        /*
+            Dense float <-> float16 runs 8 elements at a time, returns how many were converted
+        */
+        template <typename T, typename R>
+        XI_PRECISION_TARGET inline size_t convert_f16c(const T* in, R* out, size_t n)
+        {
+            size_t j = 0;
+            if constexpr (std::is_same<T, float>::value && std::is_same<R, float16>::value)
+            {
+                for (; j + 8 <= n; j += 8)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                        _mm256_cvtps_ph(_mm256_loadu_ps(in + j), _MM_FROUND_TO_NEAREST_INT));
+                }
+            }
+            else if constexpr (std::is_same<T, float16>::value && std::is_same<R, float>::value)
+            {
+                for (; j + 8 <= n; j += 8)
+                {
+                    _mm256_storeu_ps(out + j, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + j))));
+                }
+            }
+            return j;
+        }
+#endif
+
+        /*
+            Copies [ v ] into a dense row-major buffer, transposed if asked, unless it already is one
+        */
+        template <typename S>
+        inline const S* pack(ConstMatrixView<S> v, bool transposed, std::vector<S>& buffer)
+        {
+            if (!transposed && v.is_contiguous())
+            {
+                return v.data();
+            }
+
+            const size_t rows = transposed ? v.cols() : v.rows();
+            const size_t cols = transposed ? v.rows() : v.cols();
+            buffer.resize(rows * cols);
+
+            MatrixView<S> dense(buffer.data(), rows, cols, static_cast<std::ptrdiff_t>(cols));
+            dense.assign(transposed ? v.transpose() : v);
+            return buffer.data();
+        }
+    }
+
+    /*
+        Dot product of [ n ] storage elements under [ Policy ]
+    */
+    template <typename Policy>
+    inline typename Policy::accumulate_type precision_dot(
+        const typename Policy::storage_type* x, const typename Policy::storage_type* y, size_t n)
+    {
+        return detail::DotKernel<Policy>::run(x, y, n);
+    }
+
+    /*
+        out = a * b with every element of [ a ] and [ b ] of Policy::storage_type,
+        products formed in Policy::compute_type and summed in Policy::accumulate_type,
+        each result is then converted to the element type of [ out ]
+
+        [ b ] is packed transposed once so every output element is one contiguous SIMD dot product,
+        rows of [ out ] are split across the xi_parallel pool
+    */
+    template <typename Policy, typename A, typename B, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>
+    precision_multiply(const A& a, const B& b, Out&& out)
+    {
+        using S = typename Policy::storage_type;
+        static_assert(
+            std::is_same<detail::value_type_t<A>, S>::value && std::is_same<detail::value_type_t<B>, S>::value,
+            "Operands must be stored in the storage type of the precision policy"
+        );
+
+        auto va = detail::as_view(a);
+        auto vb = detail::as_view(b);
+        auto vo = detail::as_mutable_view(out);
+        using R = typename decltype(vo)::value_type;
+
+        assert(
+            va.cols() == vb.rows() && vo.rows() == va.rows() && vo.cols() == vb.cols() &&
+            "Matrix dimensions must match up for multiplication"
+        );
+
+        const size_t k = va.cols();
+
+        XI_TIME_CALL(PRECISION);
+        XI_COUNT(PRECISION, FLOPS, 2 * vo.size() * k);
+        XI_COUNT(PRECISION, BYTES, (va.size() + vb.size()) * sizeof(S) + vo.size() * sizeof(R));
+
+        std::vector<S> a_buffer;
+        std::vector<S> b_buffer;
+        const S* pa = detail::pack(va, false, a_buffer);
+        const S* pbt = detail::pack(vb, true, b_buffer);
+
+        const size_t grain = std::max<size_t>(1, detail::parallel_threshold / std::max<size_t>(1, vo.cols() * k));
+
+        xi_parallel::parallel_for(0, vo.rows(), grain, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i)
+            {
+                const S* row = pa + i * k;
+                for (size_t j = 0; j < vo.cols(); ++j)
+                {
+                    vo(i, j) = detail::convert_element<R>(precision_dot<Policy>(row, pbt + j * k, k));
+                }
+            }
+        });
+    }
+
+    template <typename Policy, typename A, typename B>
+    inline std::enable_if_t<
+        detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value,
+        Matrix<typename Policy::accumulate_type>>
+    precision_multiply(const A& a, const B& b)
+    {
+        Matrix<typename Policy::accumulate_type> result(detail::as_view(a).rows(), detail::as_view(b).cols());
+        precision_multiply<Policy>(a, b, result);
+        return result;
+    }
+
+    /*
+        Element-wise conversion between storage types (e.g. float <-> float16 / bfloat16),
+        dense float <-> float16 runs use the F16C 8 lane conversions when the CPU has them
+    */
+    template <typename A, typename Out>
+    inline std::enable_if_t<detail::is_matrix_like<A>::value> convert(const A& src, Out&& dst)
+    {
+        using T = detail::value_type_t<A>;
+        auto vs = detail::as_view(src);
+        auto vd = detail::as_mutable_view(dst);
+        using R = typename decltype(vd)::value_type;
+
+        assert(
+            vs.rows() == vd.rows() && vs.cols() == vd.cols() &&
+            "Matrix dimensions must match for conversion"
+        );
+
+        XI_TIME_CALL(PRECISION);
+        XI_COUNT(PRECISION, BYTES, vs.size() * (sizeof(T) + sizeof(R)));
+
+        const size_t grain = std::max<size_t>(1, detail::parallel_threshold / std::max<size_t>(1, vs.cols()));
+
+        xi_parallel::parallel_for(0, vs.rows(), grain, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i)
+            {
+                const T* in = vs.data() + static_cast<std::ptrdiff_t>(i) * vs.row_stride();
+                R* o = vd.data() + static_cast<std::ptrdiff_t>(i) * vd.row_stride();
+                size_t j = 0;
+
+#if XI_PRECISION_F16C
+                if (vs.col_stride() == 1 && vd.col_stride() == 1 && detail::simd_supported())
+                {
+                    j = detail::convert_f16c(in, o, vs.cols());
+                }
+#endif
+
+                for (; j < vs.cols(); ++j)
+                {
+                    std::ptrdiff_t jj = static_cast<std::ptrdiff_t>(j);
+                    o[jj * vd.col_stride()] = detail::convert_element<R>(in[jj * vs.col_stride()]);
+                }
+            }
+        });
+    }
+}
+
+#undef XI_PRECISION_DISPATCH
+#undef XI_PRECISION_TARGET
+#undef XI_PRECISION_AVX
+#undef XI_PRECISION_AVX2
+#undef XI_PRECISION_F16C
+#undef XI_PRECISION_FMA
+
+#endif
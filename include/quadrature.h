@@ -0,0 +1,846 @@
+#ifndef XI_QUADRATURE
+#define XI_QUADRATURE
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "math_consts.h"
+#include "instrument.h"
+
+/*
+    Gaussian quadrature and tanh-sinh integration
+
+    An n point Gauss rule integrates w(x) p(x) exactly for every polynomial p of degree 2n - 1,
+    so smooth integrands need a few dozen evaluations where composite Simpson needs thousands:
+
+        gauss_legendre(f, a, b, n)   integral of f(x) over [ a, b ]
+        gauss_laguerre(f, n)         integral of f(x) e^-x over [ 0, inf )
+        gauss_hermite(f, n)          integral of f(x) e^-x^2 over ( -inf, inf )
+        gauss_chebyshev(f, a, b, n)  integral of f(x) / sqrt((x - a)(b - x)) over [ a, b ]
+
+    Nodes and weights are computed once per order by Newton iteration on the three term
+    recurrence of the orthogonal polynomials and kept in a thread safe cache, legendre_rule(n)
+    and friends hand out references that stay valid for the lifetime of the program.
+    Common Gauss-Legendre orders are also available at compile time as GaussLegendreTable<N>
+
+    Integrands without a known weight, singular at an endpoint or running off to infinity go to
+    the double exponential (tanh-sinh) rule, which clusters its nodes doubly exponentially
+    towards the endpoints and never evaluates the endpoints themselves:
+
+        tanh_sinh(f, a, b)                      [ a, b ], endpoint singularities allowed
+        semi_infinite_integral(f, a)            [ a, inf )
+        infinite_integral(f)                    ( -inf, inf )
+
+    The tanh-sinh step is halved until two levels agree to [ tolerance ] (relative), every level
+    reuses the evaluations of the previous ones and roughly doubles the number of correct digits
+*/
+namespace xi_integral
+{
+    /*
+        Nodes and weights of an n point rule, nodes in increasing order
+    */
+    struct QuadratureRule
+    {
+        std::vector<long double> nodes;
+        std::vector<long double> weights;
+
+        size_t size() const { return nodes.size(); }
+    };
+
+    /*
+        Gauss-Legendre rules on [ -1, 1 ] as compile time tables for common orders,
+        the rules are symmetric so only the non-negative nodes (increasing) and their weights are stored
+    */
+    template <size_t N>
+    struct GaussLegendreTable;
+
+    template <>
+    struct GaussLegendreTable<2>
+    {
+        static constexpr long double nodes[] = {
+            5.773502691896257645091e-1L
+        };
+        static constexpr long double weights[] = {
+            1.000000000000000000000e+0L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<3>
+    {
+        static constexpr long double nodes[] = {
+            0.0L, 7.745966692414833770359e-1L
+        };
+        static constexpr long double weights[] = {
+            8.888888888888888888889e-1L, 5.555555555555555555556e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<4>
+    {
+        static constexpr long double nodes[] = {
+            3.399810435848562648027e-1L, 8.611363115940525752239e-1L
+        };
+        static constexpr long double weights[] = {
+            6.521451548625461426269e-1L, 3.478548451374538573731e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<5>
+    {
+        static constexpr long double nodes[] = {
+            0.0L, 5.384693101056830910363e-1L, 9.061798459386639927976e-1L
+        };
+        static constexpr long double weights[] = {
+            5.688888888888888888889e-1L, 4.786286704993664680413e-1L, 2.369268850561890875143e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<6>
+    {
+        static constexpr long double nodes[] = {
+            2.386191860831969086305e-1L, 6.612093864662645136614e-1L, 9.324695142031520278123e-1L
+        };
+        static constexpr long double weights[] = {
+            4.679139345726910473899e-1L, 3.607615730481386075698e-1L, 1.713244923791703450403e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<7>
+    {
+        static constexpr long double nodes[] = {
+            0.0L, 4.058451513773971669066e-1L, 7.415311855993944398639e-1L,
+            9.491079123427585245262e-1L
+        };
+        static constexpr long double weights[] = {
+            4.179591836734693877551e-1L, 3.818300505051189449504e-1L, 2.797053914892766679015e-1L,
+            1.294849661688696932706e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<8>
+    {
+        static constexpr long double nodes[] = {
+            1.834346424956498049395e-1L, 5.255324099163289858177e-1L, 7.966664774136267395916e-1L,
+            9.602898564975362316836e-1L
+        };
+        static constexpr long double weights[] = {
+            3.626837833783619829652e-1L, 3.137066458778872873380e-1L, 2.223810344533744705444e-1L,
+            1.012285362903762591525e-1L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<10>
+    {
+        static constexpr long double nodes[] = {
+            1.488743389816312108848e-1L, 4.333953941292471907993e-1L, 6.794095682990244062343e-1L,
+            8.650633666889845107321e-1L, 9.739065285171717200780e-1L
+        };
+        static constexpr long double weights[] = {
+            2.955242247147528701739e-1L, 2.692667193099963550912e-1L, 2.190863625159820439955e-1L,
+            1.494513491505805931458e-1L, 6.667134430868813759357e-2L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<12>
+    {
+        static constexpr long double nodes[] = {
+            1.252334085114689154724e-1L, 3.678314989981801937527e-1L, 5.873179542866174472967e-1L,
+            7.699026741943046870369e-1L, 9.041172563704748566785e-1L, 9.815606342467192506905e-1L
+        };
+        static constexpr long double weights[] = {
+            2.491470458134027850006e-1L, 2.334925365383548087608e-1L, 2.031674267230659217491e-1L,
+            1.600783285433462263347e-1L, 1.069393259953184309603e-1L, 4.717533638651182719462e-2L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<16>
+    {
+        static constexpr long double nodes[] = {
+            9.501250983763744018532e-2L, 2.816035507792589132305e-1L, 4.580167776572273863424e-1L,
+            6.178762444026437484467e-1L, 7.554044083550030338951e-1L, 8.656312023878317438805e-1L,
+            9.445750230732325760780e-1L, 9.894009349916499325962e-1L
+        };
+        static constexpr long double weights[] = {
+            1.894506104550684962854e-1L, 1.826034150449235888668e-1L, 1.691565193950025381893e-1L,
+            1.495959888165767320815e-1L, 1.246289712555338720525e-1L, 9.515851168249278480993e-2L,
+            6.225352393864789286284e-2L, 2.715245941175409485178e-2L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<20>
+    {
+        static constexpr long double nodes[] = {
+            7.652652113349733375464e-2L, 2.277858511416450780805e-1L, 3.737060887154195606725e-1L,
+            5.108670019508270980044e-1L, 6.360536807265150254528e-1L, 7.463319064601507926143e-1L,
+            8.391169718222188233945e-1L, 9.122344282513259058678e-1L, 9.639719272779137912677e-1L,
+            9.931285991850949247861e-1L
+        };
+        static constexpr long double weights[] = {
+            1.527533871307258506981e-1L, 1.491729864726037467878e-1L, 1.420961093183820513293e-1L,
+            1.316886384491766268985e-1L, 1.181945319615184173124e-1L, 1.019301198172404350368e-1L,
+            8.327674157670474872476e-2L, 6.267204833410906356951e-2L, 4.060142980038694133104e-2L,
+            1.761400713915211831186e-2L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<24>
+    {
+        static constexpr long double nodes[] = {
+            6.405689286260562608504e-2L, 1.911188674736163091586e-1L, 3.150426796961633743868e-1L,
+            4.337935076260451384871e-1L, 5.454214713888395356584e-1L, 6.480936519369755692525e-1L,
+            7.401241915785543642438e-1L, 8.200019859739029219539e-1L, 8.864155270044010342132e-1L,
+            9.382745520027327585236e-1L, 9.747285559713094981984e-1L, 9.951872199970213601800e-1L
+        };
+        static constexpr long double weights[] = {
+            1.279381953467521569741e-1L, 1.258374563468282961214e-1L, 1.216704729278033912045e-1L,
+            1.155056680537256013533e-1L, 1.074442701159656347826e-1L, 9.761865210411388826988e-2L,
+            8.619016153195327591719e-2L, 7.334648141108030573403e-2L, 5.929858491543678074637e-2L,
+            4.427743881741980616860e-2L, 2.853138862893366318131e-2L, 1.234122979998719954681e-2L
+        };
+    };
+
+    template <>
+    struct GaussLegendreTable<32>
+    {
+        static constexpr long double nodes[] = {
+            4.830766568773831623481e-2L, 1.444719615827964934852e-1L, 2.392873622521370745446e-1L,
+            3.318686022821276497799e-1L, 4.213512761306353453641e-1L, 5.068999089322293900237e-1L,
+            5.877157572407623290407e-1L, 6.630442669302152009751e-1L, 7.321821187402896803874e-1L,
+            7.944837959679424069631e-1L, 8.493676137325699701337e-1L, 8.963211557660521239653e-1L,
+            9.349060759377396891709e-1L, 9.647622555875064307738e-1L, 9.856115115452683354002e-1L,
+            9.972638618494815635450e-1L
+        };
+        static constexpr long double weights[] = {
+            9.654008851472780056676e-2L, 9.563872007927485941908e-2L, 9.384439908080456563918e-2L,
+            9.117387869576388471287e-2L, 8.765209300440381114277e-2L, 8.331192422694675522220e-2L,
+            7.819389578707030647174e-2L, 7.234579410884850622540e-2L, 6.582222277636184683765e-2L,
+            5.868409347853554714528e-2L, 5.099805926237617619616e-2L, 4.283589802222668065688e-2L,
+            3.427386291302143310269e-2L, 2.539206530926205945575e-2L, 1.627439473090567060517e-2L,
+            7.018610009470096600407e-3L
+        };
+    };
+    namespace detail
+    {
+        // xi_math_consts::PI is a double literal, the rules are computed in full long double precision
+        inline constexpr long double pi = 3.141592653589793238462643383279502884L;
+
+        /*
+            Full rule from the non-negative half of a symmetric one
+        */
+        template <typename Table>
+        inline QuadratureRule from_table()
+        {
+            constexpr size_t half = sizeof(Table::nodes) / sizeof(Table::nodes[0]);
+            const bool center = Table::nodes[0] == 0.0L;
+
+            QuadratureRule rule;
+            for (size_t i = half; i-- > (center ? 1 : 0);)
+            {
+                rule.nodes.push_back(-Table::nodes[i]);
+                rule.weights.push_back(Table::weights[i]);
+            }
+            for (size_t i = 0; i < half; ++i)
+            {
+                rule.nodes.push_back(Table::nodes[i]);
+                rule.weights.push_back(Table::weights[i]);
+            }
+            return rule;
+        }
+
+        inline bool tabulated_legendre(size_t n, QuadratureRule& rule)
+        {
+            switch (n)
+            {
+                case 2: rule = from_table<GaussLegendreTable<2>>(); return true;
+                case 3: rule = from_table<GaussLegendreTable<3>>(); return true;
+                case 4: rule = from_table<GaussLegendreTable<4>>(); return true;
+                case 5: rule = from_table<GaussLegendreTable<5>>(); return true;
+                case 6: rule = from_table<GaussLegendreTable<6>>(); return true;
+                case 7: rule = from_table<GaussLegendreTable<7>>(); return true;
+                case 8: rule = from_table<GaussLegendreTable<8>>(); return true;
+                case 10: rule = from_table<GaussLegendreTable<10>>(); return true;
+                case 12: rule = from_table<GaussLegendreTable<12>>(); return true;
+                case 16: rule = from_table<GaussLegendreTable<16>>(); return true;
+                case 20: rule = from_table<GaussLegendreTable<20>>(); return true;
+                case 24: rule = from_table<GaussLegendreTable<24>>(); return true;
+                case 32: rule = from_table<GaussLegendreTable<32>>(); return true;
+                default: return false;
+            }
+        }
+
+        inline constexpr int newton_iterations = 100;
+
+        /*
+            Done once the step is down to a few ulps, or once it is small and stopped shrinking
+            because the polynomial values are only known up to rounding noise
+        */
+        inline bool newton_converged(long double step, long double& previous, long double z)
+        {
+            const long double eps = std::numeric_limits<long double>::epsilon();
+            const long double scale = std::max(1.0L, std::fabs(z));
+            const long double size = std::fabs(step);
+            const bool stalled = size <= std::sqrt(eps) * scale && size >= previous / 2;
+            previous = size;
+            return size <= 4 * eps * scale || stalled;
+        }
+
+        [[noreturn]] inline void newton_failed(const char* family)
+        {
+            throw std::runtime_error(std::string("Newton iteration for the ") + family + " nodes did not converge");
+        }
+
+        /*
+            Roots of P_n from the asymptotic guesses cos(pi (i + 3/4) / (n + 1/2)),
+            weights 2 / ((1 - x^2) P_n'(x)^2)
+        */
+        inline QuadratureRule compute_legendre(size_t n)
+        {
+            QuadratureRule rule;
+            rule.nodes.resize(n);
+            rule.weights.resize(n);
+
+            const long double ln = static_cast<long double>(n);
+            for (size_t i = 0; i < (n + 1) / 2; ++i)
+            {
+                long double z = std::cos(detail::pi * (static_cast<long double>(i) + 0.75L) / (ln + 0.5L));
+                long double dp = 0;
+                long double previous = std::numeric_limits<long double>::infinity();
+                int iteration = 0;
+                for (; iteration < newton_iterations; ++iteration)
+                {
+                    long double p0 = 1, p1 = z;
+                    for (size_t j = 2; j <= n; ++j)
+                    {
+                        const long double lj = static_cast<long double>(j);
+                        const long double p2 = ((2 * lj - 1) * z * p1 - (lj - 1) * p0) / lj;
+                        p0 = p1;
+                        p1 = p2;
+                    }
+                    dp = ln * (z * p1 - p0) / (z * z - 1);
+                    const long double step = p1 / dp;
+                    z -= step;
+                    if (newton_converged(step, previous, z)) break;
+                }
+                if (iteration == newton_iterations) newton_failed("Gauss-Legendre");
+
+                const long double w = 2 / ((1 - z * z) * dp * dp);
+                rule.nodes[i] = -z;
+                rule.nodes[n - 1 - i] = z;
+                rule.weights[i] = w;
+                rule.weights[n - 1 - i] = w;
+            }
+            if (n % 2 == 1) rule.nodes[n / 2] = 0;
+            return rule;
+        }
+
+        /*
+            Roots of the Laguerre polynomial L_n, initial guesses from Stroud and Secrest
+            (as in Numerical Recipes, gaulag), weights -1 / (n L_n'(x) L_{n-1}(x))
+        */
+        inline QuadratureRule compute_laguerre(size_t n)
+        {
+            QuadratureRule rule;
+            rule.nodes.resize(n);
+            rule.weights.resize(n);
+
+            const long double ln = static_cast<long double>(n);
+            long double z = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (i == 0)
+                {
+                    z = 3 / (1 + 2.4L * ln);
+                }
+                else if (i == 1)
+                {
+                    z += 15 / (1 + 2.5L * ln);
+                }
+                else
+                {
+                    const long double ai = static_cast<long double>(i - 1);
+                    z += (1 + 2.55L * ai) / (1.9L * ai) * (z - rule.nodes[i - 2]);
+                }
+
+                long double dp = 0, p_prev = 0;
+                long double previous = std::numeric_limits<long double>::infinity();
+                int iteration = 0;
+                for (; iteration < newton_iterations; ++iteration)
+                {
+                    long double p0 = 0, p1 = 1;
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        const long double lj = static_cast<long double>(j);
+                        const long double p2 = ((2 * lj + 1 - z) * p1 - lj * p0) / (lj + 1);
+                        p0 = p1;
+                        p1 = p2;
+                    }
+                    dp = (ln * p1 - ln * p0) / z;
+                    p_prev = p0;
+                    const long double step = p1 / dp;
+                    z -= step;
+                    if (newton_converged(step, previous, z)) break;
+                }
+                if (iteration == newton_iterations) newton_failed("Gauss-Laguerre");
+
+                rule.nodes[i] = z;
+                rule.weights[i] = -1 / (dp * ln * p_prev);
+            }
+            return rule;
+        }
+
+        /*
+            Number of zeros of H_n below [ x ]: the negative pivots of the LDL^T factorization of
+            J - x I, J the Jacobi matrix of H_n (zero diagonal, off diagonal sqrt(k / 2)).
+            A Sturm count, nothing in it can overflow
+        */
+        inline size_t hermite_zeros_below(size_t n, long double x)
+        {
+            size_t count = 0;
+            long double d = 1;
+            for (size_t k = 0; k < n; ++k)
+            {
+                d = -x - (k == 0 ? 0 : static_cast<long double>(k) / 2 / d);
+                if (d == 0) d = -std::numeric_limits<long double>::epsilon();
+                if (d < 0) ++count;
+            }
+            return count;
+        }
+
+        /*
+            Roots of the Hermite polynomial H_n, Newton on the orthonormal recurrence started from
+            a bisection of the Sturm count to 1e-9, so every root starts next to its own zero (the
+            gauher extrapolated guesses send Newton to a neighbouring root from n ~ 200 on).
+            The unweighted recurrence overflows long double for n above about 11000, orders that
+            large throw, as does any rule whose nodes do not come out strictly increasing
+        */
+        inline QuadratureRule compute_hermite(size_t n)
+        {
+            QuadratureRule rule;
+            rule.nodes.resize(n);
+            rule.weights.resize(n);
+
+            const long double ln = static_cast<long double>(n);
+            const long double pim4 = 1 / std::pow(detail::pi, 0.25L);
+            const long double bound = std::sqrt(2 * ln + 1);    // every zero lies in ( -bound, bound )
+            for (size_t i = 0; i < (n + 1) / 2; ++i)
+            {
+                // i-th root from the top, the (n - 1 - i)-th from the bottom
+                long double lo = 0, hi = bound;
+                while (hi - lo > 1e-9L)
+                {
+                    const long double mid = (lo + hi) / 2;
+                    if (hermite_zeros_below(n, mid) > n - 1 - i) hi = mid;
+                    else lo = mid;
+                }
+                long double z = (lo + hi) / 2;
+
+                long double dp = 0;
+                long double previous = std::numeric_limits<long double>::infinity();
+                int iteration = 0;
+                for (; iteration < newton_iterations; ++iteration)
+                {
+                    long double p0 = 0, p1 = pim4;
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        const long double lj = static_cast<long double>(j);
+                        const long double p2 = z * std::sqrt(2 / (lj + 1)) * p1 - std::sqrt(lj / (lj + 1)) * p0;
+                        p0 = p1;
+                        p1 = p2;
+                    }
+                    dp = std::sqrt(2 * ln) * p0;
+                    const long double step = p1 / dp;
+                    z -= step;
+                    if (newton_converged(step, previous, z)) break;
+                }
+                if (iteration == newton_iterations) newton_failed("Gauss-Hermite");
+
+                const long double w = 2 / (dp * dp);
+                rule.nodes[i] = -z;
+                rule.nodes[n - 1 - i] = z;
+                rule.weights[i] = w;
+                rule.weights[n - 1 - i] = w;
+            }
+            if (n % 2 == 1) rule.nodes[n / 2] = 0;
+
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (!(rule.nodes[i] > rule.nodes[i - 1]))
+                    throw std::runtime_error("Gauss-Hermite nodes did not separate, order " + std::to_string(n) + " is too large");
+            }
+            return rule;
+        }
+
+        /*
+            Chebyshev nodes of the first kind, all weights pi / n
+        */
+        inline QuadratureRule compute_chebyshev(size_t n)
+        {
+            QuadratureRule rule;
+            const long double ln = static_cast<long double>(n);
+            for (size_t i = n; i-- > 0;)
+            {
+                rule.nodes.push_back(std::cos(detail::pi * (2 * static_cast<long double>(i) + 1) / (2 * ln)));
+                rule.weights.push_back(detail::pi / ln);
+            }
+            if (n % 2 == 1) rule.nodes[n / 2] = 0;
+            return rule;
+        }
+
+        /*
+            Rules of one family by order, computed on first use
+            A rule is computed outside the lock, if two threads race for the same order the first
+            one stored wins and the other copy is dropped
+        */
+        class RuleCache
+        {
+            private:
+                std::mutex _lock;
+                std::map<size_t, std::unique_ptr<const QuadratureRule>> _rules;
+            public:
+                template <typename Make>
+                const QuadratureRule& get(size_t n, Make make)
+                {
+                    {
+                        std::lock_guard<std::mutex> guard(_lock);
+                        auto it = _rules.find(n);
+                        if (it != _rules.end()) return *it->second;
+                    }
+
+                    auto rule = std::make_unique<const QuadratureRule>(make(n));
+                    std::lock_guard<std::mutex> guard(_lock);
+                    return *_rules.emplace(n, std::move(rule)).first->second;
+                }
+        };
+
+        template <int Family>
+        inline RuleCache& rule_cache()
+        {
+            static RuleCache cache;
+            return cache;
+        }
+    }
+
+    /*
+        n point Gauss-Legendre rule on [ -1, 1 ] (weight 1)
+    */
+    inline const QuadratureRule& legendre_rule(size_t n)
+    {
+        assert(n > 0 && "A quadrature rule needs at least one node");
+        return detail::rule_cache<0>().get(n, [](size_t order) {
+            QuadratureRule rule;
+            if (!detail::tabulated_legendre(order, rule)) rule = detail::compute_legendre(order);
+            return rule;
+        });
+    }
+
+    /*
+        n point Gauss-Laguerre rule on [ 0, inf ) (weight e^-x)
+    */
+    inline const QuadratureRule& laguerre_rule(size_t n)
+    {
+        assert(n > 0 && "A quadrature rule needs at least one node");
+        return detail::rule_cache<1>().get(n, detail::compute_laguerre);
+    }
+
+    /*
+        n point Gauss-Hermite rule on ( -inf, inf ) (weight e^-x^2)
+    */
+    inline const QuadratureRule& hermite_rule(size_t n)
+    {
+        assert(n > 0 && "A quadrature rule needs at least one node");
+        return detail::rule_cache<2>().get(n, detail::compute_hermite);
+    }
+
+    /*
+        n point Gauss-Chebyshev rule of the first kind on [ -1, 1 ] (weight 1 / sqrt(1 - x^2))
+    */
+    inline const QuadratureRule& chebyshev_rule(size_t n)
+    {
+        assert(n > 0 && "A quadrature rule needs at least one node");
+        return detail::rule_cache<3>().get(n, detail::compute_chebyshev);
+    }
+
+    namespace detail
+    {
+        /*
+            sum of w_i f(shift + scale x_i)
+        */
+        template <typename Func>
+        inline long double apply_rule(Func& f, const QuadratureRule& rule, long double shift, long double scale)
+        {
+            XI_TIME_CALL(INTEGRAL);
+            XI_COUNT(INTEGRAL, EVALUATIONS, rule.size());
+
+            long double sum = 0;
+            for (size_t i = 0; i < rule.size(); ++i)
+            {
+                sum += rule.weights[i] * static_cast<long double>(f(shift + scale * rule.nodes[i]));
+            }
+            return sum;
+        }
+    }
+
+    /*
+        Integral of f over [ a, b ] with the n point Gauss-Legendre rule,
+        exact for polynomials up to degree 2n - 1
+    */
+    template <typename Func, typename T1, typename T2>
+    inline long double gauss_legendre(Func&& f, T1 a, T2 b, size_t n = 20)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+
+        const long double half = (static_cast<long double>(b) - a) / 2;
+        const long double mid = (static_cast<long double>(b) + a) / 2;
+        return half * detail::apply_rule(f, legendre_rule(n), mid, half);
+    }
+
+    /*
+        Integral of f(x) e^-x over [ 0, inf ) with the n point Gauss-Laguerre rule
+    */
+    template <typename Func>
+    inline long double gauss_laguerre(Func&& f, size_t n = 32)
+    {
+        return detail::apply_rule(f, laguerre_rule(n), 0, 1);
+    }
+
+    /*
+        Integral of f(x) e^-x^2 over ( -inf, inf ) with the n point Gauss-Hermite rule
+    */
+    template <typename Func>
+    inline long double gauss_hermite(Func&& f, size_t n = 32)
+    {
+        return detail::apply_rule(f, hermite_rule(n), 0, 1);
+    }
+
+    /*
+        Integral of f(x) / sqrt((x - a)(b - x)) over [ a, b ] with the n point Gauss-Chebyshev rule
+    */
+    template <typename Func, typename T1, typename T2>
+    inline long double gauss_chebyshev(Func&& f, T1 a, T2 b, size_t n = 32)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+
+        const long double half = (static_cast<long double>(b) - a) / 2;
+        const long double mid = (static_cast<long double>(b) + a) / 2;
+        return detail::apply_rule(f, chebyshev_rule(n), mid, half);
+    }
+
+    namespace detail
+    {
+        /*
+            One tanh-sinh node at t > 0: x = tanh(pi/2 sinh t), comp = 1 - x (computed directly,
+            so nodes next to the endpoints keep their full relative accuracy) and its weight
+        */
+        struct TanhSinhNode
+        {
+            long double comp;
+            long double weight;
+        };
+
+        /*
+            Nodes are generated for t up to tanh_sinh_t_max, where 1 - x is about 1e-275 and
+            still a normal double, so integrands taking double arguments never see the endpoint
+        */
+        inline constexpr long double tanh_sinh_t_max = 6.0L;
+
+        inline constexpr size_t tanh_sinh_max_level = 16;
+
+        /*
+            Level 0 holds t = 1, 2, ..., level L > 0 the odd multiples of 2^-L,
+            every level is computed once and shared by all threads
+        */
+        class TanhSinhNodes
+        {
+            private:
+                std::mutex _lock;
+                std::unique_ptr<const std::vector<TanhSinhNode>> _levels[tanh_sinh_max_level + 1];
+
+                static std::vector<TanhSinhNode> compute(size_t level)
+                {
+                    const long double h = std::ldexp(1.0L, -static_cast<int>(level));
+                    const long double half_pi = detail::pi / 2;
+                    std::vector<TanhSinhNode> nodes;
+                    for (size_t k = 1;; k += level == 0 ? 1 : 2)
+                    {
+                        const long double t = static_cast<long double>(k) * h;
+                        if (t > tanh_sinh_t_max) break;
+
+                        const long double u = half_pi * std::sinh(t);
+                        const long double cu = std::cosh(u);
+                        nodes.push_back({ 1 / (std::exp(u) * cu), half_pi * std::cosh(t) / (cu * cu) });
+                    }
+                    return nodes;
+                }
+            public:
+                const std::vector<TanhSinhNode>& level(size_t l)
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    if (!_levels[l])
+                    {
+                        _levels[l] = std::make_unique<const std::vector<TanhSinhNode>>(compute(l));
+                    }
+                    return *_levels[l];
+                }
+
+                static TanhSinhNodes& instance()
+                {
+                    static TanhSinhNodes nodes;
+                    return nodes;
+                }
+        };
+
+        /*
+            Tanh-sinh sum over ( -1, 1 ) of g(comp, right), where the abscissa is 1 - comp
+            (right) or -(1 - comp) (left) and g already includes the Jacobian of any change of
+            variables; the centre is evaluated as g(1, true)
+        */
+        template <typename G>
+        inline long double tanh_sinh_sum(G&& g, long double tolerance, size_t max_level)
+        {
+            XI_TIME_CALL(INTEGRAL);
+            assert(tolerance > 0 && "Tolerance must be positive");
+
+            TanhSinhNodes& table = TanhSinhNodes::instance();
+            max_level = std::min(max_level, tanh_sinh_max_level);
+
+            uint64_t evaluations = 1;
+            long double sum = detail::pi / 2 * g(1.0L, true);
+            auto add_level = [&](size_t l) {
+                long double level_sum = 0;
+                for (const TanhSinhNode& node : table.level(l))
+                {
+                    level_sum += node.weight * (g(node.comp, true) + g(node.comp, false));
+                }
+                evaluations += 2 * table.level(l).size();
+                sum += level_sum;
+            };
+
+            add_level(0);
+            long double h = 1;
+            long double estimate = sum;
+            for (size_t l = 1; l <= max_level; ++l)
+            {
+                add_level(l);
+                h /= 2;
+                const long double next = h * sum;
+                const bool converged = l >= 2 && std::fabs(next - estimate) <= tolerance * std::fabs(next);
+                estimate = next;
+                if (converged) break;
+            }
+
+            XI_COUNT(INTEGRAL, EVALUATIONS, evaluations);
+            return estimate;
+        }
+
+        /*
+            f(x) * jacobian, treating an exact zero as zero even when the Jacobian overflows
+        */
+        template <typename Func>
+        inline long double scaled(Func& f, long double x, long double jacobian)
+        {
+            const long double fx = static_cast<long double>(f(x));
+            return fx == 0 ? 0 : fx * jacobian;
+        }
+    }
+
+    /*
+        Integral of f over [ a, b ] with the tanh-sinh rule, for integrands that are smooth
+        inside the interval but singular or not differentiable at its endpoints
+        f is never evaluated at a or b, [ max_level ] bounds the number of step halvings (at most 16)
+
+        f may also take a second argument, the exact distance to the nearer endpoint: a - x in
+        the left half (negative) and b - x in the right half, so a factor like (x - a)^-0.9 can be
+        written as pow(-gap, -0.9) without the cancellation in x - a
+    */
+    template <typename Func, typename T1, typename T2>
+    inline long double tanh_sinh(Func&& f, T1 a, T2 b, long double tolerance = 1e-10L, size_t max_level = 10)
+    {
+        static_assert(
+            std::is_arithmetic<T1>::value && std::is_arithmetic<T2>::value,
+            "Types for A and B must be both numerical"
+        );
+
+        const long double lo = static_cast<long double>(a);
+        const long double hi = static_cast<long double>(b);
+        const long double half = (hi - lo) / 2;
+
+        return half * detail::tanh_sinh_sum([&](long double comp, bool right) -> long double {
+            const long double gap = half * comp;
+            const long double x = right ? hi - gap : lo + gap;
+            if constexpr (std::is_invocable<Func&, long double, long double>::value)
+            {
+                if (gap == 0) return 0;
+                return static_cast<long double>(f(x, right ? gap : -gap));
+            }
+            else
+            {
+                if (x == lo || x == hi) return 0;
+                return static_cast<long double>(f(x));
+            }
+        }, tolerance, max_level);
+    }
+
+    /*
+        Integral of f over [ a, inf ), mapped onto [ 0, 1 ) by x = a + t / (1 - t)
+        f has to decay faster than 1 / x
+    */
+    template <typename Func, typename T>
+    inline long double semi_infinite_integral(Func&& f, T a, long double tolerance = 1e-10L, size_t max_level = 10)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Type for A must be numerical");
+
+        const long double lo = static_cast<long double>(a);
+        return detail::tanh_sinh_sum([&](long double comp, bool right) -> long double {
+            // t = (1 + s) / 2 for the tanh-sinh abscissa s, 1 - t is known exactly on the right
+            const long double t = right ? 1 - comp / 2 : comp / 2;
+            const long double rest = right ? comp / 2 : 1 - comp / 2;
+            const long double x = lo + t / rest;
+            if (x == lo) return 0;
+            return detail::scaled(f, x, 0.5L / (rest * rest));
+        }, tolerance, max_level);
+    }
+
+    /*
+        Integral of f over ( -inf, inf ), mapped onto ( -1, 1 ) by x = s / (1 - s^2)
+        f has to decay faster than 1 / |x|
+    */
+    template <typename Func>
+    inline long double infinite_integral(Func&& f, long double tolerance = 1e-10L, size_t max_level = 10)
+    {
+        return detail::tanh_sinh_sum([&](long double comp, bool right) -> long double {
+            const long double s = 1 - comp;
+            const long double gap = comp * (2 - comp);
+            const long double x = (right ? s : -s) / gap;
+            return detail::scaled(f, x, (1 + s * s) / (gap * gap));
+        }, tolerance, max_level);
+    }
+}
+
+#endif
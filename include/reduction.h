@@ -0,0 +1,639 @@
+#ifndef XI_REDUCTION
+#define XI_REDUCTION
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <cassert>
+#include <type_traits>
+#include "matrix.h"
+#include "parallel.h"
+
+/*
+    Reductions over whole matrices or along one of their axes
+
+    Every function accepts a Matrix_Numerical or any MatrixView / ConstMatrixView
+    Axis::PER_COLUMN collapses every column into one value (the result is 1 x cols),
+    Axis::PER_ROW collapses every row into one value (the result is rows x 1),
+    so the results broadcast straight back against the reduced matrix:
+
+        auto centered = X - xi_matrix::mean(X, xi_matrix::Axis::PER_COLUMN);
+
+    Rows are split into contiguous chunks across the xi_parallel pool once the matrix is large
+    enough, every chunk is folded in row order and the partial results are merged in chunk
+    order, so results are reproducible for a fixed thread count
+*/
+namespace xi_matrix
+{
+    enum class Axis { PER_COLUMN, PER_ROW };
+
+    /*
+        Entry-wise norms, L2 over a whole matrix is the Frobenius norm
+    */
+    enum class Norm { L1, L2, INF };
+
+    namespace detail
+    {
+        /*
+            Accumulator used for sums of [ T ], float sums are carried in double and integers in 64 bits
+        */
+        template <typename T>
+        using accum_t = std::conditional_t<
+            std::is_integral<T>::value,
+            std::conditional_t<std::is_signed<T>::value, long long, unsigned long long>,
+            std::conditional_t<std::is_same<T, float>::value, double, T>
+        >;
+
+        /*
+            Type of means, variances and norms of [ T ]
+        */
+        template <typename T>
+        using real_t = std::conditional_t<std::is_floating_point<T>::value, accum_t<T>, double>;
+
+        /*
+            Element count below which a reduction stays on the calling thread
+        */
+        inline constexpr size_t reduction_threshold = size_t(1) << 16;
+
+        template <typename T>
+        inline const T* row_ptr(ConstMatrixView<T> v, size_t i)
+        {
+            return v.data() + static_cast<std::ptrdiff_t>(i) * v.row_stride();
+        }
+
+        /*
+            Splits the rows of a matrix into one contiguous chunk per thread and calls
+            body(partial, first_row, last_row) for each, returns the per chunk partials in row order
+        */
+        template <typename Acc, typename Body>
+        inline std::vector<Acc> partition_rows(size_t rows, size_t elements, const Acc& init, Body body)
+        {
+            size_t count = 1;
+            if (elements >= reduction_threshold)
+            {
+                count = std::max<size_t>(1, std::min(xi_parallel::concurrency(), rows));
+            }
+
+            std::vector<Acc> partial(count, init);
+
+            xi_parallel::parallel_for(0, count, 1, [&](size_t first, size_t last) {
+                for (size_t t = first; t < last; ++t)
+                {
+                    body(partial[t], rows * t / count, rows * (t + 1) / count);
+                }
+            });
+
+            return partial;
+        }
+
+        /*
+            Fold operations, each one knows how to
+                fold:        reduce a run of n elements (stride apart) of row [ row ] into one accumulator
+                fold_across: add element j of a row into accumulator j (column reductions)
+                merge:       combine two accumulators, [ from ] covering rows after [ into ]
+        */
+        struct Identity { template <typename A, typename T> static A apply(T x) { return static_cast<A>(x); } };
+
+        struct Absolute
+        {
+            template <typename A, typename T>
+            static A apply(T x)
+            {
+                A a = static_cast<A>(x);
+                return a < A(0) ? -a : a;
+            }
+        };
+
+        struct Square
+        {
+            template <typename A, typename T>
+            static A apply(T x)
+            {
+                A a = static_cast<A>(x);
+                return a * a;
+            }
+        };
+
+        template <typename T, typename Transform, typename A = accum_t<T>>
+        struct SumOp
+        {
+            using acc_type = A;
+
+            acc_type identity() const { return acc_type(0); }
+
+            void fold(acc_type& acc, const T* p, size_t n, std::ptrdiff_t stride, size_t) const
+            {
+                acc_type total = 0;
+                if (stride == 1)
+                {
+                    #pragma omp simd reduction(+ : total)
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        total += Transform::template apply<acc_type>(p[j]);
+                    }
+                }
+                else
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        total += Transform::template apply<acc_type>(p[static_cast<std::ptrdiff_t>(j) * stride]);
+                    }
+                }
+                acc += total;
+            }
+
+            void fold_across(acc_type* acc, const T* p, size_t n, std::ptrdiff_t stride, size_t) const
+            {
+                if (stride == 1)
+                {
+                    #pragma omp simd
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        acc[j] += Transform::template apply<acc_type>(p[j]);
+                    }
+                }
+                else
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        acc[j] += Transform::template apply<acc_type>(p[static_cast<std::ptrdiff_t>(j) * stride]);
+                    }
+                }
+            }
+
+            void merge(acc_type& into, const acc_type& from) const { into += from; }
+        };
+
+        /*
+            Sum of squared deviations from a center, the center is either one value,
+            one value per row (row_centers) or one value per column (col_centers)
+        */
+        template <typename T, typename R>
+        struct SquaredDeviationOp
+        {
+            using acc_type = R;
+
+            R center = R(0);
+            const R* row_centers = nullptr;
+            const R* col_centers = nullptr;
+
+            acc_type identity() const { return acc_type(0); }
+
+            void fold(acc_type& acc, const T* p, size_t n, std::ptrdiff_t stride, size_t row) const
+            {
+                const R c = row_centers ? row_centers[row] : center;
+                acc_type total = 0;
+                if (stride == 1)
+                {
+                    #pragma omp simd reduction(+ : total)
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        R d = static_cast<R>(p[j]) - c;
+                        total += d * d;
+                    }
+                }
+                else
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        R d = static_cast<R>(p[static_cast<std::ptrdiff_t>(j) * stride]) - c;
+                        total += d * d;
+                    }
+                }
+                acc += total;
+            }
+
+            void fold_across(acc_type* acc, const T* p, size_t n, std::ptrdiff_t stride, size_t) const
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    R d = static_cast<R>(p[static_cast<std::ptrdiff_t>(j) * stride]) - col_centers[j];
+                    acc[j] += d * d;
+                }
+            }
+
+            void merge(acc_type& into, const acc_type& from) const { into += from; }
+        };
+
+        /*
+            Running extreme value and where it was found, ties keep the earliest position
+        */
+        template <typename T>
+        struct Extreme
+        {
+            T value = T(0);
+            size_t row = 0;
+            size_t col = 0;
+            bool found = false;
+        };
+
+        template <typename T, bool Greatest>
+        struct ExtremeOp
+        {
+            using acc_type = Extreme<T>;
+
+            static bool better(T candidate, T best) { return Greatest ? best < candidate : candidate < best; }
+
+            acc_type identity() const { return acc_type(); }
+
+            void fold(acc_type& acc, const T* p, size_t n, std::ptrdiff_t stride, size_t row) const
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    T x = p[static_cast<std::ptrdiff_t>(j) * stride];
+                    if (!acc.found || better(x, acc.value))
+                    {
+                        acc.value = x;
+                        acc.row = row;
+                        acc.col = j;
+                        acc.found = true;
+                    }
+                }
+            }
+
+            void fold_across(acc_type* acc, const T* p, size_t n, std::ptrdiff_t stride, size_t row) const
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    T x = p[static_cast<std::ptrdiff_t>(j) * stride];
+                    if (!acc[j].found || better(x, acc[j].value))
+                    {
+                        acc[j].value = x;
+                        acc[j].row = row;
+                        acc[j].col = j;
+                        acc[j].found = true;
+                    }
+                }
+            }
+
+            void merge(acc_type& into, const acc_type& from) const
+            {
+                if (from.found && (!into.found || better(from.value, into.value)))
+                {
+                    into = from;
+                }
+            }
+        };
+
+        /*
+            Largest absolute value, used by the infinity norm
+        */
+        template <typename T, typename R>
+        struct MaxAbsOp
+        {
+            using acc_type = R;
+
+            acc_type identity() const { return acc_type(0); }
+
+            void fold(acc_type& acc, const T* p, size_t n, std::ptrdiff_t stride, size_t) const
+            {
+                acc_type best = acc;
+                for (size_t j = 0; j < n; ++j)
+                {
+                    acc_type a = Absolute::apply<acc_type>(p[static_cast<std::ptrdiff_t>(j) * stride]);
+                    best = best < a ? a : best;
+                }
+                acc = best;
+            }
+
+            void fold_across(acc_type* acc, const T* p, size_t n, std::ptrdiff_t stride, size_t) const
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    acc_type a = Absolute::apply<acc_type>(p[static_cast<std::ptrdiff_t>(j) * stride]);
+                    acc[j] = acc[j] < a ? a : acc[j];
+                }
+            }
+
+            void merge(acc_type& into, const acc_type& from) const { into = into < from ? from : into; }
+        };
+
+        template <typename T, typename Op>
+        inline typename Op::acc_type reduce_all(ConstMatrixView<T> v, const Op& op)
+        {
+            XI_TIME_CALL(REDUCTION);
+            XI_COUNT(REDUCTION, FLOPS, v.size());
+            XI_COUNT(REDUCTION, BYTES, v.size() * sizeof(T));
+
+            auto partial = partition_rows(v.rows(), v.size(), op.identity(),
+                [&](typename Op::acc_type& acc, size_t first, size_t last) {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        op.fold(acc, row_ptr(v, i), v.cols(), v.col_stride(), i);
+                    }
+                });
+
+            typename Op::acc_type result = partial[0];
+            for (size_t k = 1; k < partial.size(); ++k)
+            {
+                op.merge(result, partial[k]);
+            }
+            return result;
+        }
+
+        /*
+            Column reductions stream the matrix row by row into one accumulator per column
+            instead of walking down each column, so memory is read exactly once and in order
+        */
+        template <typename T, typename Op>
+        inline std::vector<typename Op::acc_type> reduce_per_column(ConstMatrixView<T> v, const Op& op)
+        {
+            using Acc = typename Op::acc_type;
+
+            XI_TIME_CALL(REDUCTION);
+            XI_COUNT(REDUCTION, FLOPS, v.size());
+            XI_COUNT(REDUCTION, BYTES, v.size() * sizeof(T));
+
+            auto partial = partition_rows(v.rows(), v.size(), std::vector<Acc>(v.cols(), op.identity()),
+                [&](std::vector<Acc>& acc, size_t first, size_t last) {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        op.fold_across(acc.data(), row_ptr(v, i), v.cols(), v.col_stride(), i);
+                    }
+                });
+
+            std::vector<Acc> result = std::move(partial[0]);
+            for (size_t k = 1; k < partial.size(); ++k)
+            {
+                for (size_t j = 0; j < v.cols(); ++j)
+                {
+                    op.merge(result[j], partial[k][j]);
+                }
+            }
+            return result;
+        }
+
+        template <typename T, typename Op>
+        inline std::vector<typename Op::acc_type> reduce_per_row(ConstMatrixView<T> v, const Op& op)
+        {
+            XI_TIME_CALL(REDUCTION);
+            XI_COUNT(REDUCTION, FLOPS, v.size());
+            XI_COUNT(REDUCTION, BYTES, v.size() * sizeof(T));
+
+            std::vector<typename Op::acc_type> result(v.rows(), op.identity());
+            const size_t grain = std::max<size_t>(1, reduction_threshold / std::max<size_t>(1, v.cols()));
+
+            xi_parallel::parallel_for(0, v.rows(), grain, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i)
+                {
+                    op.fold(result[i], row_ptr(v, i), v.cols(), v.col_stride(), i);
+                }
+            });
+            return result;
+        }
+
+        template <typename T, typename Op>
+        inline std::vector<typename Op::acc_type> reduce_axis(ConstMatrixView<T> v, Axis axis, const Op& op)
+        {
+            return axis == Axis::PER_COLUMN ? reduce_per_column(v, op) : reduce_per_row(v, op);
+        }
+
+        /*
+            Packs per axis results into a 1 x cols (PER_COLUMN) or rows x 1 (PER_ROW) matrix
+        */
+        template <typename R, typename Acc, typename Finish>
+        inline Matrix_Numerical<R> axis_result(const std::vector<Acc>& acc, Axis axis, Finish finish)
+        {
+            Matrix_Numerical<R> result = axis == Axis::PER_COLUMN
+                ? Matrix_Numerical<R>(1, acc.size())
+                : Matrix_Numerical<R>(acc.size(), 1);
+
+            R* out = result.data();
+            for (size_t k = 0; k < acc.size(); ++k)
+            {
+                out[k] = finish(acc[k]);
+            }
+            return result;
+        }
+
+        template <typename T>
+        inline size_t axis_length(ConstMatrixView<T> v, Axis axis)
+        {
+            return axis == Axis::PER_COLUMN ? v.rows() : v.cols();
+        }
+    }
+
+    /*
+        Sum of every element
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::accum_t<detail::value_type_t<M>> sum(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        return detail::reduce_all(detail::as_view(m), detail::SumOp<T, detail::Identity>());
+    }
+
+    /*
+        Sum of every column (PER_COLUMN) or every row (PER_ROW)
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::accum_t<detail::value_type_t<M>>> sum(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        using A = detail::accum_t<T>;
+        auto acc = detail::reduce_axis(detail::as_view(m), axis, detail::SumOp<T, detail::Identity>());
+        return detail::axis_result<A>(acc, axis, [](A x) { return x; });
+    }
+
+    /*
+        Arithmetic mean of every element, NaN for an empty matrix
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::real_t<detail::value_type_t<M>> mean(const M& m)
+    {
+        using R = detail::real_t<detail::value_type_t<M>>;
+        auto v = detail::as_view(m);
+        return static_cast<R>(xi_matrix::sum(v)) / static_cast<R>(v.size());
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::real_t<detail::value_type_t<M>>> mean(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        using R = detail::real_t<T>;
+        auto v = detail::as_view(m);
+        const R count = static_cast<R>(detail::axis_length(v, axis));
+        auto acc = detail::reduce_axis(v, axis, detail::SumOp<T, detail::Identity>());
+        return detail::axis_result<R>(acc, axis, [count](detail::accum_t<T> x) { return static_cast<R>(x) / count; });
+    }
+
+    /*
+        Variance of every element, divided by (count - ddof), ddof = 1 gives the sample variance,
+        NaN when ddof >= count (as in NumPy, the divisor would not be positive)
+        Computed in two passes (mean first, then squared deviations from it) which avoids
+        the cancellation of the single pass sum of squares formula
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::real_t<detail::value_type_t<M>> variance(const M& m, size_t ddof = 0)
+    {
+        using T = detail::value_type_t<M>;
+        using R = detail::real_t<T>;
+        auto v = detail::as_view(m);
+
+        if (ddof >= v.size())
+        {
+            return std::numeric_limits<R>::quiet_NaN();
+        }
+
+        detail::SquaredDeviationOp<T, R> op;
+        op.center = xi_matrix::mean(v);
+        return detail::reduce_all(v, op) / static_cast<R>(v.size() - ddof);
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::real_t<detail::value_type_t<M>>> variance(const M& m, Axis axis, size_t ddof = 0)
+    {
+        using T = detail::value_type_t<M>;
+        using R = detail::real_t<T>;
+        auto v = detail::as_view(m);
+
+        const size_t length = detail::axis_length(v, axis);
+        if (ddof >= length)
+        {
+            const std::vector<R> lines(axis == Axis::PER_COLUMN ? v.cols() : v.rows());
+            return detail::axis_result<R>(lines, axis, [](R) { return std::numeric_limits<R>::quiet_NaN(); });
+        }
+
+        Matrix_Numerical<R> centers = xi_matrix::mean(v, axis);
+        detail::SquaredDeviationOp<T, R> op;
+        (axis == Axis::PER_COLUMN ? op.col_centers : op.row_centers) = centers.data();
+
+        const R count = static_cast<R>(length - ddof);
+        auto acc = detail::reduce_axis(v, axis, op);
+        return detail::axis_result<R>(acc, axis, [count](R x) { return x / count; });
+    }
+
+    /*
+        Smallest / largest element, the matrix must not be empty
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::value_type_t<M> min(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        auto v = detail::as_view(m);
+        assert(!v.empty() && "Cannot reduce an empty matrix");
+        return detail::reduce_all(v, detail::ExtremeOp<T, false>()).value;
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::value_type_t<M> max(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        auto v = detail::as_view(m);
+        assert(!v.empty() && "Cannot reduce an empty matrix");
+        return detail::reduce_all(v, detail::ExtremeOp<T, true>()).value;
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::value_type_t<M>> min(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        auto acc = detail::reduce_axis(detail::as_view(m), axis, detail::ExtremeOp<T, false>());
+        return detail::axis_result<T>(acc, axis, [](const detail::Extreme<T>& e) { return e.value; });
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::value_type_t<M>> max(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        auto acc = detail::reduce_axis(detail::as_view(m), axis, detail::ExtremeOp<T, true>());
+        return detail::axis_result<T>(acc, axis, [](const detail::Extreme<T>& e) { return e.value; });
+    }
+
+    /*
+        (row, col) of the smallest / largest element, the first one in row-major order on ties
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline std::pair<size_t, size_t> argmin(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        auto v = detail::as_view(m);
+        assert(!v.empty() && "Cannot reduce an empty matrix");
+        auto e = detail::reduce_all(v, detail::ExtremeOp<T, false>());
+        return { e.row, e.col };
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline std::pair<size_t, size_t> argmax(const M& m)
+    {
+        using T = detail::value_type_t<M>;
+        auto v = detail::as_view(m);
+        assert(!v.empty() && "Cannot reduce an empty matrix");
+        auto e = detail::reduce_all(v, detail::ExtremeOp<T, true>());
+        return { e.row, e.col };
+    }
+
+    /*
+        Row index of the extreme of every column (PER_COLUMN) or column index of the extreme of every row (PER_ROW)
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<size_t> argmin(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        auto acc = detail::reduce_axis(detail::as_view(m), axis, detail::ExtremeOp<T, false>());
+        return detail::axis_result<size_t>(acc, axis, [axis](const detail::Extreme<T>& e) {
+            return axis == Axis::PER_COLUMN ? e.row : e.col;
+        });
+    }
+
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<size_t> argmax(const M& m, Axis axis)
+    {
+        using T = detail::value_type_t<M>;
+        auto acc = detail::reduce_axis(detail::as_view(m), axis, detail::ExtremeOp<T, true>());
+        return detail::axis_result<size_t>(acc, axis, [axis](const detail::Extreme<T>& e) {
+            return axis == Axis::PER_COLUMN ? e.row : e.col;
+        });
+    }
+
+    /*
+        Entry-wise norm of the whole matrix, Norm::L2 is the Frobenius norm
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline detail::real_t<detail::value_type_t<M>> norm(const M& m, Norm kind = Norm::L2)
+    {
+        using T = detail::value_type_t<M>;
+        using R = detail::real_t<T>;
+        auto v = detail::as_view(m);
+
+        switch (kind)
+        {
+            case Norm::L1:
+                return detail::reduce_all(v, detail::SumOp<T, detail::Absolute, R>());
+            case Norm::INF:
+                return detail::reduce_all(v, detail::MaxAbsOp<T, R>());
+            case Norm::L2:
+            default:
+                return std::sqrt(detail::reduce_all(v, detail::SumOp<T, detail::Square, R>()));
+        }
+    }
+
+    /*
+        Norm of every column (PER_COLUMN) or every row (PER_ROW) taken as a vector
+    */
+    template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+    inline Matrix_Numerical<detail::real_t<detail::value_type_t<M>>> norm(const M& m, Axis axis, Norm kind = Norm::L2)
+    {
+        using T = detail::value_type_t<M>;
+        using R = detail::real_t<T>;
+        auto v = detail::as_view(m);
+        auto same = [](R x) { return x; };
+
+        switch (kind)
+        {
+            case Norm::L1:
+                return detail::axis_result<R>(detail::reduce_axis(v, axis, detail::SumOp<T, detail::Absolute, R>()), axis, same);
+            case Norm::INF:
+                return detail::axis_result<R>(detail::reduce_axis(v, axis, detail::MaxAbsOp<T, R>()), axis, same);
+            case Norm::L2:
+            default:
+                return detail::axis_result<R>(
+                    detail::reduce_axis(v, axis, detail::SumOp<T, detail::Square, R>()), axis,
+                    [](R x) { return std::sqrt(x); }
+                );
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,757 @@
+#ifndef XI_ROOTS
+#define XI_ROOTS
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+
+/*
+    Roots of scalar and vector functions
+
+        brent(f, a, b)          bracketing, never leaves [ a, b ], one evaluation per iteration
+        newton(f, x0)           damped Newton
+        safe_newton(f, a, b)    Newton inside a bracket, bisection whenever a step leaves it
+        halley(f, x0)           cubically convergent, uses f''
+        newton_krylov(F, x0)    F : R^n -> R^n, Jacobian-free Newton-GMRES
+
+    Every evaluation of f is assumed to be expensive (a model run), so the solvers never pay for
+    a full derivative stencil the way definite_derivative does (6 evaluations):
+
+        - a scalar f may return std::pair / std::array { f, f' } or { f, f', f'' } and the
+          derivatives are taken as given, one evaluation per iteration
+        - otherwise the value at the iterate is reused: Newton adds one forward difference point,
+          Halley the two neighbours of a central stencil, Newton-Krylov one residual per
+          Jacobian-vector product
+        - batched(g) wraps a callable g(const std::vector<long double>& xs, std::vector<long double>& fx)
+          that evaluates several points per call (in parallel, on a cluster, ...), the iterate and
+          its stencil points are then requested together
+
+    Results report the number of evaluated points next to the root
+*/
+namespace xi_roots
+{
+    struct Options
+    {
+        long double tolerance = 1e-12L;     // converged once a step is below tolerance * (1 + |x|)
+        long double value_tolerance = 0;    // or once |f(x)| (max norm for vectors) is at most this
+        size_t max_iterations = 100;
+    };
+
+    struct RootResult
+    {
+        long double root = 0;
+        long double value = 0;              // f(root)
+        size_t evaluations = 0;             // points at which f was evaluated
+        size_t iterations = 0;
+        bool converged = false;
+    };
+
+    template <typename T>
+    struct VectorRootResult
+    {
+        std::vector<T> root;
+        T residual = 0;                     // Euclidean norm of F(root)
+        size_t evaluations = 0;
+        size_t iterations = 0;
+        bool converged = false;
+    };
+
+    /*
+        Callable evaluating a whole set of points per call, see batched()
+    */
+    template <typename Func>
+    struct Batched
+    {
+        Func f;
+    };
+
+    /*
+        Marks [ f ] as batched: f(points, values) fills values[i] for every points[i]
+        (values is resized to points.size() before the call)
+    */
+    template <typename Func>
+    inline Batched<std::decay_t<Func>> batched(Func&& f)
+    {
+        return Batched<std::decay_t<Func>>{ std::forward<Func>(f) };
+    }
+
+    namespace detail
+    {
+        template <typename Func>
+        struct is_batched : std::false_type {};
+
+        template <typename Func>
+        struct is_batched<Batched<Func>> : std::true_type {};
+
+        template <typename Func>
+        inline constexpr bool is_batched_v = is_batched<std::decay_t<Func>>::value;
+
+        /*
+            Function value of a result that may carry derivatives after it
+        */
+        template <typename R>
+        inline long double value_of(const R& r)
+        {
+            if constexpr (std::is_arithmetic<R>::value)
+            {
+                return static_cast<long double>(r);
+            }
+            else
+            {
+                return static_cast<long double>(std::get<0>(r));
+            }
+        }
+
+        /*
+            Evaluates [ f ] at every point, in one call for batched callables
+        */
+        template <typename Func, typename P, typename V>
+        inline void evaluate(Func& f, const std::vector<P>& points, std::vector<V>& values, size_t& evaluations)
+        {
+            values.resize(points.size());
+            if constexpr (is_batched_v<Func>)
+            {
+                f.f(points, values);
+            }
+            else
+            {
+                for (size_t i = 0; i < points.size(); ++i)
+                {
+                    values[i] = static_cast<V>(value_of(f(points[i])));
+                }
+            }
+
+            evaluations += points.size();
+            XI_COUNT(DERIVATIVE, EVALUATIONS, points.size());
+        }
+
+        /*
+            Number of derivatives a scalar function returns next to its value
+        */
+        template <typename Func, typename = void>
+        struct derivative_order : std::integral_constant<size_t, 0> {};
+
+        template <typename Func>
+        struct derivative_order<Func, std::enable_if_t<
+            !is_batched_v<Func> &&
+            !std::is_arithmetic<std::decay_t<std::invoke_result_t<Func&, long double>>>::value>>
+            : std::integral_constant<size_t, std::tuple_size<std::decay_t<std::invoke_result_t<Func&, long double>>>::value - 1> {};
+
+        struct Sample
+        {
+            long double x = 0, value = 0, d1 = 0, d2 = 0;
+        };
+
+        /*
+            f at x in one evaluation, with whatever derivatives the callable returns analytically
+        */
+        template <typename Func>
+        inline Sample probe(Func& f, long double x, size_t& evaluations)
+        {
+            constexpr size_t order = derivative_order<Func>::value;
+            Sample s;
+            s.x = x;
+
+            if constexpr (order > 0)
+            {
+                const auto r = f(x);
+                ++evaluations;
+                XI_COUNT(DERIVATIVE, EVALUATIONS, 1);
+
+                s.value = static_cast<long double>(std::get<0>(r));
+                s.d1 = static_cast<long double>(std::get<1>(r));
+                if constexpr (order > 1)
+                {
+                    s.d2 = static_cast<long double>(std::get<2>(r));
+                }
+            }
+            else
+            {
+                std::vector<long double> points{ x }, values;
+                evaluate(f, points, values, evaluations);
+                s.value = values[0];
+            }
+            return s;
+        }
+
+        /*
+            Fills in f' and (with [ second ]) f'' of a probed sample, f(x) is reused: a forward
+            difference (first derivative only) or a central stencil on the two neighbours of x,
+            an analytic f' is differenced centrally for f''
+        */
+        template <typename Func>
+        inline void complete(Func& f, Sample& s, bool second, size_t& evaluations)
+        {
+            constexpr size_t order = derivative_order<Func>::value;
+            const long double eps = std::numeric_limits<long double>::epsilon();
+            const long double x = s.x;
+            const long double scale = std::max(1.0L, std::fabs(x));
+
+            if constexpr (order > 1)
+            {
+                return;
+            }
+            else if constexpr (order == 1)
+            {
+                if (!second) return;
+
+                // h ~ eps^(1/3) balances the O(h^2) error of the central difference against rounding
+                const long double h = (x + std::cbrt(eps) * scale) - x;
+                const auto below = f(x - h);
+                const auto above = f(x + h);
+                evaluations += 2;
+                XI_COUNT(DERIVATIVE, EVALUATIONS, 2);
+                s.d2 = (static_cast<long double>(std::get<1>(above)) - static_cast<long double>(std::get<1>(below))) / (2 * h);
+            }
+            else if (second)
+            {
+                // Central stencil, h ~ eps^(1/4) balances the O(h^2) error of f'' against rounding
+                const long double h = (x + std::pow(eps, 0.25L) * scale) - x;
+                std::vector<long double> points{ x - h, x + h }, values;
+                evaluate(f, points, values, evaluations);
+
+                s.d1 = (values[1] - values[0]) / (2 * h);
+                s.d2 = (values[1] - 2 * s.value + values[0]) / (h * h);
+            }
+            else
+            {
+                const long double h = (x + std::sqrt(eps) * scale) - x;
+                std::vector<long double> points{ x + h }, values;
+                evaluate(f, points, values, evaluations);
+
+                s.d1 = (values[0] - s.value) / h;
+            }
+        }
+
+        /*
+            f, f' and (with [ second ]) f'' at x
+            Analytic derivatives cost one evaluation, otherwise f(x) is shared with a forward
+            difference (first derivative only) or a central stencil, all points in one batch
+        */
+        template <typename Func>
+        inline Sample sample(Func& f, long double x, bool second, size_t& evaluations)
+        {
+            Sample s = probe(f, x, evaluations);
+            complete(f, s, second, evaluations);
+            return s;
+        }
+
+        template <typename Func>
+        inline long double value(Func& f, long double x, size_t& evaluations)
+        {
+            std::vector<long double> points{ x }, values;
+            evaluate(f, points, values, evaluations);
+            return values[0];
+        }
+
+        inline bool step_converged(long double step, long double x, const Options& options)
+        {
+            return std::fabs(step) <= options.tolerance * (1 + std::fabs(x));
+        }
+
+        inline bool value_converged(long double value, const Options& options)
+        {
+            return value == 0 || std::fabs(value) <= options.value_tolerance;
+        }
+
+        /*
+            Shared loop of newton() and halley(): [ correction ] turns a Sample into the step
+            x_new = x - step, steps that do not reduce |f| are halved (at most 30 times)
+            Trial points are single evaluations, the derivatives are taken once at the accepted one.
+            A step only counts as converged when it decreased |f| undamped; when no step decreases
+            |f| the iterate is a root only if |f / f'| is already below the step tolerance (the
+            rounding floor), otherwise it is a local minimum of |f| and the search fails
+        */
+        template <typename Func, typename Correction>
+        inline RootResult damped_iteration(Func& f, long double x0, bool second, const Options& options, Correction&& correction)
+        {
+            RootResult result;
+            Sample s = sample(f, x0, second, result.evaluations);
+
+            auto at_floor = [&](const Sample& point, long double slope) {
+                return value_converged(point.value, options) ||
+                    (slope != 0 && step_converged(point.value / slope, point.x, options));
+            };
+
+            for (; result.iterations < options.max_iterations; )
+            {
+                if (value_converged(s.value, options))
+                {
+                    result.converged = true;
+                    break;
+                }
+
+                long double step = correction(s);
+                if (!std::isfinite(step))
+                {
+                    break;
+                }
+                ++result.iterations;
+
+                Sample next = probe(f, s.x - step, result.evaluations);
+                int halvings = 0;
+                for (; halvings < 30 && !(std::fabs(next.value) < std::fabs(s.value)) && !step_converged(step, s.x, options); ++halvings)
+                {
+                    step /= 2;
+                    next = probe(f, s.x - step, result.evaluations);
+                }
+
+                if (!(std::fabs(next.value) < std::fabs(s.value)))
+                {
+                    result.converged = at_floor(s, s.d1);
+                    break;
+                }
+
+                if (step_converged(step, s.x, options))
+                {
+                    result.converged = halvings == 0 || at_floor(next, s.d1);
+                    s = next;
+                    break;
+                }
+
+                complete(f, next, second, result.evaluations);
+                s = next;
+            }
+
+            result.root = s.x;
+            result.value = s.value;
+            return result;
+        }
+    }
+
+    /*
+        Brent's method (van Wijngaarden-Dekker-Brent): inverse quadratic interpolation and secant
+        steps guarded by bisection, so it converges whenever f(a) and f(b) differ in sign and
+        superlinearly near a simple root. Throws std::invalid_argument without a sign change
+    */
+    template <typename Func>
+    inline RootResult brent(Func&& f, long double a, long double b, const Options& options = Options())
+    {
+        XI_TIME_CALL(DERIVATIVE);
+
+        RootResult result;
+        long double fa = detail::value(f, a, result.evaluations);
+        long double fb = detail::value(f, b, result.evaluations);
+
+        if ((fa > 0 && fb > 0) || (fa < 0 && fb < 0))
+        {
+            throw std::invalid_argument("xi_roots::brent: f(a) and f(b) must differ in sign");
+        }
+
+        const long double eps = std::numeric_limits<long double>::epsilon();
+        long double c = b, fc = fb, d = 0, e = 0;
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0))
+            {
+                c = a;
+                fc = fa;
+                d = e = b - a;
+            }
+            if (std::fabs(fc) < std::fabs(fb))
+            {
+                a = b; b = c; c = a;
+                fa = fb; fb = fc; fc = fa;
+            }
+
+            const long double tol = 2 * eps * std::fabs(b) + options.tolerance * (1 + std::fabs(b)) / 2;
+            const long double m = (c - b) / 2;
+            if (std::fabs(m) <= tol || detail::value_converged(fb, options))
+            {
+                result.converged = true;
+                break;
+            }
+
+            if (std::fabs(e) >= tol && std::fabs(fa) > std::fabs(fb))
+            {
+                // Secant (a == c) or inverse quadratic interpolation
+                long double p, q, r;
+                const long double s = fb / fa;
+                if (a == c)
+                {
+                    p = 2 * m * s;
+                    q = 1 - s;
+                }
+                else
+                {
+                    q = fa / fc;
+                    r = fb / fc;
+                    p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+                    q = (q - 1) * (r - 1) * (s - 1);
+                }
+                if (p > 0) q = -q;
+                p = std::fabs(p);
+
+                if (2 * p < std::min(3 * m * q - std::fabs(tol * q), std::fabs(e * q)))
+                {
+                    e = d;
+                    d = p / q;
+                }
+                else
+                {
+                    d = m;
+                    e = m;
+                }
+            }
+            else
+            {
+                d = m;
+                e = m;
+            }
+
+            a = b;
+            fa = fb;
+            b += std::fabs(d) > tol ? d : (m > 0 ? tol : -tol);
+            fb = detail::value(f, b, result.evaluations);
+        }
+
+        result.root = b;
+        result.value = fb;
+        return result;
+    }
+
+    /*
+        Newton's method from [ x0 ], halving steps that do not reduce |f|
+        Without analytic derivatives every iteration costs two points (the iterate and one
+        forward difference point), one call for batched callables
+    */
+    template <typename Func>
+    inline RootResult newton(Func&& f, long double x0, const Options& options = Options())
+    {
+        XI_TIME_CALL(DERIVATIVE);
+
+        return detail::damped_iteration(f, x0, false, options, [](const detail::Sample& s) {
+            return s.value / s.d1;
+        });
+    }
+
+    /*
+        Newton's method kept inside the bracket [ a, b ] (f(a) and f(b) of opposite sign):
+        a step that leaves the bracket or does not halve it at least as fast as bisection is
+        replaced by bisection, every evaluated point tightens the bracket
+        Throws std::invalid_argument without a sign change
+    */
+    template <typename Func>
+    inline RootResult safe_newton(Func&& f, long double a, long double b, const Options& options = Options())
+    {
+        XI_TIME_CALL(DERIVATIVE);
+
+        RootResult result;
+        const long double fa = detail::value(f, a, result.evaluations);
+        const long double fb = detail::value(f, b, result.evaluations);
+
+        if ((fa > 0 && fb > 0) || (fa < 0 && fb < 0))
+        {
+            throw std::invalid_argument("xi_roots::safe_newton: f(a) and f(b) must differ in sign");
+        }
+        if (fa == 0 || fb == 0)
+        {
+            result.root = fa == 0 ? a : b;
+            result.converged = true;
+            return result;
+        }
+
+        // Orient the bracket so that f(lo) < 0 < f(hi)
+        long double lo = fa < 0 ? a : b;
+        long double hi = fa < 0 ? b : a;
+        long double dx_old = std::fabs(b - a), dx = dx_old;
+
+        detail::Sample s = detail::sample(f, (a + b) / 2, false, result.evaluations);
+        (s.value < 0 ? lo : hi) = s.x;
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            if (detail::value_converged(s.value, options))
+            {
+                result.converged = true;
+                break;
+            }
+
+            const bool newton_leaves = ((s.x - hi) * s.d1 - s.value) * ((s.x - lo) * s.d1 - s.value) > 0;
+            const bool newton_slow = std::fabs(2 * s.value) > std::fabs(dx_old * s.d1);
+
+            dx_old = dx;
+            long double x;
+            if (newton_leaves || newton_slow || !std::isfinite(s.value / s.d1))
+            {
+                dx = (hi - lo) / 2;
+                x = lo + dx;
+            }
+            else
+            {
+                dx = s.value / s.d1;
+                x = s.x - dx;
+            }
+
+            if (detail::step_converged(dx, x, options) || x == s.x)
+            {
+                s.x = x;
+                s.value = detail::value(f, x, result.evaluations);
+                result.converged = true;
+                break;
+            }
+
+            s = detail::sample(f, x, false, result.evaluations);
+            (s.value < 0 ? lo : hi) = s.x;
+        }
+
+        result.root = s.x;
+        result.value = s.value;
+        return result;
+    }
+
+    /*
+        Halley's method, cubic convergence near a simple root
+        Without analytic derivatives every accepted iterate adds the two neighbours of a central
+        stencil (one batched call), f' and f'' share them with f(x); with an analytic f' only f''
+        is differenced, from f' at the two neighbours
+    */
+    template <typename Func>
+    inline RootResult halley(Func&& f, long double x0, const Options& options = Options())
+    {
+        XI_TIME_CALL(DERIVATIVE);
+
+        return detail::damped_iteration(f, x0, true, options, [](const detail::Sample& s) {
+            const long double denominator = 2 * s.d1 * s.d1 - s.value * s.d2;
+            const long double step = 2 * s.value * s.d1 / denominator;
+            return std::isfinite(step) ? step : s.value / s.d1;
+        });
+    }
+
+    namespace detail
+    {
+        /*
+            F(x) into [ out ], F either fills a vector (F(x, out)) or returns one
+        */
+        template <typename Func, typename T>
+        inline void residual(Func& F, const std::vector<T>& x, std::vector<T>& out, size_t& evaluations)
+        {
+            if constexpr (std::is_invocable<Func&, const std::vector<T>&, std::vector<T>&>::value)
+            {
+                F(x, out);
+            }
+            else
+            {
+                const auto values = F(x);
+                for (size_t i = 0; i < out.size(); ++i)
+                {
+                    out[i] = static_cast<T>(values[i]);
+                }
+            }
+
+            ++evaluations;
+            XI_COUNT(DERIVATIVE, EVALUATIONS, 1);
+        }
+
+        template <typename T>
+        inline T norm2(const std::vector<T>& v)
+        {
+            T sum = 0;
+            for (T value : v) sum += value * value;
+            return std::sqrt(sum);
+        }
+
+        template <typename T>
+        inline T norm_inf(const std::vector<T>& v)
+        {
+            T largest = 0;
+            for (T value : v) largest = std::max(largest, std::fabs(value));
+            return largest;
+        }
+    }
+
+    /*
+        Jacobian-free Newton-Krylov for F(x) = 0, F : R^n -> R^n given as F(x, out) or returning
+        a std::vector, x0 sets n
+
+        Each Newton step solves J s = -F(x) with restarted GMRES only as accurately as the
+        Eisenstat-Walker forcing term asks for, J v is the directional difference
+        (F(x + e v) - F(x)) / e, one evaluation per Krylov iteration with F(x) shared.
+        Steps are backtracked until |F| decreases
+    */
+    template <typename Func, typename T>
+    inline VectorRootResult<T> newton_krylov(Func&& F, const std::vector<T>& x0, const Options& options = Options())
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Newton-Krylov requires a floating point state"
+        );
+
+        XI_TIME_CALL(DERIVATIVE);
+
+        const size_t n = x0.size();
+        const size_t krylov = std::min<size_t>(n, 40);
+        const size_t restarts = 3;
+        const T sqrt_eps = std::sqrt(std::numeric_limits<T>::epsilon());
+
+        VectorRootResult<T> result;
+        std::vector<T> x = x0, fx(n), trial(n), f_trial(n), s(n), w(n);
+
+        detail::residual(F, x, fx, result.evaluations);
+        T norm = detail::norm2(fx);
+        T eta = T(0.5);
+
+        std::vector<std::vector<T>> V(krylov + 1, std::vector<T>(n));
+        std::vector<T> H((krylov + 1) * krylov), cs(krylov), sn(krylov), g(krylov + 1), y(krylov);
+
+        // J v ~ (F(x + e v) - F(x)) / e, e scaled to the lengths of x and v
+        auto jacobian_times = [&](const std::vector<T>& v, std::vector<T>& out) {
+            const T length = detail::norm2(v);
+            if (length == 0)
+            {
+                std::fill(out.begin(), out.end(), T(0));
+                return;
+            }
+
+            const T e = sqrt_eps * (1 + detail::norm2(x)) / length;
+            for (size_t i = 0; i < n; ++i) trial[i] = x[i] + e * v[i];
+            detail::residual(F, trial, out, result.evaluations);
+            for (size_t i = 0; i < n; ++i) out[i] = (out[i] - fx[i]) / e;
+        };
+
+        for (; result.iterations < options.max_iterations; ++result.iterations)
+        {
+            if (detail::norm_inf(fx) <= options.value_tolerance || norm == 0)
+            {
+                result.converged = true;
+                break;
+            }
+
+            // Restarted GMRES on J s = -F(x) to relative accuracy eta
+            std::fill(s.begin(), s.end(), T(0));
+            const T target = eta * norm;
+
+            for (size_t cycle = 0; cycle < restarts; ++cycle)
+            {
+                // r = -F - J s
+                if (cycle == 0)
+                {
+                    for (size_t i = 0; i < n; ++i) V[0][i] = -fx[i];
+                }
+                else
+                {
+                    jacobian_times(s, w);
+                    for (size_t i = 0; i < n; ++i) V[0][i] = -fx[i] - w[i];
+                }
+
+                const T beta = detail::norm2(V[0]);
+                if (beta <= target) break;
+                for (T& value : V[0]) value /= beta;
+
+                std::fill(g.begin(), g.end(), T(0));
+                g[0] = beta;
+                size_t k = 0;
+
+                while (k < krylov)
+                {
+                    jacobian_times(V[k], w);
+
+                    // Modified Gram-Schmidt
+                    for (size_t j = 0; j <= k; ++j)
+                    {
+                        T h = 0;
+                        for (size_t i = 0; i < n; ++i) h += w[i] * V[j][i];
+                        for (size_t i = 0; i < n; ++i) w[i] -= h * V[j][i];
+                        H[j * krylov + k] = h;
+                    }
+                    const T h_next = detail::norm2(w);
+
+                    // Previous Givens rotations, then the one eliminating h_next
+                    for (size_t j = 0; j < k; ++j)
+                    {
+                        const T a = H[j * krylov + k], b = H[(j + 1) * krylov + k];
+                        H[j * krylov + k] = cs[j] * a + sn[j] * b;
+                        H[(j + 1) * krylov + k] = -sn[j] * a + cs[j] * b;
+                    }
+                    const T diagonal = H[k * krylov + k];
+                    const T r = std::hypot(diagonal, h_next);
+                    cs[k] = r > 0 ? diagonal / r : T(1);
+                    sn[k] = r > 0 ? h_next / r : T(0);
+                    H[k * krylov + k] = r;
+                    g[k + 1] = -sn[k] * g[k];
+                    g[k] = cs[k] * g[k];
+                    ++k;
+
+                    if (std::fabs(g[k]) <= target || h_next == 0 || k == krylov)
+                    {
+                        break;
+                    }
+                    for (size_t i = 0; i < n; ++i) V[k][i] = w[i] / h_next;
+                }
+
+                // Back substitution of the k x k triangle, s += V y
+                for (size_t i = k; i-- > 0; )
+                {
+                    T sum = g[i];
+                    for (size_t j = i + 1; j < k; ++j) sum -= H[i * krylov + j] * y[j];
+                    y[i] = H[i * krylov + i] != 0 ? sum / H[i * krylov + i] : T(0);
+                }
+                for (size_t j = 0; j < k; ++j)
+                {
+                    for (size_t i = 0; i < n; ++i) s[i] += y[j] * V[j][i];
+                }
+
+                if (std::fabs(g[k]) <= target) break;
+            }
+
+            // Backtracking on |F|
+            T lambda = 1, trial_norm = 0;
+            bool decreased = false;
+            for (int backtrack = 0; backtrack < 20; ++backtrack, lambda /= 2)
+            {
+                for (size_t i = 0; i < n; ++i) trial[i] = x[i] + lambda * s[i];
+                detail::residual(F, trial, f_trial, result.evaluations);
+                trial_norm = detail::norm2(f_trial);
+                if (trial_norm <= (1 - T(1e-4) * lambda) * norm)
+                {
+                    decreased = true;
+                    break;
+                }
+            }
+            if (!decreased)
+            {
+                // At the rounding floor of |F| no step decreases it, a negligible Newton step still
+                // means x is a root
+                T full_step = 0;
+                for (size_t i = 0; i < n; ++i) full_step = std::max(full_step, std::fabs(s[i]));
+                result.converged = full_step <= options.tolerance * (1 + detail::norm_inf(x));
+                break;
+            }
+
+            T step = 0;
+            for (size_t i = 0; i < n; ++i) step = std::max(step, std::fabs(lambda * s[i]));
+
+            std::swap(x, trial);
+            std::swap(fx, f_trial);
+
+            // Eisenstat-Walker choice 2 with its safeguard
+            const T ratio = trial_norm / norm;
+            T next_eta = T(0.9) * ratio * ratio;
+            if (T(0.9) * eta * eta > T(0.1)) next_eta = std::max(next_eta, T(0.9) * eta * eta);
+            eta = std::min(next_eta, T(0.9));
+            norm = trial_norm;
+
+            if (step <= options.tolerance * (1 + detail::norm_inf(x)))
+            {
+                ++result.iterations;
+                result.converged = true;
+                break;
+            }
+        }
+
+        result.root = x;
+        result.residual = norm;
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,762 @@
+#ifndef XI_SPLINE
+#define XI_SPLINE
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+
+/*
+    Interpolation of tabulated data
+
+        linear_interpolant(x, y)                piecewise linear
+        cubic_spline(x, y, boundary)            C2 cubic spline, natural / clamped / not-a-knot
+        akima(x, y)                             Akima 1970, no overshoot next to outliers
+        pchip(x, y)                             monotone cubic (Fritsch-Carlson), keeps monotone data monotone
+        hermite(x, y, dydx)                     cubic Hermite with given slopes
+        interpolating_bspline(x, y, degree)     B-spline of any degree through the points
+
+    The first five return a PiecewiseCubic, one polynomial a + b t + c t^2 + d t^3 (t = x - x_i)
+    per interval. The cubic spline solves one tridiagonal system for the knot slopes, O(n).
+
+    Evaluation finds the interval in O(1) on uniform grids (detected at construction) and by
+    binary search otherwise; batches hunt from the previous interval, so sorted or clustered
+    points cost O(1) each, and then run the polynomials as one SIMD loop over the batch.
+    Outside [ x_0, x_n-1 ] the end polynomials extrapolate.
+
+    integral(lo, hi) and derivative() are exact on the polynomials, a spline passed to
+    definite_integral would only approximate what integral() returns directly
+*/
+namespace xi_spline
+{
+    enum class Boundary
+    {
+        NATURAL,        // zero second derivative at both ends
+        CLAMPED,        // given first derivatives at both ends
+        NOT_A_KNOT      // continuous third derivative at x_1 and x_n-2
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        inline void check_knots(const std::vector<T>& x, size_t values, size_t minimum)
+        {
+            if (x.size() != values)
+            {
+                throw std::invalid_argument("xi_spline: x and y must have the same length");
+            }
+            if (x.size() < minimum)
+            {
+                throw std::invalid_argument("xi_spline: too few points for this interpolant");
+            }
+            for (size_t i = 1; i < x.size(); ++i)
+            {
+                if (!(x[i] > x[i - 1]))
+                {
+                    throw std::invalid_argument("xi_spline: x must be strictly increasing");
+                }
+            }
+        }
+
+        /*
+            Index of the interval [ x_i, x_i+1 ) holding [ value ], clamped to [ 0, n - 2 ]
+            Steps away from [ guess ] in doubling strides before bisecting, so a point d
+            intervals from the previous one costs O(log d) rather than O(log n)
+        */
+        template <typename T>
+        inline size_t hunt(const T* x, size_t n, T value, size_t guess)
+        {
+            const size_t last = n - 2;
+            size_t lo, hi;
+
+            if (guess > last) guess = last;
+            if (value >= x[guess])
+            {
+                if (guess == last || value < x[guess + 1]) return guess;
+                lo = guess + 1;
+                size_t step = 1;
+                hi = lo + step;
+                while (hi <= last && value >= x[hi])
+                {
+                    lo = hi;
+                    step *= 2;
+                    hi = lo + step;
+                }
+                if (hi > last) hi = last + 1;
+            }
+            else
+            {
+                if (guess == 0) return 0;
+                hi = guess;
+                size_t step = 1;
+                lo = hi > step ? hi - step : 0;
+                while (lo > 0 && value < x[lo])
+                {
+                    hi = lo;
+                    step *= 2;
+                    lo = hi > step ? hi - step : 0;
+                }
+            }
+
+            // x[lo] <= value < x[hi] (or an end), bisect
+            while (hi - lo > 1)
+            {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (value >= x[mid]) lo = mid;
+                else hi = mid;
+            }
+            return std::min(lo, last);
+        }
+    }
+
+    template <typename T = double>
+    class PiecewiseCubic
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Splines require a floating point type"
+        );
+
+        private:
+            std::vector<T> _x;
+            std::vector<T> _a, _b, _c, _d;   // per interval, structure of arrays for the SIMD evaluation
+            std::vector<T> _cumulative;      // integral from x_0 to every knot
+            bool _uniform = false;
+            T _inverse_step = 0;
+
+            /*
+                On uniform grids the interval comes straight from the position; when rounding puts
+                a point on a knot into the neighbouring interval, that polynomial agrees there to
+                rounding, as the interpolants are continuous
+                NaN goes to interval 0 (a NaN never reaches the size_t conversion) and evaluates to NaN
+            */
+            size_t interval(T value, size_t guess) const
+            {
+                if (_uniform)
+                {
+                    const T last = static_cast<T>(_x.size() - 2);
+                    const T scaled = (value - _x[0]) * _inverse_step;
+                    const T position = scaled >= T(0) ? std::min(scaled, last) : T(0);
+                    return static_cast<size_t>(position);
+                }
+                return detail::hunt(_x.data(), _x.size(), value, guess);
+            }
+
+            T antiderivative(T value, size_t i) const
+            {
+                const T t = value - _x[i];
+                return _cumulative[i] + t * (_a[i] + t * (_b[i] / 2 + t * (_c[i] / 3 + t * _d[i] / 4)));
+            }
+
+            void finish()
+            {
+                const size_t n = _x.size();
+                const T step = (_x[n - 1] - _x[0]) / static_cast<T>(n - 1);
+                const T tolerance = 8 * std::numeric_limits<T>::epsilon() * std::max(std::fabs(_x[0]), std::fabs(_x[n - 1]));
+
+                _uniform = true;
+                for (size_t i = 1; i < n - 1 && _uniform; ++i)
+                {
+                    _uniform = std::fabs(_x[i] - (_x[0] + static_cast<T>(i) * step)) <= tolerance;
+                }
+                _inverse_step = T(1) / step;
+
+                _cumulative.assign(n, T(0));
+                for (size_t i = 0; i + 1 < n; ++i)
+                {
+                    _cumulative[i + 1] = antiderivative(_x[i + 1], i);
+                }
+            }
+
+        public:
+            PiecewiseCubic() = default;
+
+            /*
+                Polynomials a + b t + c t^2 + d t^3 with t = x - x_i on every interval
+                [ x_i, x_i+1 ], the coefficient vectors hold x.size() - 1 entries
+            */
+            PiecewiseCubic(std::vector<T> x, std::vector<T> a, std::vector<T> b, std::vector<T> c, std::vector<T> d)
+                : _x(std::move(x)), _a(std::move(a)), _b(std::move(b)), _c(std::move(c)), _d(std::move(d))
+            {
+                if (_x.size() < 2 || _a.size() != _x.size() - 1 || _b.size() != _a.size() || _c.size() != _a.size() || _d.size() != _a.size())
+                {
+                    throw std::invalid_argument("xi_spline::PiecewiseCubic: need one coefficient per interval and at least two knots");
+                }
+                finish();
+            }
+
+            const std::vector<T>& knots() const { return _x; }
+
+            size_t intervals() const { return _a.size(); }
+
+            bool uniform() const { return _uniform; }
+
+            T operator()(T value) const
+            {
+                const size_t i = interval(value, _x.size() / 2);
+                const T t = value - _x[i];
+                return _a[i] + t * (_b[i] + t * (_c[i] + t * _d[i]));
+            }
+
+            /*
+                [ count ] values at once, large batches are split over the xi_parallel pool
+                Uniform grids compute every interval arithmetically in one vectorized loop, other
+                grids search from the interval of the previous point
+            */
+            void evaluate(const T* values, T* out, size_t count) const
+            {
+                const T *x = _x.data(), *a = _a.data(), *b = _b.data(), *c = _c.data(), *d = _d.data();
+                const T x0 = _x[0], inverse_step = _inverse_step;
+                const T last = static_cast<T>(_x.size() - 2);
+
+                xi_parallel::parallel_for(0, count, 4096, [&](size_t first, size_t end) {
+                    if (_uniform)
+                    {
+                        #pragma omp simd
+                        for (size_t j = first; j < end; ++j)
+                        {
+                            // NaN fails the comparison and takes interval 0, t is NaN then
+                            const T scaled = (values[j] - x0) * inverse_step;
+                            const T position = scaled >= T(0) ? std::min(scaled, last) : T(0);
+                            const size_t i = static_cast<size_t>(position);
+                            const T t = values[j] - x[i];
+                            out[j] = a[i] + t * (b[i] + t * (c[i] + t * d[i]));
+                        }
+                    }
+                    else
+                    {
+                        size_t i = _x.size() / 2;
+                        for (size_t j = first; j < end; ++j)
+                        {
+                            i = detail::hunt(x, _x.size(), values[j], i);
+                            const T t = values[j] - x[i];
+                            out[j] = a[i] + t * (b[i] + t * (c[i] + t * d[i]));
+                        }
+                    }
+                });
+            }
+
+            std::vector<T> operator()(const std::vector<T>& values) const
+            {
+                std::vector<T> out(values.size());
+                evaluate(values.data(), out.data(), values.size());
+                return out;
+            }
+
+            /*
+                Derivative of the given [ order ] as another PiecewiseCubic (exact)
+            */
+            PiecewiseCubic derivative(size_t order = 1) const
+            {
+                PiecewiseCubic p = *this;
+                for (size_t m = 0; m < order; ++m)
+                {
+                    for (size_t i = 0; i < p._a.size(); ++i)
+                    {
+                        p._a[i] = p._b[i];
+                        p._b[i] = 2 * p._c[i];
+                        p._c[i] = 3 * p._d[i];
+                        p._d[i] = 0;
+                    }
+                }
+                p.finish();
+                return p;
+            }
+
+            /*
+                Exact integral over [ lo, hi ] (lo > hi gives the negative), O(log n)
+            */
+            T integral(T lo, T hi) const
+            {
+                const size_t n = _x.size();
+                return antiderivative(hi, interval(hi, n / 2)) - antiderivative(lo, interval(lo, n / 2));
+            }
+
+            /*
+                Exact integral over [ x_0, x_n-1 ], O(1)
+            */
+            T integral() const { return _cumulative.back(); }
+    };
+
+    /*
+        Cubic Hermite interpolant through (x_i, y_i) with slopes dydx_i
+    */
+    template <typename T>
+    inline PiecewiseCubic<T> hermite(const std::vector<T>& x, const std::vector<T>& y, const std::vector<T>& dydx)
+    {
+        detail::check_knots(x, y.size(), 2);
+        if (dydx.size() != x.size())
+        {
+            throw std::invalid_argument("xi_spline::hermite: one slope per point is required");
+        }
+
+        const size_t m = x.size() - 1;
+        std::vector<T> a(m), b(m), c(m), d(m);
+        for (size_t i = 0; i < m; ++i)
+        {
+            const T h = x[i + 1] - x[i];
+            const T delta = (y[i + 1] - y[i]) / h;
+            a[i] = y[i];
+            b[i] = dydx[i];
+            c[i] = (3 * delta - 2 * dydx[i] - dydx[i + 1]) / h;
+            d[i] = (dydx[i] + dydx[i + 1] - 2 * delta) / (h * h);
+        }
+        return PiecewiseCubic<T>(x, std::move(a), std::move(b), std::move(c), std::move(d));
+    }
+
+    template <typename T>
+    inline PiecewiseCubic<T> linear_interpolant(const std::vector<T>& x, const std::vector<T>& y)
+    {
+        detail::check_knots(x, y.size(), 2);
+
+        const size_t m = x.size() - 1;
+        std::vector<T> a(y.begin(), y.end() - 1), b(m), zero(m, T(0));
+        for (size_t i = 0; i < m; ++i)
+        {
+            b[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+        }
+        return PiecewiseCubic<T>(x, std::move(a), std::move(b), zero, zero);
+    }
+
+    /*
+        C2 cubic spline: the knot slopes s solve one tridiagonal system (Thomas algorithm, the
+        matrix is diagonally dominant apart from the not-a-knot rows), O(n)
+        [ start ] and [ end ] are the end slopes of a CLAMPED spline, ignored otherwise
+        Two points give the line (the clamped Hermite cubic), NOT_A_KNOT on three the parabola
+    */
+    template <typename T>
+    inline PiecewiseCubic<T> cubic_spline(const std::vector<T>& x, const std::vector<T>& y,
+                                          Boundary boundary = Boundary::NATURAL, T start = 0, T end = 0)
+    {
+        detail::check_knots(x, y.size(), 2);
+
+        const size_t n = x.size();
+        std::vector<T> h(n - 1), delta(n - 1), slope(n);
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            h[i] = x[i + 1] - x[i];
+            delta[i] = (y[i + 1] - y[i]) / h[i];
+        }
+
+        if (n == 2 && boundary != Boundary::CLAMPED)
+        {
+            return linear_interpolant(x, y);
+        }
+        if (n == 3 && boundary == Boundary::NOT_A_KNOT)
+        {
+            // The parabola through the three points
+            const T curvature = (delta[1] - delta[0]) / (x[2] - x[0]);
+            slope[0] = delta[0] - curvature * h[0];
+            slope[1] = delta[0] + curvature * h[0];
+            slope[2] = delta[1] + curvature * h[1];
+            return hermite(x, y, slope);
+        }
+
+        // Row i: lower[i] s_i-1 + diagonal[i] s_i + upper[i] s_i+1 = rhs[i]
+        std::vector<T> lower(n, T(0)), diagonal(n), upper(n, T(0)), rhs(n);
+        for (size_t i = 1; i + 1 < n; ++i)
+        {
+            lower[i] = h[i];
+            diagonal[i] = 2 * (h[i - 1] + h[i]);
+            upper[i] = h[i - 1];
+            rhs[i] = 3 * (h[i] * delta[i - 1] + h[i - 1] * delta[i]);
+        }
+
+        switch (boundary)
+        {
+            case Boundary::NATURAL:
+                diagonal[0] = 2; upper[0] = 1; rhs[0] = 3 * delta[0];
+                lower[n - 1] = 1; diagonal[n - 1] = 2; rhs[n - 1] = 3 * delta[n - 2];
+                break;
+            case Boundary::CLAMPED:
+                diagonal[0] = 1; upper[0] = 0; rhs[0] = start;
+                lower[n - 1] = 0; diagonal[n - 1] = 1; rhs[n - 1] = end;
+                break;
+            case Boundary::NOT_A_KNOT:
+            {
+                const T d0 = x[2] - x[0];
+                diagonal[0] = h[1];
+                upper[0] = d0;
+                rhs[0] = ((h[0] + 2 * d0) * h[1] * delta[0] + h[0] * h[0] * delta[1]) / d0;
+
+                const T dn = x[n - 1] - x[n - 3];
+                lower[n - 1] = dn;
+                diagonal[n - 1] = h[n - 3];
+                rhs[n - 1] = (h[n - 2] * h[n - 2] * delta[n - 3] + (2 * dn + h[n - 2]) * h[n - 3] * delta[n - 2]) / dn;
+                break;
+            }
+        }
+
+        // Forward elimination and back substitution
+        for (size_t i = 1; i < n; ++i)
+        {
+            const T w = lower[i] / diagonal[i - 1];
+            diagonal[i] -= w * upper[i - 1];
+            rhs[i] -= w * rhs[i - 1];
+        }
+        slope[n - 1] = rhs[n - 1] / diagonal[n - 1];
+        for (size_t i = n - 1; i-- > 0; )
+        {
+            slope[i] = (rhs[i] - upper[i] * slope[i + 1]) / diagonal[i];
+        }
+
+        return hermite(x, y, slope);
+    }
+
+    /*
+        Akima spline: the slope at x_i weights the neighbouring secants by how much the secants
+        on the far side change, so a single outlier only disturbs its own neighbourhood
+        The secants are extended by two linearly extrapolated ones at each end
+    */
+    template <typename T>
+    inline PiecewiseCubic<T> akima(const std::vector<T>& x, const std::vector<T>& y)
+    {
+        detail::check_knots(x, y.size(), 2);
+
+        const size_t n = x.size();
+        if (n == 2)
+        {
+            return linear_interpolant(x, y);
+        }
+
+        // m[j + 2] is the secant of interval j, for j = -2 ... n
+        std::vector<T> m(n + 3);
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            m[i + 2] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+        }
+        m[1] = 2 * m[2] - m[3];
+        m[0] = 2 * m[1] - m[2];
+        m[n + 1] = 2 * m[n] - m[n - 1];
+        m[n + 2] = 2 * m[n + 1] - m[n];
+
+        std::vector<T> slope(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            // Secants m_i-2, m_i-1, m_i, m_i+1 around point i
+            const T w1 = std::fabs(m[i + 3] - m[i + 2]);
+            const T w2 = std::fabs(m[i + 1] - m[i]);
+            slope[i] = w1 + w2 > 0
+                ? (w1 * m[i + 1] + w2 * m[i + 2]) / (w1 + w2)
+                : (m[i + 1] + m[i + 2]) / 2;
+        }
+        return hermite(x, y, slope);
+    }
+
+    /*
+        Piecewise cubic Hermite interpolating polynomial (Fritsch-Carlson with the end
+        conditions of Moler): slopes are weighted harmonic means of the neighbouring secants and
+        zero at local extrema, so monotone data gives a monotone interpolant without overshoot
+    */
+    template <typename T>
+    inline PiecewiseCubic<T> pchip(const std::vector<T>& x, const std::vector<T>& y)
+    {
+        detail::check_knots(x, y.size(), 2);
+
+        const size_t n = x.size();
+        if (n == 2)
+        {
+            return linear_interpolant(x, y);
+        }
+
+        std::vector<T> h(n - 1), delta(n - 1), slope(n);
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            h[i] = x[i + 1] - x[i];
+            delta[i] = (y[i + 1] - y[i]) / h[i];
+        }
+
+        for (size_t i = 1; i + 1 < n; ++i)
+        {
+            if (delta[i - 1] * delta[i] <= 0)
+            {
+                slope[i] = 0;
+            }
+            else
+            {
+                const T w1 = 2 * h[i] + h[i - 1];
+                const T w2 = h[i] + 2 * h[i - 1];
+                slope[i] = (w1 + w2) / (w1 / delta[i - 1] + w2 / delta[i]);
+            }
+        }
+
+        // One sided three point slopes, kept shape preserving
+        auto end_slope = [](T h0, T h1, T d0, T d1) {
+            T s = ((2 * h0 + h1) * d0 - h0 * d1) / (h0 + h1);
+            if ((s > 0) != (d0 > 0) || s == 0 || d0 == 0)
+            {
+                s = 0;
+            }
+            else if ((d0 > 0) != (d1 > 0) && std::fabs(s) > 3 * std::fabs(d0))
+            {
+                s = 3 * d0;
+            }
+            return s;
+        };
+        slope[0] = end_slope(h[0], h[1], delta[0], delta[1]);
+        slope[n - 1] = end_slope(h[n - 2], h[n - 3], delta[n - 2], delta[n - 3]);
+
+        return hermite(x, y, slope);
+    }
+
+    /*
+        B-spline of degree k: sum_j c_j B_j,k(x) over the knot vector t (non-decreasing,
+        t.size() = c.size() + k + 1), evaluated with de Boor's algorithm on [ t_k, t_n ]
+        (outside, the end pieces extrapolate)
+    */
+    template <typename T = double>
+    class BSpline
+    {
+        static_assert(
+            std::is_floating_point<T>::value,
+            "Splines require a floating point type"
+        );
+
+        private:
+            std::vector<T> _t;
+            std::vector<T> _c;
+            size_t _k = 0;
+
+            /*
+                Knot span mu with t_mu <= x < t_mu+1, restricted to k ... n - 1
+            */
+            size_t span(T value, size_t guess) const
+            {
+                const size_t n = _c.size();
+                const size_t mu = detail::hunt(_t.data() + _k, n - _k + 1, value, guess > _k ? guess - _k : 0) + _k;
+                return std::min(std::max(mu, _k), n - 1);
+            }
+
+            T de_boor(T value, size_t mu, std::vector<T>& d) const
+            {
+                d.assign(_c.begin() + (mu - _k), _c.begin() + (mu + 1));
+                for (size_t r = 1; r <= _k; ++r)
+                {
+                    for (size_t j = _k; j >= r; --j)
+                    {
+                        const size_t i = mu - _k + j;
+                        const T denominator = _t[i + _k + 1 - r] - _t[i];
+                        const T alpha = denominator > 0 ? (value - _t[i]) / denominator : T(0);
+                        d[j] = (1 - alpha) * d[j - 1] + alpha * d[j];
+                    }
+                }
+                return d[_k];
+            }
+
+        public:
+            BSpline() = default;
+
+            BSpline(std::vector<T> knots, std::vector<T> coefficients, size_t degree)
+                : _t(std::move(knots)), _c(std::move(coefficients)), _k(degree)
+            {
+                if (_c.size() <= _k || _t.size() != _c.size() + _k + 1)
+                {
+                    throw std::invalid_argument("xi_spline::BSpline: need degree + 1 coefficients and coefficients + degree + 1 knots");
+                }
+                for (size_t i = 1; i < _t.size(); ++i)
+                {
+                    if (_t[i] < _t[i - 1])
+                    {
+                        throw std::invalid_argument("xi_spline::BSpline: knots must be non-decreasing");
+                    }
+                }
+            }
+
+            size_t degree() const { return _k; }
+
+            const std::vector<T>& knots() const { return _t; }
+
+            const std::vector<T>& coefficients() const { return _c; }
+
+            T operator()(T value) const
+            {
+                std::vector<T> d;
+                return de_boor(value, span(value, _c.size() / 2), d);
+            }
+
+            /*
+                [ count ] values, each span search starts from the previous one
+            */
+            void evaluate(const T* values, T* out, size_t count) const
+            {
+                std::vector<T> d(_k + 1);
+                size_t mu = _c.size() / 2;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    mu = span(values[j], mu);
+                    out[j] = de_boor(values[j], mu, d);
+                }
+            }
+
+            std::vector<T> operator()(const std::vector<T>& values) const
+            {
+                std::vector<T> out(values.size());
+                evaluate(values.data(), out.data(), values.size());
+                return out;
+            }
+
+            /*
+                Derivative as a B-spline of degree k - 1 on the inner knots
+            */
+            BSpline derivative() const
+            {
+                if (_k == 0)
+                {
+                    return BSpline(_t, std::vector<T>(_c.size(), T(0)), 0);
+                }
+
+                const size_t n = _c.size();
+                std::vector<T> c(n - 1);
+                for (size_t i = 0; i + 1 < n; ++i)
+                {
+                    const T width = _t[i + _k + 1] - _t[i + 1];
+                    c[i] = width > 0 ? static_cast<T>(_k) * (_c[i + 1] - _c[i]) / width : T(0);
+                }
+                return BSpline(std::vector<T>(_t.begin() + 1, _t.end() - 1), std::move(c), _k - 1);
+            }
+
+            /*
+                Antiderivative vanishing at t_0, a B-spline of degree k + 1
+            */
+            BSpline antiderivative() const
+            {
+                const size_t n = _c.size();
+                std::vector<T> c(n + 1, T(0));
+                for (size_t i = 0; i < n; ++i)
+                {
+                    c[i + 1] = c[i] + _c[i] * (_t[i + _k + 1] - _t[i]) / static_cast<T>(_k + 1);
+                }
+
+                std::vector<T> t;
+                t.reserve(_t.size() + 2);
+                t.push_back(_t.front());
+                t.insert(t.end(), _t.begin(), _t.end());
+                t.push_back(_t.back());
+                return BSpline(std::move(t), std::move(c), _k + 1);
+            }
+
+            /*
+                Exact integral over [ lo, hi ] inside [ t_k, t_n ], O(n) for the antiderivative
+            */
+            T integral(T lo, T hi) const
+            {
+                const BSpline F = antiderivative();
+                return F(hi) - F(lo);
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            The k + 1 B-splines of degree k that are non-zero on span mu, evaluated at x
+            (Piegl & Tiller A2.2), basis[j] belongs to B_mu-k+j
+        */
+        template <typename T>
+        inline void basis_functions(const std::vector<T>& t, size_t k, size_t mu, T value, std::vector<T>& basis)
+        {
+            std::vector<T> left(k + 1), right(k + 1);
+            basis.assign(k + 1, T(0));
+            basis[0] = 1;
+
+            for (size_t j = 1; j <= k; ++j)
+            {
+                left[j] = value - t[mu + 1 - j];
+                right[j] = t[mu + j] - value;
+                T saved = 0;
+                for (size_t r = 0; r < j; ++r)
+                {
+                    const T temp = basis[r] / (right[r + 1] + left[j - r]);
+                    basis[r] = saved + right[r + 1] * temp;
+                    saved = left[j - r] * temp;
+                }
+                basis[j] = saved;
+            }
+        }
+    }
+
+    /*
+        B-spline of [ degree ] through (x_i, y_i) with the not-a-knot knot vector: degree + 1 fold
+        end knots and the interior data points (midpoints between them for even degrees) as knots
+        The collocation matrix is banded with bandwidth degree and totally positive, so it is
+        eliminated without pivoting in O(n degree^2)
+    */
+    template <typename T>
+    inline BSpline<T> interpolating_bspline(const std::vector<T>& x, const std::vector<T>& y, size_t degree = 3)
+    {
+        detail::check_knots(x, y.size(), degree + 1);
+
+        const size_t n = x.size();
+        const size_t k = degree;
+
+        std::vector<T> t(k + 1, x.front());
+        if (k % 2 == 1)
+        {
+            for (size_t j = (k + 1) / 2; j + (k + 1) / 2 < n; ++j) t.push_back(x[j]);
+        }
+        else
+        {
+            for (size_t j = k / 2; j + k / 2 + 1 < n; ++j) t.push_back((x[j] + x[j + 1]) / 2);
+        }
+        t.insert(t.end(), k + 1, x.back());
+
+        // Band storage, row i keeps columns i - k ... i + k at band[i * width + (j - i + k)]
+        const size_t width = 2 * k + 1;
+        std::vector<T> band(n * width, T(0)), basis, c(y.begin(), y.end());
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t mu = detail::hunt(t.data() + k, n - k + 1, x[i], 0) + k;
+            mu = std::min(std::max(mu, k), n - 1);
+            detail::basis_functions(t, k, mu, x[i], basis);
+
+            for (size_t r = 0; r <= k; ++r)
+            {
+                const size_t j = mu - k + r;
+                if (j + k < i || j > i + k)
+                {
+                    throw std::invalid_argument("xi_spline::interpolating_bspline: data points violate the Schoenberg-Whitney condition");
+                }
+                band[i * width + (j + k - i)] = basis[r];
+            }
+        }
+
+        auto at = [&](size_t i, size_t j) -> T& { return band[i * width + (j + k - i)]; };
+
+        for (size_t p = 0; p < n; ++p)
+        {
+            const T pivot = at(p, p);
+            if (pivot == 0)
+            {
+                throw std::runtime_error("xi_spline::interpolating_bspline: singular collocation matrix");
+            }
+            for (size_t i = p + 1; i <= std::min(n - 1, p + k); ++i)
+            {
+                const T w = at(i, p) / pivot;
+                if (w == 0) continue;
+                for (size_t j = p; j <= std::min(n - 1, p + k); ++j)
+                {
+                    at(i, j) -= w * at(p, j);
+                }
+                c[i] -= w * c[p];
+            }
+        }
+        for (size_t i = n; i-- > 0; )
+        {
+            T sum = c[i];
+            for (size_t j = i + 1; j <= std::min(n - 1, i + k); ++j)
+            {
+                sum -= at(i, j) * c[j];
+            }
+            c[i] = sum / at(i, i);
+        }
+
+        return BSpline<T>(std::move(t), std::move(c), k);
+    }
+}
+
+#endif
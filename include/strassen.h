@@ -0,0 +1,335 @@
+#ifndef XI_STRASSEN
+#define XI_STRASSEN
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+#include "parallel.h"
+
+/*
+    Strassen-Winograd matrix products for very large matrices
+
+    strassen_multiply(a, b, out) splits the operands into 2 x 2 blocks and forms the product
+    from 7 block products and 15 block additions instead of 8 products, recursively, until the
+    smallest dimension drops to the crossover where the conventional kernel (xi_matrix::multiply)
+    takes over. Odd dimensions are peeled off and fixed up with conventional products
+
+        xi_matrix::StrassenOptions options;
+        options.crossover = 1024;
+        auto C = xi_matrix::strassen_multiply(A, B, options);
+
+    Parallelism: the 7 block products of the top levels run as xi_parallel tasks (enough
+    levels to give every worker a product), every deeper level runs sequentially and leaves
+    parallelism to the conventional kernel at the bottom
+
+    Memory: a sequential level needs two scratch blocks, a quarter of an operand each, and the
+    levels below reuse a quarter of that again, so all sequential levels together stay under
+    (m * max(k, n) + k * n) / 3 elements. A parallel level keeps its 8 operand sums and 3 of its
+    7 products alive at once, about 2.75 times the size of one operand for square matrices
+
+    Accuracy: the conventional product satisfies the componentwise bound
+        | C - fl(A B) | <= k u |A| |B|
+    Strassen-Winograd only satisfies a normwise one (Higham, Accuracy and Stability of
+    Numerical Algorithms, 2nd ed., section 23.2.2), with M(X) = max |x_ij|, u the unit roundoff
+    and n0 the size at which the recursion stops:
+        M(C - fl(A B)) <= [ (n / n0)^log2(18) (n0^2 + 6 n0) - 6 n ] u M(A) M(B) + O(u^2)
+    Small elements of C are therefore only accurate relative to the largest elements of A and B,
+    and every extra recursion level multiplies the bound by about 4.5 (a little over 2 bits), which
+    a larger crossover gives back. Prefer the conventional product when rows or columns of the
+    operands differ greatly in scale
+*/
+namespace xi_matrix
+{
+    struct StrassenOptions
+    {
+        /*
+            Matrices whose smallest dimension is at or below this size use the conventional kernel
+        */
+        size_t crossover = 512;
+
+        /*
+            Number of recursion levels whose 7 products run in parallel, -1 picks the smallest
+            depth that gives every worker of the xi_parallel pool a product to compute
+        */
+        int parallel_depth = -1;
+    };
+
+    namespace detail
+    {
+        template <typename T, typename U, typename R>
+        inline void strassen(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> c,
+                             const StrassenOptions& options, size_t depth, size_t parallel_depth);
+
+        template <typename R>
+        inline MatrixView<R> scratch_view(std::vector<R>& buffer, size_t offset, size_t rows, size_t cols)
+        {
+            return MatrixView<R>(buffer.data() + offset, rows, cols, static_cast<std::ptrdiff_t>(cols));
+        }
+
+        template <typename R>
+        inline std::vector<R> scratch_buffer(size_t size)
+        {
+            XI_COUNT(MATRIX, ALLOCATIONS, 1);
+            XI_COUNT(MATRIX, ALLOCATED_BYTES, size * sizeof(R));
+            return std::vector<R>(size);
+        }
+
+        template <typename T, typename U, typename R>
+        inline void block_add(ConstMatrixView<T> x, ConstMatrixView<U> y, MatrixView<R> out)
+        {
+            elementwise(x, y, out, std::plus<>());
+        }
+
+        template <typename T, typename U, typename R>
+        inline void block_sub(ConstMatrixView<T> x, ConstMatrixView<U> y, MatrixView<R> out)
+        {
+            elementwise(x, y, out, std::minus<>());
+        }
+
+        /*
+            One level with the 7 products computed one after the other (Boyer, Dumas, Pernet and
+            Zhou, "Memory efficient scheduling of Strassen-Winograd's matrix multiplication
+            algorithm", 2009): the products land in the quadrants of [ c ] and are combined in place,
+            X and Y are the only scratch blocks
+        */
+        template <typename T, typename U, typename R>
+        inline void strassen_sequential(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> c,
+                                        const StrassenOptions& options, size_t depth, size_t parallel_depth)
+        {
+            const size_t m2 = a.rows() / 2;
+            const size_t k2 = a.cols() / 2;
+            const size_t n2 = b.cols() / 2;
+
+            auto a11 = a.block(0, 0, m2, k2), a12 = a.block(0, k2, m2, k2);
+            auto a21 = a.block(m2, 0, m2, k2), a22 = a.block(m2, k2, m2, k2);
+            auto b11 = b.block(0, 0, k2, n2), b12 = b.block(0, n2, k2, n2);
+            auto b21 = b.block(k2, 0, k2, n2), b22 = b.block(k2, n2, k2, n2);
+            auto c11 = c.block(0, 0, m2, n2), c12 = c.block(0, n2, m2, n2);
+            auto c21 = c.block(m2, 0, m2, n2), c22 = c.block(m2, n2, m2, n2);
+
+            std::vector<R> buffer = scratch_buffer<R>(m2 * std::max(k2, n2) + k2 * n2);
+            MatrixView<R> xs = scratch_view(buffer, 0, m2, k2);
+            MatrixView<R> xp = scratch_view(buffer, 0, m2, n2);
+            MatrixView<R> y = scratch_view(buffer, m2 * std::max(k2, n2), k2, n2);
+
+            auto recurse = [&](auto x, auto z, MatrixView<R> out) {
+                strassen(as_view(x), as_view(z), out, options, depth + 1, parallel_depth);
+            };
+
+            block_sub(a11, a21, xs);                // S3
+            block_sub(b22, b12, y);                 // T3
+            recurse(xs, y, c21);                    // P7 = S3 T3
+            block_add(a21, a22, xs);                // S1
+            block_sub(b12, b11, y);                 // T1
+            recurse(xs, y, c22);                    // P5 = S1 T1
+            block_sub(xs.as_const(), a11, xs);      // S2 = S1 - A11
+            block_sub(b22, y.as_const(), y);        // T2 = B22 - T1
+            recurse(xs, y, c12);                    // P6 = S2 T2
+            block_sub(a12, xs.as_const(), xs);      // S4 = A12 - S2
+            recurse(xs, b22, c11);                  // P3 = S4 B22
+            recurse(a11, b11, xp);                  // P1
+
+            block_add(xp.as_const(), c12.as_const(), c12);  // U2 = P1 + P6
+            block_add(c12.as_const(), c21.as_const(), c21); // U3 = U2 + P7
+            block_add(c12.as_const(), c22.as_const(), c12); // U4 = U2 + P5
+            block_add(c21.as_const(), c22.as_const(), c22); // U7 = U3 + P5   -> C22
+            block_add(c12.as_const(), c11.as_const(), c12); // U5 = U4 + P3   -> C12
+
+            block_sub(y.as_const(), b21, y);                // T4 = T2 - B21
+            recurse(a22, y, c11);                           // P4 = A22 T4
+            block_sub(c21.as_const(), c11.as_const(), c21); // U6 = U3 - P4   -> C21
+            recurse(a12, b21, c11);                         // P2
+            block_add(xp.as_const(), c11.as_const(), c11);  // U1 = P1 + P2   -> C11
+        }
+
+        /*
+            One level with all 7 products running as tasks, every product needs its own operands
+            so all 8 operand sums are formed up front and 3 products get scratch blocks of their own
+        */
+        template <typename T, typename U, typename R>
+        inline void strassen_parallel(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> c,
+                                      const StrassenOptions& options, size_t depth, size_t parallel_depth)
+        {
+            const size_t m2 = a.rows() / 2;
+            const size_t k2 = a.cols() / 2;
+            const size_t n2 = b.cols() / 2;
+
+            auto a11 = a.block(0, 0, m2, k2), a12 = a.block(0, k2, m2, k2);
+            auto a21 = a.block(m2, 0, m2, k2), a22 = a.block(m2, k2, m2, k2);
+            auto b11 = b.block(0, 0, k2, n2), b12 = b.block(0, n2, k2, n2);
+            auto b21 = b.block(k2, 0, k2, n2), b22 = b.block(k2, n2, k2, n2);
+            auto c11 = c.block(0, 0, m2, n2), c12 = c.block(0, n2, m2, n2);
+            auto c21 = c.block(m2, 0, m2, n2), c22 = c.block(m2, n2, m2, n2);
+
+            const size_t sa = m2 * k2, sb = k2 * n2, sc = m2 * n2;
+            std::vector<R> buffer = scratch_buffer<R>(4 * sa + 4 * sb + 3 * sc);
+            MatrixView<R> s1 = scratch_view(buffer, 0, m2, k2), s2 = scratch_view(buffer, sa, m2, k2);
+            MatrixView<R> s3 = scratch_view(buffer, 2 * sa, m2, k2), s4 = scratch_view(buffer, 3 * sa, m2, k2);
+            MatrixView<R> t1 = scratch_view(buffer, 4 * sa, k2, n2), t2 = scratch_view(buffer, 4 * sa + sb, k2, n2);
+            MatrixView<R> t3 = scratch_view(buffer, 4 * sa + 2 * sb, k2, n2), t4 = scratch_view(buffer, 4 * sa + 3 * sb, k2, n2);
+            MatrixView<R> p1 = scratch_view(buffer, 4 * sa + 4 * sb, m2, n2);
+            MatrixView<R> p2 = scratch_view(buffer, 4 * sa + 4 * sb + sc, m2, n2);
+            MatrixView<R> p4 = scratch_view(buffer, 4 * sa + 4 * sb + 2 * sc, m2, n2);
+
+            block_add(a21, a22, s1);
+            block_sub(s1.as_const(), a11, s2);
+            block_sub(a11, a21, s3);
+            block_sub(a12, s2.as_const(), s4);
+            block_sub(b12, b11, t1);
+            block_sub(b22, t1.as_const(), t2);
+            block_sub(b22, b12, t3);
+            block_sub(t2.as_const(), b21, t4);
+
+            {
+                xi_parallel::TaskGroup group;
+                auto spawn = [&](auto x, auto z, MatrixView<R> out) {
+                    group.run([=, &options] {
+                        strassen(as_view(x), as_view(z), out, options, depth + 1, parallel_depth);
+                    });
+                };
+
+                spawn(a11, b11, p1);
+                spawn(a12, b21, p2);
+                spawn(s4, b22, c11);    // P3
+                spawn(a22, t4, p4);
+                spawn(s1, t1, c22);     // P5
+                spawn(s2, t2, c12);     // P6
+                spawn(s3, t3, c21);     // P7
+                group.wait();
+            }
+
+            block_add(p1.as_const(), c12.as_const(), c12);  // U2 = P1 + P6
+            block_add(c12.as_const(), c21.as_const(), c21); // U3 = U2 + P7
+            block_add(c12.as_const(), c22.as_const(), c12); // U4 = U2 + P5
+            block_add(c21.as_const(), c22.as_const(), c22); // U7 = U3 + P5   -> C22
+            block_add(c12.as_const(), c11.as_const(), c12); // U5 = U4 + P3   -> C12
+            block_sub(c21.as_const(), p4.as_const(), c21);  // U6 = U3 - P4   -> C21
+            block_add(p1.as_const(), p2.as_const(), c11);   // U1 = P1 + P2   -> C11
+        }
+
+        /*
+            c = a * b, recursing on the even leading part of every dimension and fixing up
+            the odd last row / column / inner index with conventional products
+        */
+        template <typename T, typename U, typename R>
+        inline void strassen(ConstMatrixView<T> a, ConstMatrixView<U> b, MatrixView<R> c,
+                             const StrassenOptions& options, size_t depth, size_t parallel_depth)
+        {
+            const size_t m = a.rows();
+            const size_t k = a.cols();
+            const size_t n = b.cols();
+
+            if (std::min({ m, k, n }) <= std::max<size_t>(options.crossover, 1))
+            {
+                gemm(a, b, c);
+                return;
+            }
+
+            const size_t me = m & ~size_t(1);
+            const size_t ke = k & ~size_t(1);
+            const size_t ne = n & ~size_t(1);
+
+            auto ae = a.block(0, 0, me, ke);
+            auto be = b.block(0, 0, ke, ne);
+            auto ce = c.block(0, 0, me, ne);
+            if (depth < parallel_depth)
+            {
+                strassen_parallel(ae, be, ce, options, depth, parallel_depth);
+            }
+            else
+            {
+                strassen_sequential(ae, be, ce, options, depth, parallel_depth);
+            }
+
+            if (k != ke)
+            {
+                // rank one update with the last column of a and the last row of b
+                const T* pa = a.data() + static_cast<std::ptrdiff_t>(ke) * a.col_stride();
+                const U* pb = b.data() + static_cast<std::ptrdiff_t>(ke) * b.row_stride();
+                xi_parallel::parallel_for(0, me, std::max<size_t>(1, parallel_threshold / ne), [&](size_t first, size_t last) {
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        const R ai = static_cast<R>(pa[static_cast<std::ptrdiff_t>(i) * a.row_stride()]);
+                        R* pc = c.data() + static_cast<std::ptrdiff_t>(i) * c.row_stride();
+                        for (size_t j = 0; j < ne; ++j)
+                        {
+                            const std::ptrdiff_t jj = static_cast<std::ptrdiff_t>(j);
+                            pc[jj * c.col_stride()] += ai * static_cast<R>(pb[jj * b.col_stride()]);
+                        }
+                    }
+                });
+                XI_COUNT(MATRIX, FLOPS, 2 * me * ne);
+            }
+
+            if (n != ne)
+            {
+                gemm(a, b.block(0, ne, k, 1), c.block(0, ne, m, 1));
+            }
+
+            if (m != me)
+            {
+                gemm(a.block(me, 0, 1, k), b.block(0, 0, k, ne), c.block(me, 0, 1, ne));
+            }
+        }
+
+        /*
+            Smallest depth whose 7^depth parallel products cover every worker of the pool
+        */
+        inline size_t strassen_parallel_depth(const StrassenOptions& options)
+        {
+            if (options.parallel_depth >= 0) return static_cast<size_t>(options.parallel_depth);
+
+            const size_t workers = xi_parallel::concurrency();
+            size_t depth = 0;
+            for (size_t tasks = 1; tasks < workers; tasks *= 7)
+            {
+                ++depth;
+            }
+            return depth;
+        }
+    }
+
+    /*
+        out = a * b with Strassen-Winograd recursion above [ options.crossover ],
+        [ out ] must not overlap [ a ] or [ b ]
+        Floating point element types only, see the accuracy notes at the top of this file
+    */
+    template <typename A, typename B, typename Out>
+    inline std::enable_if_t<
+        detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value &&
+        detail::is_matrix_like<std::decay_t<Out>>::value>
+    strassen_multiply(const A& a, const B& b, Out&& out, const StrassenOptions& options = StrassenOptions())
+    {
+        auto va = detail::as_view(a);
+        auto vb = detail::as_view(b);
+        auto vo = detail::as_mutable_view(out);
+        using R = typename decltype(vo)::value_type;
+
+        static_assert(std::is_floating_point<R>::value, "Strassen multiplication requires a floating point result type");
+        assert(
+            va.cols() == vb.rows() && vo.rows() == va.rows() && vo.cols() == vb.cols() &&
+            "Matrix dimensions must match up for multiplication"
+        );
+
+        XI_TIME_CALL(MATRIX);
+        detail::strassen(va, vb, vo, options, 0, detail::strassen_parallel_depth(options));
+    }
+
+    template <typename A, typename B, typename = std::enable_if_t<detail::is_matrix_like<A>::value && detail::is_matrix_like<B>::value>>
+    inline xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>>
+    strassen_multiply(const A& a, const B& b, const StrassenOptions& options = StrassenOptions())
+    {
+        xi_matrix::Matrix_Numerical<std::common_type_t<detail::value_type_t<A>, detail::value_type_t<B>>> result(
+            detail::as_view(a).rows(), detail::as_view(b).cols()
+        );
+        strassen_multiply(a, b, result, options);
+        return result;
+    }
+}
+
+#endif
@@ -0,0 +1,887 @@
+#ifndef XI_STRUCTURED
+#define XI_STRUCTURED
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+
+/*
+    Matrices that store only their meaningful entries
+
+        DiagonalMatrix<T>(n)                    n values
+        BandedMatrix<T>(n, lower, upper)        n (lower + upper + 1) values, e.g. finite difference operators
+        SymmetricMatrix<T>(n)                   packed lower triangle, n (n + 1) / 2 values, e.g. covariances
+        TriangularMatrix<T>(n, Triangle)        packed triangle, n (n + 1) / 2 values
+
+    Every type offers at(i, j), multiply / operator* with a std::vector or any matrix-like
+    operand (Matrix_Numerical, MatrixView, ConstMatrixView), solve for a std::vector or in place
+    for the columns of a MatrixView, det() and to_dense()
+
+        Diagonal        multiply O(n), solve O(n), det O(n)
+        Banded          multiply O(n b), LU with partial pivoting O(n b^2), solve O(n b) per column
+        Symmetric       multiply O(n^2) over half the memory, Cholesky O(n^3 / 6)
+        Triangular      multiply O(n^2 / 2), substitution O(n^2 / 2), det O(n)
+
+    Singular systems make solve throw std::runtime_error, det() returns 0 for them
+*/
+namespace xi_matrix
+{
+    enum class Triangle
+    {
+        LOWER,
+        UPPER
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        inline void check_structured_type()
+        {
+            static_assert(
+                std::is_floating_point<T>::value,
+                "Structured matrices require a floating point element type"
+            );
+        }
+
+        /*
+            Applies solve_one(column) to every column of [ b ], each copied into a contiguous
+            buffer first
+        */
+        template <typename T, typename Solve>
+        inline void solve_columns(MatrixView<T> b, Solve&& solve_one)
+        {
+            std::vector<T> column(b.rows());
+            for (size_t j = 0; j < b.cols(); ++j)
+            {
+                for (size_t i = 0; i < b.rows(); ++i) column[i] = b(i, j);
+                solve_one(column.data());
+                for (size_t i = 0; i < b.rows(); ++i) b(i, j) = column[i];
+            }
+        }
+
+        /*
+            out = A b for a structured A given as multiply_one(x, y), column by column
+        */
+        template <typename T, typename Multiply>
+        inline Matrix_Numerical<T> multiply_columns(size_t rows, ConstMatrixView<T> b, Multiply&& multiply_one)
+        {
+            Matrix_Numerical<T> out(rows, b.cols());
+            std::vector<T> x(b.rows()), y(rows);
+            for (size_t j = 0; j < b.cols(); ++j)
+            {
+                for (size_t i = 0; i < b.rows(); ++i) x[i] = b(i, j);
+                multiply_one(x.data(), y.data());
+                for (size_t i = 0; i < rows; ++i) out(i, j) = y[i];
+            }
+            return out;
+        }
+    }
+
+    template <typename T = long double>
+    class DiagonalMatrix
+    {
+        private:
+            std::vector<T> _d;
+
+        public:
+            explicit DiagonalMatrix(size_t n, T value = T(0)) : _d(n, value)
+            {
+                detail::check_structured_type<T>();
+            }
+
+            explicit DiagonalMatrix(std::vector<T> diagonal) : _d(std::move(diagonal))
+            {
+                detail::check_structured_type<T>();
+            }
+
+            size_t rows() const { return _d.size(); }
+
+            size_t cols() const { return _d.size(); }
+
+            /*
+                Number of stored elements
+            */
+            size_t storage() const { return _d.size(); }
+
+            T at(size_t i, size_t j) const
+            {
+                if (i >= _d.size() || j >= _d.size())
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return i == j ? _d[i] : T(0);
+            }
+
+            T& operator()(size_t i)
+            {
+                assert(i < _d.size() && "Index out of bounds");
+                return _d[i];
+            }
+
+            const std::vector<T>& diagonal() const { return _d; }
+
+            std::vector<T> multiply(const std::vector<T>& x) const
+            {
+                assert(x.size() == _d.size() && "Vector length must match the matrix size");
+                std::vector<T> y(x.size());
+                for (size_t i = 0; i < x.size(); ++i) y[i] = _d[i] * x[i];
+                return y;
+            }
+
+            /*
+                Scales row i of [ b ] by d_i
+            */
+            Matrix_Numerical<T> multiply(ConstMatrixView<T> b) const
+            {
+                assert(b.rows() == _d.size() && "Matrix dimensions must match up for multiplication");
+                Matrix_Numerical<T> out(b.rows(), b.cols());
+                for (size_t i = 0; i < b.rows(); ++i)
+                {
+                    for (size_t j = 0; j < b.cols(); ++j) out(i, j) = _d[i] * b(i, j);
+                }
+                return out;
+            }
+
+            std::vector<T> operator*(const std::vector<T>& x) const { return multiply(x); }
+
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            Matrix_Numerical<T> operator*(const M& b) const { return multiply(ConstMatrixView<T>(detail::as_view(b))); }
+
+            void solve(MatrixView<T> b) const
+            {
+                assert(b.rows() == _d.size() && "Right hand side must have as many rows as the matrix");
+                for (size_t i = 0; i < _d.size(); ++i)
+                {
+                    if (_d[i] == T(0))
+                    {
+                        throw std::runtime_error("xi_matrix::DiagonalMatrix::solve: matrix is singular");
+                    }
+                    for (size_t j = 0; j < b.cols(); ++j) b(i, j) /= _d[i];
+                }
+            }
+
+            std::vector<T> solve(std::vector<T> b) const
+            {
+                solve(MatrixView<T>(b.data(), b.size(), 1, 1));
+                return b;
+            }
+
+            T det() const
+            {
+                T result = 1;
+                for (T d : _d) result *= d;
+                return result;
+            }
+
+            DiagonalMatrix inverse() const
+            {
+                std::vector<T> inv(_d.size());
+                for (size_t i = 0; i < _d.size(); ++i)
+                {
+                    if (_d[i] == T(0))
+                    {
+                        throw std::runtime_error("xi_matrix::DiagonalMatrix::inverse: matrix is singular");
+                    }
+                    inv[i] = T(1) / _d[i];
+                }
+                return DiagonalMatrix(std::move(inv));
+            }
+
+            Matrix_Numerical<T> to_dense() const
+            {
+                Matrix_Numerical<T> out(_d.size(), _d.size(), T(0));
+                for (size_t i = 0; i < _d.size(); ++i) out(i, i) = _d[i];
+                return out;
+            }
+    };
+
+    template <typename T>
+    class BandedMatrix;
+
+    /*
+        LU factorization with partial pivoting of a banded matrix (as LAPACK gbtrf): U gains
+        up to [ lower ] extra superdiagonals from the row swaps, L keeps its multipliers in
+        the rows they were computed in and the swaps are replayed during the solve
+    */
+    template <typename T = long double>
+    class BandedLU
+    {
+        friend class BandedMatrix<T>;
+
+        private:
+            size_t _n = 0, _lower = 0, _upper = 0, _width = 1;
+            std::vector<T> _band;           // row i holds columns i - lower ... i + lower + upper
+            std::vector<size_t> _pivots;
+            int _sign = 1;                  // 0 when singular
+
+            T& el(size_t i, size_t j) { return _band[i * _width + (j + _lower - i)]; }
+
+            const T& el(size_t i, size_t j) const { return _band[i * _width + (j + _lower - i)]; }
+
+        public:
+            size_t size() const { return _n; }
+
+            bool singular() const { return _sign == 0; }
+
+            T det() const
+            {
+                if (_sign == 0) return T(0);
+                T result = static_cast<T>(_sign);
+                for (size_t i = 0; i < _n; ++i) result *= el(i, i);
+                return result;
+            }
+
+            void solve(MatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Right hand side must have as many rows as the matrix");
+                if (_sign == 0)
+                {
+                    throw std::runtime_error("xi_matrix::BandedMatrix::solve: matrix is singular");
+                }
+
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * (2 * _lower + _upper + 1) * b.cols());
+
+                const size_t reach = _lower + _upper;
+                detail::solve_columns(b, [&](T* x) {
+                    for (size_t p = 0; p < _n; ++p)
+                    {
+                        std::swap(x[p], x[_pivots[p]]);
+                        const size_t last = std::min(_n - 1, p + _lower);
+                        for (size_t i = p + 1; i <= last; ++i) x[i] -= el(i, p) * x[p];
+                    }
+                    for (size_t i = _n; i-- > 0; )
+                    {
+                        T sum = x[i];
+                        const size_t last = std::min(_n - 1, i + reach);
+                        for (size_t j = i + 1; j <= last; ++j) sum -= el(i, j) * x[j];
+                        x[i] = sum / el(i, i);
+                    }
+                });
+            }
+
+            std::vector<T> solve(std::vector<T> b) const
+            {
+                solve(MatrixView<T>(b.data(), b.size(), 1, 1));
+                return b;
+            }
+    };
+
+    /*
+        Square matrix with [ lower ] sub- and [ upper ] superdiagonals, row i stores the columns
+        i - lower ... i + upper
+    */
+    template <typename T = long double>
+    class BandedMatrix
+    {
+        private:
+            size_t _n, _lower, _upper, _width;
+            std::vector<T> _band;
+
+            bool in_band(size_t i, size_t j) const { return j + _lower >= i && j <= i + _upper; }
+
+        public:
+            BandedMatrix(size_t n, size_t lower, size_t upper)
+                : _n(n), _lower(lower), _upper(upper), _width(lower + upper + 1), _band(n * (lower + upper + 1), T(0))
+            {
+                detail::check_structured_type<T>();
+            }
+
+            /*
+                The band of a dense square matrix, entries outside it are dropped
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            static BandedMatrix from_dense(const M& m, size_t lower, size_t upper)
+            {
+                auto v = detail::as_view(m);
+                assert(v.rows() == v.cols() && "Banded matrices are square");
+
+                BandedMatrix out(v.rows(), lower, upper);
+                for (size_t i = 0; i < v.rows(); ++i)
+                {
+                    const size_t first = i > lower ? i - lower : 0;
+                    const size_t last = std::min(v.cols() - 1, i + upper);
+                    for (size_t j = first; j <= last; ++j) out(i, j) = static_cast<T>(v(i, j));
+                }
+                return out;
+            }
+
+            size_t rows() const { return _n; }
+
+            size_t cols() const { return _n; }
+
+            size_t lower() const { return _lower; }
+
+            size_t upper() const { return _upper; }
+
+            size_t storage() const { return _band.size(); }
+
+            T at(size_t i, size_t j) const
+            {
+                if (i >= _n || j >= _n)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return in_band(i, j) ? _band[i * _width + (j + _lower - i)] : T(0);
+            }
+
+            /*
+                Element inside the band
+            */
+            T& operator()(size_t i, size_t j)
+            {
+                if (i >= _n || j >= _n || !in_band(i, j))
+                {
+                    throw std::out_of_range("Index outside the band");
+                }
+                return _band[i * _width + (j + _lower - i)];
+            }
+
+            std::vector<T> multiply(const std::vector<T>& x) const
+            {
+                assert(x.size() == _n && "Vector length must match the matrix size");
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * _width);
+
+                std::vector<T> y(_n);
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    const size_t first = i > _lower ? i - _lower : 0;
+                    const size_t last = std::min(_n - 1, i + _upper);
+                    const T* row = _band.data() + i * _width + (first + _lower - i);
+                    T sum = 0;
+                    for (size_t j = first; j <= last; ++j) sum += row[j - first] * x[j];
+                    y[i] = sum;
+                }
+                return y;
+            }
+
+            Matrix_Numerical<T> multiply(ConstMatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Matrix dimensions must match up for multiplication");
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * _width * b.cols());
+
+                Matrix_Numerical<T> out(_n, b.cols(), T(0));
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    const size_t first = i > _lower ? i - _lower : 0;
+                    const size_t last = std::min(_n - 1, i + _upper);
+                    for (size_t j = first; j <= last; ++j)
+                    {
+                        const T a = _band[i * _width + (j + _lower - i)];
+                        for (size_t k = 0; k < b.cols(); ++k) out(i, k) += a * b(j, k);
+                    }
+                }
+                return out;
+            }
+
+            std::vector<T> operator*(const std::vector<T>& x) const { return multiply(x); }
+
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            Matrix_Numerical<T> operator*(const M& b) const { return multiply(ConstMatrixView<T>(detail::as_view(b))); }
+
+            /*
+                O(n lower (lower + upper)) factorization, reusable for many right hand sides
+            */
+            BandedLU<T> factor() const
+            {
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * _lower * (_lower + _upper + 1));
+
+                BandedLU<T> lu;
+                lu._n = _n;
+                lu._lower = _lower;
+                lu._upper = _upper;
+                lu._width = 2 * _lower + _upper + 1;
+                lu._band.assign(_n * lu._width, T(0));
+                lu._pivots.resize(_n);
+
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    const size_t first = i > _lower ? i - _lower : 0;
+                    const size_t last = std::min(_n - 1, i + _upper);
+                    for (size_t j = first; j <= last; ++j) lu.el(i, j) = _band[i * _width + (j + _lower - i)];
+                }
+
+                const size_t reach = _lower + _upper;
+                for (size_t p = 0; p < _n; ++p)
+                {
+                    const size_t rows_end = std::min(_n - 1, p + _lower);
+                    const size_t cols_end = std::min(_n - 1, p + reach);
+
+                    size_t pivot = p;
+                    T largest = std::abs(lu.el(p, p));
+                    for (size_t i = p + 1; i <= rows_end; ++i)
+                    {
+                        if (std::abs(lu.el(i, p)) > largest)
+                        {
+                            largest = std::abs(lu.el(i, p));
+                            pivot = i;
+                        }
+                    }
+
+                    lu._pivots[p] = pivot;
+                    if (largest == T(0))
+                    {
+                        lu._sign = 0;
+                        continue;
+                    }
+                    if (pivot != p)
+                    {
+                        for (size_t j = p; j <= cols_end; ++j) std::swap(lu.el(p, j), lu.el(pivot, j));
+                        lu._sign = -lu._sign;
+                    }
+
+                    const T inv = T(1) / lu.el(p, p);
+                    for (size_t i = p + 1; i <= rows_end; ++i)
+                    {
+                        T& l = lu.el(i, p);
+                        l *= inv;
+                        if (l == T(0)) continue;
+                        for (size_t j = p + 1; j <= cols_end; ++j) lu.el(i, j) -= l * lu.el(p, j);
+                    }
+                }
+                return lu;
+            }
+
+            void solve(MatrixView<T> b) const { factor().solve(b); }
+
+            std::vector<T> solve(std::vector<T> b) const { return factor().solve(std::move(b)); }
+
+            T det() const { return factor().det(); }
+
+            Matrix_Numerical<T> to_dense() const
+            {
+                Matrix_Numerical<T> out(_n, _n, T(0));
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    for (size_t j = 0; j < _n; ++j)
+                    {
+                        if (in_band(i, j)) out(i, j) = _band[i * _width + (j + _lower - i)];
+                    }
+                }
+                return out;
+            }
+    };
+
+    /*
+        Triangular matrix packed by rows: LOWER row i holds columns 0 ... i, UPPER row i holds
+        columns i ... n - 1
+    */
+    template <typename T>
+    class SymmetricMatrix;
+
+    template <typename T = long double>
+    class TriangularMatrix
+    {
+        friend class SymmetricMatrix<T>;
+
+        private:
+            size_t _n;
+            Triangle _triangle;
+            std::vector<T> _packed;
+
+            bool inside(size_t i, size_t j) const { return _triangle == Triangle::LOWER ? j <= i : j >= i; }
+
+            size_t index(size_t i, size_t j) const
+            {
+                return _triangle == Triangle::LOWER
+                    ? i * (i + 1) / 2 + j
+                    : i * _n - i * (i - 1) / 2 + (j - i);
+            }
+
+            void apply(const T* x, T* y) const
+            {
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    const size_t first = _triangle == Triangle::LOWER ? 0 : i;
+                    const size_t last = _triangle == Triangle::LOWER ? i : _n - 1;
+                    const T* row = _packed.data() + index(i, first);
+                    T sum = 0;
+                    for (size_t j = first; j <= last; ++j) sum += row[j - first] * x[j];
+                    y[i] = sum;
+                }
+            }
+
+        public:
+            TriangularMatrix(size_t n, Triangle triangle = Triangle::LOWER)
+                : _n(n), _triangle(triangle), _packed(n * (n + 1) / 2, T(0))
+            {
+                detail::check_structured_type<T>();
+            }
+
+            /*
+                The [ triangle ] of a dense square matrix
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            static TriangularMatrix from_dense(const M& m, Triangle triangle = Triangle::LOWER)
+            {
+                auto v = detail::as_view(m);
+                assert(v.rows() == v.cols() && "Triangular matrices are square");
+
+                TriangularMatrix out(v.rows(), triangle);
+                for (size_t i = 0; i < v.rows(); ++i)
+                {
+                    for (size_t j = 0; j < v.cols(); ++j)
+                    {
+                        if (out.inside(i, j)) out(i, j) = static_cast<T>(v(i, j));
+                    }
+                }
+                return out;
+            }
+
+            size_t rows() const { return _n; }
+
+            size_t cols() const { return _n; }
+
+            Triangle triangle() const { return _triangle; }
+
+            size_t storage() const { return _packed.size(); }
+
+            T at(size_t i, size_t j) const
+            {
+                if (i >= _n || j >= _n)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return inside(i, j) ? _packed[index(i, j)] : T(0);
+            }
+
+            /*
+                Element inside the triangle
+            */
+            T& operator()(size_t i, size_t j)
+            {
+                if (i >= _n || j >= _n || !inside(i, j))
+                {
+                    throw std::out_of_range("Index outside the triangle");
+                }
+                return _packed[index(i, j)];
+            }
+
+            std::vector<T> multiply(const std::vector<T>& x) const
+            {
+                assert(x.size() == _n && "Vector length must match the matrix size");
+                XI_COUNT(MATRIX, FLOPS, _n * (_n + 1));
+
+                std::vector<T> y(_n);
+                apply(x.data(), y.data());
+                return y;
+            }
+
+            Matrix_Numerical<T> multiply(ConstMatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Matrix dimensions must match up for multiplication");
+                XI_COUNT(MATRIX, FLOPS, _n * (_n + 1) * b.cols());
+                return detail::multiply_columns(_n, b, [&](const T* x, T* y) { apply(x, y); });
+            }
+
+            std::vector<T> operator*(const std::vector<T>& x) const { return multiply(x); }
+
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            Matrix_Numerical<T> operator*(const M& b) const { return multiply(ConstMatrixView<T>(detail::as_view(b))); }
+
+            /*
+                Forward (LOWER) or back (UPPER) substitution for every column of [ b ]
+            */
+            void solve(MatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Right hand side must have as many rows as the matrix");
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    if (_packed[index(i, i)] == T(0))
+                    {
+                        throw std::runtime_error("xi_matrix::TriangularMatrix::solve: matrix is singular");
+                    }
+                }
+
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, FLOPS, _n * _n * b.cols());
+
+                detail::solve_columns(b, [&](T* x) {
+                    if (_triangle == Triangle::LOWER)
+                    {
+                        for (size_t i = 0; i < _n; ++i)
+                        {
+                            const T* row = _packed.data() + index(i, 0);
+                            T sum = x[i];
+                            for (size_t j = 0; j < i; ++j) sum -= row[j] * x[j];
+                            x[i] = sum / row[i];
+                        }
+                    }
+                    else
+                    {
+                        for (size_t i = _n; i-- > 0; )
+                        {
+                            const T* row = _packed.data() + index(i, i);
+                            T sum = x[i];
+                            for (size_t j = i + 1; j < _n; ++j) sum -= row[j - i] * x[j];
+                            x[i] = sum / row[0];
+                        }
+                    }
+                });
+            }
+
+            std::vector<T> solve(std::vector<T> b) const
+            {
+                solve(MatrixView<T>(b.data(), b.size(), 1, 1));
+                return b;
+            }
+
+            T det() const
+            {
+                T result = 1;
+                for (size_t i = 0; i < _n; ++i) result *= _packed[index(i, i)];
+                return result;
+            }
+
+            TriangularMatrix transpose() const
+            {
+                TriangularMatrix out(_n, _triangle == Triangle::LOWER ? Triangle::UPPER : Triangle::LOWER);
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    for (size_t j = 0; j < _n; ++j)
+                    {
+                        if (inside(i, j)) out._packed[out.index(j, i)] = _packed[index(i, j)];
+                    }
+                }
+                return out;
+            }
+
+            Matrix_Numerical<T> to_dense() const
+            {
+                Matrix_Numerical<T> out(_n, _n, T(0));
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    for (size_t j = 0; j < _n; ++j)
+                    {
+                        if (inside(i, j)) out(i, j) = _packed[index(i, j)];
+                    }
+                }
+                return out;
+            }
+    };
+
+    /*
+        Symmetric matrix storing its lower triangle packed by rows, (i, j) and (j, i) are one element
+    */
+    template <typename T = long double>
+    class SymmetricMatrix
+    {
+        private:
+            size_t _n;
+            std::vector<T> _packed;
+
+            static size_t index(size_t i, size_t j)
+            {
+                if (j > i) std::swap(i, j);
+                return i * (i + 1) / 2 + j;
+            }
+
+            /*
+                y = A x reading every stored element once: a_ij contributes to y_i and y_j
+            */
+            void apply(const T* x, T* y) const
+            {
+                std::fill(y, y + _n, T(0));
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    const T* row = _packed.data() + i * (i + 1) / 2;
+                    const T xi = x[i];
+                    T sum = 0;
+                    for (size_t j = 0; j < i; ++j)
+                    {
+                        sum += row[j] * x[j];
+                        y[j] += row[j] * xi;
+                    }
+                    y[i] += sum + row[i] * xi;
+                }
+            }
+
+            /*
+                Cholesky factor written into [ L ] (same packed layout), false unless positive definite
+            */
+            bool factor(TriangularMatrix<T>& L) const
+            {
+                XI_TIME_CALL(MATRIX);
+                XI_COUNT(MATRIX, FLOPS, _n * _n * _n / 3);
+
+                L = TriangularMatrix<T>(_n, Triangle::LOWER);
+                L._packed = _packed;
+                T* packed = L._packed.data();
+
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    T* li = packed + i * (i + 1) / 2;
+                    for (size_t j = 0; j <= i; ++j)
+                    {
+                        const T* lj = packed + j * (j + 1) / 2;
+                        T sum = li[j];
+                        for (size_t k = 0; k < j; ++k) sum -= li[k] * lj[k];
+
+                        if (j < i)
+                        {
+                            li[j] = sum / lj[j];
+                        }
+                        else if (sum > T(0))
+                        {
+                            li[i] = std::sqrt(sum);
+                        }
+                        else
+                        {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+
+        public:
+            explicit SymmetricMatrix(size_t n) : _n(n), _packed(n * (n + 1) / 2, T(0))
+            {
+                detail::check_structured_type<T>();
+            }
+
+            /*
+                The lower triangle of a dense square matrix (the upper one is assumed to mirror it)
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            static SymmetricMatrix from_dense(const M& m)
+            {
+                auto v = detail::as_view(m);
+                assert(v.rows() == v.cols() && "Symmetric matrices are square");
+
+                SymmetricMatrix out(v.rows());
+                for (size_t i = 0; i < v.rows(); ++i)
+                {
+                    for (size_t j = 0; j <= i; ++j) out(i, j) = static_cast<T>(v(i, j));
+                }
+                return out;
+            }
+
+            size_t rows() const { return _n; }
+
+            size_t cols() const { return _n; }
+
+            size_t storage() const { return _packed.size(); }
+
+            T at(size_t i, size_t j) const
+            {
+                if (i >= _n || j >= _n)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _packed[index(i, j)];
+            }
+
+            /*
+                The element shared by (i, j) and (j, i)
+            */
+            T& operator()(size_t i, size_t j)
+            {
+                if (i >= _n || j >= _n)
+                {
+                    throw std::out_of_range("Index out of bounds");
+                }
+                return _packed[index(i, j)];
+            }
+
+            std::vector<T> multiply(const std::vector<T>& x) const
+            {
+                assert(x.size() == _n && "Vector length must match the matrix size");
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * _n);
+
+                std::vector<T> y(_n);
+                apply(x.data(), y.data());
+                return y;
+            }
+
+            Matrix_Numerical<T> multiply(ConstMatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Matrix dimensions must match up for multiplication");
+                XI_COUNT(MATRIX, FLOPS, 2 * _n * _n * b.cols());
+                return detail::multiply_columns(_n, b, [&](const T* x, T* y) { apply(x, y); });
+            }
+
+            std::vector<T> operator*(const std::vector<T>& x) const { return multiply(x); }
+
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            Matrix_Numerical<T> operator*(const M& b) const { return multiply(ConstMatrixView<T>(detail::as_view(b))); }
+
+            /*
+                Lower triangular L with A = L L^T, throws std::domain_error unless A is positive definite
+            */
+            TriangularMatrix<T> cholesky() const
+            {
+                TriangularMatrix<T> L(0);
+                if (!factor(L))
+                {
+                    throw std::domain_error("xi_matrix::SymmetricMatrix::cholesky: matrix is not positive definite");
+                }
+                return L;
+            }
+
+            /*
+                Cholesky solve for positive definite matrices, dense LU with partial pivoting otherwise
+            */
+            void solve(MatrixView<T> b) const
+            {
+                assert(b.rows() == _n && "Right hand side must have as many rows as the matrix");
+
+                TriangularMatrix<T> L(0);
+                if (factor(L))
+                {
+                    L.solve(b);
+                    L.transpose().solve(b);
+                    return;
+                }
+
+                Matrix_Numerical<T> lu = to_dense();
+                std::vector<size_t> pivots;
+                if (lu_factor(lu.view(), pivots) == 0)
+                {
+                    throw std::runtime_error("xi_matrix::SymmetricMatrix::solve: matrix is singular");
+                }
+                lu_solve(lu.view().as_const(), pivots, b);
+            }
+
+            std::vector<T> solve(std::vector<T> b) const
+            {
+                solve(MatrixView<T>(b.data(), b.size(), 1, 1));
+                return b;
+            }
+
+            T det() const
+            {
+                TriangularMatrix<T> L(0);
+                if (factor(L))
+                {
+                    const T d = L.det();
+                    return d * d;
+                }
+                return xi_matrix::det(to_dense());
+            }
+
+            Matrix_Numerical<T> to_dense() const
+            {
+                Matrix_Numerical<T> out(_n, _n);
+                for (size_t i = 0; i < _n; ++i)
+                {
+                    for (size_t j = 0; j <= i; ++j)
+                    {
+                        out(i, j) = out(j, i) = _packed[index(i, j)];
+                    }
+                }
+                return out;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,1045 @@
+#ifndef XI_TILED
+#define XI_TILED
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "instrument.h"
+#include "matrix.h"
+#include "matrix_io.h"
+#include "reduction.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+    Out-of-core matrices stored as a grid of fixed size tiles in a file
+
+    Tiled format (.xit), little endian:
+
+        offset  size  field
+             0     8  magic "XITILED\0"
+             8     4  version (1)
+            12     4  dtype (see DType in matrix_io.h)
+            16     4  element size in bytes
+            20     4  byte order mark 0x01020304 as written by the producing machine
+            24     8  rows
+            32     8  cols
+            40     8  tile rows
+            48     8  tile cols
+            56     8  data offset from the start of the file, in bytes (a multiple of 4096)
+            64    64  reserved, zero
+           128        data
+
+    Tile (ti, tj) is a dense row-major block of tile rows x tile cols elements stored at
+    data + (ti * tile grid cols + tj) * tile bytes; tiles on the bottom and right edges are padded
+    to the full tile size, so every tile is one contiguous read
+
+    Only a bounded number of tiles is held in memory: read_tile / write_tile pin a tile in an LRU
+    cache of TiledOptions::memory_budget bytes and hand out a view of it, unpinned tiles are evicted
+    least recently used first and written back when they were modified. prefetch queues tiles for a
+    background thread that reads them while the caller computes on the current ones
+
+        xi_matrix::TiledMatrix<double> A("a.xit", 100000, 100000);
+        A.update_tiles([](size_t row, size_t col, xi_matrix::MatrixView<double> tile) { ... });
+        xi_matrix::multiply(A, B, C);
+        double total = xi_matrix::sum(C);
+
+    multiply, transpose and the reductions stream tiles in an order that reuses what is cached:
+    the product sweeps its inner dimension forwards and backwards on alternating output tiles, so
+    the last A and B tiles of one output tile are the first ones of the next
+
+    Pinned tiles are never evicted, the cache grows past its budget when every tile is pinned
+    Write back happens on eviction, flush() and destruction; nothing is fsync'ed
+*/
+namespace xi_matrix
+{
+    struct TiledOptions
+    {
+        /*
+            Tile shape of newly created files, opened files keep the shape they were written with
+        */
+        size_t tile_rows = 1024;
+        size_t tile_cols = 1024;
+
+        /*
+            Bytes of tile data kept in memory
+        */
+        size_t memory_budget = size_t(512) << 20;
+
+        /*
+            Tiles the streaming algorithms ask the background reader for ahead of use, 0 disables prefetch
+        */
+        size_t prefetch_depth = 2;
+
+        /*
+            Opens existing files without write access, write_tile then throws std::logic_error
+        */
+        bool read_only = false;
+    };
+
+    struct TileCacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t prefetched = 0;
+        uint64_t evictions = 0;
+        uint64_t writebacks = 0;
+    };
+
+    struct TiledFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t dtype;
+        uint32_t element_size;
+        uint32_t byte_order;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t tile_rows;
+        uint64_t tile_cols;
+        uint64_t data_offset;
+        uint8_t reserved[64];
+    };
+
+    static_assert(sizeof(TiledFileHeader) == 128, "Tiled file header must be 128 bytes");
+
+    template <typename T>
+    class TiledMatrix;
+
+    namespace detail
+    {
+        inline constexpr char tiled_magic[8] = { 'X', 'I', 'T', 'I', 'L', 'E', 'D', '\0' };
+        inline constexpr uint32_t tiled_version = 1;
+        inline constexpr uint64_t tiled_alignment = 4096;
+
+        inline void read_at(int fd, void* data, size_t bytes, uint64_t offset, const std::string& path)
+        {
+            char* p = static_cast<char*>(data);
+            while (bytes > 0)
+            {
+                ssize_t got = ::pread(fd, p, bytes, static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0)
+                {
+                    throw io_error("Failed to read tiled matrix file", path);
+                }
+                p += got;
+                bytes -= static_cast<size_t>(got);
+                offset += static_cast<uint64_t>(got);
+                XI_COUNT(IO, BYTES, static_cast<size_t>(got));
+            }
+        }
+
+        inline void write_at(int fd, const void* data, size_t bytes, uint64_t offset, const std::string& path)
+        {
+            const char* p = static_cast<const char*>(data);
+            while (bytes > 0)
+            {
+                ssize_t put = ::pwrite(fd, p, bytes, static_cast<off_t>(offset));
+                if (put < 0 && errno == EINTR) continue;
+                if (put <= 0)
+                {
+                    throw io_error("Failed to write tiled matrix file", path);
+                }
+                p += put;
+                bytes -= static_cast<size_t>(put);
+                offset += static_cast<uint64_t>(put);
+                XI_COUNT(IO, BYTES, static_cast<size_t>(put));
+            }
+        }
+    }
+
+    /*
+        A tile pinned in the cache of its TiledMatrix for as long as the handle lives, move only
+        Writable handles mark their tile as modified
+    */
+    template <typename T, bool Writable>
+    class TileHandle
+    {
+        private:
+            using Entry = typename TiledMatrix<T>::Entry;
+
+            const TiledMatrix<T>* _owner;
+            Entry* _entry;
+            size_t _rows;
+            size_t _cols;
+
+            friend class TiledMatrix<T>;
+
+            TileHandle(const TiledMatrix<T>* owner, Entry* entry, size_t rows, size_t cols)
+                : _owner(owner), _entry(entry), _rows(rows), _cols(cols) {};
+        public:
+            using view_type = std::conditional_t<Writable, MatrixView<T>, ConstMatrixView<T>>;
+
+            TileHandle(const TileHandle&) = delete;
+
+            TileHandle& operator=(const TileHandle&) = delete;
+
+            TileHandle(TileHandle&& other) noexcept
+                : _owner(other._owner), _entry(other._entry), _rows(other._rows), _cols(other._cols)
+            {
+                other._entry = nullptr;
+            };
+
+            TileHandle& operator=(TileHandle&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    _owner = other._owner;
+                    _entry = other._entry;
+                    _rows = other._rows;
+                    _cols = other._cols;
+                    other._entry = nullptr;
+                }
+                return *this;
+            }
+
+            ~TileHandle() { release(); }
+
+            /*
+                Unpins the tile, the handle is empty afterwards
+            */
+            void release()
+            {
+                if (_entry != nullptr)
+                {
+                    _owner->unpin(*_entry, Writable);
+                    _entry = nullptr;
+                }
+            }
+
+            size_t rows() const { return _rows; };
+
+            size_t cols() const { return _cols; };
+
+            /*
+                View of the valid rows() x cols() part of the tile, rows are tile_cols() elements apart
+            */
+            view_type view() const
+            {
+                assert(_entry != nullptr && "Tile handle is empty");
+                return view_type(_entry->data.data(), _rows, _cols, static_cast<std::ptrdiff_t>(_owner->tile_cols()));
+            }
+    };
+
+    /*
+        File backed matrix of tiles with an LRU tile cache and a background prefetch thread
+        Neither copyable nor movable, the prefetch thread refers to the object
+        Tiles may be read and written from several threads at once, concurrent writes to the
+        same tile have to be synchronized by the caller
+    */
+    template <typename T>
+    class TiledMatrix
+    {
+        private:
+            struct Entry
+            {
+                size_t index = 0;
+                std::vector<T> data;
+                size_t pins = 0;
+                bool ready = false;
+                bool failed = false;
+                bool dirty = false;
+            };
+
+            friend class TileHandle<T, false>;
+            friend class TileHandle<T, true>;
+
+            using EntryList = std::list<Entry>;
+
+            std::string _path;
+            int _fd;
+            TiledFileHeader _header;
+            TiledOptions _options;
+            size_t _grid_rows;
+            size_t _grid_cols;
+            size_t _tile_elements;
+            size_t _capacity;
+
+            mutable std::mutex _lock;
+            mutable std::condition_variable _changed;
+            mutable EntryList _lru;
+            mutable std::unordered_map<size_t, typename EntryList::iterator> _index;
+            mutable TileCacheStats _stats;
+
+            mutable std::condition_variable _queued;
+            mutable std::deque<size_t> _queue;
+            mutable std::thread _loader;
+            mutable bool _stopping = false;
+
+            uint64_t tile_offset(size_t index) const
+            {
+                return _header.data_offset + static_cast<uint64_t>(index) * _tile_elements * sizeof(T);
+            }
+
+            /*
+                Called once the header is known, sizes the tile grid and the cache
+            */
+            void setup()
+            {
+                _grid_rows = static_cast<size_t>((_header.rows + _header.tile_rows - 1) / _header.tile_rows);
+                _grid_cols = static_cast<size_t>((_header.cols + _header.tile_cols - 1) / _header.tile_cols);
+                _tile_elements = static_cast<size_t>(_header.tile_rows * _header.tile_cols);
+                _capacity = std::max<size_t>(1, _options.memory_budget / (_tile_elements * sizeof(T)));
+            }
+
+            /*
+                Whether a new tile can be cached without going over the budget, or by evicting an
+                unpinned one
+            */
+            bool has_room() const
+            {
+                if (_index.size() < _capacity) return true;
+                for (auto it = _lru.rbegin(); it != _lru.rend(); ++it)
+                {
+                    if (it->pins == 0 && it->ready) return true;
+                }
+                return false;
+            }
+
+            /*
+                Adds a pinned, not yet loaded entry for [ index ] at the front of the LRU list,
+                evicting unpinned tiles (and reusing the buffer of the last one) to stay within budget
+                The caller holds _lock
+            */
+            Entry& insert(size_t index) const
+            {
+                std::vector<T> buffer;
+                while (_index.size() >= _capacity)
+                {
+                    auto victim = _lru.end();
+                    for (auto it = _lru.end(); it != _lru.begin();)
+                    {
+                        --it;
+                        if (it->pins == 0 && it->ready)
+                        {
+                            victim = it;
+                            break;
+                        }
+                    }
+                    if (victim == _lru.end()) break;
+
+                    if (victim->dirty)
+                    {
+                        detail::write_at(_fd, victim->data.data(), _tile_elements * sizeof(T), tile_offset(victim->index), _path);
+                        ++_stats.writebacks;
+                    }
+                    buffer = std::move(victim->data);
+                    _index.erase(victim->index);
+                    _lru.erase(victim);
+                    ++_stats.evictions;
+                }
+
+                if (buffer.size() != _tile_elements)
+                {
+                    buffer.assign(_tile_elements, T());
+                    XI_COUNT(IO, ALLOCATIONS, 1);
+                    XI_COUNT(IO, ALLOCATED_BYTES, _tile_elements * sizeof(T));
+                }
+
+                _lru.emplace_front();
+                Entry& entry = _lru.front();
+                entry.index = index;
+                entry.data = std::move(buffer);
+                entry.pins = 1;
+                _index[index] = _lru.begin();
+                return entry;
+            }
+
+            /*
+                Drops a pin of an entry whose load failed, the last pin removes it from the cache
+                The caller holds _lock
+            */
+            void abandon(Entry& entry) const
+            {
+                if (--entry.pins == 0)
+                {
+                    auto it = _index.find(entry.index);
+                    if (it != _index.end() && &*it->second == &entry)
+                    {
+                        _lru.erase(it->second);
+                        _index.erase(it);
+                    }
+                }
+            }
+
+            /*
+                Reads the tile of a freshly inserted entry (unless [ discard ], which zero fills it)
+                and publishes it to the threads waiting for it
+            */
+            void load(Entry& entry, bool discard) const
+            {
+                try
+                {
+                    if (discard)
+                    {
+                        std::fill(entry.data.begin(), entry.data.end(), T());
+                    }
+                    else
+                    {
+                        detail::read_at(_fd, entry.data.data(), _tile_elements * sizeof(T), tile_offset(entry.index), _path);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    entry.failed = true;
+                    abandon(entry);
+                    _changed.notify_all();
+                    throw;
+                }
+
+                std::lock_guard<std::mutex> guard(_lock);
+                entry.ready = true;
+                _changed.notify_all();
+            }
+
+            /*
+                Pins tile [ index ], reading it from the file on a miss
+            */
+            Entry& acquire(size_t index, bool writable, bool discard) const
+            {
+                if (writable && _options.read_only)
+                {
+                    throw std::logic_error("Tiled matrix was opened read only: " + _path);
+                }
+
+                std::unique_lock<std::mutex> guard(_lock);
+                auto found = _index.find(index);
+                if (found != _index.end())
+                {
+                    Entry& entry = *found->second;
+                    ++entry.pins;
+                    ++_stats.hits;
+                    _lru.splice(_lru.begin(), _lru, found->second);
+
+                    _changed.wait(guard, [&] { return entry.ready || entry.failed; });
+                    if (entry.failed)
+                    {
+                        abandon(entry);
+                        throw std::runtime_error("Failed to read tile of tiled matrix file: " + _path);
+                    }
+
+                    entry.dirty = entry.dirty || writable;
+                    return entry;
+                }
+
+                ++_stats.misses;
+                Entry& entry = insert(index);
+                entry.dirty = writable;
+                guard.unlock();
+
+                load(entry, discard);
+                return entry;
+            }
+
+            /*
+                Drops a pin, releasing a writable one marks the tile modified again in case a flush()
+                wrote it back while the handle was still in use
+            */
+            void unpin(Entry& entry, bool writable) const
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                --entry.pins;
+                entry.dirty = entry.dirty || writable;
+            }
+
+            /*
+                Background reader, loads queued tiles while there is room for them
+            */
+            void run_loader() const
+            {
+                std::unique_lock<std::mutex> guard(_lock);
+                for (;;)
+                {
+                    _queued.wait(guard, [&] { return _stopping || !_queue.empty(); });
+                    if (_stopping) return;
+
+                    const size_t index = _queue.front();
+                    _queue.pop_front();
+                    if (_index.count(index) != 0 || !has_room()) continue;
+
+                    Entry& entry = insert(index);
+                    guard.unlock();
+                    bool loaded = true;
+                    try
+                    {
+                        load(entry, false);
+                    }
+                    catch (...)
+                    {
+                        // load() has dropped the entry, the read that needs the tile reports the error
+                        loaded = false;
+                    }
+                    guard.lock();
+
+                    if (loaded)
+                    {
+                        --entry.pins;
+                        ++_stats.prefetched;
+                    }
+                }
+            }
+
+            void open_file(int flags)
+            {
+                _fd = ::open(_path.c_str(), flags, 0644);
+                if (_fd < 0)
+                {
+                    throw detail::io_error("Failed to open tiled matrix file", _path);
+                }
+            }
+
+            void stop_loader()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _stopping = true;
+                }
+                _queued.notify_all();
+                if (_loader.joinable()) _loader.join();
+            }
+
+        public:
+            using value_type = T;
+            using ConstTile = TileHandle<T, false>;
+            using MutableTile = TileHandle<T, true>;
+
+            /*
+                Creates (or truncates) [ path ] for a rows x cols matrix of zeros with the tile shape
+                of [ options ], the file is sparse until tiles are written
+            */
+            TiledMatrix(const std::string& path, size_t rows, size_t cols, const TiledOptions& options = TiledOptions())
+                : _path(path), _fd(-1), _options(options)
+            {
+                assert(options.tile_rows > 0 && options.tile_cols > 0 && "Tiles must not be empty");
+                assert(!options.read_only && "A new tiled matrix cannot be read only");
+
+                std::memset(&_header, 0, sizeof(_header));
+                std::memcpy(_header.magic, detail::tiled_magic, sizeof(_header.magic));
+                _header.version = detail::tiled_version;
+                _header.dtype = static_cast<uint32_t>(dtype_of<T>::value);
+                _header.element_size = sizeof(T);
+                _header.byte_order = detail::byte_order_mark;
+                _header.rows = rows;
+                _header.cols = cols;
+                _header.tile_rows = std::min<size_t>(options.tile_rows, std::max<size_t>(rows, 1));
+                _header.tile_cols = std::min<size_t>(options.tile_cols, std::max<size_t>(cols, 1));
+                _header.data_offset = detail::tiled_alignment;
+                setup();
+
+                open_file(O_RDWR | O_CREAT | O_TRUNC);
+                try
+                {
+                    detail::write_at(_fd, &_header, sizeof(_header), 0, _path);
+                    const uint64_t length = tile_offset(_grid_rows * _grid_cols);
+                    if (::ftruncate(_fd, static_cast<off_t>(length)) != 0)
+                    {
+                        throw detail::io_error("Failed to size tiled matrix file", _path);
+                    }
+                }
+                catch (...)
+                {
+                    ::close(_fd);
+                    throw;
+                }
+            };
+
+            /*
+                Opens an existing tiled file, throws std::runtime_error if it cannot be opened or is
+                not a valid tiled file of element type [ T ]
+            */
+            explicit TiledMatrix(const std::string& path, const TiledOptions& options = TiledOptions())
+                : _path(path), _fd(-1), _options(options)
+            {
+                open_file(options.read_only ? O_RDONLY : O_RDWR);
+                try
+                {
+                    struct stat info;
+                    if (::fstat(_fd, &info) != 0)
+                    {
+                        throw detail::io_error("Failed to stat tiled matrix file", _path);
+                    }
+                    if (static_cast<uint64_t>(info.st_size) < sizeof(TiledFileHeader))
+                    {
+                        throw std::runtime_error("Tiled matrix file is too small to hold a header: " + _path);
+                    }
+
+                    detail::read_at(_fd, &_header, sizeof(_header), 0, _path);
+                    if (std::memcmp(_header.magic, detail::tiled_magic, sizeof(_header.magic)) != 0)
+                    {
+                        throw std::runtime_error("Not an xi tiled matrix file: " + _path);
+                    }
+                    if (_header.version != detail::tiled_version)
+                    {
+                        throw std::runtime_error("Unsupported xi tiled matrix file version: " + _path);
+                    }
+                    if (_header.byte_order != detail::byte_order_mark)
+                    {
+                        throw std::runtime_error("Tiled matrix file was written with a different byte order: " + _path);
+                    }
+                    if (_header.dtype != static_cast<uint32_t>(dtype_of<T>::value) || _header.element_size != sizeof(T))
+                    {
+                        throw std::runtime_error("Tiled matrix file element type does not match the requested type: " + _path);
+                    }
+                    if (_header.tile_rows == 0 || _header.tile_cols == 0)
+                    {
+                        throw std::runtime_error("Tiled matrix file has empty tiles: " + _path);
+                    }
+
+                    setup();
+                    if (tile_offset(_grid_rows * _grid_cols) > static_cast<uint64_t>(info.st_size))
+                    {
+                        throw std::runtime_error("Tiled matrix file is truncated: " + _path);
+                    }
+                }
+                catch (...)
+                {
+                    ::close(_fd);
+                    throw;
+                }
+            };
+
+            TiledMatrix(const TiledMatrix&) = delete;
+
+            TiledMatrix& operator=(const TiledMatrix&) = delete;
+
+            /*
+                Writes back modified tiles and closes the file, errors are swallowed (call flush()
+                first to see them)
+            */
+            ~TiledMatrix()
+            {
+                stop_loader();
+                try
+                {
+                    flush();
+                }
+                catch (...)
+                {
+                }
+                ::close(_fd);
+            }
+
+            size_t rows() const { return static_cast<size_t>(_header.rows); };
+
+            size_t cols() const { return static_cast<size_t>(_header.cols); };
+
+            size_t tile_rows() const { return static_cast<size_t>(_header.tile_rows); };
+
+            size_t tile_cols() const { return static_cast<size_t>(_header.tile_cols); };
+
+            /*
+                Number of tiles down and across
+            */
+            size_t grid_rows() const { return _grid_rows; };
+
+            size_t grid_cols() const { return _grid_cols; };
+
+            /*
+                Valid rows of tile row [ ti ] and valid columns of tile column [ tj ]
+            */
+            size_t tile_height(size_t ti) const { return std::min(tile_rows(), rows() - ti * tile_rows()); };
+
+            size_t tile_width(size_t tj) const { return std::min(tile_cols(), cols() - tj * tile_cols()); };
+
+            const std::string& path() const { return _path; }
+
+            const TiledFileHeader& header() const { return _header; }
+
+            const TiledOptions& options() const { return _options; }
+
+            /*
+                Most tiles the cache holds before it starts evicting
+            */
+            size_t capacity() const { return _capacity; };
+
+            TileCacheStats stats() const
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                return _stats;
+            }
+
+            /*
+                Pins tile (ti, tj) for reading, blocks until it is in memory
+            */
+            ConstTile read_tile(size_t ti, size_t tj) const
+            {
+                assert(ti < _grid_rows && tj < _grid_cols && "Tile index out of range");
+                Entry& entry = acquire(ti * _grid_cols + tj, false, false);
+                return ConstTile(this, &entry, tile_height(ti), tile_width(tj));
+            }
+
+            /*
+                Pins tile (ti, tj) for writing, [ discard ] skips reading the old contents (the tile
+                starts out as zeros) when the caller overwrites all of it
+            */
+            MutableTile write_tile(size_t ti, size_t tj, bool discard = false)
+            {
+                assert(ti < _grid_rows && tj < _grid_cols && "Tile index out of range");
+                Entry& entry = acquire(ti * _grid_cols + tj, true, discard);
+                return MutableTile(this, &entry, tile_height(ti), tile_width(tj));
+            }
+
+            /*
+                Queues tile (ti, tj) for the background reader, a no-op when it is cached already,
+                prefetch is disabled or the cache has no evictable tile to make room with
+            */
+            void prefetch(size_t ti, size_t tj) const
+            {
+                if (_options.prefetch_depth == 0 || ti >= _grid_rows || tj >= _grid_cols) return;
+
+                const size_t index = ti * _grid_cols + tj;
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    if (_index.count(index) != 0) return;
+
+                    // requests the reader has not got to yet are stale once the caller moved past them
+                    while (_queue.size() >= 2 * _options.prefetch_depth + 2)
+                    {
+                        _queue.pop_front();
+                    }
+                    _queue.push_back(index);
+
+                    if (!_loader.joinable())
+                    {
+                        _loader = std::thread([this] { run_loader(); });
+                    }
+                }
+                _queued.notify_one();
+            }
+
+            /*
+                Writes every modified tile back to the file
+                Tiles still pinned stay marked modified, a live MutableTile may write to them again
+            */
+            void flush()
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                for (Entry& entry : _lru)
+                {
+                    if (entry.dirty && entry.ready)
+                    {
+                        detail::write_at(_fd, entry.data.data(), _tile_elements * sizeof(T), tile_offset(entry.index), _path);
+                        entry.dirty = entry.pins != 0;
+                        ++_stats.writebacks;
+                    }
+                }
+            }
+
+            /*
+                Single element access, each call pins the tile holding it
+            */
+            T at(size_t row, size_t col) const
+            {
+                if (row >= rows() || col >= cols())
+                {
+                    throw std::out_of_range("Tiled matrix index out of range");
+                }
+                return read_tile(row / tile_rows(), col / tile_cols()).view()(row % tile_rows(), col % tile_cols());
+            }
+
+            void set(size_t row, size_t col, T value)
+            {
+                if (row >= rows() || col >= cols())
+                {
+                    throw std::out_of_range("Tiled matrix index out of range");
+                }
+                write_tile(row / tile_rows(), col / tile_cols()).view()(row % tile_rows(), col % tile_cols()) = value;
+            }
+
+            /*
+                Calls f(first_row, first_col, ConstMatrixView<T> tile) for every tile in row-major
+                tile order, prefetching the tiles that follow
+            */
+            template <typename F>
+            void visit_tiles(F&& f) const
+            {
+                const size_t count = _grid_rows * _grid_cols;
+                for (size_t t = 0; t < count; ++t)
+                {
+                    for (size_t ahead = 1; ahead <= _options.prefetch_depth && t + ahead < count; ++ahead)
+                    {
+                        prefetch((t + ahead) / _grid_cols, (t + ahead) % _grid_cols);
+                    }
+
+                    const size_t ti = t / _grid_cols;
+                    const size_t tj = t % _grid_cols;
+                    auto tile = read_tile(ti, tj);
+                    f(ti * tile_rows(), tj * tile_cols(), tile.view());
+                }
+            }
+
+            /*
+                Calls f(first_row, first_col, MatrixView<T> tile) for every tile in row-major tile
+                order, [ discard ] as for write_tile
+            */
+            template <typename F>
+            void update_tiles(F&& f, bool discard = false)
+            {
+                const size_t count = _grid_rows * _grid_cols;
+                for (size_t t = 0; t < count; ++t)
+                {
+                    if (!discard)
+                    {
+                        for (size_t ahead = 1; ahead <= _options.prefetch_depth && t + ahead < count; ++ahead)
+                        {
+                            prefetch((t + ahead) / _grid_cols, (t + ahead) % _grid_cols);
+                        }
+                    }
+
+                    const size_t ti = t / _grid_cols;
+                    const size_t tj = t % _grid_cols;
+                    auto tile = write_tile(ti, tj, discard);
+                    f(ti * tile_rows(), tj * tile_cols(), tile.view());
+                }
+            }
+
+            void fill(T value)
+            {
+                update_tiles([value](size_t, size_t, MatrixView<T> tile) { tile.fill(value); }, true);
+            }
+
+            /*
+                Copies any matrix or view of the same dimensions into the tiles, e.g. the view of a
+                MappedMatrix to convert a dense binary file without loading it
+            */
+            template <typename M, typename = std::enable_if_t<detail::is_matrix_like<M>::value>>
+            void assign(const M& m)
+            {
+                auto v = detail::as_view(m);
+                assert(v.rows() == rows() && v.cols() == cols() && "Matrix dimensions must match the tiled matrix");
+
+                update_tiles([&v](size_t row, size_t col, MatrixView<T> tile) {
+                    tile.assign(v.block(row, col, tile.rows(), tile.cols()));
+                }, true);
+            }
+
+            /*
+                Dense in-memory copy, only sensible for matrices that fit in memory
+            */
+            Matrix<T> to_matrix() const
+            {
+                Matrix<T> result(rows(), cols());
+                auto out = result.view();
+                visit_tiles([&out](size_t row, size_t col, ConstMatrixView<T> tile) {
+                    out.block(row, col, tile.rows(), tile.cols()).assign(tile);
+                });
+                return result;
+            }
+    };
+
+    namespace detail
+    {
+        /*
+            Tile indices of step [ s ] of the tiled product: output tiles row by row, columns swept
+            in alternating directions on successive tile rows and the inner dimension in alternating
+            directions on successive output tiles
+        */
+        struct TiledStep
+        {
+            size_t i;
+            size_t j;
+            size_t k;
+            bool first;
+        };
+
+        inline TiledStep tiled_step(size_t s, size_t gj, size_t gk)
+        {
+            const size_t i = s / (gj * gk);
+            const size_t rest = s % (gj * gk);
+            const size_t jj = rest / gk;
+            const size_t kk = rest % gk;
+            const size_t j = (i % 2 == 0) ? jj : gj - 1 - jj;
+            const size_t k = ((i * gj + jj) % 2 == 0) ? kk : gk - 1 - kk;
+            return { i, j, k, kk == 0 };
+        }
+    }
+
+    /*
+        c = a * b tile by tile, [ c ] must be a different matrix from [ a ] and [ b ]
+        Tile shapes have to line up: a.tile_cols() == b.tile_rows(), c.tile_rows() == a.tile_rows()
+        and c.tile_cols() == b.tile_cols()
+        Each tile product runs on the conventional (parallel) kernel while the next A and B tiles
+        are prefetched, the first product of every output tile overwrites it without reading it
+    */
+    template <typename T>
+    inline void multiply(const TiledMatrix<T>& a, const TiledMatrix<T>& b, TiledMatrix<T>& c)
+    {
+        assert(
+            a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols() &&
+            "Matrix dimensions must match up for multiplication"
+        );
+        assert(
+            a.tile_cols() == b.tile_rows() && c.tile_rows() == a.tile_rows() && c.tile_cols() == b.tile_cols() &&
+            "Tile shapes must match up for tiled multiplication"
+        );
+        assert(&c != &a && &c != &b && "Output of a tiled product must not be one of its operands");
+
+        XI_TIME_CALL(MATRIX);
+
+        const size_t gi = a.grid_rows();
+        const size_t gj = b.grid_cols();
+        const size_t gk = a.grid_cols();
+        if (gi == 0 || gj == 0) return;
+        if (gk == 0)
+        {
+            c.fill(T(0));
+            return;
+        }
+
+        const size_t steps = gi * gj * gk;
+        const size_t depth = std::max(a.options().prefetch_depth, b.options().prefetch_depth);
+
+        Matrix<T> scratch(c.tile_rows(), c.tile_cols());
+        typename TiledMatrix<T>::MutableTile out = c.write_tile(0, 0, true);
+
+        for (size_t s = 0; s < steps; ++s)
+        {
+            for (size_t ahead = 1; ahead <= depth && s + ahead < steps; ++ahead)
+            {
+                const detail::TiledStep next = detail::tiled_step(s + ahead, gj, gk);
+                a.prefetch(next.i, next.k);
+                b.prefetch(next.k, next.j);
+            }
+
+            const detail::TiledStep step = detail::tiled_step(s, gj, gk);
+            if (step.first && s != 0)
+            {
+                out.release();
+                out = c.write_tile(step.i, step.j, true);
+            }
+
+            auto ta = a.read_tile(step.i, step.k);
+            auto tb = b.read_tile(step.k, step.j);
+
+            if (step.first)
+            {
+                detail::gemm(ta.view(), tb.view(), out.view());
+            }
+            else
+            {
+                auto partial = scratch.view().block(0, 0, out.rows(), out.cols());
+                detail::gemm(ta.view(), tb.view(), partial);
+                xi_matrix::add(out.view().as_const(), partial.as_const(), out.view());
+            }
+        }
+    }
+
+    /*
+        out = transpose(a), [ out ] needs the transposed dimensions and tile shape
+        (out.tile_rows() == a.tile_cols() and out.tile_cols() == a.tile_rows())
+    */
+    template <typename T>
+    inline void transpose(const TiledMatrix<T>& a, TiledMatrix<T>& out)
+    {
+        assert(out.rows() == a.cols() && out.cols() == a.rows() && "Output must have the transposed dimensions");
+        assert(
+            out.tile_rows() == a.tile_cols() && out.tile_cols() == a.tile_rows() &&
+            "Output must have the transposed tile shape"
+        );
+        assert(&out != &a && "Tiled transpose cannot run in place");
+
+        XI_TIME_CALL(MATRIX);
+
+        a.visit_tiles([&](size_t row, size_t col, ConstMatrixView<T> tile) {
+            auto target = out.write_tile(col / out.tile_rows(), row / out.tile_cols(), true);
+            target.view().assign(tile.transpose());
+        });
+    }
+
+    /*
+        Reductions over a tiled matrix, tiles are streamed once in file order and reduced with the
+        in-memory kernels of reduction.h
+    */
+    template <typename T>
+    inline detail::accum_t<T> sum(const TiledMatrix<T>& m)
+    {
+        XI_TIME_CALL(REDUCTION);
+        detail::accum_t<T> total = 0;
+        m.visit_tiles([&total](size_t, size_t, ConstMatrixView<T> tile) { total += xi_matrix::sum(tile); });
+        return total;
+    }
+
+    template <typename T>
+    inline Matrix_Numerical<detail::accum_t<T>> sum(const TiledMatrix<T>& m, Axis axis)
+    {
+        using A = detail::accum_t<T>;
+        XI_TIME_CALL(REDUCTION);
+
+        const bool per_column = axis == Axis::PER_COLUMN;
+        Matrix_Numerical<A> result(per_column ? 1 : m.rows(), per_column ? m.cols() : 1, A(0));
+        m.visit_tiles([&](size_t row, size_t col, ConstMatrixView<T> tile) {
+            auto partial = xi_matrix::sum(tile, axis);
+            auto target = per_column ? result.view().block(0, col, 1, tile.cols()) : result.view().block(row, 0, tile.rows(), 1);
+            xi_matrix::add(target.as_const(), partial, target);
+        });
+        return result;
+    }
+
+    template <typename T>
+    inline T min(const TiledMatrix<T>& m)
+    {
+        XI_TIME_CALL(REDUCTION);
+        T result = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+        m.visit_tiles([&result](size_t, size_t, ConstMatrixView<T> tile) { result = std::min(result, xi_matrix::min(tile)); });
+        return result;
+    }
+
+    template <typename T>
+    inline T max(const TiledMatrix<T>& m)
+    {
+        XI_TIME_CALL(REDUCTION);
+        T result = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+        m.visit_tiles([&result](size_t, size_t, ConstMatrixView<T> tile) { result = std::max(result, xi_matrix::max(tile)); });
+        return result;
+    }
+
+    /*
+        Entry-wise norm, Norm::L2 is the Frobenius norm
+    */
+    template <typename T>
+    inline detail::real_t<T> norm(const TiledMatrix<T>& m, Norm kind = Norm::L2)
+    {
+        using R = detail::real_t<T>;
+        XI_TIME_CALL(REDUCTION);
+
+        R result = 0;
+        m.visit_tiles([&](size_t, size_t, ConstMatrixView<T> tile) {
+            switch (kind)
+            {
+                case Norm::L1:
+                    result += detail::reduce_all(tile, detail::SumOp<T, detail::Absolute, R>());
+                    break;
+                case Norm::INF:
+                    result = std::max(result, detail::reduce_all(tile, detail::MaxAbsOp<T, R>()));
+                    break;
+                case Norm::L2:
+                default:
+                    result += detail::reduce_all(tile, detail::SumOp<T, detail::Square, R>());
+                    break;
+            }
+        });
+        return kind == Norm::L2 ? std::sqrt(result) : result;
+    }
+}
+
+#endif
@@ -0,0 +1,875 @@
+#ifndef XI_VMATH
+#define XI_VMATH
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "matrix.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+    Vectorized elementary functions over arrays and matrices
+
+        exp  log  sin  cos  tanh  sqrt      one input array
+        pow                                 x^y with an array or a single exponent
+
+    Every function but sqrt (the hardware instruction) is a branch free polynomial kernel
+    (Cody-Waite range reduction, fdlibm minimax polynomials for log / sin / cos, a degree 13
+    Taylor polynomial for exp) written once and compiled three times: for the baseline target,
+    for AVX2 + FMA and for AVX-512. The widest one the CPU supports is picked at run time
+    (__builtin_cpu_supports, GCC / Clang on x86), set_isa() narrows the choice, e.g. to compare
+    paths. Other compilers and targets get the baseline kernels, which vectorize as far as the
+    build flags allow; on baseline x86 (SSE2) sin and pow are plain std::sin and std::pow.
+
+    Maximum error against a long double reference, measured over 2 * 10^6 random arguments per range
+    on every path:
+
+        exp     1 ulp           sin     1 ulp           tanh    3 ulp
+        log     1 ulp           cos     1 ulp           sqrt    correctly rounded
+        pow     2 ulp, y log2(x) is carried in double-double so this holds up to the overflow threshold
+
+    sin / cos reduce by pi / 2 in three parts, which is exact enough up to | x | = 2^20. Larger
+    arguments, infinities, NaNs and non-positive or subnormal log and pow arguments fall back to
+    the std:: functions. Each block of 512 elements is checked first, so a block containing such an
+    element runs at libm speed while the others stay vectorized.
+    float arrays are evaluated in double lanes and rounded once (0.5 ulp in practice), long double
+    goes straight to std::.
+
+    Arrays (x, out, n) may be the same array, matrix entry points accept any Matrix_Numerical,
+    MatrixView or ConstMatrixView and may write into their own input:
+
+        xi_vmath::exp(x, y, n);
+        auto s = xi_vmath::apply(xi_vmath::Function::SIN, A);
+        xi_vmath::pow(A, 2.5, A);
+
+    Large arrays are split across the xi_parallel pool.
+*/
+namespace xi_vmath
+{
+    enum class Function { EXP, LOG, SIN, COS, TANH, SQRT };
+
+    /*
+        Instruction set the kernels run on, in increasing order of width
+    */
+    enum class Isa { GENERIC, AVX2, AVX512 };
+
+#if defined(__GNUC__)
+#define XI_VMATH_INLINE inline __attribute__((always_inline))
+#else
+#define XI_VMATH_INLINE inline
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XI_VMATH_DISPATCH 1
+#else
+#define XI_VMATH_DISPATCH 0
+#endif
+
+    namespace detail
+    {
+        /*
+            Elements checked for out of range arguments at once
+        */
+        inline constexpr size_t block = 512;
+
+        /*
+            1.5 * 2^52, adding it rounds to an integer that can be read back from the low mantissa bits
+        */
+        inline constexpr double shifter = 6755399441055744.0;
+
+        inline constexpr double log2e_hi = 1.44269504088896338700e+00;
+        inline constexpr double log2e_lo = 2.03552737409310331007e-17;
+        inline constexpr double ln2 = 6.93147180559945286227e-01;
+        inline constexpr double ln2_hi = 6.93147180369123816490e-01;
+        inline constexpr double ln2_lo = 1.90821492927058770002e-10;
+        inline constexpr double sqrt2 = 1.41421356237309514547e+00;
+        inline constexpr double two_over_pi = 6.36619772367581382433e-01;
+
+        /*
+            pi / 2 split into 33 bit pieces, k * piece is exact for | k | < 2^20
+        */
+        inline constexpr double pio2_1 = 1.57079632673412561417e+00;
+        inline constexpr double pio2_2 = 6.07710050630396597660e-11;
+        inline constexpr double pio2_3 = 2.02226624871116645580e-21;
+        inline constexpr double pio2_3t = 8.47842766036889956997e-32;
+        inline constexpr double trig_limit = 1048576.0;
+
+        XI_VMATH_INLINE int64_t to_bits(double x)
+        {
+            int64_t b;
+            std::memcpy(&b, &x, sizeof(b));
+            return b;
+        }
+
+        XI_VMATH_INLINE double from_bits(int64_t b)
+        {
+            double x;
+            std::memcpy(&x, &b, sizeof(x));
+            return x;
+        }
+
+        /*
+            c ? a : b on the bit patterns, GCC sinks the arithmetic feeding a plain ?: into its arms
+            and then (under the default -ftrapping-math) refuses to if-convert them
+        */
+        XI_VMATH_INLINE double select_mask(int64_t mask, double a, double b)
+        {
+            return from_bits((to_bits(a) & mask) | (to_bits(b) & ~mask));
+        }
+
+        XI_VMATH_INLINE double select(bool c, double a, double b)
+        {
+            return select_mask(-static_cast<int64_t>(c), a, b);
+        }
+
+        /*
+            Rounds to the nearest integer (ties to even) for | x | < 2^51
+        */
+        XI_VMATH_INLINE double round_even(double x)
+        {
+            return (x + shifter) - shifter;
+        }
+
+        /*
+            2^k for integral -1022 <= k <= 1023: the low bits of k + 1023 + shifter are k + 1023,
+            shifting them into the exponent field drops everything else
+            Exponents stay in doubles throughout, AVX2 has no 64 bit arithmetic shifts or conversions
+        */
+        XI_VMATH_INLINE double exp2i(double k)
+        {
+            return from_bits(static_cast<int64_t>(static_cast<uint64_t>(to_bits(k + (shifter + 1023.0))) << 52));
+        }
+
+        /*
+            p * 2^k in two steps so that results in the subnormal range round only once
+        */
+        XI_VMATH_INLINE double scale(double p, double k)
+        {
+            const double half = round_even(0.5 * k);
+            return p * exp2i(half) * exp2i(k - half);
+        }
+
+        /*
+            Exact product a * b = hi + lo, with a fused multiply-add when the target has one
+            and by Dekker's splitting otherwise
+        */
+        template <bool Fma>
+        XI_VMATH_INLINE double product_error(double a, double b, double hi)
+        {
+            if constexpr (Fma)
+            {
+                return std::fma(a, b, -hi);
+            }
+            else
+            {
+                constexpr double split = 134217729.0;
+                const double ca = split * a, cb = split * b;
+                const double ah = ca - (ca - a), bh = cb - (cb - b);
+                const double al = a - ah, bl = b - bh;
+                return ((ah * bh - hi) + ah * bl + al * bh) + al * bl;
+            }
+        }
+
+        /*
+            e^x = 2^k (1 + q), | r | <= ln2 / 2 after the reduction, the Taylor polynomial of
+            degree 13 leaves a truncation error below 2^-57
+        */
+        XI_VMATH_INLINE double exp_reduce(double x, double& k)
+        {
+            k = round_even(x * log2e_hi);
+            const double r = (x - k * ln2_hi) - k * ln2_lo;
+            return r + r * r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 +
+                r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880 + r * (1.0 / 3628800 +
+                r * (1.0 / 39916800 + r * (1.0 / 479001600 + r * (1.0 / 6227020800.0))))))))))));
+        }
+
+        /*
+            Reduces a positive normal x to x = 2^e (1 + f) with sqrt(2) / 2 <= 1 + f < sqrt(2),
+            returns f and e as a double
+            Subtracting the bits of sqrt(2) / 2 moves the mantissa boundary to where the exponent
+            field changes, so e and 1 + f come out of integer adds and masks without a select
+        */
+        XI_VMATH_INLINE double log_reduce(double x, double& e)
+        {
+            constexpr int64_t offset = 0x3fe6a09e667f3bcdLL;
+            constexpr int64_t one = 0x3ff0000000000000LL;
+
+            const int64_t b = to_bits(x);
+            const int64_t t = b - offset;
+            const uint64_t biased = static_cast<uint64_t>(t + one) >> 52;
+
+            e = from_bits(static_cast<int64_t>(biased) + to_bits(shifter)) - (shifter + 1023.0);
+            return from_bits(b - (t & static_cast<int64_t>(0xfff0000000000000ULL))) - 1.0;
+        }
+
+        /*
+            fdlibm's R(z) for log(1 + f) = f - f^2 / 2 + s (f^2 / 2 + R), s = f / (2 + f), z = s^2
+        */
+        XI_VMATH_INLINE double log_tail(double z)
+        {
+            const double w = z * z;
+            const double t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+            const double t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 +
+                w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+            return t1 + t2;
+        }
+
+        XI_VMATH_INLINE double exp_kernel(double x)
+        {
+            double k;
+            const double q = exp_reduce(x, k);
+            return scale(1.0 + q, k);
+        }
+
+        XI_VMATH_INLINE double log_kernel(double x)
+        {
+            double e;
+            const double f = log_reduce(x, e);
+            const double s = f / (2.0 + f);
+            const double hfsq = 0.5 * f * f;
+            const double r = log_tail(s * s);
+            return e * ln2_hi - ((hfsq - (s * (hfsq + r) + e * ln2_lo)) - f);
+        }
+
+        /*
+            sin (Cosine = false) or cos (Cosine = true) for | x | <= trig_limit
+            The reduced argument is carried as r + r_lo, the tail enters through the first order terms
+        */
+        template <bool Cosine>
+        XI_VMATH_INLINE double trig_kernel(double x)
+        {
+            const double t = x * two_over_pi + shifter;
+            const double k = t - shifter;
+            const int64_t quadrant = to_bits(t) + (Cosine ? 1 : 0);     // low bits of t are those of k
+
+            const double a = x - k * pio2_1;
+            const double w = k * pio2_2;
+            const double b = a - w;
+            const double bb = b - a;
+            const double b_lo = (a - (b - bb)) - (w + bb);
+            const double c = b_lo - (k * pio2_3 + k * pio2_3t);
+            const double r = b + c;
+            const double r_lo = (b - r) + c;
+            const double z = r * r;
+
+            const double sin_r = r + (r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+                z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+                z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10))))) + r_lo * (1.0 - 0.5 * z));
+
+            const double hz = 0.5 * z;
+            const double v = 1.0 - hz;
+            const double cos_r = v + ((((1.0 - v) - hz) + z * z * (4.16666666666666019037e-02 +
+                z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 +
+                z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 +
+                z * -1.13596475577881948265e-11)))))) - r * r_lo);
+
+            const double folded = select_mask(-(quadrant & 1), cos_r, sin_r);
+            const double result = from_bits(to_bits(folded) ^ static_cast<int64_t>(static_cast<uint64_t>(quadrant & 2) << 62));
+            return Cosine ? result : select(x == 0.0, x, result);
+        }
+
+        /*
+            tanh(x) = u / (u + 2) with u = e^2|x| - 1, which has no cancellation near zero
+        */
+        XI_VMATH_INLINE double tanh_kernel(double x)
+        {
+            const double a = std::fabs(x);
+
+            double k;
+            const double q = exp_reduce(2.0 * a, k);
+            const double s = exp2i(k);
+            const double u = s * q + (s - 1.0);
+            return std::copysign(select(a < 22.0, u / (u + 2.0), 1.0), x);
+        }
+
+        /*
+            x^y = 2^(y log2 x) for positive normal x and finite y
+            log(1 + f) = 2 atanh(s) is summed in double-double: 2s and 2s^3 / 3 exactly, the rest
+            of the series in double, then y log2 x keeps the rounding error of its product and only
+            the fraction of the exponent goes through exp_reduce
+        */
+        template <bool Fma>
+        XI_VMATH_INLINE double pow_kernel(double x, double y)
+        {
+            constexpr double two_thirds_hi = 6.66666666666666629659e-01;
+            constexpr double two_thirds_lo = 3.70074341541718826e-17;
+
+            double e;
+            const double f = log_reduce(x, e);
+
+            const double d = 2.0 + f;
+            const double d_lo = (2.0 - d) + f;
+            const double s = f / d;
+            const double sd = s * d;
+            const double s_lo = (((f - sd) - product_error<Fma>(s, d, sd)) - s * d_lo) / d;
+
+            const double z = s * s;
+            const double z_lo = product_error<Fma>(s, s, z) + 2.0 * s * s_lo;
+            const double c = z * s;
+            const double c_lo = product_error<Fma>(z, s, c) + (z_lo * s + z * s_lo);
+            const double u = c * two_thirds_hi;
+            const double u_lo = product_error<Fma>(c, two_thirds_hi, u) + (c_lo * two_thirds_hi + c * two_thirds_lo);
+            const double rest = c * z * (2.0 / 5 + z * (2.0 / 7 + z * (2.0 / 9 + z * (2.0 / 11 + z * (2.0 / 13 +
+                z * (2.0 / 15 + z * (2.0 / 17 + z * (2.0 / 19 + z * (2.0 / 21 + z * (2.0 / 23 + z * (2.0 / 25)))))))))));
+
+            const double l_hi = 2.0 * s + u;
+            const double l_lo = ((2.0 * s - l_hi) + u) + (2.0 * s_lo + u_lo + rest);
+
+            const double m_hi = l_hi * log2e_hi;
+            const double m_lo = product_error<Fma>(l_hi, log2e_hi, m_hi) + (l_lo * log2e_hi + l_hi * log2e_lo);
+            const double g_hi = e + m_hi;
+            const double g_lo = ((e - g_hi) + m_hi) + m_lo;
+
+            double p = y * g_hi;
+            double p_lo = product_error<Fma>(y, g_hi, p) + y * g_lo;
+
+            const bool saturated = !(std::fabs(p) < 2000.0);
+            p = select(saturated, std::copysign(2000.0, p), p);
+            p_lo = select(saturated, 0.0, p_lo);
+
+            const double k = round_even(p);
+            double j;
+            const double q = exp_reduce(((p - k) + p_lo) * ln2, j);
+            return scale(1.0 + q, k + j);
+        }
+
+        /*
+            Arguments the kernels handle, everything else goes to the std:: function
+        */
+        XI_VMATH_INLINE bool positive_normal(double x)
+        {
+            return x >= std::numeric_limits<double>::min() && x <= std::numeric_limits<double>::max();
+        }
+
+        template <Function F>
+        struct Unary;
+
+        template <>
+        struct Unary<Function::EXP>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return exp_kernel(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return x >= -746.0 && x <= 710.0; }
+            template <typename T> static T reference(T x) { return std::exp(x); }
+        };
+
+        template <>
+        struct Unary<Function::LOG>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return log_kernel(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return positive_normal(x); }
+            template <typename T> static T reference(T x) { return std::log(x); }
+        };
+
+        template <>
+        struct Unary<Function::SIN>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return trig_kernel<false>(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return std::fabs(x) <= trig_limit; }
+            template <typename T> static T reference(T x) { return std::sin(x); }
+        };
+
+        template <>
+        struct Unary<Function::COS>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return trig_kernel<true>(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return std::fabs(x) <= trig_limit; }
+            template <typename T> static T reference(T x) { return std::cos(x); }
+        };
+
+        template <>
+        struct Unary<Function::TANH>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return tanh_kernel(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return x == x; }
+            template <typename T> static T reference(T x) { return std::tanh(x); }
+        };
+
+        template <>
+        struct Unary<Function::SQRT>
+        {
+            XI_VMATH_INLINE static double eval(double x) { return std::sqrt(x); }
+            XI_VMATH_INLINE static bool in_range(double x) { return x >= 0.0; }
+            template <typename T> static T reference(T x) { return std::sqrt(x); }
+        };
+
+        /*
+            One block: count the arguments outside the kernel's range, run the vector loop when there
+            are none and pick per element otherwise (in place calls must not lose the input first)
+        */
+        template <Function F, typename T>
+        XI_VMATH_INLINE void unary_block(const T* x, T* out, size_t n)
+        {
+            using K = Unary<F>;
+
+            if constexpr (std::is_same<T, float>::value)
+            {
+                double wide[block];
+                for (size_t i = 0; i < n; ++i) wide[i] = x[i];
+                unary_block<F>(wide, wide, n);
+                for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(wide[i]);
+                return;
+            }
+
+            size_t outside = 0;
+            #pragma omp simd reduction(+ : outside)
+            for (size_t i = 0; i < n; ++i)
+            {
+                outside += K::in_range(static_cast<double>(x[i])) ? 0 : 1;
+            }
+
+            if (outside == 0)
+            {
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = static_cast<T>(K::eval(static_cast<double>(x[i])));
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double v = static_cast<double>(x[i]);
+                out[i] = static_cast<T>(K::in_range(v) ? K::eval(v) : K::reference(v));
+            }
+        }
+
+        template <Function F, typename T>
+        XI_VMATH_INLINE void unary_loop(const T* x, T* out, size_t n)
+        {
+            for (size_t b = 0; b < n; b += block)
+            {
+                unary_block<F>(x + b, out + b, std::min(block, n - b));
+            }
+        }
+
+        /*
+            x^y over a block, [ y_stride ] is 0 for a single exponent
+        */
+        template <bool Fma, typename T>
+        XI_VMATH_INLINE void pow_block(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+            if constexpr (std::is_same<T, float>::value)
+            {
+                double wide_x[block], wide_y[block];
+                for (size_t i = 0; i < n; ++i) wide_x[i] = x[i];
+                for (size_t i = 0; i < n; ++i) wide_y[i] = y[i * y_stride];
+                pow_block<Fma>(wide_x, wide_y, 1, wide_x, n);
+                for (size_t i = 0; i < n; ++i) out[i] = static_cast<float>(wide_x[i]);
+                return;
+            }
+
+            size_t outside = 0;
+            #pragma omp simd reduction(+ : outside)
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double yi = static_cast<double>(y[i * y_stride]);
+                outside += positive_normal(static_cast<double>(x[i])) && std::fabs(yi) <= std::numeric_limits<double>::max() ? 0 : 1;
+            }
+
+            if (outside == 0)
+            {
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = static_cast<T>(pow_kernel<Fma>(static_cast<double>(x[i]), static_cast<double>(y[i * y_stride])));
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double xi = static_cast<double>(x[i]);
+                const double yi = static_cast<double>(y[i * y_stride]);
+                const bool fast = positive_normal(xi) && std::fabs(yi) <= std::numeric_limits<double>::max();
+                out[i] = static_cast<T>(fast ? pow_kernel<Fma>(xi, yi) : std::pow(xi, yi));
+            }
+        }
+
+        template <bool Fma, typename T>
+        XI_VMATH_INLINE void pow_loop(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+            for (size_t b = 0; b < n; b += block)
+            {
+                pow_block<Fma>(x + b, y + b * y_stride, y_stride, out + b, std::min(block, n - b));
+            }
+        }
+
+        /*
+            One instantiation of the loops per instruction set, the kernels are force inlined so
+            they are vectorized for the target of the function they end up in
+            Baseline x86 (SSE2) lacks the 64 bit compares the sin and pow kernels need to vectorize,
+            scalar they lose to libm, so there they are just std::sin and std::pow
+        */
+        template <Function F, typename T>
+        void unary_generic(const T* x, T* out, size_t n)
+        {
+#if XI_VMATH_DISPATCH
+            if constexpr (F == Function::SIN)
+            {
+                for (size_t i = 0; i < n; ++i) out[i] = Unary<F>::reference(x[i]);
+                return;
+            }
+#endif
+            unary_loop<F>(x, out, n);
+        }
+
+        template <typename T>
+        void pow_generic(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+#if XI_VMATH_DISPATCH
+            for (size_t i = 0; i < n; ++i) out[i] = static_cast<T>(std::pow(x[i], y[i * y_stride]));
+#else
+            pow_loop<false>(x, y, y_stride, out, n);
+#endif
+        }
+
+#if XI_VMATH_DISPATCH
+        /*
+            sqrt is the hardware instruction, GCC keeps std::sqrt scalar to preserve errno
+            (the zero-masked AVX-512 forms avoid a -Wmaybe-uninitialized false positive in GCC 12)
+        */
+        template <typename T>
+        __attribute__((target("avx2,fma"))) inline void sqrt_avx2(const T* x, T* out, size_t n)
+        {
+            size_t i = 0;
+            if constexpr (std::is_same<T, double>::value)
+            {
+                for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_loadu_pd(x + i)));
+            }
+            else
+            {
+                for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_loadu_ps(x + i)));
+            }
+            for (; i < n; ++i) out[i] = std::sqrt(x[i]);
+        }
+
+        template <typename T>
+        __attribute__((target("avx512f,avx512dq,avx2,fma"))) inline void sqrt_avx512(const T* x, T* out, size_t n)
+        {
+            size_t i = 0;
+            if constexpr (std::is_same<T, double>::value)
+            {
+                for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_maskz_sqrt_pd(0xff, _mm512_loadu_pd(x + i)));
+            }
+            else
+            {
+                for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, _mm512_maskz_sqrt_ps(0xffff, _mm512_loadu_ps(x + i)));
+            }
+            for (; i < n; ++i) out[i] = std::sqrt(x[i]);
+        }
+
+        template <Function F, typename T>
+        __attribute__((target("avx2,fma"))) void unary_avx2(const T* x, T* out, size_t n)
+        {
+            if constexpr (F == Function::SQRT) sqrt_avx2(x, out, n);
+            else unary_loop<F>(x, out, n);
+        }
+
+        template <typename T>
+        __attribute__((target("avx2,fma"))) void pow_avx2(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+            pow_loop<true>(x, y, y_stride, out, n);
+        }
+
+        template <Function F, typename T>
+        __attribute__((target("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")))
+        void unary_avx512(const T* x, T* out, size_t n)
+        {
+            if constexpr (F == Function::SQRT) sqrt_avx512(x, out, n);
+            else unary_loop<F>(x, out, n);
+        }
+
+        template <typename T>
+        __attribute__((target("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")))
+        void pow_avx512(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+            pow_loop<true>(x, y, y_stride, out, n);
+        }
+#endif
+
+        inline Isa detect_isa()
+        {
+#if XI_VMATH_DISPATCH
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return Isa::AVX512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::AVX2;
+#endif
+            return Isa::GENERIC;
+        }
+
+        inline std::atomic<Isa>& isa_state()
+        {
+            static std::atomic<Isa> state{ detect_isa() };
+            return state;
+        }
+
+        template <typename T>
+        inline constexpr bool vectorized = std::is_same<T, float>::value || std::is_same<T, double>::value;
+    }
+
+    /*
+        Instruction set the kernels currently run on
+    */
+    inline Isa isa() { return detail::isa_state().load(std::memory_order_relaxed); }
+
+    /*
+        Runs the kernels on [ requested ] or the widest supported instruction set below it,
+        returns the one actually selected
+    */
+    inline Isa set_isa(Isa requested)
+    {
+        const Isa selected = std::min(requested, detail::detect_isa());
+        detail::isa_state().store(selected, std::memory_order_relaxed);
+        return selected;
+    }
+
+    inline const char* isa_name(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::AVX512: return "avx512";
+            case Isa::AVX2: return "avx2";
+            default: return "generic";
+        }
+    }
+
+    namespace detail
+    {
+        template <Function F, typename T>
+        inline void dispatch(const T* x, T* out, size_t n)
+        {
+            if constexpr (!vectorized<T>)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = Unary<F>::reference(x[i]);
+                }
+            }
+            else
+            {
+                switch (isa())
+                {
+#if XI_VMATH_DISPATCH
+                    case Isa::AVX512: unary_avx512<F>(x, out, n); return;
+                    case Isa::AVX2: unary_avx2<F>(x, out, n); return;
+#endif
+                    default: unary_generic<F>(x, out, n); return;
+                }
+            }
+        }
+
+        template <typename T>
+        inline void dispatch_pow(const T* x, const T* y, size_t y_stride, T* out, size_t n)
+        {
+            if constexpr (!vectorized<T>)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = std::pow(x[i], y[i * y_stride]);
+                }
+            }
+            else
+            {
+                switch (isa())
+                {
+#if XI_VMATH_DISPATCH
+                    case Isa::AVX512: pow_avx512(x, y, y_stride, out, n); return;
+                    case Isa::AVX2: pow_avx2(x, y, y_stride, out, n); return;
+#endif
+                    default: pow_generic(x, y, y_stride, out, n); return;
+                }
+            }
+        }
+
+        template <typename T>
+        inline void run(Function f, const T* x, T* out, size_t n)
+        {
+            switch (f)
+            {
+                case Function::EXP: dispatch<Function::EXP>(x, out, n); return;
+                case Function::LOG: dispatch<Function::LOG>(x, out, n); return;
+                case Function::SIN: dispatch<Function::SIN>(x, out, n); return;
+                case Function::COS: dispatch<Function::COS>(x, out, n); return;
+                case Function::TANH: dispatch<Function::TANH>(x, out, n); return;
+                case Function::SQRT: dispatch<Function::SQRT>(x, out, n); return;
+            }
+        }
+
+        /*
+            Elements per parallel_for chunk, arrays below it stay on the calling thread
+        */
+        inline constexpr size_t grain = size_t(1) << 15;
+    }
+
+    /*
+        out[i] = f(x[i]) for i < n, [ out ] may be [ x ] itself but must not partially overlap it
+    */
+    template <typename T>
+    inline std::enable_if_t<std::is_floating_point<T>::value> apply(Function f, const T* x, T* out, size_t n)
+    {
+        xi_parallel::parallel_for(0, n, detail::grain, [&](size_t first, size_t last) {
+            detail::run(f, x + first, out + first, last - first);
+        });
+    }
+
+    template <typename T>
+    inline std::enable_if_t<std::is_floating_point<T>::value, std::vector<T>> apply(Function f, const std::vector<T>& x)
+    {
+        std::vector<T> out(x.size());
+        xi_vmath::apply(f, x.data(), out.data(), x.size());
+        return out;
+    }
+
+    /*
+        out = f(m) element-wise, [ out ] has the shape of [ m ] and may be [ m ] itself
+    */
+    template <typename M, typename Out>
+    inline std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value> apply(Function f, const M& m, Out&& out)
+    {
+        using T = xi_matrix::detail::value_type_t<M>;
+        static_assert(std::is_floating_point<T>::value, "xi_vmath needs floating point elements");
+
+        auto a = xi_matrix::detail::as_view(m);
+        auto o = xi_matrix::detail::as_mutable_view(out);
+        static_assert(std::is_same<typename decltype(o)::value_type, T>::value, "Output must have the element type of the input");
+        assert(a.rows() == o.rows() && a.cols() == o.cols() && "Matrix dimensions must match for element-wise operations");
+
+        const size_t cols = a.cols();
+        const bool unit = a.col_stride() == 1 && o.col_stride() == 1;
+        const size_t rows_per_chunk = std::max<size_t>(1, detail::grain / std::max<size_t>(1, cols));
+
+        xi_parallel::parallel_for(0, a.rows(), rows_per_chunk, [&](size_t first, size_t last) {
+            std::vector<T> row(unit ? 0 : cols);
+            for (size_t i = first; i < last; ++i)
+            {
+                const T* in = a.data() + static_cast<std::ptrdiff_t>(i) * a.row_stride();
+                T* po = o.data() + static_cast<std::ptrdiff_t>(i) * o.row_stride();
+                if (unit)
+                {
+                    detail::run(f, in, po, cols);
+                    continue;
+                }
+
+                for (size_t j = 0; j < cols; ++j) row[j] = in[static_cast<std::ptrdiff_t>(j) * a.col_stride()];
+                detail::run(f, row.data(), row.data(), cols);
+                for (size_t j = 0; j < cols; ++j) po[static_cast<std::ptrdiff_t>(j) * o.col_stride()] = row[j];
+            }
+        });
+    }
+
+    template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value>>
+    inline xi_matrix::Matrix_Numerical<xi_matrix::detail::value_type_t<M>> apply(Function f, const M& m)
+    {
+        auto a = xi_matrix::detail::as_view(m);
+        xi_matrix::Matrix_Numerical<xi_matrix::detail::value_type_t<M>> out(a.rows(), a.cols());
+        xi_vmath::apply(f, m, out);
+        return out;
+    }
+
+    /*
+        Named forms of apply, for arrays (x, out, n), vectors and matrices (m, out) or (m)
+    */
+    template <typename... Args>
+    inline auto exp(Args&&... args) { return xi_vmath::apply(Function::EXP, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    inline auto log(Args&&... args) { return xi_vmath::apply(Function::LOG, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    inline auto sin(Args&&... args) { return xi_vmath::apply(Function::SIN, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    inline auto cos(Args&&... args) { return xi_vmath::apply(Function::COS, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    inline auto tanh(Args&&... args) { return xi_vmath::apply(Function::TANH, std::forward<Args>(args)...); }
+
+    template <typename... Args>
+    inline auto sqrt(Args&&... args) { return xi_vmath::apply(Function::SQRT, std::forward<Args>(args)...); }
+
+    /*
+        out[i] = x[i]^y[i], [ out ] may be [ x ] or [ y ] itself
+    */
+    template <typename T>
+    inline std::enable_if_t<std::is_floating_point<T>::value> pow(const T* x, const T* y, T* out, size_t n)
+    {
+        xi_parallel::parallel_for(0, n, detail::grain, [&](size_t first, size_t last) {
+            detail::dispatch_pow(x + first, y + first, 1, out + first, last - first);
+        });
+    }
+
+    /*
+        out[i] = x[i]^y
+    */
+    template <typename T>
+    inline std::enable_if_t<std::is_floating_point<T>::value> pow(const T* x, T y, T* out, size_t n)
+    {
+        xi_parallel::parallel_for(0, n, detail::grain, [&](size_t first, size_t last) {
+            detail::dispatch_pow(x + first, &y, 0, out + first, last - first);
+        });
+    }
+
+    /*
+        out(i, j) = m(i, j)^y element-wise (xi_matrix::pow is the matrix power), [ out ] may be [ m ] itself
+    */
+    template <typename M, typename Out>
+    inline std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value>
+    pow(const M& m, xi_matrix::detail::value_type_t<M> y, Out&& out)
+    {
+        using T = xi_matrix::detail::value_type_t<M>;
+        static_assert(std::is_floating_point<T>::value, "xi_vmath needs floating point elements");
+
+        auto a = xi_matrix::detail::as_view(m);
+        auto o = xi_matrix::detail::as_mutable_view(out);
+        static_assert(std::is_same<typename decltype(o)::value_type, T>::value, "Output must have the element type of the input");
+        assert(a.rows() == o.rows() && a.cols() == o.cols() && "Matrix dimensions must match for element-wise operations");
+
+        const size_t cols = a.cols();
+        const bool unit = a.col_stride() == 1 && o.col_stride() == 1;
+        const size_t rows_per_chunk = std::max<size_t>(1, detail::grain / std::max<size_t>(1, cols));
+
+        xi_parallel::parallel_for(0, a.rows(), rows_per_chunk, [&](size_t first, size_t last) {
+            std::vector<T> row(unit ? 0 : cols);
+            for (size_t i = first; i < last; ++i)
+            {
+                const T* in = a.data() + static_cast<std::ptrdiff_t>(i) * a.row_stride();
+                T* po = o.data() + static_cast<std::ptrdiff_t>(i) * o.row_stride();
+                if (unit)
+                {
+                    detail::dispatch_pow(in, &y, 0, po, cols);
+                    continue;
+                }
+
+                for (size_t j = 0; j < cols; ++j) row[j] = in[static_cast<std::ptrdiff_t>(j) * a.col_stride()];
+                detail::dispatch_pow(row.data(), &y, 0, row.data(), cols);
+                for (size_t j = 0; j < cols; ++j) po[static_cast<std::ptrdiff_t>(j) * o.col_stride()] = row[j];
+            }
+        });
+    }
+
+    template <typename M, typename = std::enable_if_t<xi_matrix::detail::is_matrix_like<M>::value>>
+    inline xi_matrix::Matrix_Numerical<xi_matrix::detail::value_type_t<M>> pow(const M& m, xi_matrix::detail::value_type_t<M> y)
+    {
+        auto a = xi_matrix::detail::as_view(m);
+        xi_matrix::Matrix_Numerical<xi_matrix::detail::value_type_t<M>> out(a.rows(), a.cols());
+        xi_vmath::pow(m, y, out);
+        return out;
+    }
+}
+
+#undef XI_VMATH_INLINE
+#undef XI_VMATH_DISPATCH
+
+#endif
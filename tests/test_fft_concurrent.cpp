@@ -0,0 +1,52 @@
+#include "fft.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+/*
+    Transforms started from pool tasks: a thread waiting inside one transform's parallel_for
+    picks up the next task and starts another transform on the same thread
+*/
+int main()
+{
+    xi_parallel::configure({ 4 });
+
+    const size_t n = size_t(1) << 16;
+    const size_t transforms = 64;
+
+    std::vector<std::vector<std::complex<double>>> input(transforms), output(transforms);
+    for (size_t t = 0; t < transforms; ++t)
+    {
+        input[t].resize(n);
+        for (size_t j = 0; j < n; ++j)
+            input[t][j] = { std::sin(0.001 * static_cast<double>(j * (t + 1))), std::cos(0.003 * static_cast<double>(j + t)) };
+    }
+
+    for (int run = 0; run < 10; ++run)
+    {
+        xi_parallel::TaskGroup group;
+        for (size_t t = 0; t < transforms; ++t)
+            group.run([&, t]() { output[t] = xi_fft::fft(input[t]); });
+        group.wait();
+
+        for (size_t t = 0; t < transforms; ++t)
+        {
+            const std::vector<std::complex<double>> expected = xi_fft::fft(input[t]);
+            double error = 0;
+            for (size_t k = 0; k < n; ++k) error = std::max(error, std::abs(output[t][k] - expected[k]));
+            if (error > 1e-9)
+            {
+                std::printf("run %d, transform %zu: max error %g\n", run, t, error);
+                return 1;
+            }
+        }
+    }
+
+    std::printf("ok\n");
+    return 0;
+}
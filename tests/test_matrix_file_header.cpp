@@ -0,0 +1,93 @@
+#include "matrix_io.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+/*
+    Headers with a misaligned data offset or sizes that overflow are rejected before any element
+    is read, a valid file still maps
+*/
+namespace
+{
+    const std::string path = "xi_test_matrix_file_header.xim";
+
+    xi_matrix::MatrixFileHeader saved_header()
+    {
+        xi_matrix::Matrix<double> m(3, 4);
+        for (size_t i = 0; i < 3; ++i)
+            for (size_t j = 0; j < 4; ++j) m(i, j) = static_cast<double>(i * 4 + j);
+        xi_matrix::save_binary(path, m);
+        return xi_matrix::map_binary<double>(path).header();
+    }
+
+    void write_header(const xi_matrix::MatrixFileHeader& header)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fclose(file);
+    }
+
+    bool rejected()
+    {
+        try
+        {
+            xi_matrix::map_binary<double>(path);
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+}
+
+int main()
+{
+    const xi_matrix::MatrixFileHeader valid = saved_header();
+    int failures = 0;
+
+    if (xi_matrix::map_binary<double>(path).rows() != 3 || rejected())
+    {
+        std::printf("valid file was not mapped\n");
+        ++failures;
+    }
+
+    xi_matrix::MatrixFileHeader header = valid;
+    header.rows = 2;                    // leaves the data after the offset in range
+    header.data_offset += 4;
+    write_header(header);
+    if (!rejected())
+    {
+        std::printf("misaligned data offset accepted\n");
+        ++failures;
+    }
+
+    header = valid;
+    header.rows = (uint64_t(1) << 32) + 1;
+    header.cols = uint64_t(1) << 32;
+    header.row_stride = 0;
+    header.col_stride = 0;
+    write_header(header);
+    if (!rejected())
+    {
+        std::printf("overflowing rows * cols accepted\n");
+        ++failures;
+    }
+
+    header = valid;
+    header.rows = (uint64_t(1) << 61) + 1;
+    header.cols = 1;
+    header.row_stride = 8;              // (rows - 1) * row_stride wraps to 0
+    write_header(header);
+    if (!rejected())
+    {
+        std::printf("overflowing stride accepted\n");
+        ++failures;
+    }
+
+    std::remove(path.c_str());
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include "roots.h"
+
+#include <cstdio>
+#include <vector>
+
+/*
+    A root found to the rounding floor of |F|, where the line search cannot decrease the residual
+    any further, is reported as converged; a system without a root is not
+*/
+int main()
+{
+    auto circle = [](const std::vector<double>& v) { return std::vector<double>{ v[0] * v[0] + v[1] * v[1] - 4, v[0] - v[1] }; };
+    const auto found = xi_roots::newton_krylov(circle, std::vector<double>{ 1, 0.5 });
+    if (!found.converged || found.residual > 1e-12)
+    {
+        std::printf("circle: converged %d, residual %g\n", static_cast<int>(found.converged), found.residual);
+        return 1;
+    }
+
+    auto rootless = [](const std::vector<double>& v) { return std::vector<double>{ v[0] * v[0] + 1, v[1] }; };
+    const auto missed = xi_roots::newton_krylov(rootless, std::vector<double>{ 1, 0.5 });
+    if (missed.converged)
+    {
+        std::printf("x^2 + 1 reported converged, residual %g\n", missed.residual);
+        return 1;
+    }
+
+    std::printf("ok\n");
+    return 0;
+}
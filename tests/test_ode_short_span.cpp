@@ -0,0 +1,41 @@
+#include "ode.h"
+
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+/*
+    Spans far shorter than 1 or than the start time are integrated instead of reported as a step
+    size underflow
+*/
+int main()
+{
+    auto decay = [](double, const std::vector<double>& y, std::vector<double>& dydt) { dydt[0] = -y[0]; };
+    const double spans[][2] = { { 0.0, 1e-16 }, { 1e6, 1e6 + 1e-9 }, { 1.0, 1.0 - 1e-14 } };
+
+    int failures = 0;
+    for (const auto& span : spans)
+    {
+        const double expected = std::exp(-(span[1] - span[0]));
+        try
+        {
+            const auto explicit_solution = xi_ode::dopri5(decay, span[0], span[1], std::vector<double>{ 1.0 });
+            const auto stiff_solution = xi_ode::rosenbrock23(decay, span[0], span[1], std::vector<double>{ 1.0 });
+            const double a = explicit_solution.y.back(), b = stiff_solution.y.back();
+            if (std::fabs(a - expected) > 1e-12 || std::fabs(b - expected) > 1e-12)
+            {
+                std::printf("[%g, %.17g]: dopri5 %.17g, rosenbrock23 %.17g\n", span[0], span[1], a, b);
+                ++failures;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("[%g, %.17g]: %s\n", span[0], span[1], e.what());
+            ++failures;
+        }
+    }
+
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
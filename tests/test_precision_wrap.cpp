@@ -0,0 +1,28 @@
+#include "precision.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+    int16 products summed past 2^31 wrap around the same way in the scalar and the SIMD kernel
+*/
+int main()
+{
+    const size_t n = 4099;
+    std::vector<int16_t> x(n, INT16_MIN), y(n, INT16_MIN);
+
+    uint32_t expected = 0;
+    for (size_t i = 0; i < n; ++i) expected += uint32_t(1) << 30;
+
+    const int32_t scalar = xi_matrix::detail::dot_scalar<xi_matrix::Int16Accumulate32>(x.data(), y.data(), n);
+    const int32_t kernel = xi_matrix::precision_dot<xi_matrix::Int16Accumulate32>(x.data(), y.data(), n);
+    if (scalar != static_cast<int32_t>(expected) || kernel != scalar)
+    {
+        std::printf("scalar %d, kernel %d, expected %d\n", scalar, kernel, static_cast<int32_t>(expected));
+        return 1;
+    }
+
+    std::printf("ok\n");
+    return 0;
+}
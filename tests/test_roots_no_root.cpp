@@ -0,0 +1,40 @@
+#include "roots.h"
+
+#include <cmath>
+#include <cstdio>
+
+/*
+    newton() and halley() on functions without a real root must not report convergence at the
+    minimum of |f|, and still converge on a simple root
+*/
+int main()
+{
+    int failures = 0;
+    auto expect = [&](const char* name, const xi_roots::RootResult& r, bool converged) {
+        if (r.converged != converged)
+        {
+            std::printf("%s: converged %d at %Lg, f = %Lg\n", name, static_cast<int>(r.converged), r.root, r.value);
+            ++failures;
+        }
+    };
+
+    auto lifted = [](long double x) { return (x - 1) * (x - 1) + 1e-6L; };
+    auto shifted = [](long double x) { return x * x + 1; };
+    auto sqrt2 = [](long double x) { return x * x - 2; };
+
+    expect("halley, (x - 1)^2 + 1e-6", xi_roots::halley(lifted, 1.5L), false);
+    expect("newton, (x - 1)^2 + 1e-6", xi_roots::newton(lifted, 1.5L), false);
+    expect("halley, x^2 + 1", xi_roots::halley(shifted, 0.5L), false);
+    expect("newton, x^2 + 1", xi_roots::newton(shifted, 0.5L), false);
+
+    const auto root = xi_roots::halley(sqrt2, 1.0L);
+    expect("halley, x^2 - 2", root, true);
+    if (std::fabs(root.root - std::sqrt(2.0L)) > 1e-15L)
+    {
+        std::printf("halley, x^2 - 2: root %Lg\n", root.root);
+        ++failures;
+    }
+
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
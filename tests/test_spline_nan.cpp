@@ -0,0 +1,44 @@
+#include "spline.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+/*
+    NaN arguments on the uniform grid fast path evaluate to NaN instead of indexing out of bounds
+*/
+int main()
+{
+    std::vector<double> x(11), y(11);
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        x[i] = 0.5 * static_cast<double>(i);
+        y[i] = std::sin(x[i]);
+    }
+    const auto spline = xi_spline::cubic_spline(x, y);
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> values = { 1.25, nan, -1.0, nan, 7.5 };
+    const std::vector<double> batch = spline(values);
+
+    int failures = 0;
+    if (!spline.uniform())
+    {
+        std::printf("grid was not detected as uniform\n");
+        ++failures;
+    }
+    if (!std::isnan(spline(nan)) || !std::isnan(batch[1]) || !std::isnan(batch[3]))
+    {
+        std::printf("NaN argument did not evaluate to NaN\n");
+        ++failures;
+    }
+    if (std::fabs(batch[0] - spline(1.25)) > 1e-15 || std::isnan(batch[2]) || std::isnan(batch[4]))
+    {
+        std::printf("finite arguments next to NaNs changed\n");
+        ++failures;
+    }
+
+    if (failures == 0) std::printf("ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#include "tiled.h"
+
+#include <cstdio>
+#include <string>
+
+/*
+    Writes made through a MutableTile after a flush() must survive the eviction of the tile
+*/
+int main()
+{
+    const std::string path = "xi_test_tiled_flush.xit";
+
+    xi_matrix::TiledOptions options;
+    options.tile_rows = 4;
+    options.tile_cols = 4;
+    options.memory_budget = 4 * 4 * sizeof(double);    // one tile, loading another evicts it
+    options.prefetch_depth = 0;
+
+    double value = 0;
+    {
+        xi_matrix::TiledMatrix<double> A(path, 8, 8, options);
+        {
+            auto tile = A.write_tile(0, 0);
+            tile.view()(0, 0) = 1;
+            A.flush();
+            tile.view()(0, 0) = 2;
+        }
+        { auto other = A.read_tile(1, 1); }
+        value = A.at(0, 0);
+    }
+    std::remove(path.c_str());
+
+    if (value != 2)
+    {
+        std::printf("element after eviction is %g, expected 2\n", value);
+        return 1;
+    }
+
+    std::printf("ok\n");
+    return 0;
+}